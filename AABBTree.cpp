@@ -0,0 +1,317 @@
+#include "AABBTree.hpp"
+
+#include <algorithm>
+#include <limits>
+
+//helpers:
+static AABBTree::Box merge(AABBTree::Box const &a, AABBTree::Box const &b) {
+	AABBTree::Box ret;
+	ret.min = glm::min(a.min, b.min);
+	ret.max = glm::max(a.max, b.max);
+	return ret;
+}
+
+//(half) surface area, the cost of a box in the insertion heuristic:
+static float area(AABBTree::Box const &box) {
+	glm::vec3 size = box.max - box.min;
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+static bool contains(AABBTree::Box const &outer, AABBTree::Box const &inner) {
+	return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::lessThanEqual(inner.max, outer.max));
+}
+
+uint32_t AABBTree::allocate() {
+	uint32_t index;
+	if (free_list != Null) {
+		index = free_list;
+		free_list = nodes[index].parent;
+		nodes[index] = Node();
+	} else {
+		index = uint32_t(nodes.size());
+		nodes.emplace_back();
+	}
+	return index;
+}
+
+void AABBTree::release(uint32_t index) {
+	nodes[index].parent = free_list;
+	nodes[index].height = -1;
+	nodes[index].user = nullptr;
+	free_list = index;
+}
+
+uint32_t AABBTree::insert(Box const &box, void *user) {
+	uint32_t leaf = allocate();
+	nodes[leaf].box.min = box.min - glm::vec3(margin);
+	nodes[leaf].box.max = box.max + glm::vec3(margin);
+	nodes[leaf].user = user;
+	insert_leaf(leaf);
+	count += 1;
+	return leaf;
+}
+
+void AABBTree::remove(uint32_t proxy) {
+	assert(proxy < nodes.size() && nodes[proxy].leaf() && nodes[proxy].height == 0);
+	remove_leaf(proxy);
+	release(proxy);
+	count -= 1;
+}
+
+bool AABBTree::move(uint32_t proxy, Box const &box) {
+	assert(proxy < nodes.size() && nodes[proxy].leaf() && nodes[proxy].height == 0);
+	if (contains(nodes[proxy].box, box)) return false;
+
+	remove_leaf(proxy);
+	nodes[proxy].box.min = box.min - glm::vec3(margin);
+	nodes[proxy].box.max = box.max + glm::vec3(margin);
+	insert_leaf(proxy);
+	return true;
+}
+
+void AABBTree::clear() {
+	nodes.clear();
+	root = Null;
+	free_list = Null;
+	count = 0;
+}
+
+void AABBTree::insert_leaf(uint32_t leaf) {
+	if (root == Null) {
+		root = leaf;
+		nodes[leaf].parent = Null;
+		return;
+	}
+
+	//find the best sibling by walking down, choosing the child that costs least to add the leaf to:
+	// (as in Box2D's b2DynamicTree, with surface area in place of perimeter)
+	Box leaf_box = nodes[leaf].box;
+	uint32_t index = root;
+	while (!nodes[index].leaf()) {
+		Node const &node = nodes[index];
+		float node_area = area(node.box);
+		float merged_area = area(merge(node.box, leaf_box));
+
+		//cost of making a new parent for this node and the leaf:
+		float cost = 2.0f * merged_area;
+		//minimum cost of pushing the leaf further down the tree:
+		float inheritance_cost = 2.0f * (merged_area - node_area);
+
+		auto descend_cost = [&](uint32_t child) {
+			Node const &c = nodes[child];
+			float merged = area(merge(c.box, leaf_box));
+			return (c.leaf() ? merged : merged - area(c.box)) + inheritance_cost;
+		};
+		float left_cost = descend_cost(node.left);
+		float right_cost = descend_cost(node.right);
+
+		if (cost < left_cost && cost < right_cost) break;
+		index = (left_cost < right_cost ? node.left : node.right);
+	}
+	uint32_t sibling = index;
+
+	//make a new parent for the sibling and the leaf:
+	uint32_t old_parent = nodes[sibling].parent;
+	uint32_t new_parent = allocate();
+	nodes[new_parent].parent = old_parent;
+	nodes[new_parent].box = merge(leaf_box, nodes[sibling].box);
+	nodes[new_parent].height = nodes[sibling].height + 1;
+	nodes[new_parent].left = sibling;
+	nodes[new_parent].right = leaf;
+	nodes[sibling].parent = new_parent;
+	nodes[leaf].parent = new_parent;
+
+	if (old_parent != Null) {
+		if (nodes[old_parent].left == sibling) nodes[old_parent].left = new_parent;
+		else nodes[old_parent].right = new_parent;
+	} else {
+		root = new_parent;
+	}
+
+	refit_upward(nodes[leaf].parent);
+}
+
+void AABBTree::remove_leaf(uint32_t leaf) {
+	if (leaf == root) {
+		root = Null;
+		return;
+	}
+
+	uint32_t parent = nodes[leaf].parent;
+	uint32_t grandparent = nodes[parent].parent;
+	uint32_t sibling = (nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left);
+
+	//replace parent with sibling:
+	if (grandparent != Null) {
+		if (nodes[grandparent].left == parent) nodes[grandparent].left = sibling;
+		else nodes[grandparent].right = sibling;
+		nodes[sibling].parent = grandparent;
+		release(parent);
+		refit_upward(grandparent);
+	} else {
+		root = sibling;
+		nodes[sibling].parent = Null;
+		release(parent);
+	}
+	nodes[leaf].parent = Null;
+}
+
+//re-balance and re-compute boxes and heights from 'index' to the root:
+void AABBTree::refit_upward(uint32_t index) {
+	while (index != Null) {
+		index = balance(index);
+		Node &node = nodes[index];
+		node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+		node.box = merge(nodes[node.left].box, nodes[node.right].box);
+		index = node.parent;
+	}
+}
+
+//if subtree at 'a' is imbalanced, rotate its taller child up; returns the subtree's new root:
+// (as in Box2D's b2DynamicTree::Balance)
+uint32_t AABBTree::balance(uint32_t ia) {
+	Node &a = nodes[ia];
+	if (a.leaf() || a.height < 2) return ia;
+
+	uint32_t ib = a.left;
+	uint32_t ic = a.right;
+	Node &b = nodes[ib];
+	Node &c = nodes[ic];
+	int32_t imbalance = c.height - b.height;
+
+	//rotate 'c' up:
+	if (imbalance > 1) {
+		uint32_t i_f = c.left;
+		uint32_t i_g = c.right;
+		Node &f = nodes[i_f];
+		Node &g = nodes[i_g];
+
+		c.left = ia;
+		c.parent = a.parent;
+		a.parent = ic;
+		if (c.parent != Null) {
+			if (nodes[c.parent].left == ia) nodes[c.parent].left = ic;
+			else nodes[c.parent].right = ic;
+		} else {
+			root = ic;
+		}
+
+		//the taller of c's children stays with c:
+		if (f.height > g.height) {
+			c.right = i_f;
+			a.right = i_g;
+			g.parent = ia;
+			a.box = merge(b.box, g.box);
+			c.box = merge(a.box, f.box);
+			a.height = 1 + std::max(b.height, g.height);
+			c.height = 1 + std::max(a.height, f.height);
+		} else {
+			c.right = i_g;
+			a.right = i_f;
+			f.parent = ia;
+			a.box = merge(b.box, f.box);
+			c.box = merge(a.box, g.box);
+			a.height = 1 + std::max(b.height, f.height);
+			c.height = 1 + std::max(a.height, g.height);
+		}
+		return ic;
+	}
+
+	//rotate 'b' up:
+	if (imbalance < -1) {
+		uint32_t i_d = b.left;
+		uint32_t i_e = b.right;
+		Node &d = nodes[i_d];
+		Node &e = nodes[i_e];
+
+		b.left = ia;
+		b.parent = a.parent;
+		a.parent = ib;
+		if (b.parent != Null) {
+			if (nodes[b.parent].left == ia) nodes[b.parent].left = ib;
+			else nodes[b.parent].right = ib;
+		} else {
+			root = ib;
+		}
+
+		//the taller of b's children stays with b:
+		if (d.height > e.height) {
+			b.right = i_d;
+			a.left = i_e;
+			e.parent = ia;
+			a.box = merge(c.box, e.box);
+			b.box = merge(a.box, d.box);
+			a.height = 1 + std::max(c.height, e.height);
+			b.height = 1 + std::max(a.height, d.height);
+		} else {
+			b.right = i_e;
+			a.left = i_d;
+			d.parent = ia;
+			a.box = merge(c.box, d.box);
+			b.box = merge(a.box, e.box);
+			a.height = 1 + std::max(c.height, d.height);
+			b.height = 1 + std::max(a.height, e.height);
+		}
+		return ib;
+	}
+
+	return ia;
+}
+
+void AABBTree::build(std::vector< std::pair< Box, void * > > const &items, std::vector< uint32_t > *proxies) {
+	assert(proxies);
+	clear();
+	nodes.reserve(2 * items.size());
+
+	std::vector< uint32_t > leaves;
+	leaves.reserve(items.size());
+	for (auto const &item : items) {
+		uint32_t leaf = allocate();
+		nodes[leaf].box.min = item.first.min - glm::vec3(margin);
+		nodes[leaf].box.max = item.first.max + glm::vec3(margin);
+		nodes[leaf].user = item.second;
+		leaves.emplace_back(leaf);
+	}
+	*proxies = leaves;
+	count = uint32_t(items.size());
+
+	if (!leaves.empty()) {
+		root = build_range(leaves, 0, uint32_t(leaves.size()));
+		nodes[root].parent = Null;
+	}
+}
+
+//build subtree over leaves[begin,end) by splitting at the median center along the longest axis:
+uint32_t AABBTree::build_range(std::vector< uint32_t > &leaves, uint32_t begin, uint32_t end) {
+	assert(begin < end);
+	if (end - begin == 1) return leaves[begin];
+
+	glm::vec3 cmin = glm::vec3( std::numeric_limits< float >::infinity());
+	glm::vec3 cmax = glm::vec3(-std::numeric_limits< float >::infinity());
+	for (uint32_t i = begin; i < end; ++i) {
+		glm::vec3 center = nodes[leaves[i]].box.min + nodes[leaves[i]].box.max;
+		cmin = glm::min(cmin, center);
+		cmax = glm::max(cmax, center);
+	}
+	uint32_t axis = 0;
+	if (cmax.y - cmin.y > cmax[axis] - cmin[axis]) axis = 1;
+	if (cmax.z - cmin.z > cmax[axis] - cmin[axis]) axis = 2;
+
+	uint32_t mid = begin + (end - begin) / 2;
+	std::nth_element(leaves.begin() + begin, leaves.begin() + mid, leaves.begin() + end, [this,axis](uint32_t a, uint32_t b) {
+		return nodes[a].box.min[axis] + nodes[a].box.max[axis] < nodes[b].box.min[axis] + nodes[b].box.max[axis];
+	});
+
+	uint32_t left = build_range(leaves, begin, mid);
+	uint32_t right = build_range(leaves, mid, end);
+
+	uint32_t index = allocate();
+	Node &node = nodes[index];
+	node.left = left;
+	node.right = right;
+	node.box = merge(nodes[left].box, nodes[right].box);
+	node.height = 1 + std::max(nodes[left].height, nodes[right].height);
+	nodes[left].parent = index;
+	nodes[right].parent = index;
+	return index;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+/*
+ * An AABBTree is a dynamic bounding volume hierarchy over axis-aligned boxes
+ *  (each with a user pointer), for finding which of many objects overlap a
+ *  box, sphere, frustum, or ray without testing every one.
+ *
+ * Boxes can be inserted, removed, and moved at any time:
+ *  - stored boxes are enlarged by 'margin', so small moves don't change the tree
+ *  - boxes that do leave their stored box are re-inserted, and insertion keeps
+ *    the tree balanced with rotations
+ * build() makes a (better) tree for many boxes at once.
+ *
+ * Scene keeps two of these -- for static and dynamic drawables -- see Scene::update_bounds().
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct AABBTree {
+	struct Box {
+		glm::vec3 min = glm::vec3(0.0f);
+		glm::vec3 max = glm::vec3(0.0f);
+	};
+
+	AABBTree(float margin_ = 0.0f) : margin(margin_) { }
+
+	//add a box, returning a proxy id used to move or remove it later:
+	uint32_t insert(Box const &box, void *user);
+	void remove(uint32_t proxy);
+	//update a proxy's box; returns true if the proxy had to be re-inserted:
+	bool move(uint32_t proxy, Box const &box);
+
+	//replace contents with 'items', built top-down (proxies[i] is set to the proxy of items[i]):
+	void build(std::vector< std::pair< Box, void * > > const &items, std::vector< uint32_t > *proxies);
+	void clear();
+
+	void *user(uint32_t proxy) const { return nodes[proxy].user; }
+	Box const &box(uint32_t proxy) const { return nodes[proxy].box; } //(enlarged by margin)
+	uint32_t size() const { return count; }
+	uint32_t height() const { return (root == Null ? 0 : uint32_t(nodes[root].height)); }
+
+	//Queries call fn(void *user) for every proxy whose (enlarged) box overlaps the query shape:
+
+	template< typename F >
+	void query_box(Box const &query, F const &fn) const;
+
+	template< typename F >
+	void query_sphere(glm::vec3 const &center, float radius, F const &fn) const;
+
+	//convex volume bounded by planes (inside is where dot(plane, vec4(x, 1)) >= 0; normals need not be unit length):
+	template< typename F >
+	void query_planes(glm::vec4 const *planes, uint32_t plane_count, F const &fn) const;
+
+	//ray 'origin + t * direction', t in [0, t_max]: fn(user) returns a new t_max
+	// (e.g., the t of a hit, to look only for closer hits; or the t_max it was given, to keep going)
+	template< typename F >
+	void query_ray(glm::vec3 const &origin, glm::vec3 const &direction, float t_max, F const &fn) const;
+
+	//The box tests used by the queries:
+	static bool overlaps_box(Box const &box, Box const &query) {
+		return !(glm::any(glm::lessThan(box.max, query.min)) || glm::any(glm::greaterThan(box.min, query.max)));
+	}
+	static bool overlaps_sphere(Box const &box, glm::vec3 const &center, float radius) {
+		glm::vec3 gap = glm::max(box.min - center, glm::vec3(0.0f)) + glm::max(center - box.max, glm::vec3(0.0f));
+		return glm::dot(gap, gap) <= radius * radius;
+	}
+	//(clears bits of 'active' for planes the box is entirely inside of; planes whose bits are clear aren't tested)
+	static bool overlaps_planes(Box const &box, glm::vec4 const *planes, uint32_t plane_count, uint32_t *active) {
+		for (uint32_t p = 0; p < plane_count; ++p) {
+			if (!(*active & (1u << p))) continue;
+			glm::vec3 normal = glm::vec3(planes[p]);
+			//corners of the box farthest along and against the plane normal:
+			glm::vec3 along = glm::mix(box.min, box.max, glm::vec3(glm::greaterThanEqual(normal, glm::vec3(0.0f))));
+			glm::vec3 against = glm::mix(box.max, box.min, glm::vec3(glm::greaterThanEqual(normal, glm::vec3(0.0f))));
+			if (glm::dot(normal, along) + planes[p].w < 0.0f) return false;
+			if (glm::dot(normal, against) + planes[p].w >= 0.0f) *active &= ~(1u << p);
+		}
+		return true;
+	}
+	static bool overlaps_ray(Box const &box, glm::vec3 const &origin, glm::vec3 const &inv_direction, float t_max) {
+		glm::vec3 t0 = (box.min - origin) * inv_direction;
+		glm::vec3 t1 = (box.max - origin) * inv_direction;
+		glm::vec3 t_near = glm::min(t0, t1);
+		glm::vec3 t_far = glm::max(t0, t1);
+		float enter = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, 0.0f));
+		float exit = std::min(std::min(t_far.x, t_far.y), std::min(t_far.z, t_max));
+		return enter <= exit;
+	}
+
+	//-- internals ---
+	static constexpr uint32_t Null = -1U;
+
+	struct Node {
+		Box box;
+		void *user = nullptr;
+		uint32_t parent = Null; //(next free node, if on free list)
+		uint32_t left = Null, right = Null; //children (Null for leaves)
+		int32_t height = 0; //0 for leaves, -1 for free nodes
+		bool leaf() const { return left == Null; }
+	};
+	std::vector< Node > nodes;
+	uint32_t root = Null;
+	uint32_t free_list = Null;
+	uint32_t count = 0; //proxies in tree
+
+	float margin;
+
+	//traversal stack size (plenty for a balanced tree):
+	static constexpr uint32_t StackSize = 128;
+
+	uint32_t allocate();
+	void release(uint32_t index);
+	void insert_leaf(uint32_t leaf);
+	void remove_leaf(uint32_t leaf);
+	uint32_t balance(uint32_t index);
+	void refit_upward(uint32_t index);
+	uint32_t build_range(std::vector< uint32_t > &leaves, uint32_t begin, uint32_t end);
+};
+
+//------------ query implementations ------------
+
+template< typename F >
+void AABBTree::query_box(Box const &query, F const &fn) const {
+	if (root == Null) return;
+	std::array< uint32_t, StackSize > stack;
+	uint32_t stack_size = 0;
+	stack[stack_size++] = root;
+	while (stack_size > 0) {
+		Node const &node = nodes[stack[--stack_size]];
+		if (!overlaps_box(node.box, query)) continue;
+		if (node.leaf()) {
+			fn(node.user);
+		} else {
+			assert(stack_size + 2 <= StackSize);
+			stack[stack_size++] = node.left;
+			stack[stack_size++] = node.right;
+		}
+	}
+}
+
+template< typename F >
+void AABBTree::query_sphere(glm::vec3 const &center, float radius, F const &fn) const {
+	if (root == Null) return;
+	std::array< uint32_t, StackSize > stack;
+	uint32_t stack_size = 0;
+	stack[stack_size++] = root;
+	while (stack_size > 0) {
+		Node const &node = nodes[stack[--stack_size]];
+		if (!overlaps_sphere(node.box, center, radius)) continue;
+		if (node.leaf()) {
+			fn(node.user);
+		} else {
+			assert(stack_size + 2 <= StackSize);
+			stack[stack_size++] = node.left;
+			stack[stack_size++] = node.right;
+		}
+	}
+}
+
+template< typename F >
+void AABBTree::query_planes(glm::vec4 const *planes, uint32_t plane_count, F const &fn) const {
+	assert(plane_count <= 32);
+	if (root == Null) return;
+	//(each entry also tracks which planes might still cut the node; children of nodes entirely inside a plane skip it)
+	std::array< std::pair< uint32_t, uint32_t >, StackSize > stack;
+	uint32_t stack_size = 0;
+	stack[stack_size++] = std::make_pair(root, uint32_t((1ull << plane_count) - 1));
+	while (stack_size > 0) {
+		auto [index, active] = stack[--stack_size];
+		Node const &node = nodes[index];
+		if (!overlaps_planes(node.box, planes, plane_count, &active)) continue;
+		if (node.leaf()) {
+			fn(node.user);
+		} else {
+			assert(stack_size + 2 <= StackSize);
+			stack[stack_size++] = std::make_pair(node.left, active);
+			stack[stack_size++] = std::make_pair(node.right, active);
+		}
+	}
+}
+
+template< typename F >
+void AABBTree::query_ray(glm::vec3 const &origin, glm::vec3 const &direction, float t_max, F const &fn) const {
+	if (root == Null) return;
+	glm::vec3 inv_direction = 1.0f / direction;
+	std::array< uint32_t, StackSize > stack;
+	uint32_t stack_size = 0;
+	stack[stack_size++] = root;
+	while (stack_size > 0) {
+		Node const &node = nodes[stack[--stack_size]];
+		if (!overlaps_ray(node.box, origin, inv_direction, t_max)) continue;
+		if (node.leaf()) {
+			t_max = fn(node.user);
+		} else {
+			assert(stack_size + 2 <= StackSize);
+			stack[stack_size++] = node.left;
+			stack[stack_size++] = node.right;
+		}
+	}
+}
@@ -0,0 +1,259 @@
+#include "Animation.hpp"
+
+#include "read_write_chunk.hpp"
+#include "simd4.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+static uint32_t round_up_4(size_t count) {
+	return uint32_t((count + 3) & ~size_t(3));
+}
+
+AnimationClip::AnimationClip(std::string const &name_, float frame_rate_, uint32_t frame_count_, std::vector< uint32_t > const &targets_)
+	: name(name_), frame_rate(frame_rate_), frame_count(frame_count_), targets(targets_), stride(round_up_4(targets_.size())) {
+	if (!(frame_rate > 0.0f)) throw std::runtime_error("animation clip '" + name + "' has non-positive frame rate");
+	if (frame_count == 0) throw std::runtime_error("animation clip '" + name + "' has no frames");
+
+	keys.assign(size_t(frame_count) * Components * stride, 0.0f);
+	for (uint32_t f = 0; f < frame_count; ++f) {
+		float *frame = keys.data() + size_t(f) * Components * stride;
+		std::fill(frame + 6 * stride, frame + 7 * stride, 1.0f); //rotation.w
+		std::fill(frame + 7 * stride, frame + 10 * stride, 1.0f); //scale
+	}
+}
+
+void AnimationClip::set_key(uint32_t frame, uint32_t track, glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale) {
+	assert(frame < frame_count && track < targets.size());
+	float *at = keys.data() + size_t(frame) * Components * stride + track;
+	float const values[Components] = {
+		position.x, position.y, position.z,
+		rotation.x, rotation.y, rotation.z, rotation.w,
+		scale.x, scale.y, scale.z
+	};
+	for (uint32_t c = 0; c < Components; ++c) {
+		at[c * stride] = values[c];
+	}
+}
+
+void AnimationClip::read(std::istream &from, std::vector< char > const &str0, std::vector< uint32_t > const &entry_slots,
+	std::vector< std::shared_ptr< AnimationClip const > > *clips) {
+	assert(clips);
+
+	struct ClipEntry {
+		uint32_t name_begin, name_end;
+		float frame_rate;
+		uint32_t frame_count;
+		uint32_t track_begin, track_end; //tracks (in 'ant0')
+		uint32_t key_begin; //first key (in 'ank0'); keys are by frame, then by track
+	};
+	static_assert(sizeof(ClipEntry) == 4*7, "ClipEntry is packed.");
+	struct KeyEntry {
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+	};
+	static_assert(sizeof(KeyEntry) == 4*3 + 4*4 + 4*3, "KeyEntry is packed.");
+
+	std::vector< ClipEntry > entries;
+	std::vector< uint32_t > tracks; //hierarchy entry of each track
+	std::vector< KeyEntry > loaded_keys;
+	read_chunk(from, "anc0", &entries);
+	read_chunk(from, "ant0", &tracks);
+	read_chunk(from, "ank0", &loaded_keys);
+
+	for (auto const &entry : entries) {
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= str0.size())) {
+			throw std::runtime_error("animation clip has invalid name indices");
+		}
+		std::string name(str0.begin() + entry.name_begin, str0.begin() + entry.name_end);
+		if (!(entry.track_begin <= entry.track_end && entry.track_end <= tracks.size())) {
+			throw std::runtime_error("animation clip '" + name + "' has invalid track range");
+		}
+		uint64_t track_count = entry.track_end - entry.track_begin;
+		if (!(uint64_t(entry.key_begin) + track_count * entry.frame_count <= loaded_keys.size())) {
+			throw std::runtime_error("animation clip '" + name + "' has invalid key range");
+		}
+
+		std::vector< uint32_t > targets;
+		targets.reserve(track_count);
+		for (uint32_t t = entry.track_begin; t < entry.track_end; ++t) {
+			if (tracks[t] >= entry_slots.size() || entry_slots[tracks[t]] == -1U) {
+				throw std::runtime_error("animation clip '" + name + "' has a track for hierarchy entry " + std::to_string(tracks[t]) + ", which has no transform");
+			}
+			targets.emplace_back(entry_slots[tracks[t]]);
+		}
+
+		std::shared_ptr< AnimationClip > clip = std::make_shared< AnimationClip >(name, entry.frame_rate, entry.frame_count, targets);
+		KeyEntry const *key = loaded_keys.data() + entry.key_begin;
+		for (uint32_t f = 0; f < clip->frame_count; ++f) {
+			for (uint32_t t = 0; t < track_count; ++t, ++key) {
+				clip->set_key(f, t, key->position, key->rotation, key->scale);
+			}
+		}
+		clips->emplace_back(clip);
+	}
+}
+
+//------------------------------
+
+AnimationPose::AnimationPose(std::vector< uint32_t > const &targets_) : targets(targets_), stride(round_up_4(targets_.size())) {
+	sums.assign(size_t(Weight + 1) * stride, 0.0f);
+}
+
+void AnimationPose::clear() {
+	std::fill(sums.begin(), sums.end(), 0.0f);
+}
+
+std::vector< uint32_t > const &AnimationPose::track_map(AnimationClip const &clip) {
+	for (auto const &map : track_maps) {
+		if (map.clip == &clip && map.clip_targets == clip.targets) return map.to_target;
+	}
+	track_maps.erase(std::remove_if(track_maps.begin(), track_maps.end(), [&](TrackMap const &map) { return map.clip == &clip; }), track_maps.end());
+
+	std::vector< std::pair< uint32_t, uint32_t > > by_slot; //(slot, target), sorted
+	by_slot.reserve(targets.size());
+	for (uint32_t i = 0; i < targets.size(); ++i) {
+		by_slot.emplace_back(targets[i], i);
+	}
+	std::sort(by_slot.begin(), by_slot.end());
+
+	track_maps.emplace_back();
+	TrackMap &map = track_maps.back();
+	map.clip = &clip;
+	map.clip_targets = clip.targets;
+	map.to_target.reserve(clip.targets.size());
+	for (uint32_t slot : clip.targets) {
+		auto f = std::lower_bound(by_slot.begin(), by_slot.end(), std::make_pair(slot, 0U));
+		map.to_target.emplace_back(f != by_slot.end() && f->first == slot ? f->second : -1U);
+	}
+	return map.to_target;
+}
+
+void AnimationPose::add(AnimationClip const &clip, float time, float weight, bool loop) {
+	if (!(weight > 0.0f)) return;
+
+	//the two frames to interpolate between (the same for every track):
+	float duration = clip.duration();
+	if (loop && duration > 0.0f) {
+		time = std::fmod(time, duration);
+		if (time < 0.0f) time += duration;
+	}
+	float at = std::max(0.0f, std::min(time, duration)) * clip.frame_rate;
+	uint32_t f0 = std::min(uint32_t(at), clip.frame_count - 1);
+	uint32_t f1 = std::min(f0 + 1, clip.frame_count - 1);
+	float amt = at - float(f0);
+
+	bool same_targets = (clip.targets == targets);
+	std::vector< uint32_t > const *to_target = (same_targets ? nullptr : &track_map(clip));
+
+	size_t frame_size = size_t(AnimationClip::Components) * clip.stride;
+	float const *k0 = clip.keys.data() + f0 * frame_size;
+	float const *k1 = clip.keys.data() + f1 * frame_size;
+	uint32_t const cs = clip.stride;
+
+	F4 const t = splat(amt);
+	F4 const w = splat(weight);
+	F4 const zero = splat(0.0f);
+	F4 const one = splat(1.0f);
+	F4 const minus_one = splat(-1.0f);
+
+	for (uint32_t i = 0; i < cs; i += 4) {
+		//interpolate four tracks:
+		F4 sample[AnimationClip::Components];
+		for (uint32_t c : {0, 1, 2, 7, 8, 9}) {
+			F4 a = load4(k0 + c * cs + i);
+			F4 b = load4(k1 + c * cs + i);
+			sample[c] = (a + (b - a) * t) * w;
+		}
+		F4 a[4], b[4];
+		for (uint32_t c = 0; c < 4; ++c) {
+			a[c] = load4(k0 + (3 + c) * cs + i);
+			b[c] = load4(k1 + (3 + c) * cs + i);
+		}
+		//(take the short way around: flip b if it's in the other hemisphere from a)
+		F4 flip = select4(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < zero, minus_one, one);
+		F4 q[4];
+		for (uint32_t c = 0; c < 4; ++c) {
+			q[c] = a[c] + (b[c] * flip - a[c]) * t;
+		}
+		F4 length = sqrt4(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		F4 scale = w / max4(length, splat(1e-20f));
+		for (uint32_t c = 0; c < 4; ++c) {
+			sample[3 + c] = q[c] * scale;
+		}
+
+		if (same_targets) {
+			//...and add them to the sums of the same four targets:
+			float *s = sums.data() + i;
+			F4 sum_q[4];
+			for (uint32_t c = 0; c < 4; ++c) {
+				sum_q[c] = load4(s + (3 + c) * stride);
+			}
+			F4 side = select4(sum_q[0] * sample[3] + sum_q[1] * sample[4] + sum_q[2] * sample[5] + sum_q[3] * sample[6] < zero, minus_one, one);
+			for (uint32_t c = 0; c < 4; ++c) {
+				store4(sum_q[c] + sample[3 + c] * side, s + (3 + c) * stride);
+			}
+			for (uint32_t c : {0, 1, 2, 7, 8, 9}) {
+				store4(load4(s + c * stride) + sample[c], s + c * stride);
+			}
+			store4(load4(s + Weight * stride) + w, s + Weight * stride);
+		} else {
+			//...or to the targets they map to, one at a time:
+			float lanes[AnimationClip::Components][4];
+			for (uint32_t c = 0; c < AnimationClip::Components; ++c) {
+				store4(sample[c], lanes[c]);
+			}
+			for (uint32_t l = 0; l < 4 && i + l < clip.targets.size(); ++l) {
+				uint32_t target = (*to_target)[i + l];
+				if (target == -1U) continue;
+				float *s = sums.data() + target;
+				float dot = 0.0f;
+				for (uint32_t c = 3; c < 7; ++c) {
+					dot += s[c * stride] * lanes[c][l];
+				}
+				float side = (dot < 0.0f ? -1.0f : 1.0f);
+				for (uint32_t c = 0; c < AnimationClip::Components; ++c) {
+					s[c * stride] += (c >= 3 && c < 7 ? side : 1.0f) * lanes[c][l];
+				}
+				s[Weight * stride] += weight;
+			}
+		}
+	}
+}
+
+void AnimationPose::apply(Scene &scene) const {
+	F4 const tiny = splat(1e-20f);
+	for (uint32_t i = 0; i < stride; i += 4) {
+		float const *s = sums.data() + i;
+		F4 weight = load4(s + Weight * stride);
+		if (bits(weight > splat(0.0f)) == 0) continue;
+
+		//normalize four targets' sums...
+		float lanes[AnimationClip::Components][4];
+		F4 inv_weight = splat(1.0f) / max4(weight, tiny);
+		for (uint32_t c : {0, 1, 2, 7, 8, 9}) {
+			store4(load4(s + c * stride) * inv_weight, lanes[c]);
+		}
+		F4 q[4];
+		for (uint32_t c = 0; c < 4; ++c) {
+			q[c] = load4(s + (3 + c) * stride);
+		}
+		F4 inv_length = splat(1.0f) / max4(sqrt4(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]), tiny);
+		for (uint32_t c = 0; c < 4; ++c) {
+			store4(q[c] * inv_length, lanes[3 + c]);
+		}
+
+		//...and write them to their transforms:
+		for (uint32_t l = 0; l < 4 && i + l < targets.size(); ++l) {
+			if (!(s[Weight * stride + l] > 0.0f)) continue;
+			Scene::Transform *transform = scene.transforms.at(targets[i + l]);
+			if (!transform) continue;
+			transform->position = glm::vec3(lanes[0][l], lanes[1][l], lanes[2][l]);
+			transform->rotation = glm::quat(lanes[6][l], lanes[3][l], lanes[4][l], lanes[5][l]); //(wxyz constructor)
+			transform->scale = glm::vec3(lanes[7][l], lanes[8][l], lanes[9][l]);
+		}
+	}
+}
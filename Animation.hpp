@@ -0,0 +1,93 @@
+#pragma once
+
+/*
+ * Keyframe animation of a Scene's transforms.
+ *
+ * An AnimationClip has one track per animated transform, each with a key (position, rotation, scale) at
+ *  every frame of a fixed frame rate -- so sampling a clip at any time reads the same two frames of every
+ *  track, and tracks can be interpolated four at a time (see simd4.hpp). Keys are stored by component
+ *  (all tracks' position.x, then all tracks' position.y, ...) for the same reason.
+ *
+ * Clips are exported with scenes by export-scene.py (chunks 'anc0', 'ant0', 'ank0'; one clip per timeline
+ *  marker) and read into Scene::clips by Scene::load_extra(). Tracks refer to transforms by slot (Pool index),
+ *  so clips also work on copies of the scene made by Scene::set.
+ *
+ * An AnimationPose blends weighted samples of any number of clips for a list of transforms, then writes
+ *  the result into the transforms:
+ *    pose.clear();
+ *    pose.add(*walk, walk_time, 0.75f);
+ *    pose.add(*run, run_time, 0.25f);
+ *    pose.apply(scene);
+ *  positions and scales are weighted averages; rotations are interpolated and blended by normalized
+ *  weighted sums ("nlerp"), each flipped into the same hemisphere as the sum so far.
+ *  Transforms that no sampled clip has a track for are left as they are.
+ *
+ * Drawables on animated transforms (or their children) need to be 'dynamic' for bounds to follow them.
+ *
+ */
+
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct AnimationClip {
+	//clip with one track per transform slot in 'targets', of 'frame_count' (at least one) keys each, all identity:
+	AnimationClip(std::string const &name, float frame_rate, uint32_t frame_count, std::vector< uint32_t > const &targets);
+
+	std::string name;
+	float frame_rate; //keys per second
+	uint32_t frame_count; //keys per track
+	std::vector< uint32_t > targets; //transform slot (index in Scene::transforms) of each track
+
+	//time of the last key, in seconds:
+	float duration() const { return float(frame_count - 1) / frame_rate; }
+
+	void set_key(uint32_t frame, uint32_t track, glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale);
+
+	//read clips from chunks 'anc0', 'ant0', 'ank0' (throws on errors), appending them to 'clips':
+	// (tracks refer to hierarchy entries of the file; entry_slots[i] is the transform slot for entry i, or -1U if there isn't one)
+	static void read(std::istream &from, std::vector< char > const &str0, std::vector< uint32_t > const &entry_slots,
+		std::vector< std::shared_ptr< AnimationClip const > > *clips);
+
+	//-- internals ---
+	enum : uint32_t { Components = 10 }; //position xyz, rotation xyzw, scale xyz
+	uint32_t stride; //track count rounded up to a multiple of four (extra tracks are identity)
+	std::vector< float > keys; //component c of track t at frame f is keys[(f * Components + c) * stride + t]
+};
+
+struct AnimationPose {
+	//pose for the transform slots in 'targets' (e.g., the targets of the clips it will blend):
+	explicit AnimationPose(std::vector< uint32_t > const &targets = {});
+
+	std::vector< uint32_t > targets;
+
+	//forget everything added since the last clear():
+	void clear();
+
+	//add 'clip' sampled at 'time' (seconds; wrapped to the clip's duration if 'loop', clamped otherwise) with 'weight':
+	// (clips whose targets are the same as the pose's are interpolated and summed four tracks at a time; for others, sums are track by track)
+	void add(AnimationClip const &clip, float time, float weight = 1.0f, bool loop = true);
+
+	//write blended positions, rotations, and scales to the transforms (skipping slots no longer in use):
+	void apply(Scene &scene) const;
+
+	//-- internals ---
+	enum : uint32_t { Weight = AnimationClip::Components }; //sums has an extra component for the sum of weights
+	uint32_t stride = 0; //targets rounded up to a multiple of four
+	std::vector< float > sums; //component c of target i is sums[c * stride + i]
+
+	//for clips with other targets, the pose target (or -1U) of each track:
+	struct TrackMap {
+		AnimationClip const *clip;
+		std::vector< uint32_t > clip_targets; //(to notice a different clip at the same address)
+		std::vector< uint32_t > to_target;
+	};
+	std::vector< TrackMap > track_maps;
+	std::vector< uint32_t > const &track_map(AnimationClip const &clip);
+};
@@ -0,0 +1,151 @@
+#include "Broadphase.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+uint32_t Broadphase::add(Box const &box, void *user) {
+	uint32_t proxy;
+	if (free_list != Null) {
+		proxy = free_list;
+		free_list = proxies[proxy].entry;
+		proxies[proxy] = Proxy();
+	} else {
+		proxy = uint32_t(proxies.size());
+		proxies.emplace_back();
+	}
+	proxies[proxy].entry = uint32_t(entries.size());
+	proxies[proxy].user = user;
+	entries.emplace_back(Entry{box, proxy});
+	added += 1;
+	return proxy;
+}
+
+void Broadphase::remove(uint32_t proxy) {
+	assert(proxy < proxies.size() && !proxies[proxy].removed);
+	//(entry stays until the next update(), so pairs with it can be reported as ended)
+	proxies[proxy].removed = true;
+	pending_free.emplace_back(proxy);
+	removed += 1;
+}
+
+void Broadphase::move(uint32_t proxy, Box const &box) {
+	assert(proxy < proxies.size() && !proxies[proxy].removed);
+	entries[proxies[proxy].entry].box = box;
+}
+
+void Broadphase::sort_entries() {
+	//sweep along the axis with the most spread-out box centers, so fewer boxes overlap along it:
+	// (only switching when another axis is clearly better, since switching needs a full sort)
+	bool full_sort = (added > entries.size() / 8 + 16);
+	if (!entries.empty()) {
+		glm::vec3 sum = glm::vec3(0.0f);
+		glm::vec3 sum2 = glm::vec3(0.0f);
+		for (auto const &entry : entries) {
+			glm::vec3 center = 0.5f * (entry.box.min + entry.box.max);
+			sum += center;
+			sum2 += center * center;
+		}
+		glm::vec3 variance = sum2 / float(entries.size()) - (sum * sum) / float(entries.size() * entries.size());
+		uint32_t best = 0;
+		if (variance.y > variance[best]) best = 1;
+		if (variance.z > variance[best]) best = 2;
+		if (variance[best] > 1.5f * variance[axis]) {
+			axis = best;
+			full_sort = true;
+		}
+	}
+
+	uint32_t const a = axis;
+	if (full_sort) {
+		std::sort(entries.begin(), entries.end(), [a](Entry const &x, Entry const &y) {
+			return x.box.min[a] < y.box.min[a];
+		});
+	} else {
+		//entries are nearly sorted from the last update, so insertion sort is (nearly) linear:
+		for (uint32_t i = 1; i < entries.size(); ++i) {
+			float key = entries[i].box.min[a];
+			if (!(entries[i-1].box.min[a] > key)) continue;
+			Entry entry = entries[i];
+			uint32_t j = i;
+			do {
+				entries[j] = entries[j-1];
+				--j;
+			} while (j > 0 && entries[j-1].box.min[a] > key);
+			entries[j] = entry;
+		}
+	}
+
+	//update proxies' entry indices and copy out the boxes in the layout used by the sweep:
+	uint32_t const b = (a + 1) % 3;
+	uint32_t const c = (a + 2) % 3;
+	sweep_min.resize(entries.size());
+	sweep_max.resize(entries.size());
+	sweep_cross.resize(entries.size());
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		Box const &box = entries[i].box;
+		proxies[entries[i].proxy].entry = i;
+		sweep_min[i] = box.min[a];
+		sweep_max[i] = box.max[a];
+		sweep_cross[i] = glm::vec4(box.min[b], box.max[b], box.min[c], box.max[c]);
+	}
+}
+
+void Broadphase::update() {
+	//drop entries of removed proxies:
+	if (removed > 0) {
+		entries.erase(std::remove_if(entries.begin(), entries.end(), [this](Entry const &entry) {
+			return proxies[entry.proxy].removed;
+		}), entries.end());
+	}
+
+	sort_entries();
+
+	//sweep: each box can only overlap boxes that start (along the axis) before it ends:
+	next_pairs.clear();
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		float end = sweep_max[i];
+		glm::vec4 const &cross = sweep_cross[i];
+		//(since entries are sorted, every j in this loop overlaps i along the axis)
+		for (uint32_t j = i + 1; j < entries.size() && sweep_min[j] <= end; ++j) {
+			glm::vec4 const &other = sweep_cross[j];
+			if (other.y < cross.x || other.x > cross.y || other.w < cross.z || other.z > cross.w) continue;
+			uint64_t p = entries[i].proxy;
+			uint64_t q = entries[j].proxy;
+			next_pairs.emplace_back(p < q ? (p << 32 | q) : (q << 32 | p));
+		}
+	}
+	std::sort(next_pairs.begin(), next_pairs.end());
+
+	//compare with the last update's pairs:
+	began.clear();
+	persisted.clear();
+	ended.clear();
+	auto to_pair = [](uint64_t key) {
+		return Pair{uint32_t(key >> 32), uint32_t(key)};
+	};
+	auto n = next_pairs.begin();
+	auto o = pairs.begin();
+	while (n != next_pairs.end() || o != pairs.end()) {
+		if (o == pairs.end() || (n != next_pairs.end() && *n < *o)) {
+			began.emplace_back(to_pair(*n));
+			++n;
+		} else if (n == next_pairs.end() || *o < *n) {
+			ended.emplace_back(to_pair(*o));
+			++o;
+		} else {
+			persisted.emplace_back(to_pair(*n));
+			++n;
+			++o;
+		}
+	}
+	std::swap(pairs, next_pairs);
+
+	//now that their pairs have been reported, removed proxies can be re-used:
+	for (uint32_t proxy : pending_free) {
+		proxies[proxy].entry = free_list;
+		free_list = proxy;
+	}
+	pending_free.clear();
+	removed = 0;
+	added = 0;
+}
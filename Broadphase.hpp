@@ -0,0 +1,92 @@
+#pragma once
+
+/*
+ * A Broadphase finds which of many moving boxes overlap, every frame, and
+ *  reports pairs that began, persisted, or ended overlapping since the last
+ *  update -- e.g., for triggers and collision between gameplay objects.
+ *
+ * It is a sweep-and-prune: boxes are kept sorted by their minimum along one
+ *  axis (the axis along which box centers are most spread out), and each box
+ *  is tested only against the boxes that start before it ends on that axis.
+ *  Since objects move only a little between frames, the order is repaired
+ *  with an insertion sort, which takes close to linear time.
+ *
+ * Boxes are usually world-space bounds of drawables (see Scene::Drawable::world_bounds).
+ *
+ * Usage:
+ *   uint32_t proxy = broadphase.add(box, user);
+ *   //each frame:
+ *   broadphase.move(proxy, new_box);
+ *   broadphase.update();
+ *   for (auto const &pair : broadphase.began) { ... broadphase.user(pair.a) ... }
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct Broadphase {
+	struct Box {
+		glm::vec3 min = glm::vec3(0.0f);
+		glm::vec3 max = glm::vec3(0.0f);
+	};
+
+	//add a box, returning a proxy id used to move or remove it later:
+	// (ids of removed proxies are re-used, but not until after the next update())
+	uint32_t add(Box const &box, void *user);
+	//remove a proxy; its overlaps are reported as 'ended' by the next update():
+	// (its user() pointer stays available until its id is re-used)
+	void remove(uint32_t proxy);
+	void move(uint32_t proxy, Box const &box);
+
+	void *user(uint32_t proxy) const { return proxies[proxy].user; }
+	Box const &box(uint32_t proxy) const { return entries[proxies[proxy].entry].box; }
+	uint32_t size() const { return uint32_t(entries.size()) - removed; }
+
+	//find overlapping pairs and compare them to those found by the last update():
+	void update();
+
+	//pairs of proxies with overlapping boxes (always a < b):
+	struct Pair {
+		uint32_t a, b;
+	};
+	//filled in by update() (and valid until the next call):
+	std::vector< Pair > began; //overlapping now but not at the last update
+	std::vector< Pair > persisted; //overlapping now and at the last update
+	std::vector< Pair > ended; //overlapping at the last update but not now (or one proxy was removed)
+
+	//-- internals ---
+	static constexpr uint32_t Null = -1U;
+
+	//boxes, in sorted order along 'axis':
+	struct Entry {
+		Box box;
+		uint32_t proxy;
+	};
+	std::vector< Entry > entries;
+	uint32_t axis = 0;
+
+	//entries' boxes, copied by sort_entries() into arrays for the sweep:
+	// (bounds along the axis, and (min, max, min, max) along the other two axes)
+	std::vector< float > sweep_min, sweep_max;
+	std::vector< glm::vec4 > sweep_cross;
+
+	struct Proxy {
+		uint32_t entry = Null; //index in entries (or next free proxy, if freed)
+		void *user = nullptr;
+		bool removed = false;
+	};
+	std::vector< Proxy > proxies;
+	uint32_t free_list = Null;
+	std::vector< uint32_t > pending_free; //removed proxies, freed after the next update()
+	uint32_t removed = 0; //entries belonging to removed proxies
+	uint32_t added = 0; //entries appended since the last update()
+
+	//overlapping pairs found by the last update(), as sorted (a << 32 | b) keys:
+	std::vector< uint64_t > pairs;
+	std::vector< uint64_t > next_pairs; //(scratch space for update())
+
+	void sort_entries();
+};
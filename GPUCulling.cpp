@@ -0,0 +1,451 @@
+#include "GPUCulling.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+
+#ifdef __ANDROID__
+#include <GLES3/gl31.h>
+#else
+#include <SDL.h>
+
+//compute shaders, image load/store, immutable textures, and indirect draws are newer than the
+// OpenGL 3.3 core functions in GL.hpp (and not present at all on, e.g., macOS), so are looked up at runtime:
+static void (APIENTRY *glDispatchCompute)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z) = nullptr;
+static void (APIENTRY *glMemoryBarrier)(GLbitfield barriers) = nullptr;
+static void (APIENTRY *glBindImageTexture)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format) = nullptr;
+static void (APIENTRY *glTexStorage2D)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height) = nullptr;
+static void (APIENTRY *glDrawArraysIndirect)(GLenum mode, const void *indirect) = nullptr;
+
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif //__ANDROID__
+
+//is the context new enough for compute shaders and indirect draws? (looks up entry points, if needed)
+static bool check_support() {
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	#ifdef __ANDROID__
+	bool supported = (major > 3 || (major == 3 && minor >= 1));
+	#else
+	bool supported = (major > 4 || (major == 4 && minor >= 3));
+	if (supported) {
+		glDispatchCompute = (decltype(glDispatchCompute))SDL_GL_GetProcAddress("glDispatchCompute");
+		glMemoryBarrier = (decltype(glMemoryBarrier))SDL_GL_GetProcAddress("glMemoryBarrier");
+		glBindImageTexture = (decltype(glBindImageTexture))SDL_GL_GetProcAddress("glBindImageTexture");
+		glTexStorage2D = (decltype(glTexStorage2D))SDL_GL_GetProcAddress("glTexStorage2D");
+		glDrawArraysIndirect = (decltype(glDrawArraysIndirect))SDL_GL_GetProcAddress("glDrawArraysIndirect");
+		supported = glDispatchCompute && glMemoryBarrier && glBindImageTexture && glTexStorage2D && glDrawArraysIndirect;
+	}
+	#endif
+	if (!supported) {
+		std::cout << "NOTE: compute shaders not available (OpenGL " << major << "." << minor << "); GPU culling is disabled." << std::endl;
+	}
+	return supported;
+}
+
+//shared by both compute programs:
+static std::string const ComputeHeader =
+#ifdef __ANDROID__
+	"#version 310 es\n"
+	"precision highp float;\n"
+	"precision highp int;\n"
+	"precision highp sampler2D;\n"
+#else
+	"#version 430\n"
+#endif
+;
+
+//uniform locations (the same for every GPUCulling, since programs are compiled from the same source):
+static GLuint WORLD_TO_CLIP_mat4 = -1U;
+static GLuint PYRAMID_WORLD_TO_CLIP_mat4 = -1U;
+static GLuint USE_PYRAMID_bool = -1U;
+static GLuint DEPTH_SIZE_vec2 = -1U;
+static GLuint PYRAMID_LEVELS_int = -1U;
+static GLuint COUNT_uint = -1U;
+static GLuint SOURCE_LEVEL_int = -1U;
+
+GPUCulling::GPUCulling() {
+	if (!check_support()) return;
+
+	//test every slot's box against the frustum and the depth pyramid:
+	cull_program = gl_compile_compute_program(
+		ComputeHeader +
+		"#line " STR(__LINE__) "\n"
+		"layout(local_size_x = 64) in;\n"
+		"struct Bounds { vec4 lo; vec4 hi; };\n"
+		"layout(std430, binding = 0) readonly buffer BoundsBuffer { Bounds bounds[]; };\n"
+		"struct Command { uint count; uint instance_count; uint first; uint reserved; };\n"
+		"layout(std430, binding = 1) buffer CommandBuffer { Command commands[]; };\n"
+		"layout(std430, binding = 2) buffer VisibleCountBuffer { uint visible_count; };\n"
+		"uniform mat4 WORLD_TO_CLIP;\n"
+		"uniform mat4 PYRAMID_WORLD_TO_CLIP;\n" //view the pyramid's depth was drawn from
+		"uniform bool USE_PYRAMID;\n"
+		"uniform vec2 DEPTH_SIZE;\n" //size of the depth buffer the pyramid was made from
+		"uniform int PYRAMID_LEVELS;\n"
+		"uniform uint COUNT;\n"
+		"uniform sampler2D PYRAMID;\n" //farthest depth of each 2x2 (then 4x4, ...) block of pixels
+		"vec3 corner(vec3 lo, vec3 hi, int i) {\n"
+		"	return vec3((i & 1) != 0 ? hi.x : lo.x, (i & 2) != 0 ? hi.y : lo.y, (i & 4) != 0 ? hi.z : lo.z);\n"
+		"}\n"
+		//out of view if all corners are outside the same clip plane:
+		"bool outside_view(vec3 lo, vec3 hi) {\n"
+		"	uint all_outside = 63u;\n"
+		"	for (int i = 0; i < 8; ++i) {\n"
+		"		vec4 c = WORLD_TO_CLIP * vec4(corner(lo, hi, i), 1.0);\n"
+		"		uint outside = 0u;\n"
+		"		if (c.x < -c.w) outside |= 1u;\n"
+		"		if (c.x >  c.w) outside |= 2u;\n"
+		"		if (c.y < -c.w) outside |= 4u;\n"
+		"		if (c.y >  c.w) outside |= 8u;\n"
+		"		if (c.z < -c.w) outside |= 16u;\n"
+		"		if (c.z >  c.w) outside |= 32u;\n"
+		"		all_outside &= outside;\n"
+		"	}\n"
+		"	return all_outside != 0u;\n"
+		"}\n"
+		//hidden if the nearest depth of the box is beyond the farthest depth drawn where it would be:
+		// (depth is window-space depth with the default glDepthRange(0,1))
+		"bool occluded(vec3 lo, vec3 hi) {\n"
+		"	vec2 screen_lo = vec2( 1e30);\n"
+		"	vec2 screen_hi = vec2(-1e30);\n"
+		"	float nearest = 1.0;\n"
+		"	for (int i = 0; i < 8; ++i) {\n"
+		"		vec4 c = PYRAMID_WORLD_TO_CLIP * vec4(corner(lo, hi, i), 1.0);\n"
+		"		if (c.w <= 1e-5) return false;\n" //reaches behind the eye
+		"		vec3 ndc = c.xyz / c.w;\n"
+		"		screen_lo = min(screen_lo, ndc.xy);\n"
+		"		screen_hi = max(screen_hi, ndc.xy);\n"
+		"		nearest = min(nearest, 0.5 * ndc.z + 0.5);\n"
+		"	}\n"
+		"	screen_lo = (0.5 * screen_lo + 0.5) * DEPTH_SIZE;\n"
+		"	screen_hi = (0.5 * screen_hi + 0.5) * DEPTH_SIZE;\n"
+		"	if (screen_hi.x < 0.0 || screen_hi.y < 0.0 || screen_lo.x >= DEPTH_SIZE.x || screen_lo.y >= DEPTH_SIZE.y) return false;\n" //wasn't in view
+		"	ivec2 a = ivec2(clamp(screen_lo, vec2(0.0), DEPTH_SIZE - 1.0)) / 2;\n" //(pyramid level 0 texels cover 2x2 pixels)
+		"	ivec2 b = ivec2(clamp(screen_hi, vec2(0.0), DEPTH_SIZE - 1.0)) / 2;\n"
+		//coarsest needed level where the box covers (at most) 2x2 texels:
+		"	int level = 0;\n"
+		"	while (level + 1 < PYRAMID_LEVELS && ((b.x >> level) - (a.x >> level) > 1 || (b.y >> level) - (a.y >> level) > 1)) ++level;\n"
+		"	ivec2 last = textureSize(PYRAMID, level) - 1;\n"
+		"	a = min(a >> level, last);\n"
+		"	b = min(b >> level, last);\n"
+		"	float farthest = max(\n"
+		"		max(texelFetch(PYRAMID, ivec2(a.x, a.y), level).r, texelFetch(PYRAMID, ivec2(b.x, a.y), level).r),\n"
+		"		max(texelFetch(PYRAMID, ivec2(a.x, b.y), level).r, texelFetch(PYRAMID, ivec2(b.x, b.y), level).r)\n"
+		"	);\n"
+		"	return nearest > farthest;\n"
+		"}\n"
+		"void main() {\n"
+		"	uint slot = gl_GlobalInvocationID.x;\n"
+		"	if (slot >= COUNT) return;\n"
+		"	vec3 lo = bounds[slot].lo.xyz;\n"
+		"	vec3 hi = bounds[slot].hi.xyz;\n"
+		"	bool visible = !outside_view(lo, hi) && !(USE_PYRAMID && occluded(lo, hi));\n"
+		"	commands[slot].instance_count = (visible ? 1u : 0u);\n"
+		"	if (visible) atomicAdd(visible_count, 1u);\n"
+		"}\n"
+	, "GPUCulling cull");
+
+	//make one level of the depth pyramid from the level below it (or from the depth copy):
+	reduce_program = gl_compile_compute_program(
+		ComputeHeader +
+		"#line " STR(__LINE__) "\n"
+		"layout(local_size_x = 8, local_size_y = 8) in;\n"
+		"uniform sampler2D SOURCE;\n"
+		"uniform int SOURCE_LEVEL;\n"
+		"layout(r32f, binding = 0) writeonly uniform highp image2D DESTINATION;\n"
+		"void main() {\n"
+		"	ivec2 at = ivec2(gl_GlobalInvocationID.xy);\n"
+		"	ivec2 size = imageSize(DESTINATION);\n"
+		"	if (at.x >= size.x || at.y >= size.y) return;\n"
+		"	ivec2 source_last = textureSize(SOURCE, SOURCE_LEVEL) - 1;\n"
+		"	ivec2 lo = 2 * at;\n"
+		//(levels are rounded down in size, so the last row and column also cover any leftover source texels)
+		"	ivec2 hi = min(lo + 1, source_last);\n"
+		"	if (at.x == size.x - 1) hi.x = source_last.x;\n"
+		"	if (at.y == size.y - 1) hi.y = source_last.y;\n"
+		"	float farthest = 0.0;\n"
+		"	for (int y = lo.y; y <= hi.y; ++y) {\n"
+		"		for (int x = lo.x; x <= hi.x; ++x) {\n"
+		"			farthest = max(farthest, texelFetch(SOURCE, ivec2(x, y), SOURCE_LEVEL).r);\n"
+		"		}\n"
+		"	}\n"
+		"	imageStore(DESTINATION, at, vec4(farthest));\n"
+		"}\n"
+	, "GPUCulling reduce");
+
+	WORLD_TO_CLIP_mat4 = glGetUniformLocation(cull_program, "WORLD_TO_CLIP");
+	PYRAMID_WORLD_TO_CLIP_mat4 = glGetUniformLocation(cull_program, "PYRAMID_WORLD_TO_CLIP");
+	USE_PYRAMID_bool = glGetUniformLocation(cull_program, "USE_PYRAMID");
+	DEPTH_SIZE_vec2 = glGetUniformLocation(cull_program, "DEPTH_SIZE");
+	PYRAMID_LEVELS_int = glGetUniformLocation(cull_program, "PYRAMID_LEVELS");
+	COUNT_uint = glGetUniformLocation(cull_program, "COUNT");
+	SOURCE_LEVEL_int = glGetUniformLocation(reduce_program, "SOURCE_LEVEL");
+
+	//(samplers read from texture unit 0)
+	glUseProgram(cull_program);
+	glUniform1i(glGetUniformLocation(cull_program, "PYRAMID"), 0);
+	glUseProgram(reduce_program);
+	glUniform1i(glGetUniformLocation(reduce_program, "SOURCE"), 0);
+	glUseProgram(0);
+
+	glGenBuffers(1, &bounds_buffer);
+	glGenBuffers(1, &command_buffer);
+	glGenBuffers(1, &visible_count_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, visible_count_buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	//(the depth copy's framebuffer has no color buffers)
+	glGenFramebuffers(1, &depth_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, depth_framebuffer);
+	GLenum none = GL_NONE;
+	glDrawBuffers(1, &none);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	GL_ERRORS();
+}
+
+GPUCulling::~GPUCulling() {
+	if (cull_program) glDeleteProgram(cull_program);
+	if (reduce_program) glDeleteProgram(reduce_program);
+	if (bounds_buffer) glDeleteBuffers(1, &bounds_buffer);
+	if (command_buffer) glDeleteBuffers(1, &command_buffer);
+	if (visible_count_buffer) glDeleteBuffers(1, &visible_count_buffer);
+	if (depth_framebuffer) glDeleteFramebuffers(1, &depth_framebuffer);
+	if (depth_texture) glDeleteTextures(1, &depth_texture);
+	if (pyramid) glDeleteTextures(1, &pyramid);
+}
+
+uint32_t GPUCulling::read_visible_count() const {
+	if (!supported()) return 0;
+	glBindBuffer(GL_COPY_READ_BUFFER, visible_count_buffer);
+	GLuint const *mapped = reinterpret_cast< GLuint const * >(glMapBufferRange(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT));
+	uint32_t count = (mapped ? *mapped : 0);
+	glUnmapBuffer(GL_COPY_READ_BUFFER);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	return count;
+}
+
+void GPUCulling::assign_slots(Scene const &scene) {
+	slots.clear();
+	unslotted.clear();
+	std::vector< Scene::Drawable const * > dynamic_slots;
+	for (auto const &drawable : scene.drawables) {
+		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
+		glm::vec3 min, max;
+		if (pipeline.program == 0 || pipeline.vao == 0 || pipeline.count == 0 || !drawable.world_bounds(&min, &max)) {
+			unslotted.emplace_back(&drawable);
+		} else if (drawable.dynamic) {
+			dynamic_slots.emplace_back(&drawable);
+		} else {
+			slots.emplace_back(&drawable);
+		}
+	}
+	static_count = uint32_t(slots.size());
+	slots.insert(slots.end(), dynamic_slots.begin(), dynamic_slots.end());
+
+	//(re-)allocate buffers, if needed:
+	if (buffer_slots < slots.size()) {
+		buffer_slots = std::max(slots.size(), 2 * buffer_slots);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, bounds_buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, buffer_slots * sizeof(Bounds), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, command_buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, buffer_slots * sizeof(Command), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	//upload bounds of every slot (only the dynamic ones change later):
+	bounds.resize(slots.size());
+	for (uint32_t i = 0; i < slots.size(); ++i) {
+		glm::vec3 min, max;
+		slots[i]->world_bounds(&min, &max);
+		bounds[i] = Bounds{glm::vec4(min, 0.0f), glm::vec4(max, 0.0f)};
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, bounds_buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, 0, bounds.size() * sizeof(Bounds), bounds.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	slotted_scene = &scene;
+	slotted_revision = scene.drawables.revision();
+}
+
+void GPUCulling::cull(Scene const &scene, glm::mat4 const &world_to_clip) {
+	assert(supported());
+	last_world_to_clip = world_to_clip;
+
+	if (slotted_scene != &scene || slotted_revision != scene.drawables.revision()) {
+		assign_slots(scene);
+	} else if (static_count < slots.size()) {
+		//dynamic drawables may have moved:
+		for (uint32_t i = static_count; i < slots.size(); ++i) {
+			glm::vec3 min, max;
+			if (!slots[i]->world_bounds(&min, &max)) min = max = glm::vec3(0.0f);
+			bounds[i] = Bounds{glm::vec4(min, 0.0f), glm::vec4(max, 0.0f)};
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, bounds_buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_count * sizeof(Bounds), (slots.size() - static_count) * sizeof(Bounds), bounds.data() + static_count);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	if (slots.empty()) return;
+
+	//vertex ranges (which depend on the level of detail) of every slot, with instance counts filled in by the cull program:
+	commands.resize(slots.size());
+	for (uint32_t i = 0; i < slots.size(); ++i) {
+		Scene::Drawable const &drawable = *slots[i];
+		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
+		if (pipeline.mesh && drawable.lod != 0 && drawable.lod < pipeline.mesh->lod_count) {
+			Mesh::LOD const &lod = pipeline.mesh->lods[drawable.lod];
+			commands[i] = Command{lod.count, 1, lod.start, 0};
+		} else {
+			commands[i] = Command{pipeline.count, 1, pipeline.start, 0};
+		}
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, command_buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, 0, commands.size() * sizeof(Command), commands.data());
+	GLuint zero = 0;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, visible_count_buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(GLuint), &zero);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glUseProgram(cull_program);
+	glUniformMatrix4fv(WORLD_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(world_to_clip));
+	glUniformMatrix4fv(PYRAMID_WORLD_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(pyramid_world_to_clip));
+	glUniform1i(USE_PYRAMID_bool, pyramid_valid ? 1 : 0);
+	glUniform2f(DEPTH_SIZE_vec2, float(depth_size.x), float(depth_size.y));
+	glUniform1i(PYRAMID_LEVELS_int, GLint(pyramid_levels));
+	glUniform1ui(COUNT_uint, GLuint(slots.size()));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, pyramid_valid ? pyramid : 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, bounds_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, command_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visible_count_buffer);
+
+	glDispatchCompute(GLuint((slots.size() + 63) / 64), 1, 1);
+	//commands are read by indirect draws (and the count, maybe, by read_visible_count()):
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+
+	GL_ERRORS();
+}
+
+void GPUCulling::draw(uint32_t slot, GLenum type) const {
+	assert(slot < slots.size());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+	glDrawArraysIndirect(type, reinterpret_cast< void const * >(uintptr_t(slot) * sizeof(Command)));
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GPUCulling::capture_depth() {
+	assert(supported());
+	pyramid_valid = false;
+
+	GLint draw_framebuffer = 0, read_framebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+	GLint viewport[4] = {0, 0, 0, 0};
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (viewport[2] <= 0 || viewport[3] <= 0) return;
+
+	//find the format of the framebuffer's depth, since blits need the formats to match:
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, draw_framebuffer);
+	GLenum depth_attachment = (draw_framebuffer == 0 ? GL_DEPTH : GL_DEPTH_ATTACHMENT);
+	GLenum stencil_attachment = (draw_framebuffer == 0 ? GL_STENCIL : GL_STENCIL_ATTACHMENT);
+	GLint depth_type = GL_NONE, stencil_type = GL_NONE;
+	glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depth_attachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &depth_type);
+	glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, stencil_attachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &stencil_type);
+	GLint depth_bits = 0, stencil_bits = 0, component_type = GL_NONE;
+	if (depth_type != GL_NONE) {
+		glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depth_attachment, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depth_bits);
+		glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depth_attachment, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &component_type);
+	}
+	if (stencil_type != GL_NONE) {
+		glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, stencil_attachment, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencil_bits);
+	}
+	GLenum format = GL_NONE;
+	if (depth_bits == 0) format = GL_NONE;
+	else if (component_type == GL_FLOAT) format = (stencil_bits ? GL_DEPTH32F_STENCIL8 : GL_DEPTH_COMPONENT32F);
+	else if (depth_bits <= 16 && !stencil_bits) format = GL_DEPTH_COMPONENT16;
+	else if (depth_bits <= 24) format = (stencil_bits ? GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT24);
+	#ifndef __ANDROID__
+	else if (depth_bits <= 32 && !stencil_bits) format = GL_DEPTH_COMPONENT32;
+	#endif
+	if (format == GL_NONE) {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+		return;
+	}
+
+	//(re-)allocate depth copy and pyramid to match the viewport:
+	glm::uvec2 size = glm::uvec2(viewport[2], viewport[3]);
+	if (size != depth_size || format != depth_format) {
+		depth_size = size;
+		depth_format = format;
+
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depth_framebuffer);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+		if (depth_texture) glDeleteTextures(1, &depth_texture);
+		glGenTextures(1, &depth_texture);
+		glBindTexture(GL_TEXTURE_2D, depth_texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, depth_format, depth_size.x, depth_size.y);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+		pyramid_size = glm::max(depth_size / 2u, glm::uvec2(1));
+		pyramid_levels = 1;
+		while ((std::max(pyramid_size.x, pyramid_size.y) >> pyramid_levels) != 0) ++pyramid_levels;
+		if (pyramid) glDeleteTextures(1, &pyramid);
+		glGenTextures(1, &pyramid);
+		glBindTexture(GL_TEXTURE_2D, pyramid);
+		glTexStorage2D(GL_TEXTURE_2D, pyramid_levels, GL_R32F, pyramid_size.x, pyramid_size.y);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, (stencil_bits ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT), GL_TEXTURE_2D, depth_texture, 0);
+	}
+
+	//copy depth:
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depth_framebuffer);
+	glBlitFramebuffer(
+		viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3],
+		0, 0, GLint(depth_size.x), GLint(depth_size.y),
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST
+	);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+
+	//reduce to the pyramid, one level at a time:
+	glUseProgram(reduce_program);
+	glActiveTexture(GL_TEXTURE0);
+	for (uint32_t level = 0; level < pyramid_levels; ++level) {
+		glBindTexture(GL_TEXTURE_2D, level == 0 ? depth_texture : pyramid);
+		glUniform1i(SOURCE_LEVEL_int, level == 0 ? 0 : GLint(level - 1));
+		glBindImageTexture(0, pyramid, GLint(level), GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glm::uvec2 level_size = glm::max(glm::uvec2(pyramid_size.x >> level, pyramid_size.y >> level), glm::uvec2(1));
+		glDispatchCompute((level_size.x + 7) / 8, (level_size.y + 7) / 8, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+
+	pyramid_world_to_clip = last_world_to_clip;
+	pyramid_valid = true;
+
+	GL_ERRORS();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+/*
+ * GPUCulling moves Scene::draw's per-drawable visibility tests to the GPU:
+ *  - world-space bounds of drawables are kept in a GPU buffer
+ *    (static drawables' bounds are uploaded once; dynamic drawables' every frame)
+ *  - a compute pass tests every box against the view frustum and against a
+ *    depth pyramid ("hierarchical z-buffer") made from the previous frame's depth
+ *  - each drawable has a slot in an indirect draw buffer; the compute pass sets
+ *    the slot's instance count to 1 (visible) or 0 (culled), and Scene::draw
+ *    issues glDrawArraysIndirect for every slot -- the CPU never reads the results.
+ *
+ * Scene::draw uses one of these if Scene::gpu_culling is set and supported() is true
+ *  (OpenGL 4.3 or OpenGL ES 3.1 -- i.e., compute shaders and indirect draws).
+ *  At the end of the draw it copies the depth buffer of the current framebuffer
+ *  (the viewport's area) to build the pyramid used in the next frame.
+ *
+ * Since depth is from the previous frame, use one GPUCulling per view (e.g., per eye),
+ *  and expect something newly uncovered by a fast-moving camera or object to appear a frame late.
+ *
+ * Clusters (Mesh::clusters) are not culled individually on this path.
+ *
+ * Runs under Mesa's software renderer (e.g., LIBGL_ALWAYS_SOFTWARE=1 scenes/show-scene --gpu-culling ...),
+ *  so it can be checked on machines without a GPU.
+ *
+ */
+
+#include "GL.hpp"
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct GPUCulling {
+	//(needs a current OpenGL context; checks for support, and compiles compute programs if supported)
+	GPUCulling();
+	~GPUCulling();
+
+	bool supported() const { return cull_program != 0; }
+
+	//drawables that were visible in the latest cull(); waits for the GPU, so only for debugging and statistics:
+	uint32_t read_visible_count() const;
+	uint32_t slot_count() const { return uint32_t(slots.size()); }
+
+	//call to re-assign slots (e.g., after changing drawables' meshes or 'dynamic' flags):
+	// (slots are re-assigned automatically if a different scene is drawn or drawables are added or removed)
+	void invalidate() { slotted_scene = nullptr; }
+
+	//-- internals (used by Scene::draw) ---
+
+	//drawables with slots (static drawables first, then dynamic), and drawables without (always drawn):
+	std::vector< Scene::Drawable const * > slots;
+	std::vector< Scene::Drawable const * > unslotted;
+	uint32_t static_count = 0; //slots with static drawables
+
+	//test every slot against the view (and the previous frame's depth), writing indirect draw commands:
+	void cull(Scene const &scene, glm::mat4 const &world_to_clip);
+	//draw slot 'slot' (with the current program, vertex array, and uniforms) if it was found visible:
+	void draw(uint32_t slot, GLenum type) const;
+	//copy depth of the current viewport into the pyramid for the next frame's cull():
+	void capture_depth();
+
+	Scene const *slotted_scene = nullptr;
+	uint64_t slotted_revision = 0; //scene.drawables.revision() when slots were assigned
+	void assign_slots(Scene const &scene);
+
+	struct Bounds {
+		glm::vec4 min; //(w unused)
+		glm::vec4 max;
+	};
+	static_assert(sizeof(Bounds) == 32, "Bounds is packed.");
+	std::vector< Bounds > bounds; //(CPU copy, used while uploading)
+
+	//same layout as the DrawArraysIndirectCommand read by glDrawArraysIndirect:
+	struct Command {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first;
+		GLuint reserved; //(base instance; must be zero on OpenGL ES)
+	};
+	static_assert(sizeof(Command) == 16, "Command is packed.");
+	std::vector< Command > commands; //(CPU copy, used while uploading)
+
+	GLuint bounds_buffer = 0;
+	GLuint command_buffer = 0;
+	GLuint visible_count_buffer = 0;
+	size_t buffer_slots = 0; //slots allocated in the buffers
+
+	GLuint cull_program = 0;
+	GLuint reduce_program = 0;
+
+	//depth copied from the framebuffer (matching its depth format, so it can be blitted):
+	GLuint depth_framebuffer = 0;
+	GLuint depth_texture = 0;
+	GLenum depth_format = 0;
+	glm::uvec2 depth_size = glm::uvec2(0);
+
+	//pyramid of farthest depths (level 0 is half the size of the depth copy):
+	GLuint pyramid = 0;
+	glm::uvec2 pyramid_size = glm::uvec2(0);
+	uint32_t pyramid_levels = 0;
+	bool pyramid_valid = false;
+
+	glm::mat4 last_world_to_clip = glm::mat4(1.0f); //latest cull()'s view (the view captured into the pyramid)
+	glm::mat4 pyramid_world_to_clip = glm::mat4(1.0f); //view the pyramid was captured from
+
+	GPUCulling(GPUCulling const &) = delete;
+};
@@ -0,0 +1,217 @@
+#include "GeometryPool.hpp"
+
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+
+#ifndef __ANDROID__
+#include <SDL.h>
+
+//glMultiDrawArraysIndirect is core in OpenGL 4.3 -- newer than the 3.3 core functions in GL.hpp
+// (and not present at all on, e.g., macOS) -- so it is looked up at runtime instead:
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+typedef void (APIENTRY *MultiDrawArraysIndirect)(GLenum mode, const void *indirect, GLsizei drawcount, GLsizei stride);
+
+static MultiDrawArraysIndirect get_multi_draw_arrays_indirect() {
+	static bool checked = false;
+	static MultiDrawArraysIndirect fn = nullptr;
+	if (!checked) {
+		checked = true;
+		GLint major = 0, minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		if (major > 4 || (major == 4 && minor >= 3)) {
+			fn = (MultiDrawArraysIndirect)SDL_GL_GetProcAddress("glMultiDrawArraysIndirect");
+		}
+		if (!fn) {
+			std::cout << "NOTE: glMultiDrawArraysIndirect not available (OpenGL " << major << "." << minor << "); using glMultiDrawArrays." << std::endl;
+		}
+	}
+	return fn;
+}
+#endif //__ANDROID__
+
+GeometryPool::GeometryPool(GLsizei stride_) : stride(stride_) {
+	assert(stride > 0);
+	glGenBuffers(1, &buffer);
+}
+
+GeometryPool::~GeometryPool() {
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+static std::map< std::string, GeometryPool * > &shared_pools() {
+	static std::map< std::string, GeometryPool * > pools;
+	return pools;
+}
+
+GeometryPool &GeometryPool::shared(std::string const &layout, GLsizei stride) {
+	std::map< std::string, GeometryPool * > &pools = shared_pools();
+	auto f = pools.find(layout);
+	if (f == pools.end()) {
+		f = pools.emplace(layout, new GeometryPool(stride)).first;
+	}
+	if (f->second->stride != stride) {
+		throw std::runtime_error("Geometry pool for layout '" + layout + "' has stride " + std::to_string(f->second->stride) + ", not " + std::to_string(stride) + ".");
+	}
+	return *f->second;
+}
+
+GLuint GeometryPool::largest_shared_size() {
+	GLuint largest = 0;
+	for (auto const &[layout, pool] : shared_pools()) {
+		largest = std::max(largest, pool->size);
+	}
+	return largest;
+}
+
+GLuint GeometryPool::append(void const *data, GLuint count) {
+	grow(size + count);
+	GLuint first = size;
+	size += count;
+	upload(first, data, count);
+	return first;
+}
+
+GLuint GeometryPool::allocate(GLuint count) {
+	if (count == 0) return size;
+
+	//first released range big enough:
+	for (auto f = free_ranges.begin(); f != free_ranges.end(); ++f) {
+		if (f->second < count) continue;
+		GLuint first = f->first;
+		GLuint rest = f->second - count;
+		free_ranges.erase(f);
+		if (rest) free_ranges.emplace(first + count, rest);
+		released -= count;
+		return first;
+	}
+
+	grow(size + count);
+	GLuint first = size;
+	size += count;
+	return first;
+}
+
+void GeometryPool::upload(GLuint first, void const *data, GLuint count) {
+	assert(first + count <= size);
+	if (count > 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, GLintptr(first) * stride, GLsizeiptr(count) * stride, data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	GL_ERRORS();
+}
+
+void GeometryPool::release(GLuint first, GLuint count) {
+	if (count == 0) return;
+	assert(first + count <= size);
+
+	//merge with neighboring released ranges:
+	auto after = free_ranges.lower_bound(first);
+	assert((after == free_ranges.end() || first + count <= after->first) && "range was already released");
+	if (after != free_ranges.end() && after->first == first + count) {
+		count += after->second;
+		released -= after->second;
+		after = free_ranges.erase(after);
+	}
+	if (after != free_ranges.begin()) {
+		auto before = std::prev(after);
+		assert(before->first + before->second <= first && "range was already released");
+		if (before->first + before->second == first) {
+			first = before->first;
+			count += before->second;
+			released -= before->second;
+			free_ranges.erase(before);
+		}
+	}
+
+	//ranges at the end just shrink the pool:
+	if (first + count == size) {
+		size = first;
+	} else {
+		free_ranges.emplace(first, count);
+		released += count;
+	}
+}
+
+void GeometryPool::grow(GLuint new_size) {
+	if (new_size <= capacity) return;
+
+	GLuint new_capacity = std::max(new_size, std::max(2 * capacity, GLuint(1 << 16)));
+
+	//re-allocate storage without changing the buffer's name, by copying through a temporary buffer:
+	GLuint temp = 0;
+	if (size > 0) {
+		glGenBuffers(1, &temp);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, temp);
+		glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(size) * stride, nullptr, GL_STREAM_COPY);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(size) * stride);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(new_capacity) * stride, nullptr, GL_STATIC_DRAW);
+
+	if (size > 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, temp);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(size) * stride);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &temp);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	capacity = new_capacity;
+
+	GL_ERRORS();
+}
+
+void MultiDraw::add(GLuint first, GLuint count, GLuint base_instance) {
+	if (!commands.empty() && commands.back().base_instance == base_instance && commands.back().first + commands.back().count == first) {
+		commands.back().count += count;
+	} else {
+		commands.emplace_back(Command{count, 1, first, base_instance});
+	}
+}
+
+void MultiDraw::draw(GLenum type) const {
+	if (commands.empty()) return;
+
+	#ifdef __ANDROID__
+	//(GLES has neither glMultiDrawArrays nor glMultiDrawArraysIndirect)
+	for (auto const &command : commands) {
+		glDrawArrays(type, command.first, command.count);
+	}
+	#else
+	if (MultiDrawArraysIndirect multi_draw_arrays_indirect = get_multi_draw_arrays_indirect()) {
+		//commands are streamed through a buffer that is re-specified every draw:
+		static GLuint indirect_buffer = 0;
+		if (indirect_buffer == 0) glGenBuffers(1, &indirect_buffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(Command), commands.data(), GL_STREAM_DRAW);
+		multi_draw_arrays_indirect(type, nullptr, GLsizei(commands.size()), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	} else {
+		//(glMultiDrawArrays can't pass base_instance, so this only works for commands that don't use it)
+		static std::vector< GLint > firsts;
+		static std::vector< GLsizei > counts;
+		firsts.clear();
+		counts.clear();
+		for (auto const &command : commands) {
+			assert(command.base_instance == 0 && command.instance_count == 1);
+			firsts.emplace_back(command.first);
+			counts.emplace_back(command.count);
+		}
+		glMultiDrawArrays(type, firsts.data(), counts.data(), GLsizei(firsts.size()));
+	}
+	#endif
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+ * A GeometryPool keeps the vertices of many meshes (e.g., every loaded
+ *  MeshBuffer with the same vertex layout) in one OpenGL buffer, so they can
+ *  all be drawn with one vertex array object and batched into multi-draws.
+ *
+ * Most vertices are appended once and kept for the life of the program, but
+ *  ranges can also be allocated and released (e.g., by WorldStream, as cells
+ *  of the world are loaded and unloaded); released ranges are re-used by
+ *  later allocations, so the pool only grows as far as the most in use at once
+ *  (plus fragmentation).
+ *
+ * A MultiDraw collects vertex ranges (in whatever buffer the current vertex
+ *  array object refers to) and draws them with as few calls as possible:
+ *  - glMultiDrawArraysIndirect, where available (desktop OpenGL 4.3+)
+ *  - glMultiDrawArrays, otherwise
+ *  - a loop of glDrawArrays on GLES
+ *
+ */
+
+#include "GL.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct GeometryPool {
+	GeometryPool(GLsizei stride);
+	~GeometryPool();
+
+	//the pool shared by everything with a given vertex layout (created on first use; never freed):
+	// (MeshBuffer uses the name of the chunk its vertices came from -- "pnct" or "pnq0" -- as the layout; "pns0" for skinned vertices)
+	static GeometryPool &shared(std::string const &layout, GLsizei stride);
+	//vertices in use in the biggest shared pool (so a bound on any range drawn from one; 0 if there are none yet):
+	static GLuint largest_shared_size();
+
+	//copy 'count' vertices (of 'stride' bytes each) to the end of the pool:
+	// returns index of the first vertex
+	GLuint append(void const *data, GLuint count);
+
+	//reserve room for 'count' vertices (in a released range, if one is big enough, otherwise at the end):
+	// returns index of the first vertex; contents are undefined until upload()'d
+	GLuint allocate(GLuint count);
+	//copy 'count' vertices into the pool starting at vertex 'first':
+	// (may be called several times per range -- e.g., to spread uploads over frames)
+	void upload(GLuint first, void const *data, GLuint count);
+	//return a range from allocate() (or append()) to the pool:
+	// (meshes drawing from it must be gone; the vertices may be overwritten by the next allocate())
+	void release(GLuint first, GLuint count);
+
+	GLsizei stride; //bytes per vertex
+
+	//This is the OpenGL vertex buffer object containing the vertices:
+	// (keeps its name as the pool grows, so vertex array objects that use it remain valid)
+	GLuint buffer = 0;
+
+	GLuint size = 0; //vertices in use (including released ranges before the last range in use)
+	GLuint capacity = 0; //vertices allocated
+	GLuint released = 0; //vertices in released ranges
+
+	GeometryPool(GeometryPool const &) = delete;
+
+	//-- internals ---
+	std::map< GLuint, GLuint > free_ranges; //first -> count of released ranges (coalesced; none touch 'size')
+	void grow(GLuint new_size); //make capacity at least 'new_size' (keeping contents)
+};
+
+struct MultiDraw {
+	//same layout as the DrawArraysIndirectCommand structure read by glMultiDrawArraysIndirect:
+	struct Command {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first;
+		GLuint base_instance;
+	};
+	static_assert(sizeof(Command) == 16, "Command is packed.");
+	std::vector< Command > commands;
+
+	void clear() { commands.clear(); }
+	bool empty() const { return commands.empty(); }
+
+	//add a range of vertices to draw (merged with the previous range if they are contiguous):
+	void add(GLuint first, GLuint count, GLuint base_instance = 0);
+
+	//draw all ranges with the currently bound program and vertex array object:
+	void draw(GLenum type) const;
+};
@@ -1,49 +1,81 @@
 #include "LitColorTextureProgram.hpp"
 
+#include "Skinning.hpp"
 #include "gl_compile_program.hpp"
 #include "gl_errors.hpp"
 
 Scene::Drawable::Pipeline lit_color_texture_program_pipeline;
+Scene::Drawable::Pipeline quantized_lit_color_texture_program_pipeline;
+Scene::Drawable::Pipeline skinned_lit_color_texture_program_pipeline;
+
+//helper used by all program variants to build their pipeline templates:
+static void make_pipeline(LitColorTextureProgram const &program, Scene::Drawable::Pipeline *pipeline_) {
+	assert(pipeline_);
+	auto &pipeline = *pipeline_;
+
+	pipeline.program = program.program;
+
+	pipeline.OBJECT_TO_CLIP_mat4 = program.OBJECT_TO_CLIP_mat4;
+	pipeline.OBJECT_TO_LIGHT_mat4x3 = program.OBJECT_TO_LIGHT_mat4x3;
+	pipeline.NORMAL_TO_LIGHT_mat3 = program.NORMAL_TO_LIGHT_mat3;
+
+	/* This will be used later if/when we build a light loop into the Scene:
+	pipeline.LIGHT_TYPE_int = program.LIGHT_TYPE_int;
+	pipeline.LIGHT_LOCATION_vec3 = program.LIGHT_LOCATION_vec3;
+	pipeline.LIGHT_DIRECTION_vec3 = program.LIGHT_DIRECTION_vec3;
+	pipeline.LIGHT_ENERGY_vec3 = program.LIGHT_ENERGY_vec3;
+	pipeline.LIGHT_CUTOFF_float = program.LIGHT_CUTOFF_float;
+	*/
+
+	//make a 1-pixel white texture to bind by default (shared between variants):
+	static GLuint tex = 0;
+	if (tex == 0) {
+		glGenTextures(1, &tex);
+
+		glBindTexture(GL_TEXTURE_2D, tex);
+		std::vector< glm::u8vec4 > tex_data(1, glm::u8vec4(0xff));
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex_data.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	pipeline.textures[0].texture = tex;
+	pipeline.textures[0].target = GL_TEXTURE_2D;
+}
 
 Load< LitColorTextureProgram > lit_color_texture_program(LoadTagEarly, []() -> LitColorTextureProgram const * {
 	LitColorTextureProgram *ret = new LitColorTextureProgram();
 
 	//----- build the pipeline template -----
-	lit_color_texture_program_pipeline.program = ret->program;
+	make_pipeline(*ret, &lit_color_texture_program_pipeline);
 
-	lit_color_texture_program_pipeline.OBJECT_TO_CLIP_mat4 = ret->OBJECT_TO_CLIP_mat4;
-	lit_color_texture_program_pipeline.OBJECT_TO_LIGHT_mat4x3 = ret->OBJECT_TO_LIGHT_mat4x3;
-	lit_color_texture_program_pipeline.NORMAL_TO_LIGHT_mat3 = ret->NORMAL_TO_LIGHT_mat3;
+	return ret;
+});
 
-	/* This will be used later if/when we build a light loop into the Scene:
-	lit_color_texture_program_pipeline.LIGHT_TYPE_int = ret->LIGHT_TYPE_int;
-	lit_color_texture_program_pipeline.LIGHT_LOCATION_vec3 = ret->LIGHT_LOCATION_vec3;
-	lit_color_texture_program_pipeline.LIGHT_DIRECTION_vec3 = ret->LIGHT_DIRECTION_vec3;
-	lit_color_texture_program_pipeline.LIGHT_ENERGY_vec3 = ret->LIGHT_ENERGY_vec3;
-	lit_color_texture_program_pipeline.LIGHT_CUTOFF_float = ret->LIGHT_CUTOFF_float;
-	*/
+Load< LitColorTextureProgram > quantized_lit_color_texture_program(LoadTagEarly, []() -> LitColorTextureProgram const * {
+	LitColorTextureProgram *ret = new LitColorTextureProgram(true);
 
-	//make a 1-pixel white texture to bind by default:
-	GLuint tex;
-	glGenTextures(1, &tex);
+	//----- build the pipeline template -----
+	make_pipeline(*ret, &quantized_lit_color_texture_program_pipeline);
 
-	glBindTexture(GL_TEXTURE_2D, tex);
-	std::vector< glm::u8vec4 > tex_data(1, glm::u8vec4(0xff));
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex_data.data());
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	return ret;
+});
 
+Load< LitColorTextureProgram > skinned_lit_color_texture_program(LoadTagEarly, []() -> LitColorTextureProgram const * {
+	LitColorTextureProgram *ret = new LitColorTextureProgram(false, true);
 
-	lit_color_texture_program_pipeline.textures[0].texture = tex;
-	lit_color_texture_program_pipeline.textures[0].target = GL_TEXTURE_2D;
+	//----- build the pipeline template -----
+	make_pipeline(*ret, &skinned_lit_color_texture_program_pipeline);
 
 	return ret;
 });
 
-LitColorTextureProgram::LitColorTextureProgram() {
+LitColorTextureProgram::LitColorTextureProgram(bool quantized, bool skinned) {
+	assert(!(quantized && skinned) && "skinned vertices have float normals");
+
 	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
 	program = gl_compile_program(
 		//vertex shader:
@@ -52,22 +84,54 @@ LitColorTextureProgram::LitColorTextureProgram() {
 #else
 		"#version 330\n"
 #endif
+		+ std::string(quantized ? "#define QUANTIZED\n" : "")
+		+ std::string(skinned ? "#define SKINNED\n#define MAX_BONES " + std::to_string(SkinPalettes::MaxBones) + "\n" : "") +
 		"#line " STR(__LINE__) "\n"
 		"uniform mat4 OBJECT_TO_CLIP;\n"
 		"uniform mat4x3 OBJECT_TO_LIGHT;\n"
 		"uniform mat3 NORMAL_TO_LIGHT;\n"
-		"in vec4 Position;\n"
-		"in vec3 Normal;\n"
-		"in vec4 Color;\n"
-		"in vec2 TexCoord;\n"
+		"layout(location=0) in vec4 Position;\n" //(attribute locations as in MeshBuffer)
+		"#ifdef QUANTIZED\n"
+		"layout(location=1) in vec2 Normal;\n" //octahedral-encoded
+		"vec3 decode_normal(vec2 e) {\n"
+		"	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+		"	if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);\n"
+		"	return normalize(n);\n"
+		"}\n"
+		"#else\n"
+		"layout(location=1) in vec3 Normal;\n"
+		"vec3 decode_normal(vec3 n) { return n; }\n"
+		"#endif\n"
+		"layout(location=2) in vec4 Color;\n"
+		"layout(location=3) in vec2 TexCoord;\n"
+		"#ifdef SKINNED\n"
+		"layout(location=4) in vec4 BoneIndices;\n"
+		"layout(location=5) in vec4 BoneWeights;\n"
+		"layout(std140) uniform Bones {\n"
+		"	vec4 BONES[3 * MAX_BONES];\n" //three rows of each bone's matrix
+		"};\n"
+		"mat4x3 bone(float index) {\n"
+		"	int i = 3 * int(index);\n"
+		"	return transpose(mat3x4(BONES[i], BONES[i+1], BONES[i+2]));\n"
+		"}\n"
+		"#endif\n"
 		"out vec3 position;\n"
 		"out vec3 normal;\n"
 		"out vec4 color;\n"
 		"out vec2 texCoord;\n"
 		"void main() {\n"
-		"	gl_Position = OBJECT_TO_CLIP * Position;\n"
-		"	position = OBJECT_TO_LIGHT * Position;\n"
-		"	normal = NORMAL_TO_LIGHT * Normal;\n"
+		"#ifdef SKINNED\n" //(bone matrices are also used for normals, so bones should be scaled uniformly)
+		"	mat4x3 skin = BoneWeights.x * bone(BoneIndices.x) + BoneWeights.y * bone(BoneIndices.y)\n"
+		"	            + BoneWeights.z * bone(BoneIndices.z) + BoneWeights.w * bone(BoneIndices.w);\n"
+		"	vec4 p = vec4(skin * Position, 1.0);\n"
+		"	vec3 n = mat3(skin) * Normal;\n"
+		"#else\n"
+		"	vec4 p = Position;\n"
+		"	vec3 n = decode_normal(Normal);\n"
+		"#endif\n"
+		"	gl_Position = OBJECT_TO_CLIP * p;\n"
+		"	position = OBJECT_TO_LIGHT * p;\n"
+		"	normal = NORMAL_TO_LIGHT * n;\n"
 		"	color = Color;\n"
 		"	texCoord = TexCoord;\n"
 		"}\n"
@@ -118,16 +182,20 @@ LitColorTextureProgram::LitColorTextureProgram() {
 		"	fragColor = vec4(e*albedo.rgb, albedo.a);\n"
 		"}\n"
 	,
-		"LitColorTextureProgram"
+		quantized ? "LitColorTextureProgram(quantized)" : (skinned ? "LitColorTextureProgram(skinned)" : "LitColorTextureProgram")
 	);
 	//As you can see above, adjacent strings in C/C++ are concatenated.
 	// this is very useful for writing long shader programs inline.
 
-	//look up the locations of vertex attributes:
-	Position_vec4 = glGetAttribLocation(program, "Position");
-	Normal_vec3 = glGetAttribLocation(program, "Normal");
-	Color_vec4 = glGetAttribLocation(program, "Color");
-	TexCoord_vec2 = glGetAttribLocation(program, "TexCoord");
+	//vertex attributes are at fixed locations (see MeshBuffer), so don't need to be looked up:
+	Position_vec4 = MeshBuffer::PositionLocation;
+	Normal_vec3 = MeshBuffer::NormalLocation;
+	Color_vec4 = MeshBuffer::ColorLocation;
+	TexCoord_vec2 = MeshBuffer::TexCoordLocation;
+	if (skinned) {
+		BoneIndices_vec4 = MeshBuffer::BoneIndicesLocation;
+		BoneWeights_vec4 = MeshBuffer::BoneWeightsLocation;
+	}
 
 	//look up the locations of uniforms:
 	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
@@ -148,6 +216,11 @@ LitColorTextureProgram::LitColorTextureProgram() {
 
 	glUniform1i(TEX_sampler2D, 0); //set TEX to sample from GL_TEXTURE0
 
+	//bone palettes are bound (by SkinPalettes) at a fixed uniform buffer binding:
+	if (skinned) {
+		glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Bones"), SkinPalettes::Binding);
+	}
+
 	glUseProgram(0); //unbind program -- glUniform* calls refer to ??? now
 }
 
@@ -6,16 +6,20 @@
 
 //Shader program that draws transformed, lit, textured vertices tinted with vertex colors:
 struct LitColorTextureProgram {
-	LitColorTextureProgram();
+	//if 'quantized' is set, the program reads octahedral-encoded normals (for use with quantized MeshBuffers):
+	//if 'skinned' is set, the program blends bone matrices from a palette (for use with skinned MeshBuffers; see Skinning.hpp):
+	LitColorTextureProgram(bool quantized = false, bool skinned = false);
 	~LitColorTextureProgram();
 
 	GLuint program = 0;
 
 	//Attribute (per-vertex variable) locations:
 	GLuint Position_vec4 = -1U;
-	GLuint Normal_vec3 = -1U;
+	GLuint Normal_vec3 = -1U; //(Normal_vec2 in the quantized variant)
 	GLuint Color_vec4 = -1U;
 	GLuint TexCoord_vec2 = -1U;
+	GLuint BoneIndices_vec4 = -1U; //(skinned variant only)
+	GLuint BoneWeights_vec4 = -1U; //(skinned variant only)
 
 	//Uniform (per-invocation variable) locations:
 	GLuint OBJECT_TO_CLIP_mat4 = -1U;
@@ -31,6 +35,9 @@ struct LitColorTextureProgram {
 	
 	//Textures:
 	//TEXTURE0 - texture that is accessed by TexCoord
+
+	//Uniform blocks:
+	//Bones (skinned variant only) - bone palette, at binding SkinPalettes::Binding
 };
 
 extern Load< LitColorTextureProgram > lit_color_texture_program;
@@ -38,3 +45,11 @@ extern Load< LitColorTextureProgram > lit_color_texture_program;
 //For convenient scene-graph setup, copy this object:
 // NOTE: by default, has texture bound to 1-pixel white texture -- so it's okay to use with vertex-color-only meshes.
 extern Scene::Drawable::Pipeline lit_color_texture_program_pipeline;
+
+//Variant of the above for drawing meshes from quantized MeshBuffers:
+extern Load< LitColorTextureProgram > quantized_lit_color_texture_program;
+extern Scene::Drawable::Pipeline quantized_lit_color_texture_program_pipeline;
+
+//Variant for drawing SkinnedModels (the pipeline's set_uniforms and vao are filled in by SkinnedModel):
+extern Load< LitColorTextureProgram > skinned_lit_color_texture_program;
+extern Scene::Drawable::Pipeline skinned_lit_color_texture_program_pipeline;
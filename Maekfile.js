@@ -38,7 +38,18 @@ const common_sources = [
 	'DrawLines.cpp',
 	'ColorProgram.cpp',
 	'Scene.cpp',
+	'SceneInstance.cpp',
+	'SceneSnapshot.cpp',
+	'Animation.cpp',
+	'Skinning.cpp',
 	'Mesh.cpp',
+	'GeometryPool.cpp',
+	'MeshBVH.cpp',
+	'AABBTree.cpp',
+	'Broadphase.cpp',
+	'OcclusionBuffer.cpp',
+	'GPUCulling.cpp',
+	'WorldStream.cpp',
 	//'load_save_png.cpp', //<-- don't want to do a libpng compile for android just now
 	'gl_compile_program.cpp',
 	'Mode.cpp',
@@ -58,6 +69,31 @@ const show_scene_sources = [
 	'ShowSceneMode.cpp',
 ];
 
+//offline mesh processing (doesn't need common_sources):
+const cook_meshes_sources = [
+	'cook-meshes.cpp',
+];
+const bake_pvs_sources = [
+	'bake-pvs.cpp',
+];
+const cook_cells_sources = [
+	'cook-cells.cpp',
+];
+
+//benchmarks (console programs, linked with common_sources):
+const broadphase_bench_sources = [
+	'broadphase-bench.cpp',
+];
+const stream_bench_sources = [
+	'stream-bench.cpp',
+];
+const anim_bench_sources = [
+	'anim-bench.cpp',
+];
+const load_bench_sources = [
+	'load-bench.cpp',
+];
+
 
 //---- now the desktop platform build steps ----
 
@@ -139,6 +175,13 @@ const game_objs = game_sources.map((x) => maek.CPP(x));
 const common_objs = common_sources.map((x) => maek.CPP(x));
 const show_mesh_objs = show_mesh_sources.map((x) => maek.CPP(x));
 const show_scene_objs = show_scene_sources.map((x) => maek.CPP(x));
+const cook_meshes_objs = cook_meshes_sources.map((x) => maek.CPP(x));
+const bake_pvs_objs = bake_pvs_sources.map((x) => maek.CPP(x));
+const cook_cells_objs = cook_cells_sources.map((x) => maek.CPP(x));
+const broadphase_bench_objs = broadphase_bench_sources.map((x) => maek.CPP(x));
+const stream_bench_objs = stream_bench_sources.map((x) => maek.CPP(x));
+const anim_bench_objs = anim_bench_sources.map((x) => maek.CPP(x));
+const load_bench_objs = load_bench_sources.map((x) => maek.CPP(x));
 
 
 
@@ -149,9 +192,16 @@ const show_scene_objs = show_scene_sources.map((x) => maek.CPP(x));
 const game_exe = maek.LINK([...game_objs, ...common_objs], 'dist/game');
 const show_meshes_exe = maek.LINK([...show_mesh_objs, ...common_objs], 'scenes/show-meshes');
 const show_scene_exe = maek.LINK([...show_scene_objs, ...common_objs], 'scenes/show-scene');
+const cook_meshes_exe = maek.LINK([...cook_meshes_objs], 'scenes/cook-meshes');
+const bake_pvs_exe = maek.LINK([...bake_pvs_objs], 'scenes/bake-pvs');
+const cook_cells_exe = maek.LINK([...cook_cells_objs], 'scenes/cook-cells');
+const broadphase_bench_exe = maek.LINK([...broadphase_bench_objs, ...common_objs], 'bench/broadphase-bench');
+const stream_bench_exe = maek.LINK([...stream_bench_objs, ...common_objs], 'bench/stream-bench');
+const anim_bench_exe = maek.LINK([...anim_bench_objs, ...common_objs], 'bench/anim-bench');
+const load_bench_exe = maek.LINK([...load_bench_objs, ...common_objs], 'bench/load-bench');
 
 //set the default target to the game (and copy the readme files):
-maek.TARGETS = [game_exe, show_meshes_exe, show_scene_exe, ...copies];
+maek.TARGETS = [game_exe, show_meshes_exe, show_scene_exe, cook_meshes_exe, bake_pvs_exe, cook_cells_exe, broadphase_bench_exe, stream_bench_exe, anim_bench_exe, load_bench_exe, ...copies];
 
 //---- android build stuff ----
 
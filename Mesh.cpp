@@ -1,4 +1,5 @@
 #include "Mesh.hpp"
+#include "GeometryPool.hpp"
 #include "asset_stream.hpp"
 #include "read_write_chunk.hpp"
 
@@ -9,47 +10,61 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <set>
+#include <map>
+#include <algorithm>
 #include <cstddef>
+#include <cmath>
 
-MeshBuffer::MeshBuffer(std::string const &filename) {
-	glGenBuffers(1, &buffer);
+bool MeshBuffer::verify_metadata = false;
 
+//FNV-1a (must match 'cook-meshes'):
+static uint64_t hash_vertex_data(void const *data, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ reinterpret_cast< uint8_t const * >(data)[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+MeshBuffer::MeshBuffer(std::string const &filename, uint32_t flags, std::unordered_set< std::string > const *occluder_names) {
 	std::unique_ptr< std::istream > file_str = asset_stream(filename);
 	std::istream &file = *file_str;
 
 	GLuint total = 0;
+	GLuint base = 0; //index of first vertex in the geometry pool
 
-	struct Vertex {
-		glm::vec3 Position;
-		glm::vec3 Normal;
-		glm::u8vec4 Color;
-		glm::vec2 TexCoord;
-	};
-	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
 	std::vector< Vertex > data;
+	std::vector< QuantizedVertex > quantized_data;
 
 	//read + upload data chunk:
 	if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pnct") {
-		read_chunk(file, "pnct", &data);
+		//.pnct files hold either float ('pnct') or quantized ('pnq0') vertex data:
+		quantized = (peek_chunk_magic(file) == "pnq0");
 
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if (!quantized) {
+			read_chunk(file, "pnct", &data);
 
-		total = GLuint(data.size()); //store total for later checks on index
+			//upload data (appending it to the pool shared by all MeshBuffers with this layout):
+			base = use_layout(Layout::Float).append(data.data(), GLuint(data.size()));
 
-		//store attrib locations:
-		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
-		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
-		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
-		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+			total = GLuint(data.size()); //store total for later checks on index
+		} else {
+			read_chunk(file, "pnq0", &quantized_data);
+
+			//upload data:
+			base = use_layout(Layout::Quantized).append(quantized_data.data(), GLuint(quantized_data.size()));
+
+			total = GLuint(quantized_data.size()); //store total for later checks on index
+		}
 	} else {
 		throw std::runtime_error("Unknown file type '" + filename + "'");
 	}
 
-	std::vector< char > strings;
+	if (flags & KeepVertices) {
+		uint8_t const *stored = (quantized ? reinterpret_cast< uint8_t const * >(quantized_data.data()) : reinterpret_cast< uint8_t const * >(data.data()));
+		vertices.assign(stored, stored + size_t(total) * (quantized ? sizeof(QuantizedVertex) : sizeof(Vertex)));
+	}
+
 	read_chunk(file, "str0", &strings);
 
 	{ //read index chunk, add to meshes:
@@ -62,77 +77,417 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		std::vector< IndexEntry > index;
 		read_chunk(file, "idx0", &index);
 
-		for (auto const &entry : index) {
+		//quantized files also store the bounding box each mesh was quantized against:
+		struct BoxEntry {
+			glm::vec3 min, max;
+		};
+		static_assert(sizeof(BoxEntry) == 24, "Box entry should be packed");
+
+		std::vector< BoxEntry > boxes;
+		if (quantized) {
+			read_chunk(file, "box0", &boxes);
+			if (boxes.size() != index.size()) {
+				throw std::runtime_error("box chunk has " + std::to_string(boxes.size()) + " entries but index has " + std::to_string(index.size()));
+			}
+		}
+
+		//cooked files also store bounds, counts, and hashes of each mesh:
+		struct MetaEntry {
+			glm::vec3 min, max;
+			glm::vec3 center; float radius;
+			uint32_t vertex_count, triangle_count;
+			uint64_t hash;
+		};
+		static_assert(sizeof(MetaEntry) == 56, "Meta entry should be packed");
+
+		std::vector< MetaEntry > metadata;
+		if (peek_chunk_magic(file) == "met0") {
+			read_chunk(file, "met0", &metadata);
+			if (metadata.size() != index.size()) {
+				throw std::runtime_error("metadata chunk has " + std::to_string(metadata.size()) + " entries but index has " + std::to_string(index.size()));
+			}
+		}
+
+		//clustered files also store (per-mesh, contiguous) clusters:
+		struct ClusterEntry {
+			uint32_t mesh;
+			uint32_t vertex_begin, vertex_end;
+			glm::vec3 center; float radius;
+			glm::vec3 cone_axis; float cone_cutoff;
+		};
+		static_assert(sizeof(ClusterEntry) == 44, "Cluster entry should be packed");
+
+		std::vector< ClusterEntry > cluster_entries;
+		if (peek_chunk_magic(file) == "cls0") {
+			read_chunk(file, "cls0", &cluster_entries);
+		}
+
+		//first cluster of each mesh (cluster_begin[i] .. cluster_begin[i+1] belong to index[i]):
+		std::vector< uint32_t > cluster_begin(index.size() + 1, 0);
+		clusters.reserve(cluster_entries.size());
+		for (uint32_t i = 0; i < cluster_entries.size(); ++i) {
+			ClusterEntry const &c = cluster_entries[i];
+			if (!(c.mesh < index.size() && (i == 0 || cluster_entries[i-1].mesh <= c.mesh))) {
+				throw std::runtime_error("cluster entry has out-of-range or out-of-order mesh");
+			}
+			if (!(index[c.mesh].vertex_begin <= c.vertex_begin && c.vertex_begin <= c.vertex_end && c.vertex_end <= index[c.mesh].vertex_end)) {
+				throw std::runtime_error("cluster entry has vertex range outside of its mesh");
+			}
+			Mesh::Cluster cluster;
+			cluster.start = base + c.vertex_begin;
+			cluster.count = c.vertex_end - c.vertex_begin;
+			cluster.center = c.center;
+			cluster.radius = c.radius;
+			cluster.cone_axis = c.cone_axis;
+			cluster.cone_cutoff = c.cone_cutoff;
+			clusters.emplace_back(cluster);
+			cluster_begin[c.mesh + 1] += 1;
+		}
+		for (uint32_t i = 0; i < index.size(); ++i) {
+			cluster_begin[i + 1] += cluster_begin[i];
+		}
+
+		//simplified files also store (per-mesh, contiguous) levels of detail:
+		struct LODEntry {
+			uint32_t mesh;
+			uint32_t vertex_begin, vertex_end;
+			float error;
+		};
+		static_assert(sizeof(LODEntry) == 16, "LOD entry should be packed");
+
+		std::vector< LODEntry > lod_entries;
+		if (peek_chunk_magic(file) == "lod0") {
+			read_chunk(file, "lod0", &lod_entries);
+		}
+
+		//first level of each mesh (lod_begin[i] .. lod_begin[i+1] belong to index[i]; includes index[i] itself as level 0 if any others exist):
+		std::vector< uint32_t > lod_begin(index.size() + 1, 0);
+		lods.reserve(lod_entries.size() + index.size());
+		for (uint32_t i = 0; i < lod_entries.size(); ++i) {
+			LODEntry const &l = lod_entries[i];
+			if (!(l.mesh < index.size() && (i == 0 || lod_entries[i-1].mesh <= l.mesh))) {
+				throw std::runtime_error("lod entry has out-of-range or out-of-order mesh");
+			}
+			if (!(l.vertex_begin <= l.vertex_end && l.vertex_end <= total)) {
+				throw std::runtime_error("lod entry has out-of-range vertex start/count");
+			}
+			if (i == 0 || lod_entries[i-1].mesh != l.mesh) {
+				Mesh::LOD full;
+				full.start = base + index[l.mesh].vertex_begin;
+				full.count = index[l.mesh].vertex_end - index[l.mesh].vertex_begin;
+				lods.emplace_back(full);
+				lod_begin[l.mesh + 1] += 1;
+			}
+			Mesh::LOD lod;
+			lod.start = base + l.vertex_begin;
+			lod.count = l.vertex_end - l.vertex_begin;
+			lod.error = l.error;
+			lods.emplace_back(lod);
+			lod_begin[l.mesh + 1] += 1;
+		}
+		for (uint32_t i = 0; i < index.size(); ++i) {
+			lod_begin[i + 1] += lod_begin[i];
+		}
+
+		//meshes are numbered in file order:
+		meshes.reserve(index.size());
+		names.reserve(index.size());
+		//range of 'occluders' for each mesh:
+		std::vector< uint32_t > occluder_begin(index.size(), 0);
+		std::vector< uint32_t > occluder_end(index.size(), 0);
+		for (uint32_t i = 0; i < index.size(); ++i) {
+			IndexEntry const &entry = index[i];
 			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
 				throw std::runtime_error("index entry has out-of-range name begin/end");
 			}
 			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
 				throw std::runtime_error("index entry has out-of-range vertex start/count");
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
 			Mesh mesh;
 			mesh.type = GL_TRIANGLES;
-			mesh.start = entry.vertex_begin;
+			mesh.start = base + entry.vertex_begin;
 			mesh.count = entry.vertex_end - entry.vertex_begin;
-			for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
-				mesh.min = glm::min(mesh.min, data[v].Position);
-				mesh.max = glm::max(mesh.max, data[v].Position);
+			uint8_t const *stored = (quantized ? reinterpret_cast< uint8_t const * >(quantized_data.data()) : reinterpret_cast< uint8_t const * >(data.data()));
+			size_t stride = (quantized ? sizeof(QuantizedVertex) : sizeof(Vertex));
+			if (quantized) {
+				glm::vec3 size = boxes[i].max - boxes[i].min;
+				mesh.position_to_object = glm::mat4x3(
+					glm::vec3(size.x, 0.0f, 0.0f),
+					glm::vec3(0.0f, size.y, 0.0f),
+					glm::vec3(0.0f, 0.0f, size.z),
+					boxes[i].min
+				);
 			}
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
-			if (!inserted) {
-				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+			if (!metadata.empty()) {
+				//trust stored bounds:
+				MetaEntry const &meta = metadata[i];
+				if (meta.vertex_count != mesh.count) {
+					throw std::runtime_error("metadata for mesh " + std::to_string(i) + " has vertex count " + std::to_string(meta.vertex_count) + " but index has " + std::to_string(mesh.count));
+				}
+				mesh.min = meta.min;
+				mesh.max = meta.max;
+				mesh.center = meta.center;
+				mesh.radius = meta.radius;
+				mesh.hash = meta.hash;
+			} else {
+				//compute bounds from vertex data:
+				if (quantized) {
+					mesh.min = boxes[i].min;
+					mesh.max = boxes[i].max;
+				} else {
+					for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+						mesh.min = glm::min(mesh.min, data[v].Position);
+						mesh.max = glm::max(mesh.max, data[v].Position);
+					}
+				}
+				if (mesh.count != 0) {
+					mesh.center = 0.5f * (mesh.min + mesh.max);
+					mesh.radius = 0.5f * glm::length(mesh.max - mesh.min);
+				}
+			}
+			if (verify_metadata && !metadata.empty()) {
+				MetaEntry const &meta = metadata[i];
+				std::string where = "metadata for mesh " + std::to_string(i) + " in '" + filename + "'";
+				if (meta.hash != hash_vertex_data(stored + entry.vertex_begin * stride, mesh.count * stride)) {
+					throw std::runtime_error(where + " has wrong hash.");
+				}
+				if (meta.triangle_count != mesh.count / 3) {
+					throw std::runtime_error(where + " has wrong triangle count.");
+				}
+				//(quantized positions are only within rounding of the original positions)
+				float slop = (quantized ? glm::length(boxes[i].max - boxes[i].min) / 65535.0f : 0.0f) + 1e-5f * glm::length(meta.max - meta.min);
+				glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+				glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+				float radius = -1.0f;
+				for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+					glm::vec3 position;
+					if (quantized) position = mesh.position_to_object * glm::vec4(glm::vec3(quantized_data[v].Position) / 65535.0f, 1.0f);
+					else position = data[v].Position;
+					min = glm::min(min, position);
+					max = glm::max(max, position);
+					radius = std::max(radius, glm::length(position - meta.center));
+				}
+				if (mesh.count != 0 && (glm::any(glm::greaterThan(glm::abs(min - meta.min), glm::vec3(slop))) || glm::any(glm::greaterThan(glm::abs(max - meta.max), glm::vec3(slop))))) {
+					throw std::runtime_error(where + " has wrong bounding box.");
+				}
+				if (radius > meta.radius + slop) {
+					throw std::runtime_error(where + " has bounding sphere that doesn't contain all vertices.");
+				}
+			}
+			if ((flags & BuildBVH) && mesh.type == GL_TRIANGLES) {
+				//(positions are stored dequantized, so queries are in object space)
+				std::vector< glm::vec3 > positions;
+				positions.reserve(mesh.count);
+				for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+					if (quantized) positions.emplace_back(mesh.position_to_object * glm::vec4(glm::vec3(quantized_data[v].Position) / 65535.0f, 1.0f));
+					else positions.emplace_back(data[v].Position);
+				}
+				positions.resize(positions.size() / 3 * 3);
+				bvhs.emplace_back(std::make_unique< MeshBVH >(positions));
+				mesh.bvh = bvhs.back().get();
+			}
+			if ((flags & KeepOccluders) && mesh.type == GL_TRIANGLES
+			 && (!occluder_names || occluder_names->count(std::string(strings.data() + entry.name_begin, strings.data() + entry.name_end)))) {
+				//the full-detail mesh, dequantized:
+				// (coarser levels of detail can bulge past the surface that is drawn, and so hide things that are visible)
+				uint32_t begin = entry.vertex_begin;
+				uint32_t end = entry.vertex_end;
+				occluder_begin[i] = uint32_t(occluders.size());
+				for (uint32_t v = begin; v < begin + (end - begin) / 3 * 3; ++v) {
+					if (quantized) occluders.emplace_back(mesh.position_to_object * glm::vec4(glm::vec3(quantized_data[v].Position) / 65535.0f, 1.0f));
+					else occluders.emplace_back(data[v].Position);
+				}
+				occluder_end[i] = uint32_t(occluders.size());
+			}
+			if (!vertices.empty()) {
+				mesh.vertices = vertices.data() + entry.vertex_begin * stride;
+			}
+			mesh.quantized = quantized;
+			if (cluster_begin[i] != cluster_begin[i+1]) {
+				mesh.clusters = clusters.data() + cluster_begin[i];
+				mesh.cluster_count = cluster_begin[i+1] - cluster_begin[i];
+			}
+			if (lod_begin[i] != lod_begin[i+1]) {
+				mesh.lods = lods.data() + lod_begin[i];
+				mesh.lod_count = lod_begin[i+1] - lod_begin[i];
+			}
+			meshes.emplace_back(mesh);
+			names.emplace_back(strings.data() + entry.name_begin, entry.name_end - entry.name_begin);
+		}
+
+		//('occluders' is complete, so meshes can point into it now:)
+		for (uint32_t i = 0; i < meshes.size(); ++i) {
+			if (occluder_begin[i] != occluder_end[i]) {
+				meshes[i].occluder = occluders.data() + occluder_begin[i];
+				meshes[i].occluder_count = occluder_end[i] - occluder_begin[i];
 			}
 		}
 	}
 
+	{ //build name lookup table:
+		uint32_t size = 1;
+		while (size < 2 * meshes.size()) size *= 2;
+		name_table.assign(size, InvalidMeshID);
+		name_hashes.reserve(names.size());
+		for (MeshID id = 0; id < names.size(); ++id) {
+			name_hashes.emplace_back(hash_name(names[id]));
+			if (find_id(names[id]) != InvalidMeshID) {
+				std::cerr << "WARNING: mesh name '" << names[id] << "' in filename '" << filename << "' collides with existing mesh." << std::endl;
+				continue;
+			}
+			uint32_t slot = name_hashes[id] & (size - 1);
+			while (name_table[slot] != InvalidMeshID) slot = (slot + 1) & (size - 1);
+			name_table[slot] = id;
+		}
+	}
+
 	if (file.peek() != EOF) {
 		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
 	}
 
 	/* //DEBUG:
 	std::cout << "File '" << filename << "' contained meshes";
-	for (auto const &m : meshes) {
-		if (&m.second == &meshes.rbegin()->second && meshes.size() > 1) std::cout << " and";
-		std::cout << " '" << m.first << "'";
-		if (&m.second != &meshes.rbegin()->second) std::cout << ",";
+	for (MeshID id = 0; id < names.size(); ++id) {
+		if (id + 1 == names.size() && names.size() > 1) std::cout << " and";
+		std::cout << " '" << names[id] << "'";
+		if (id + 1 != names.size()) std::cout << ",";
 	}
 	std::cout << std::endl;
 	*/
 }
 
-const Mesh &MeshBuffer::lookup(std::string const &name) const {
-	auto f = meshes.find(name);
-	if (f == meshes.end()) {
-		throw std::runtime_error("Looking up mesh '" + name + "' that doesn't exist.");
+MeshBuffer::MeshBuffer(Layout layout) {
+	use_layout(layout);
+}
+
+GeometryPool &MeshBuffer::use_layout(Layout layout) {
+	quantized = (layout == Layout::Quantized);
+	skinned = (layout == Layout::Skinned);
+	if (layout == Layout::Float) {
+		GeometryPool &pool = GeometryPool::shared("pnct", sizeof(Vertex));
+		buffer = pool.buffer;
+
+		//store attrib locations:
+		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
+		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+		return pool;
+	} else if (layout == Layout::Quantized) {
+		GeometryPool &pool = GeometryPool::shared("pnq0", sizeof(QuantizedVertex));
+		buffer = pool.buffer;
+
+		//store attrib locations:
+		// (position is dequantized by Mesh::position_to_object; normal is decoded by the program)
+		Position = Attrib(3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), offsetof(QuantizedVertex, Position));
+		Normal = Attrib(2, GL_SHORT, GL_TRUE, sizeof(QuantizedVertex), offsetof(QuantizedVertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(QuantizedVertex), offsetof(QuantizedVertex, Color));
+		TexCoord = Attrib(2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex), offsetof(QuantizedVertex, TexCoord));
+		return pool;
+	} else {
+		//(skinned vertices don't come from files, but the pool is named like the others)
+		GeometryPool &pool = GeometryPool::shared("pns0", sizeof(SkinnedVertex));
+		buffer = pool.buffer;
+
+		//store attrib locations:
+		// (bone indices are read as floats -- not normalized -- so they work with glVertexAttribPointer on every version)
+		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), offsetof(SkinnedVertex, Position));
+		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), offsetof(SkinnedVertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinnedVertex), offsetof(SkinnedVertex, Color));
+		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), offsetof(SkinnedVertex, TexCoord));
+		BoneIndices = Attrib(4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(SkinnedVertex), offsetof(SkinnedVertex, BoneIndices));
+		BoneWeights = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinnedVertex), offsetof(SkinnedVertex, BoneWeights));
+		return pool;
 	}
-	return f->second;
 }
 
-GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
-	//create a new vertex array object:
-	GLuint vao = 0;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+//octahedral normal encoding, as in "A Survey of Efficient Representations for Independent Unit Vectors" [Cigolle et al. 2014]:
+// (same as 'cook-meshes')
+static glm::vec2 oct_wrap(glm::vec2 const &v) {
+	return glm::vec2(
+		(1.0f - std::abs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f),
+		(1.0f - std::abs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f)
+	);
+}
 
-	//Try to bind all attributes in this buffer:
-	std::set< GLuint > bound;
-	glBindBuffer(GL_ARRAY_BUFFER, buffer);
-	auto bind_attribute = [&](char const *name, MeshBuffer::Attrib const &attrib) {
-		if (attrib.size == 0) return; //don't bind empty attribs
-		GLint location = glGetAttribLocation(program, name);
-		if (location == -1) return; //can't bind missing attribs
-		glVertexAttribPointer(location, attrib.size, attrib.type, attrib.normalized, attrib.stride, (GLbyte *)0 + attrib.offset);
-		glEnableVertexAttribArray(location);
-		bound.insert(location);
+glm::vec3 MeshBuffer::decode_normal(glm::i16vec2 const &normal) {
+	glm::vec2 e = glm::max(glm::vec2(normal) / 32767.0f, glm::vec2(-1.0f));
+	glm::vec3 n = glm::vec3(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	if (n.z < 0.0f) {
+		glm::vec2 w = oct_wrap(glm::vec2(n.x, n.y));
+		n.x = w.x;
+		n.y = w.y;
+	}
+	return glm::normalize(n);
+}
+
+glm::i16vec2 MeshBuffer::encode_normal(glm::vec3 const &normal) {
+	float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (!(l1 > 0.0f)) return glm::i16vec2(0, 0); //degenerate normal; decodes to +z
+	glm::vec2 e = glm::vec2(normal.x, normal.y) / l1;
+	if (normal.z < 0.0f) e = oct_wrap(e);
+	e = glm::round(glm::clamp(e, glm::vec2(-1.0f), glm::vec2(1.0f)) * 32767.0f);
+	return glm::i16vec2(int16_t(e.x), int16_t(e.y));
+}
+
+uint32_t MeshBuffer::hash_name(std::string_view name) {
+	//FNV-1a:
+	uint32_t hash = 2166136261u;
+	for (char c : name) {
+		hash = (hash ^ uint8_t(c)) * 16777619u;
+	}
+	return hash;
+}
+
+MeshBuffer::MeshID MeshBuffer::find_id(std::string_view name) const {
+	if (name_table.empty()) return InvalidMeshID;
+	uint32_t mask = uint32_t(name_table.size()) - 1;
+	uint32_t hash = hash_name(name);
+	for (uint32_t slot = hash & mask; name_table[slot] != InvalidMeshID; slot = (slot + 1) & mask) {
+		MeshID id = name_table[slot];
+		if (name_hashes[id] == hash && names[id] == name) return id;
+	}
+	return InvalidMeshID;
+}
+
+MeshBuffer::MeshID MeshBuffer::lookup_id(std::string_view name) const {
+	MeshID id = find_id(name);
+	if (id == InvalidMeshID) {
+		throw std::runtime_error("Looking up mesh '" + std::string(name) + "' that doesn't exist.");
+	}
+	return id;
+}
+
+MeshBuffer::MeshID MeshBuffer::id_of(Mesh const *mesh) const {
+	//(compared as integers, since pointers into different arrays can't be ordered)
+	uintptr_t at = reinterpret_cast< uintptr_t >(mesh);
+	uintptr_t begin = reinterpret_cast< uintptr_t >(meshes.data());
+	if (at < begin || at >= begin + meshes.size() * sizeof(Mesh)) return InvalidMeshID;
+	return MeshID((at - begin) / sizeof(Mesh));
+}
+
+const Mesh &MeshBuffer::lookup(std::string_view name) const {
+	return meshes[lookup_id(name)];
+}
+
+GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
+	//every attribute of this buffer goes at its fixed location, whatever the program:
+	struct Binding {
+		char const *name;
+		GLuint location;
+		Attrib const *attrib;
+	};
+	Binding const attributes[] = {
+		{"Position", PositionLocation, &Position},
+		{"Normal", NormalLocation, &Normal},
+		{"Color", ColorLocation, &Color},
+		{"TexCoord", TexCoordLocation, &TexCoord},
+		{"BoneIndices", BoneIndicesLocation, &BoneIndices},
+		{"BoneWeights", BoneWeightsLocation, &BoneWeights},
 	};
-	bind_attribute("Position", Position);
-	bind_attribute("Normal", Normal);
-	bind_attribute("Color", Color);
-	bind_attribute("TexCoord", TexCoord);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
 
-	//Check that all active attributes were bound:
+#ifndef NDEBUG
+	//(debug builds) check that the program agrees -- that it reads its active attributes from those locations, and that this buffer has them:
 	GLint active = 0;
 	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &active);
 	assert(active >= 0 && "Doesn't makes sense to have negative active attributes.");
@@ -142,11 +497,53 @@ GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
 		GLenum type = 0;
 		glGetActiveAttrib(program, i, 100, NULL, &size, &type, name);
 		name[99] = '\0';
-		GLint location = glGetAttribLocation(program, name);
-		if (!bound.count(GLuint(location))) {
+		Binding const *binding = nullptr;
+		for (auto const &b : attributes) {
+			if (std::string(name) == b.name) binding = &b;
+		}
+		if (binding == nullptr || binding->attrib->size == 0) {
 			throw std::runtime_error("ERROR: active attribute '" + std::string(name) + "' in program is not bound.");
 		}
+		GLint location = glGetAttribLocation(program, name);
+		if (location != GLint(binding->location)) {
+			throw std::runtime_error("ERROR: program reads attribute '" + std::string(name) + "' from location " + std::to_string(location) + ", but MeshBuffer puts it at location " + std::to_string(binding->location) + ".");
+		}
+		//quantized normals are octahedral-encoded vec2's, which the program needs to know to decode:
+		if (binding->attrib == &Normal && (type == GL_FLOAT_VEC2) != quantized) {
+			throw std::runtime_error(std::string("ERROR: program's 'Normal' attribute expects ") + (quantized ? "float" : "octahedral-encoded") + " normals, but buffer is " + (quantized ? "quantized." : "not quantized."));
+		}
+	}
+#endif
+
+	//the cache key lists the buffer and the location + format of every attribute:
+	// (so vertex arrays are shared by all programs, and by MeshBuffers with the same layout)
+	std::vector< GLint > key;
+	key.emplace_back(GLint(buffer));
+	for (auto const &b : attributes) {
+		if (b.attrib->size == 0) continue;
+		key.insert(key.end(), {GLint(b.location), b.attrib->size, GLint(b.attrib->type), GLint(b.attrib->normalized), b.attrib->stride, b.attrib->offset});
+	}
+
+	//re-use a vertex array object with the same bindings, if one exists:
+	static std::map< std::vector< GLint >, GLuint > vaos;
+	auto vf = vaos.find(key);
+	if (vf != vaos.end()) return vf->second;
+
+	//otherwise, create a new vertex array object:
+	GLuint vao = 0;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (auto const &b : attributes) {
+		if (b.attrib->size == 0) continue;
+		glVertexAttribPointer(b.location, b.attrib->size, b.attrib->type, b.attrib->normalized, b.attrib->stride, (GLbyte *)0 + b.attrib->offset);
+		glEnableVertexAttribArray(b.location);
 	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	vaos.emplace(key, vao);
 
 	return vao;
 }
@@ -4,18 +4,46 @@
  * In this code, "Mesh" is a range of vertices that should be sent through
  *  the OpenGL pipeline together.
  * A "MeshBuffer" holds a collection of such meshes (loaded from a file) in
- *  a single OpenGL array buffer. Individual meshes can be looked up by name
- *  using the MeshBuffer::lookup() function.
+ *  an OpenGL array buffer shared with other MeshBuffers (see GeometryPool).
+ *  Individual meshes can be looked up by name using the MeshBuffer::lookup()
+ *  function, or by a (per-buffer) integer id from MeshBuffer::lookup_id().
+ *
+ * Mesh files (".pnct") store vertices in one of two layouts:
+ *  - 'pnct' chunk: float position, float normal, u8 color, float texcoord (36 bytes)
+ *  - 'pnq0' chunk: unorm16 position (relative to each mesh's bounding box),
+ *     octahedral snorm16 normal, u8 color, half-float texcoord (20 bytes)
+ * Quantized files are produced from float files by the 'cook-meshes' tool.
+ *
+ * A third layout, for skinned meshes, adds four bone indices and weights to
+ *  the float layout (44 bytes); it isn't stored in files, but built at runtime
+ *  (see Skinning.hpp).
+ *
+ * Mesh files may also (optionally) split meshes into 'clusters' of nearby
+ *  triangles (chunk 'cls0', also made by 'cook-meshes'), which Scene::draw
+ *  can cull individually.
+ *
+ * ..and may store coarser levels of detail for each mesh (chunk 'lod0', also
+ *  made by 'cook-meshes'), as additional vertex ranges in the same buffer.
+ *
+ * Files made by 'cook-meshes' also carry per-mesh bounds, counts, and a hash
+ *  of the vertex data (chunk 'met0'), which the loader trusts instead of
+ *  scanning every vertex (set MeshBuffer::verify_metadata to check them).
  *
  */
 
 #include "GL.hpp"
+#include "MeshBVH.hpp"
 #include <glm/glm.hpp>
-#include <map>
 #include <limits>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
 
+struct GeometryPool;
+
 struct Mesh {
 	//Meshes are vertex ranges (and primitive types) in their MeshBuffer:
 
@@ -27,28 +55,185 @@ struct Mesh {
 	//useful for debug visualization and (perhaps, eventually) collision detection:
 	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
 	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+
+	//Bounding sphere (object space; radius < 0 if mesh is empty):
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = -1.0f;
+
+	//hash of the mesh's vertex data as stored in the file (0 if file didn't include one):
+	uint64_t hash = 0;
+
+	//Maps stored vertex positions to object space:
+	// (identity for float meshes; box-relative scale + offset for quantized meshes)
+	//copy this to Scene::Drawable::Pipeline::position_to_object when making drawables.
+	glm::mat4x3 position_to_object = glm::mat4x3(1.0f);
+
+	//Clusters are contiguous sub-ranges of the mesh's vertices, with bounds for culling:
+	struct Cluster {
+		GLuint start = 0; //index of first vertex
+		GLuint count = 0; //count of vertices
+		glm::vec3 center = glm::vec3(0.0f); //bounding sphere center (object space)
+		float radius = 0.0f; //bounding sphere radius
+		//all triangles face away from eye positions 'eye' where:
+		// dot(center - eye, cone_axis) >= cone_cutoff * length(center - eye) + radius
+		// (cone_cutoff == 1 means "never")
+		glm::vec3 cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+		float cone_cutoff = 1.0f;
+	};
+	//(points into MeshBuffer::clusters; empty if mesh was not clustered)
+	Cluster const *clusters = nullptr;
+	uint32_t cluster_count = 0;
+
+	//Levels of detail are vertex ranges of progressively simpler versions of the mesh:
+	struct LOD {
+		GLuint start = 0; //index of first vertex
+		GLuint count = 0; //count of vertices
+		float error = 0.0f; //max distance (in object space) from the full-detail surface
+	};
+	//(points into MeshBuffer::lods; if present, lods[0] is the mesh itself, with error 0)
+	LOD const *lods = nullptr;
+	uint32_t lod_count = 0;
+
+	//CPU-side copy of the mesh's triangles (object space) for ray/sphere queries:
+	// (owned by MeshBuffer; only built if MeshBuffer was loaded with BuildBVH)
+	MeshBVH const *bvh = nullptr;
+
+	//CPU-side copy of the mesh's triangles (object space; three positions per triangle; full detail, so never bigger than
+	// what is drawn), for drawing as an occluder (see OcclusionBuffer and Scene::OccluderPrefix):
+	// (points into MeshBuffer::occluders; only kept if MeshBuffer was loaded with KeepOccluders, and the mesh was in its 'occluder_names')
+	glm::vec3 const *occluder = nullptr;
+	uint32_t occluder_count = 0; //(vertices)
+
+	//CPU-side copy of the mesh's vertices, as stored (a MeshBuffer::QuantizedVertex each if 'quantized', a MeshBuffer::Vertex otherwise),
+	// for re-packing them elsewhere (e.g., Scene::batch_static):
+	// (points into MeshBuffer::vertices; only kept if MeshBuffer was loaded with KeepVertices)
+	uint8_t const *vertices = nullptr;
+	bool quantized = false;
 };
 
 struct MeshBuffer {
 	//construct from a file:
 	// note: will throw if file fails to read.
-	MeshBuffer(std::string const &filename);
+	// (with KeepOccluders, only meshes named in 'occluder_names' -- e.g., those Scene::DrawableRequest marks as occluders -- get
+	//  occluder copies; all triangle meshes do if it is nullptr)
+	MeshBuffer(std::string const &filename, uint32_t flags = 0, std::unordered_set< std::string > const *occluder_names = nullptr);
+
+	//construct without meshes, for drawing vertices that other code places in the GeometryPool of a layout:
+	// (e.g., WorldStream; only 'buffer', 'quantized', the attribs, and so make_vao_for_program() are useful)
+	enum class Layout { Float, Quantized, Skinned };
+	explicit MeshBuffer(Layout layout);
+
+	//flags for the constructor:
+	enum : uint32_t {
+		BuildBVH = 1, //keep a copy of each triangle mesh's positions for queries (see Mesh::bvh)
+		KeepOccluders = 2, //keep a copy of (some) triangle meshes' triangles for occlusion culling (see Mesh::occluder)
+		KeepVertices = 4, //keep a copy of all vertices as stored (see Mesh::vertices)
+	};
+
+	//vertex layouts, as stored in the file (and the GeometryPool):
+	struct Vertex {
+		glm::vec3 Position;
+		glm::vec3 Normal;
+		glm::u8vec4 Color;
+		glm::vec2 TexCoord;
+	};
+	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+
+	struct QuantizedVertex {
+		glm::u16vec3 Position; //unorm16, relative to mesh bounding box
+		uint16_t _pad = 0; //keeps following attributes 4-byte aligned
+		glm::i16vec2 Normal; //octahedral encoding, snorm16
+		glm::u8vec4 Color;
+		glm::u16vec2 TexCoord; //half-float bits
+	};
+	static_assert(sizeof(QuantizedVertex) == 3*2+2+2*2+4*1+2*2, "QuantizedVertex is packed.");
+
+	struct SkinnedVertex {
+		glm::vec3 Position; //(model space, in the bind pose; see Skinning.hpp)
+		glm::vec3 Normal;
+		glm::u8vec4 Color;
+		glm::vec2 TexCoord;
+		glm::u8vec4 BoneIndices; //palette entries of up to four bones
+		glm::u8vec4 BoneWeights; //unorm8, summing to (about) one
+	};
+	static_assert(sizeof(SkinnedVertex) == 3*4+3*4+4*1+2*4+4*1+4*1, "SkinnedVertex is packed.");
+
+	//octahedral normal encoding used by QuantizedVertex (decode matches decode_normal() in the quantized shader variants):
+	static glm::vec3 decode_normal(glm::i16vec2 const &normal);
+	static glm::i16vec2 encode_normal(glm::vec3 const &normal);
 
 	//look up a particular mesh by name:
 	// note: will throw if mesh not found.
-	const Mesh &lookup(std::string const &name) const;
-	
-	//build a vertex array object that links this vbo to attributes to a program:
-	// note: will throw if program defines attributes not contained in this buffer
+	const Mesh &lookup(std::string_view name) const;
+
+	//meshes are also numbered (in file order), so code that refers to meshes often can store an id instead of a name:
+	typedef uint32_t MeshID;
+	static constexpr MeshID InvalidMeshID = -1U;
+	MeshID find_id(std::string_view name) const; //returns InvalidMeshID if mesh not found
+	MeshID lookup_id(std::string_view name) const; //throws if mesh not found
+	const Mesh &mesh(MeshID id) const { return meshes.at(id); }
+	std::string_view name(MeshID id) const { return names.at(id); }
+	MeshID mesh_count() const { return MeshID(meshes.size()); }
+	//id of a mesh from this buffer (e.g., a Drawable's pipeline.mesh), or InvalidMeshID if it is from elsewhere:
+	MeshID id_of(Mesh const *mesh) const;
+
+
+	//get a vertex array object that links this vbo to attributes to a program:
+	// note: attributes always go at the locations below, so vertex array objects depend only on the buffer's layout;
+	//  they are cached and shared (between MeshBuffers in the same GeometryPool and between programs), so don't delete the result
+	// note: (in debug builds) will throw if program defines attributes not contained in this buffer, reads them from
+	//  other locations, or has a Normal attribute that doesn't match this buffer's normal encoding
 	GLuint make_vao_for_program(GLuint program) const;
 
+	//Programs that draw mesh data should put attributes at these locations (e.g., "layout(location=0) in vec4 Position;"),
+	// so they don't need to look them up and can all share the same vertex array objects:
+	enum : GLuint {
+		PositionLocation = 0,
+		NormalLocation = 1,
+		ColorLocation = 2,
+		TexCoordLocation = 3,
+		BoneIndicesLocation = 4, //(skinned layout only)
+		BoneWeightsLocation = 5, //(skinned layout only)
+	};
+
 	//This is the OpenGL vertex buffer object containing the mesh data:
+	// (shared with all other MeshBuffers with the same vertex layout -- see GeometryPool -- so Mesh::start is relative to the whole pool)
 	GLuint buffer = 0;
 
+	//Quantized buffers store octahedral-encoded normals (as a two-component 'Normal' attribute),
+	// so they must be drawn with programs that decode them (e.g., quantized_lit_color_texture_program):
+	bool quantized = false;
+
+	//Skinned buffers also have 'BoneIndices' and 'BoneWeights' attributes, for programs that blend bone palettes
+	// (e.g., skinned_lit_color_texture_program):
+	bool skinned = false;
+
+	//check the metadata ('met0' chunk) of loaded files against their vertex data:
+	// (throws on mismatch; this is a full pass over all vertices, so only useful for debugging)
+	static bool verify_metadata;
+
 	//-- internals ---
 
-	//used by the lookup() function:
-	std::map< std::string, Mesh > meshes;
+	//meshes (indexed by MeshID) and their names (which point into 'strings', the file's string table):
+	std::vector< Mesh > meshes;
+	std::vector< std::string_view > names;
+	std::vector< char > strings;
+
+	//open-addressing hash table used by the lookup functions:
+	// (power-of-two size, linear probing; slots hold a MeshID or InvalidMeshID if empty)
+	std::vector< MeshID > name_table;
+	std::vector< uint32_t > name_hashes; //hash of names[id], checked before comparing names
+	static uint32_t hash_name(std::string_view name);
+
+	//storage for clusters, levels of detail, BVHs, and occluders of all meshes:
+	std::vector< Mesh::Cluster > clusters;
+	std::vector< Mesh::LOD > lods;
+	std::vector< std::unique_ptr< MeshBVH > > bvhs;
+	std::vector< glm::vec3 > occluders;
+	std::vector< uint8_t > vertices;
+
+	//meshes point into 'clusters', 'lods', 'occluders', and 'vertices', so copying a MeshBuffer is not advised:
+	MeshBuffer(MeshBuffer const &) = delete;
 
 	//These 'Attrib' structures describe the location of various attributes within the buffer (in exactly format wanted by glVertexAttribPointer). They are set when the file is loaded and are used by the "make_vao_for_program" call:
 	struct Attrib {
@@ -67,4 +252,9 @@ struct MeshBuffer {
 	Attrib Normal;
 	Attrib Color;
 	Attrib TexCoord;
+	Attrib BoneIndices;
+	Attrib BoneWeights;
+
+	//set 'buffer', 'quantized', 'skinned', and the attribs for the shared pool of a layout:
+	GeometryPool &use_layout(Layout layout);
 };
@@ -0,0 +1,424 @@
+#include "MeshBVH.hpp"
+#include "simd4.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <functional>
+
+//------------ construction ------------
+
+namespace {
+	//binary hierarchy, built first and then collapsed into 4-wide nodes:
+	struct BuildNode {
+		glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+		uint32_t left = -1U, right = -1U; //children (if not a leaf)
+		uint32_t begin = 0, end = 0; //range of 'order' (if a leaf)
+	};
+
+	struct Builder {
+		std::vector< glm::vec3 > const &positions;
+		std::vector< glm::vec3 > centroids;
+		std::vector< uint32_t > order;
+		std::vector< BuildNode > build_nodes;
+
+		static float area(glm::vec3 const &min, glm::vec3 const &max) {
+			glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+			return size.x * size.y + size.y * size.z + size.z * size.x;
+		}
+
+		void bound(uint32_t begin, uint32_t end, glm::vec3 *min, glm::vec3 *max) const {
+			for (uint32_t i = begin; i < end; ++i) {
+				for (uint32_t c = 0; c < 3; ++c) {
+					*min = glm::min(*min, positions[3 * order[i] + c]);
+					*max = glm::max(*max, positions[3 * order[i] + c]);
+				}
+			}
+		}
+
+		//build node over order[begin,end), returning its index:
+		uint32_t build(uint32_t begin, uint32_t end, uint32_t depth) {
+			uint32_t index = uint32_t(build_nodes.size());
+			build_nodes.emplace_back();
+			{
+				BuildNode &node = build_nodes.back();
+				bound(begin, end, &node.min, &node.max);
+				node.begin = begin;
+				node.end = end;
+			}
+
+			//leaves hold one packet of triangles:
+			if (end - begin <= 4) return index;
+
+			//split along the longest axis of the centroids' bounds:
+			glm::vec3 cmin = glm::vec3( std::numeric_limits< float >::infinity());
+			glm::vec3 cmax = glm::vec3(-std::numeric_limits< float >::infinity());
+			for (uint32_t i = begin; i < end; ++i) {
+				cmin = glm::min(cmin, centroids[order[i]]);
+				cmax = glm::max(cmax, centroids[order[i]]);
+			}
+			uint32_t axis = 0;
+			if (cmax.y - cmin.y > cmax[axis] - cmin[axis]) axis = 1;
+			if (cmax.z - cmin.z > cmax[axis] - cmin[axis]) axis = 2;
+			float extent = cmax[axis] - cmin[axis];
+
+			uint32_t mid = begin + (end - begin) / 2;
+			bool split = false;
+			//(deep trees -- only made by strange inputs -- are split by median to bound traversal stack size)
+			if (extent > 0.0f && depth < 48) {
+				//binned surface area heuristic:
+				constexpr uint32_t Bins = 16;
+				struct Bin {
+					glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+					glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+					uint32_t count = 0;
+				};
+				std::array< Bin, Bins > bins;
+				auto bin_of = [&](uint32_t tri) {
+					return std::min(Bins - 1, uint32_t((centroids[tri][axis] - cmin[axis]) / extent * Bins));
+				};
+				for (uint32_t i = begin; i < end; ++i) {
+					Bin &bin = bins[bin_of(order[i])];
+					bin.count += 1;
+					for (uint32_t c = 0; c < 3; ++c) {
+						bin.min = glm::min(bin.min, positions[3 * order[i] + c]);
+						bin.max = glm::max(bin.max, positions[3 * order[i] + c]);
+					}
+				}
+				//cost of splitting after each bin (sweeping from the right, then the left):
+				std::array< float, Bins > right_cost;
+				{
+					Bin acc;
+					for (uint32_t b = Bins - 1; b > 0; --b) {
+						acc.min = glm::min(acc.min, bins[b].min);
+						acc.max = glm::max(acc.max, bins[b].max);
+						acc.count += bins[b].count;
+						right_cost[b - 1] = area(acc.min, acc.max) * acc.count;
+					}
+				}
+				float best_cost = std::numeric_limits< float >::infinity();
+				uint32_t best_split = Bins;
+				{
+					Bin acc;
+					for (uint32_t b = 0; b + 1 < Bins; ++b) {
+						acc.min = glm::min(acc.min, bins[b].min);
+						acc.max = glm::max(acc.max, bins[b].max);
+						acc.count += bins[b].count;
+						if (acc.count == 0 || acc.count == end - begin) continue;
+						float cost = area(acc.min, acc.max) * acc.count + right_cost[b];
+						if (cost < best_cost) {
+							best_cost = cost;
+							best_split = b;
+						}
+					}
+				}
+				if (best_split < Bins) {
+					mid = uint32_t(std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t tri) {
+						return bin_of(tri) <= best_split;
+					}) - order.begin());
+					split = true;
+				}
+			}
+			if (!split) {
+				std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&](uint32_t a, uint32_t b) {
+					return centroids[a][axis] < centroids[b][axis];
+				});
+			}
+
+			uint32_t left = build(begin, mid, depth + 1);
+			uint32_t right = build(mid, end, depth + 1);
+			build_nodes[index].left = left;
+			build_nodes[index].right = right;
+			return index;
+		}
+	};
+}
+
+MeshBVH::MeshBVH(std::vector< glm::vec3 > const &positions) {
+	assert(positions.size() % 3 == 0);
+	triangle_count = uint32_t(positions.size() / 3);
+	if (triangle_count == 0) return;
+
+	Builder builder{positions, {}, {}, {}};
+	builder.centroids.reserve(triangle_count);
+	builder.order.reserve(triangle_count);
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		builder.centroids.emplace_back((positions[3*t+0] + positions[3*t+1] + positions[3*t+2]) / 3.0f);
+		builder.order.emplace_back(t);
+	}
+	builder.build_nodes.reserve(2 * (triangle_count / 4 + 1));
+	builder.build(0, triangle_count, 0);
+	std::vector< BuildNode > const &build_nodes = builder.build_nodes;
+
+	min = build_nodes[0].min;
+	max = build_nodes[0].max;
+
+	//collapse binary hierarchy into 4-wide nodes:
+	std::function< uint32_t(uint32_t) > emit;
+	emit = [&](uint32_t b) -> uint32_t {
+		BuildNode const &bn = build_nodes[b];
+		if (bn.left == -1U) {
+			//leaf -> packet:
+			Packet packet;
+			for (uint32_t lane = 0; lane < 4; ++lane) {
+				uint32_t i = bn.begin + lane;
+				uint32_t tri = (i < bn.end ? builder.order[i] : -1U);
+				glm::vec3 v0 = (tri != -1U ? positions[3*tri+0] : glm::vec3(0.0f));
+				glm::vec3 e1 = (tri != -1U ? positions[3*tri+1] - v0 : glm::vec3(0.0f));
+				glm::vec3 e2 = (tri != -1U ? positions[3*tri+2] - v0 : glm::vec3(0.0f));
+				for (uint32_t c = 0; c < 3; ++c) {
+					packet.v0[c][lane] = v0[c];
+					packet.e1[c][lane] = e1[c];
+					packet.e2[c][lane] = e2[c];
+				}
+				packet.triangle[lane] = tri;
+			}
+			packets.emplace_back(packet);
+			return Leaf | uint32_t(packets.size() - 1);
+		}
+
+		//gather (up to) four descendants by repeatedly opening the largest inner child:
+		std::vector< uint32_t > children{bn.left, bn.right};
+		while (children.size() < 4) {
+			uint32_t open = -1U;
+			float open_area = -1.0f;
+			for (uint32_t i = 0; i < children.size(); ++i) {
+				BuildNode const &c = build_nodes[children[i]];
+				if (c.left == -1U) continue;
+				float a = Builder::area(c.min, c.max);
+				if (a > open_area) {
+					open_area = a;
+					open = i;
+				}
+			}
+			if (open == -1U) break;
+			uint32_t opened = children[open];
+			children[open] = build_nodes[opened].left;
+			children.emplace_back(build_nodes[opened].right);
+		}
+
+		uint32_t index = uint32_t(nodes.size());
+		nodes.emplace_back();
+		for (uint32_t i = 0; i < 4; ++i) {
+			Node &node = nodes[index];
+			node.min_x[i] = node.min_y[i] = node.min_z[i] = std::numeric_limits< float >::infinity();
+			node.max_x[i] = node.max_y[i] = node.max_z[i] = -std::numeric_limits< float >::infinity();
+			node.child[i] = Empty;
+		}
+		for (uint32_t i = 0; i < children.size(); ++i) {
+			uint32_t code = emit(children[i]);
+			//(emit may have re-allocated 'nodes', so look up node after):
+			Node &node = nodes[index];
+			BuildNode const &c = build_nodes[children[i]];
+			node.min_x[i] = c.min.x; node.min_y[i] = c.min.y; node.min_z[i] = c.min.z;
+			node.max_x[i] = c.max.x; node.max_y[i] = c.max.y; node.max_z[i] = c.max.z;
+			node.child[i] = code;
+		}
+		return index;
+	};
+
+	if (build_nodes[0].left == -1U) {
+		//(a single leaf still gets a root node, so traversal always starts at nodes[0])
+		nodes.emplace_back();
+		Node &root = nodes.back();
+		for (uint32_t i = 0; i < 4; ++i) {
+			root.min_x[i] = root.min_y[i] = root.min_z[i] = std::numeric_limits< float >::infinity();
+			root.max_x[i] = root.max_y[i] = root.max_z[i] = -std::numeric_limits< float >::infinity();
+			root.child[i] = Empty;
+		}
+		root.min_x[0] = min.x; root.min_y[0] = min.y; root.min_z[0] = min.z;
+		root.max_x[0] = max.x; root.max_y[0] = max.y; root.max_z[0] = max.z;
+		uint32_t code = emit(0);
+		nodes[0].child[0] = code;
+	} else {
+		emit(0);
+	}
+}
+
+//------------ queries ------------
+
+//traversal stack size (enough for the depth limit used when building):
+static constexpr uint32_t StackSize = 256;
+
+bool MeshBVH::ray(glm::vec3 const &origin, glm::vec3 const &direction, float t_max, Hit *hit) const {
+	assert(hit);
+	if (nodes.empty()) return false;
+
+	float best_t = std::min(t_max, hit->t);
+	uint32_t best_packet = -1U;
+	uint32_t best_lane = 0;
+
+	F4 ox = splat(origin.x), oy = splat(origin.y), oz = splat(origin.z);
+	F4 dx = splat(direction.x), dy = splat(direction.y), dz = splat(direction.z);
+	F4 ix = splat(1.0f / direction.x), iy = splat(1.0f / direction.y), iz = splat(1.0f / direction.z);
+	F4 zero = splat(0.0f);
+	F4 one = splat(1.0f);
+
+	std::array< uint32_t, StackSize > stack;
+	uint32_t stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		uint32_t code = stack[--stack_size];
+
+		if (code & Leaf) {
+			//4-wide ray/triangle test (Moller-Trumbore):
+			Packet const &p = packets[code & ~Leaf];
+			F4 e1x = load4(p.e1[0]), e1y = load4(p.e1[1]), e1z = load4(p.e1[2]);
+			F4 e2x = load4(p.e2[0]), e2y = load4(p.e2[1]), e2z = load4(p.e2[2]);
+			//pv = cross(direction, e2):
+			F4 pvx = dy * e2z - dz * e2y;
+			F4 pvy = dz * e2x - dx * e2z;
+			F4 pvz = dx * e2y - dy * e2x;
+			F4 det = e1x * pvx + e1y * pvy + e1z * pvz;
+			F4 inv_det = one / det;
+			F4 sx = ox - load4(p.v0[0]), sy = oy - load4(p.v0[1]), sz = oz - load4(p.v0[2]);
+			F4 u = (sx * pvx + sy * pvy + sz * pvz) * inv_det;
+			//qv = cross(s, e1):
+			F4 qvx = sy * e1z - sz * e1y;
+			F4 qvy = sz * e1x - sx * e1z;
+			F4 qvz = sx * e1y - sy * e1x;
+			F4 v = (dx * qvx + dy * qvy + dz * qvz) * inv_det;
+			F4 t = (e2x * qvx + e2y * qvy + e2z * qvz) * inv_det;
+			//(degenerate lanes have det == 0, so NaN/inf u,v,t, and fail these tests)
+			M4 valid = ((det > zero) | (det < zero)) & (u >= zero) & (v >= zero) & (u + v <= one) & (t >= zero) & (t <= splat(best_t));
+			uint32_t mask = bits(valid);
+			if (mask) {
+				float ts[4];
+				store4(t, ts);
+				for (uint32_t lane = 0; lane < 4; ++lane) {
+					if ((mask & (1 << lane)) && ts[lane] <= best_t) {
+						best_t = ts[lane];
+						best_packet = code & ~Leaf;
+						best_lane = lane;
+					}
+				}
+			}
+			continue;
+		}
+
+		//4-wide ray/box test (slabs):
+		Node const &node = nodes[code];
+		F4 tx0 = (load4(node.min_x) - ox) * ix, tx1 = (load4(node.max_x) - ox) * ix;
+		F4 ty0 = (load4(node.min_y) - oy) * iy, ty1 = (load4(node.max_y) - oy) * iy;
+		F4 tz0 = (load4(node.min_z) - oz) * iz, tz1 = (load4(node.max_z) - oz) * iz;
+		F4 t_enter = max4(max4(min4(tx0, tx1), min4(ty0, ty1)), max4(min4(tz0, tz1), zero));
+		F4 t_exit = min4(min4(max4(tx0, tx1), max4(ty0, ty1)), min4(max4(tz0, tz1), splat(best_t)));
+		uint32_t mask = bits(t_enter <= t_exit);
+		if (!mask) continue;
+
+		//push hit children far-to-near, so the nearest is visited first:
+		float enter[4];
+		store4(t_enter, enter);
+		uint32_t order[4];
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < 4; ++i) {
+			if (!(mask & (1 << i)) || node.child[i] == Empty) continue;
+			//(insertion sort by decreasing entry distance)
+			uint32_t at = count++;
+			while (at > 0 && enter[order[at-1]] < enter[i]) {
+				order[at] = order[at-1];
+				at -= 1;
+			}
+			order[at] = i;
+		}
+		assert(stack_size + count <= StackSize);
+		for (uint32_t i = 0; i < count; ++i) {
+			stack[stack_size++] = node.child[order[i]];
+		}
+	}
+
+	if (best_packet == -1U) return false;
+
+	Packet const &p = packets[best_packet];
+	glm::vec3 e1 = glm::vec3(p.e1[0][best_lane], p.e1[1][best_lane], p.e1[2][best_lane]);
+	glm::vec3 e2 = glm::vec3(p.e2[0][best_lane], p.e2[1][best_lane], p.e2[2][best_lane]);
+	hit->t = best_t;
+	hit->triangle = p.triangle[best_lane];
+	hit->normal = glm::normalize(glm::cross(e1, e2));
+	return true;
+}
+
+//closest point to p on triangle a,b,c (from Ericson, "Real-Time Collision Detection", 5.1.5):
+static glm::vec3 closest_point_on_triangle(glm::vec3 const &p, glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c) {
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + (d1 / (d1 - d3)) * ab;
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + (d2 / (d2 - d6)) * ac;
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b);
+
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+bool MeshBVH::sphere(glm::vec3 const &center, float radius, Contact *contact) const {
+	assert(contact);
+	if (nodes.empty()) return false;
+
+	float best = std::min(radius, contact->distance);
+	bool found = false;
+
+	F4 cx = splat(center.x), cy = splat(center.y), cz = splat(center.z);
+	F4 zero = splat(0.0f);
+
+	std::array< uint32_t, StackSize > stack;
+	uint32_t stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		uint32_t code = stack[--stack_size];
+
+		if (code & Leaf) {
+			//(closest points are found one triangle at a time)
+			Packet const &p = packets[code & ~Leaf];
+			for (uint32_t lane = 0; lane < 4; ++lane) {
+				if (p.triangle[lane] == -1U) continue;
+				glm::vec3 a = glm::vec3(p.v0[0][lane], p.v0[1][lane], p.v0[2][lane]);
+				glm::vec3 b = a + glm::vec3(p.e1[0][lane], p.e1[1][lane], p.e1[2][lane]);
+				glm::vec3 c = a + glm::vec3(p.e2[0][lane], p.e2[1][lane], p.e2[2][lane]);
+				glm::vec3 point = closest_point_on_triangle(center, a, b, c);
+				float distance = glm::length(point - center);
+				if (distance <= best) {
+					best = distance;
+					found = true;
+					contact->distance = distance;
+					contact->triangle = p.triangle[lane];
+					contact->point = point;
+				}
+			}
+			continue;
+		}
+
+		//4-wide sphere/box test:
+		Node const &node = nodes[code];
+		F4 ex = max4(load4(node.min_x) - cx, zero) + max4(cx - load4(node.max_x), zero);
+		F4 ey = max4(load4(node.min_y) - cy, zero) + max4(cy - load4(node.max_y), zero);
+		F4 ez = max4(load4(node.min_z) - cz, zero) + max4(cz - load4(node.max_z), zero);
+		uint32_t mask = bits(ex * ex + ey * ey + ez * ez <= splat(best * best));
+		for (uint32_t i = 0; i < 4; ++i) {
+			if ((mask & (1 << i)) && node.child[i] != Empty) {
+				assert(stack_size < StackSize);
+				stack[stack_size++] = node.child[i];
+			}
+		}
+	}
+
+	return found;
+}
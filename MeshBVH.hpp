@@ -0,0 +1,80 @@
+#pragma once
+
+/*
+ * A MeshBVH is a CPU-side copy of a mesh's triangles (in object space),
+ *  arranged in a bounding volume hierarchy for ray, segment, and sphere
+ *  queries -- e.g., for pointer picking and ground tests without rendering.
+ *
+ * The hierarchy is built with the surface area heuristic and stored as
+ *  4-wide nodes over packets of 4 triangles, so box and ray/triangle tests
+ *  run four at a time (SSE2 on x86, NEON on ARM, plain loops elsewhere).
+ *
+ * MeshBuffers build these when loaded with the MeshBuffer::BuildBVH flag
+ *  (see Mesh::bvh); Scene::raycast and Scene::sphere_contact query all the
+ *  drawables in a scene.
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct MeshBVH {
+	//build from a list of triangles (three positions per triangle):
+	MeshBVH(std::vector< glm::vec3 > const &positions);
+
+	struct Hit {
+		float t = std::numeric_limits< float >::infinity(); //ray parameter of hit (point is origin + t * direction)
+		uint32_t triangle = -1U; //index of triangle (in the positions passed to the constructor)
+		glm::vec3 normal = glm::vec3(0.0f); //unit-length geometric normal (by counter-clockwise winding)
+	};
+
+	//closest intersection of ray 'origin + t * direction' with t in [0, min(t_max, hit->t)]:
+	// (direction need not be normalized; returns true and updates 'hit' only if a closer intersection was found)
+	bool ray(glm::vec3 const &origin, glm::vec3 const &direction, float t_max, Hit *hit) const;
+
+	//closest intersection of segment a-b (hit->t is fraction of the way from a to b):
+	bool segment(glm::vec3 const &a, glm::vec3 const &b, Hit *hit) const {
+		return ray(a, b - a, 1.0f, hit);
+	}
+
+	struct Contact {
+		float distance = std::numeric_limits< float >::infinity(); //distance from center to 'point'
+		uint32_t triangle = -1U; //index of triangle containing 'point'
+		glm::vec3 point = glm::vec3(0.0f); //closest point on the mesh
+	};
+
+	//closest point of the mesh within distance min(radius, contact->distance) of 'center':
+	// (returns true and updates 'contact' only if a closer point was found)
+	bool sphere(glm::vec3 const &center, float radius, Contact *contact) const;
+
+	//bounds of all triangles:
+	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+	uint32_t triangle_count = 0;
+
+	//-- internals ---
+
+	//a node holds the boxes of (up to) four children, stored by component for 4-wide tests:
+	struct Node {
+		float min_x[4], min_y[4], min_z[4];
+		float max_x[4], max_y[4], max_z[4];
+		uint32_t child[4]; //index of child node, Leaf | packet index, or Empty
+	};
+	static constexpr uint32_t Empty = -1U;
+	static constexpr uint32_t Leaf = 0x80000000;
+
+	//a packet holds four triangles as (v0, v1 - v0, v2 - v0), stored by component:
+	// (unused lanes are degenerate and never hit)
+	struct Packet {
+		float v0[3][4];
+		float e1[3][4];
+		float e2[3][4];
+		uint32_t triangle[4];
+	};
+
+	std::vector< Node > nodes; //nodes[0] is the root (if there are any triangles)
+	std::vector< Packet > packets;
+};
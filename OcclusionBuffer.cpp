@@ -0,0 +1,170 @@
+#include "OcclusionBuffer.hpp"
+#include "simd4.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+//clip-space w below which points count as behind the eye:
+static constexpr float MinW = 1e-5f;
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width_, uint32_t height_) : width((std::max(width_, 1u) + 3) / 4 * 4), height(std::max(height_, 1u)) {
+	//allocate all levels of the pyramid:
+	uint32_t w = width, h = height;
+	while (true) {
+		levels.emplace_back();
+		levels.back().width = w;
+		levels.back().height = h;
+		levels.back().depth.assign(w * h, 0.0f);
+		if (w == 1 && h == 1) break;
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+}
+
+void OcclusionBuffer::clear() {
+	std::fill(levels[0].depth.begin(), levels[0].depth.end(), 0.0f);
+	tested = 0;
+	rejected = 0;
+}
+
+void OcclusionBuffer::draw_occluder(glm::mat4 const &object_to_clip, glm::vec3 const *positions, uint32_t count) {
+	assert(positions || count == 0);
+	Level &level = levels[0];
+	float const half_width = 0.5f * float(width);
+	float const half_height = 0.5f * float(height);
+
+	//pixel centers of four adjacent pixels, relative to the first:
+	static float const lane_offsets[4] = {0.5f, 1.5f, 2.5f, 3.5f};
+	F4 const lanes = load4(lane_offsets);
+
+	for (uint32_t t = 0; t + 2 < count; t += 3) {
+		//screen-space position and 1 / w of each vertex:
+		std::array< glm::vec3, 3 > s;
+		bool behind = false;
+		for (uint32_t k = 0; k < 3; ++k) {
+			glm::vec4 clip = object_to_clip * glm::vec4(positions[t + k], 1.0f);
+			if (!(clip.w > MinW)) behind = true;
+			float inv_w = 1.0f / clip.w;
+			s[k] = glm::vec3((clip.x * inv_w + 1.0f) * half_width, (clip.y * inv_w + 1.0f) * half_height, inv_w);
+		}
+		//(skipping occluder triangles is always safe -- it can only make fewer things hidden)
+		if (behind) continue;
+
+		float area = (s[1].x - s[0].x) * (s[2].y - s[0].y) - (s[1].y - s[0].y) * (s[2].x - s[0].x);
+		if (!(std::abs(area) > 1e-8f)) continue;
+		//draw both sides by flipping clockwise triangles:
+		if (area < 0.0f) {
+			std::swap(s[1], s[2]);
+			area = -area;
+		}
+
+		//pixels whose centers are within the triangle's bounds:
+		glm::vec2 min = glm::min(glm::vec2(s[0]), glm::min(glm::vec2(s[1]), glm::vec2(s[2])));
+		glm::vec2 max = glm::max(glm::vec2(s[0]), glm::max(glm::vec2(s[1]), glm::vec2(s[2])));
+		min = glm::max(glm::ceil(min - 0.5f), glm::vec2(0.0f));
+		max = glm::min(glm::floor(max - 0.5f), glm::vec2(float(width - 1), float(height - 1)));
+		if (min.x > max.x || min.y > max.y) continue;
+		uint32_t x0 = uint32_t(min.x) & ~3u, x1 = uint32_t(max.x);
+		uint32_t y0 = uint32_t(min.y), y1 = uint32_t(max.y);
+
+		//edge functions (e_k = A_k * x + B_k * y + C_k, positive inside; e_k is for the edge opposite vertex k),
+		// and 1 / w as a plane interpolated by barycentric coordinates e_k / area:
+		float A[3], B[3], C[3];
+		float Az = 0.0f, Bz = 0.0f, Cz = 0.0f;
+		for (uint32_t k = 0; k < 3; ++k) {
+			glm::vec3 const &a = s[(k + 1) % 3];
+			glm::vec3 const &b = s[(k + 2) % 3];
+			A[k] = a.y - b.y;
+			B[k] = b.x - a.x;
+			C[k] = a.x * b.y - a.y * b.x;
+			Az += A[k] * s[k].z;
+			Bz += B[k] * s[k].z;
+			Cz += C[k] * s[k].z;
+		}
+		Az /= area;
+		Bz /= area;
+		Cz /= area;
+
+		F4 const A0 = splat(A[0]), A1 = splat(A[1]), A2 = splat(A[2]), Az4 = splat(Az);
+		F4 const zero = splat(0.0f);
+		for (uint32_t y = y0; y <= y1; ++y) {
+			float py = float(y) + 0.5f;
+			F4 const r0 = splat(B[0] * py + C[0]);
+			F4 const r1 = splat(B[1] * py + C[1]);
+			F4 const r2 = splat(B[2] * py + C[2]);
+			F4 const rz = splat(Bz * py + Cz);
+			float *row = level.depth.data() + y * width;
+			for (uint32_t x = x0; x <= x1; x += 4) {
+				F4 px = splat(float(x)) + lanes;
+				M4 inside = (A0 * px + r0 >= zero) & (A1 * px + r1 >= zero) & (A2 * px + r2 >= zero);
+				if (!bits(inside)) continue;
+				F4 old = load4(row + x);
+				store4(select4(inside, max4(old, Az4 * px + rz), old), row + x);
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::build_pyramid() {
+	//each texel holds the farthest (smallest 1 / w) of the texels it covers in the level below:
+	for (uint32_t l = 1; l < levels.size(); ++l) {
+		Level const &below = levels[l-1];
+		Level &level = levels[l];
+		for (uint32_t y = 0; y < level.height; ++y) {
+			uint32_t y_a = 2 * y;
+			uint32_t y_b = std::min(2 * y + 1, below.height - 1);
+			for (uint32_t x = 0; x < level.width; ++x) {
+				uint32_t x_a = 2 * x;
+				uint32_t x_b = std::min(2 * x + 1, below.width - 1);
+				level.depth[y * level.width + x] = std::min(
+					std::min(below.depth[y_a * below.width + x_a], below.depth[y_a * below.width + x_b]),
+					std::min(below.depth[y_b * below.width + x_a], below.depth[y_b * below.width + x_b])
+				);
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::visible(glm::mat4 const &object_to_clip, glm::vec3 const &min, glm::vec3 const &max) {
+	tested += 1;
+
+	//screen-space bounds and nearest 1 / w of the box's corners:
+	// (since w is linear, the nearest point of the box is a corner)
+	glm::vec2 screen_min = glm::vec2( std::numeric_limits< float >::infinity());
+	glm::vec2 screen_max = glm::vec2(-std::numeric_limits< float >::infinity());
+	float nearest = 0.0f;
+	for (uint32_t c = 0; c < 8; ++c) {
+		glm::vec3 corner = glm::vec3((c & 1) ? max.x : min.x, (c & 2) ? max.y : min.y, (c & 4) ? max.z : min.z);
+		glm::vec4 clip = object_to_clip * glm::vec4(corner, 1.0f);
+		if (!(clip.w > MinW)) return true;
+		float inv_w = 1.0f / clip.w;
+		glm::vec2 screen = glm::vec2((clip.x * inv_w + 1.0f) * 0.5f * float(width), (clip.y * inv_w + 1.0f) * 0.5f * float(height));
+		screen_min = glm::min(screen_min, screen);
+		screen_max = glm::max(screen_max, screen);
+		nearest = std::max(nearest, inv_w);
+	}
+	if (!(screen_max.x >= 0.0f && screen_max.y >= 0.0f && screen_min.x < float(width) && screen_min.y < float(height))) return true;
+
+	//pixels the box's screen bounds touch:
+	screen_min = glm::max(glm::floor(screen_min), glm::vec2(0.0f));
+	screen_max = glm::min(glm::floor(screen_max), glm::vec2(float(width - 1), float(height - 1)));
+	uint32_t x0 = uint32_t(screen_min.x), x1 = uint32_t(screen_max.x);
+	uint32_t y0 = uint32_t(screen_min.y), y1 = uint32_t(screen_max.y);
+
+	//test a few texels of the level where the bounds are (at most) 4x4 texels:
+	uint32_t l = 0;
+	while (l + 1 < levels.size() && ((x1 >> l) - (x0 >> l) > 3 || (y1 >> l) - (y0 >> l) > 3)) ++l;
+	Level const &level = levels[l];
+	for (uint32_t y = (y0 >> l); y <= (y1 >> l); ++y) {
+		for (uint32_t x = (x0 >> l); x <= (x1 >> l); ++x) {
+			if (level.depth[y * level.width + x] <= nearest) return true;
+		}
+	}
+
+	rejected += 1;
+	return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ * An OcclusionBuffer is a small, CPU-rasterized depth buffer for skipping
+ *  drawables hidden behind others ("occluders"), before they are sent to OpenGL.
+ *
+ * Each view:
+ *  - clear()
+ *  - draw_occluder() the (few, simple) triangles of designated occluders
+ *  - build_pyramid(), which makes coarser levels holding the farthest depth of each 2x2 block
+ *  - visible() tests the bounding boxes of drawables against the pyramid
+ *
+ * Occluder triangles must be hidden by the drawn surface they stand in for
+ *  (e.g., a simplified mesh or box inside it), or things behind them may be
+ *  wrongly skipped. Coverage is sampled at (low resolution) pixel centers, so
+ *  drawables peeking out past an occluder by less than a pixel may be skipped.
+ *
+ * Runs entirely on the CPU (four pixels at a time; see simd4.hpp), so results
+ *  don't depend on the GPU.
+ *
+ * Scene::draw uses one of these if Scene::occlusion is set.
+ *
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct OcclusionBuffer {
+	//(width is rounded up to a multiple of four)
+	OcclusionBuffer(uint32_t width = 256, uint32_t height = 128);
+
+	//start a new view with nothing occluded:
+	void clear();
+
+	//draw triangles (three positions per triangle) as occluders:
+	// (triangles are drawn double-sided; triangles that cross the near plane are skipped)
+	void draw_occluder(glm::mat4 const &object_to_clip, glm::vec3 const *positions, uint32_t count);
+
+	//make the coarser levels used by visible(); call after drawing occluders:
+	void build_pyramid();
+
+	//might any part of box 'min'-'max' be visible past the occluders?
+	// (boxes that reach behind the eye or are out of view are reported visible)
+	bool visible(glm::mat4 const &object_to_clip, glm::vec3 const &min, glm::vec3 const &max);
+
+	//visible() calls since clear() and how many returned false:
+	uint32_t tested = 0;
+	uint32_t rejected = 0;
+	float rejected_percent() const { return (tested ? 100.0f * float(rejected) / float(tested) : 0.0f); }
+
+	//-- internals ---
+	uint32_t width, height;
+
+	//depth is stored as 1 / w (clip-space w; larger is nearer, 0 is infinitely far):
+	// levels[0] is the full-resolution buffer, levels[l] is half the size of levels[l-1] (rounded up)
+	struct Level {
+		uint32_t width = 0, height = 0;
+		std::vector< float > depth;
+	};
+	std::vector< Level > levels;
+};
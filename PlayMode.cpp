@@ -17,46 +17,95 @@
 
 GLuint hexapod_meshes_for_lit_color_texture_program = 0;
 Load< MeshBuffer > hexapod_meshes(LoadTagDefault, []() -> MeshBuffer const * {
-	MeshBuffer const *ret = new MeshBuffer(data_path("hexapod.pnct"));
-	hexapod_meshes_for_lit_color_texture_program = ret->make_vao_for_program(lit_color_texture_program->program);
+	//(vertices are kept so the hexapod's parts can be merged into a skinned model)
+	MeshBuffer const *ret = new MeshBuffer(data_path("hexapod.pnct"), MeshBuffer::KeepVertices);
+	//(quantized mesh buffers need the program variant that decodes their normals)
+	hexapod_meshes_for_lit_color_texture_program = ret->make_vao_for_program((ret->quantized ? quantized_lit_color_texture_program : lit_color_texture_program)->program);
 	return ret;
 });
 
 Load< Scene > hexapod_scene(LoadTagDefault, []() -> Scene const * {
-	return new Scene(data_path("hexapod.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name){
+	return new Scene(data_path("hexapod.scene"), [&](Scene &scene, Scene::Transform *transform, std::string_view mesh_name){
 		Mesh const &mesh = hexapod_meshes->lookup(mesh_name);
 
 		scene.drawables.emplace_back(transform);
 		Scene::Drawable &drawable = scene.drawables.back();
 
-		drawable.pipeline = lit_color_texture_program_pipeline;
+		drawable.pipeline = (hexapod_meshes->quantized ? quantized_lit_color_texture_program_pipeline : lit_color_texture_program_pipeline);
 
 		drawable.pipeline.vao = hexapod_meshes_for_lit_color_texture_program;
 		drawable.pipeline.type = mesh.type;
 		drawable.pipeline.start = mesh.start;
 		drawable.pipeline.count = mesh.count;
+		drawable.pipeline.position_to_object = mesh.position_to_object;
+		drawable.pipeline.mesh = &mesh;
 
 	});
 });
 
 PlayMode::PlayMode() : scene(*hexapod_scene) {
-	//get pointers to leg for convenience:
-	for (auto &transform : scene.transforms) {
-		if (transform.name == "Hip.FL") hip = &transform;
-		else if (transform.name == "UpperLeg.FL") upper_leg = &transform;
-		else if (transform.name == "LowerLeg.FL") lower_leg = &transform;
+	//play the first clip exported with the scene:
+	if (!scene.clips.empty()) {
+		clip = scene.clips[0];
+	} else {
+		//...or, if there isn't one, a ten-second loop of wobbling one leg, baked here:
+		Scene::Transform *hip = scene.find("Hip.FL");
+		Scene::Transform *upper_leg = scene.find("UpperLeg.FL");
+		Scene::Transform *lower_leg = scene.find("LowerLeg.FL");
+		if (hip == nullptr) throw std::runtime_error("Hip not found.");
+		if (upper_leg == nullptr) throw std::runtime_error("Upper leg not found.");
+		if (lower_leg == nullptr) throw std::runtime_error("Lower leg not found.");
+
+		constexpr uint32_t Frames = 301;
+		std::vector< uint32_t > targets{scene.transforms.index_of(hip), scene.transforms.index_of(upper_leg), scene.transforms.index_of(lower_leg)};
+		std::shared_ptr< AnimationClip > wobble = std::make_shared< AnimationClip >("wobble", 30.0f, Frames, targets);
+		for (uint32_t f = 0; f < Frames; ++f) {
+			float amt = f / float(Frames - 1);
+			wobble->set_key(f, 0, hip->position, hip->rotation * glm::angleAxis(
+				glm::radians(5.0f * std::sin(amt * 2.0f * float(M_PI))),
+				glm::vec3(0.0f, 1.0f, 0.0f)
+			), hip->scale);
+			wobble->set_key(f, 1, upper_leg->position, upper_leg->rotation * glm::angleAxis(
+				glm::radians(7.0f * std::sin(amt * 2.0f * 2.0f * float(M_PI))),
+				glm::vec3(0.0f, 0.0f, 1.0f)
+			), upper_leg->scale);
+			wobble->set_key(f, 2, lower_leg->position, lower_leg->rotation * glm::angleAxis(
+				glm::radians(10.0f * std::sin(amt * 3.0f * 2.0f * float(M_PI))),
+				glm::vec3(0.0f, 0.0f, 1.0f)
+			), lower_leg->scale);
+		}
+		clip = wobble;
 	}
-	if (hip == nullptr) throw std::runtime_error("Hip not found.");
-	if (upper_leg == nullptr) throw std::runtime_error("Upper leg not found.");
-	if (lower_leg == nullptr) throw std::runtime_error("Lower leg not found.");
-
-	hip_base_rotation = hip->rotation;
-	upper_leg_base_rotation = upper_leg->rotation;
-	lower_leg_base_rotation = lower_leg->rotation;
+	pose = AnimationPose(clip->targets);
 
 	//get pointer to camera for convenience:
 	if (scene.cameras.size() != 1) throw std::runtime_error("Expecting scene to have exactly one camera, but it has " + std::to_string(scene.cameras.size()));
 	camera = &scene.cameras.front();
+
+	//only drawables on animated transforms (or their children) move; the rest can go in the static bounds tree:
+	std::vector< bool > animated(scene.transforms.slot_count(), false);
+	for (uint32_t slot : clip->targets) {
+		if (slot < animated.size()) animated[slot] = true;
+	}
+	for (auto &drawable : scene.drawables) {
+		drawable.dynamic = false;
+		for (Scene::Transform *t = drawable.transform; t != nullptr; t = t->parent) {
+			if (animated[scene.transforms.index_of(t)]) {
+				drawable.dynamic = true;
+				break;
+			}
+		}
+	}
+
+	//draw the animated hierarchy (everything under the topmost parent of an animated transform) as one skinned drawable:
+	if (!clip->targets.empty() && scene.transforms.at(clip->targets[0])) {
+		Scene::Transform *root = scene.transforms.at(clip->targets[0]);
+		while (root->parent) root = root->parent;
+		hexapod = std::make_unique< SkinnedModel >(scene, root, skinned_lit_color_texture_program_pipeline, &palettes);
+		palettes.update();
+	}
+
+	scene.build_bounds();
 }
 
 PlayMode::~PlayMode() {
@@ -126,22 +175,16 @@ bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 
 void PlayMode::update(float elapsed) {
 
-	//slowly rotates through [0,1):
-	wobble += elapsed / 10.0f;
-	wobble -= std::floor(wobble);
-
-	hip->rotation = hip_base_rotation * glm::angleAxis(
-		glm::radians(5.0f * std::sin(wobble * 2.0f * float(M_PI))),
-		glm::vec3(0.0f, 1.0f, 0.0f)
-	);
-	upper_leg->rotation = upper_leg_base_rotation * glm::angleAxis(
-		glm::radians(7.0f * std::sin(wobble * 2.0f * 2.0f * float(M_PI))),
-		glm::vec3(0.0f, 0.0f, 1.0f)
-	);
-	lower_leg->rotation = lower_leg_base_rotation * glm::angleAxis(
-		glm::radians(10.0f * std::sin(wobble * 3.0f * 2.0f * float(M_PI))),
-		glm::vec3(0.0f, 0.0f, 1.0f)
-	);
+	//advance the animation (wrapping, so time doesn't lose precision as it grows):
+	clip_time += elapsed;
+	if (clip->duration() > 0.0f) clip_time = std::fmod(clip_time, clip->duration());
+
+	pose.clear();
+	pose.add(*clip, clip_time);
+	pose.apply(scene);
+
+	//re-compute bone palettes (and bounds) of skinned models for the new pose:
+	palettes.update();
 
 	//move camera:
 	{
@@ -170,18 +213,52 @@ void PlayMode::update(float elapsed) {
 	right.downs = 0;
 	up.downs = 0;
 	down.downs = 0;
+
+	//refit bounds of (possibly) moved drawables:
+	scene.update_bounds();
 }
 
 void PlayMode::draw(glm::uvec2 const &drawable_size) {
 	
-	//set up light type and position for lit_color_texture_program:
+	//set up light type and position for lit_color_texture_program (and the skinned variant):
 	// TODO: consider using the Light(s) in the scene to do this
-	glUseProgram(lit_color_texture_program->program);
-	glUniform1i(lit_color_texture_program->LIGHT_TYPE_int, 1);
-	glUniform3fv(lit_color_texture_program->LIGHT_DIRECTION_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 0.0f,-1.0f)));
-	glUniform3fv(lit_color_texture_program->LIGHT_ENERGY_vec3, 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 0.95f)));
+	for (LitColorTextureProgram const *program : {&*lit_color_texture_program, &*skinned_lit_color_texture_program}) {
+		glUseProgram(program->program);
+		glUniform1i(program->LIGHT_TYPE_int, 1);
+		glUniform3fv(program->LIGHT_DIRECTION_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 0.0f,-1.0f)));
+		glUniform3fv(program->LIGHT_ENERGY_vec3, 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 0.95f)));
+	}
 	glUseProgram(0);
 
+	//set up a transform representing the stage's position in the world:
+	// NOTE: state's "up" direction is +Y.
+	Scene::Transform stage;
+	stage.rotation = glm::quat_cast(glm::mat3(
+		glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f,-1.0f, 0.0f)
+	));
+	stage.position = glm::vec3(0.0f, 0.0f, 0.0f); //just center up for now
+	stage.scale = glm::vec3(10.0f); //let's make the player large!
+
+	{ //choose levels of detail once for every view drawn this frame (so both eyes -- and the window -- agree):
+		std::vector< Scene::LODView > views;
+		#ifndef __ANDROID__
+		views.emplace_back();
+		views.back().eye = camera->transform->make_local_to_world()[3];
+		views.back().scale = Scene::lod_scale(std::tan(0.5f * camera->fovy), -std::tan(0.5f * camera->fovy), float(drawable_size.y));
+		#endif //__ANDROID__
+		if (xr && xr->next_frame.should_render) {
+			glm::mat4x3 stage_to_world = stage.make_local_to_world();
+			for (auto const &view : xr->views) {
+				views.emplace_back();
+				views.back().eye = stage_to_world * glm::vec4(view.pose.position.x, view.pose.position.y, view.pose.position.z, 1.0f);
+				views.back().scale = Scene::lod_scale(std::tan(view.fov.angleUp), std::tan(view.fov.angleDown), float(xr->size.y));
+			}
+		}
+		scene.update_lods(views);
+	}
+
 	//NOTE: on android, only render to swapchain images (below), not to the main window:
 	#ifndef __ANDROID__
 
@@ -218,17 +295,6 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 	//----------------------------------------------
 
 	if (xr && xr->next_frame.should_render) {
-		//set up a transform representing the stage's position in the world:
-		// NOTE: state's "up" direction is +Y.
-		Scene::Transform stage;
-		stage.rotation = glm::quat_cast(glm::mat3(
-			glm::vec3(1.0f, 0.0f, 0.0f),
-			glm::vec3(0.0f, 0.0f, 1.0f),
-			glm::vec3(0.0f,-1.0f, 0.0f)
-		));
-		stage.position = glm::vec3(0.0f, 0.0f, 0.0f); //just center up for now
-		stage.scale = glm::vec3(10.0f); //let's make the player large!
-
 		for (auto const &view : xr->views) {
 			if (!view.current_framebuffer) continue; //weird bug but nothing to do, I guess
 
@@ -1,9 +1,12 @@
 #include "Mode.hpp"
 
 #include "Scene.hpp"
+#include "Animation.hpp"
+#include "Skinning.hpp"
 
 #include <glm/glm.hpp>
 
+#include <memory>
 #include <vector>
 #include <deque>
 
@@ -32,14 +35,14 @@ struct PlayMode : Mode {
 	//local copy of the game scene (so code can change it during gameplay):
 	Scene scene;
 
-	//hexapod leg to wobble:
-	Scene::Transform *hip = nullptr;
-	Scene::Transform *upper_leg = nullptr;
-	Scene::Transform *lower_leg = nullptr;
-	glm::quat hip_base_rotation;
-	glm::quat upper_leg_base_rotation;
-	glm::quat lower_leg_base_rotation;
-	float wobble = 0.0f;
+	//animation playing on the hexapod (looped):
+	std::shared_ptr< AnimationClip const > clip;
+	AnimationPose pose;
+	float clip_time = 0.0f;
+
+	//the hexapod's parts, merged into one skinned drawable:
+	SkinPalettes palettes;
+	std::unique_ptr< SkinnedModel > hexapod;
 	
 	//camera:
 	Scene::Camera *camera = nullptr;
@@ -0,0 +1,306 @@
+#pragma once
+
+/*
+ * A Pool is the container Scene keeps its transforms, drawables, cameras, and lights in.
+ *
+ * Items live in fixed-size blocks of contiguous slots:
+ *  - items never move, so pointers to them (e.g., Drawable::transform) stay valid until they are erased
+ *  - iteration walks slots in index order (skipping erased ones), so is mostly a linear scan of memory
+ *  - each slot has an index (index_of()), so other code can keep per-item data in plain
+ *    arrays ("columns") indexed by slot, instead of in maps keyed by pointer
+ *  - each slot also has a generation, bumped whenever its item is erased, so a Handle
+ *    (index + generation) can tell whether the item it was made for is still there
+ *
+ * The interface follows std::list (emplace_back, back, erase, ...), but -- unlike std::list --
+ *  items are not kept in the order they were added: emplace_back() re-uses the slot of the most
+ *  recently erased item (if any) before adding a slot at the end, so iteration order is slot order.
+ *  (handles stay safe, since a re-used slot gets a new generation)
+ *  So a pool never has more slots than it has had items alive at once, and its storage -- blocks
+ *  are kept until it is destroyed -- stops growing once a scene that adds and removes items
+ *  (e.g., WorldStream cells) reaches its peak.
+ *
+ * Items are stored whole, rather than split into an array per field, because other code points to
+ *  them (Drawable::transform, Transform::parent, ...); loops that want a field-per-array layout keep
+ *  their own columns indexed by slot (as GPUCulling and ScenePrefab do).
+ *
+ * Copying a pool copies items slot-for-slot (with memcpy for trivially copyable items),
+ *  so an item and its copy have the same index -- which makes re-pointing copied
+ *  pointers (as Scene::set does) an index lookup.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template< typename T >
+struct Pool {
+	static constexpr uint32_t BlockSize = 256; //slots per block
+
+	struct Handle {
+		uint32_t index = -1U;
+		uint32_t generation = 0;
+		bool operator==(Handle const &o) const { return index == o.index && generation == o.generation; }
+		bool operator!=(Handle const &o) const { return !(*this == o); }
+	};
+
+	Pool() = default;
+	Pool(Pool const &other) { *this = other; }
+	Pool &operator=(Pool const &other);
+	~Pool() { clear(); }
+
+	//copy slot-for-slot by calling copy_item(T &to, T const &from) on default-constructed items:
+	// (for items that can't be copy-constructed, like Scene::Transform)
+	template< typename F >
+	void assign(Pool const &other, F const &copy_item);
+
+	//add an item (in the most recently erased slot, or a new slot at the end):
+	template< typename... Args >
+	T &emplace_back(Args &&... args);
+
+	//add 'n' default-constructed items (as emplace_back() would), appending their indices to 'indices':
+	// (the items can then be filled in -- e.g., from several threads, each with its own range -- through at())
+	void emplace_back_n(uint32_t n, std::vector< uint32_t > *indices);
+
+	//allocate blocks for 'n' more items, so the next 'n' emplace_back()s don't allocate:
+	void reserve_back(uint32_t n);
+
+	//remove an item (pointers to it and handles of it become invalid):
+	void erase(T const *item);
+
+	//remove all items (all handles become invalid):
+	void clear();
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	//slots (alive or erased) in use; indices are less than this:
+	uint32_t slot_count() const { return slots; }
+	//bytes allocated for slots (blocks are kept until the pool is destroyed, even by clear()):
+	size_t storage_bytes() const { return blocks.size() * sizeof(Block) + (generations.capacity() + free_slots.capacity()) * sizeof(uint32_t); }
+
+	//changes whenever items are added or removed (and never repeats), so other code can tell whether
+	// something it built from the pool -- e.g., an index of names -- is stale:
+	uint64_t revision() const { return changes; }
+
+	//slot of an item in this pool:
+	uint32_t index_of(T const *item) const;
+	Handle handle(T const *item) const { uint32_t i = index_of(item); return Handle{i, generations[i]}; }
+
+	//item in a slot (or nullptr if the slot is erased or out of range):
+	T *at(uint32_t index) { return (alive(index) ? slot(index) : nullptr); }
+	T const *at(uint32_t index) const { return (alive(index) ? slot(index) : nullptr); }
+	//item a handle was made for (or nullptr if it has since been erased):
+	T *get(Handle const &h) { return (alive(h.index) && generations[h.index] == h.generation ? slot(h.index) : nullptr); }
+	T const *get(Handle const &h) const { return (alive(h.index) && generations[h.index] == h.generation ? slot(h.index) : nullptr); }
+
+	template< typename P, typename V >
+	struct Iterator {
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = V *;
+		using reference = V &;
+
+		P *pool = nullptr;
+		uint32_t index = 0;
+
+		Iterator() = default;
+		Iterator(P *pool_, uint32_t index_) : pool(pool_), index(index_) { }
+		//(const iterators from non-const ones:)
+		template< typename P2, typename V2 >
+		Iterator(Iterator< P2, V2 > const &o) : pool(o.pool), index(o.index) { }
+
+		reference operator*() const { return *pool->slot(index); }
+		pointer operator->() const { return pool->slot(index); }
+		Iterator &operator++() { do { ++index; } while (index < pool->slots && !pool->alive(index)); return *this; }
+		Iterator &operator--() { do { --index; } while (!pool->alive(index)); return *this; }
+		Iterator operator++(int) { Iterator ret = *this; ++*this; return ret; }
+		Iterator operator--(int) { Iterator ret = *this; --*this; return ret; }
+		bool operator==(Iterator const &o) const { return index == o.index; }
+		bool operator!=(Iterator const &o) const { return index != o.index; }
+	};
+	typedef Iterator< Pool, T > iterator;
+	typedef Iterator< Pool const, T const > const_iterator;
+	typedef std::reverse_iterator< iterator > reverse_iterator;
+	typedef std::reverse_iterator< const_iterator > const_reverse_iterator;
+
+	iterator begin() { return iterator(this, first_alive()); }
+	iterator end() { return iterator(this, slots); }
+	const_iterator begin() const { return const_iterator(this, first_alive()); }
+	const_iterator end() const { return const_iterator(this, slots); }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	T &front() { assert(count); return *begin(); }
+	T const &front() const { assert(count); return *begin(); }
+	//the most recently added item if it is still there (otherwise, the item in the highest slot):
+	T &back() { assert(count); return (alive(newest) ? *slot(newest) : *std::prev(end())); }
+	T const &back() const { assert(count); return (alive(newest) ? *slot(newest) : *std::prev(end())); }
+
+	//-- internals ---
+	struct Block {
+		alignas(T) unsigned char bytes[sizeof(T) * BlockSize];
+	};
+	std::vector< std::unique_ptr< Block > > blocks;
+	std::vector< std::pair< T const *, uint32_t > > block_order; //first item of each block and its block index, sorted by address (for index_of)
+	//generation of each slot; odd while the slot holds an item:
+	std::vector< uint32_t > generations;
+	uint32_t slots = 0; //slots used since the last clear()
+	size_t count = 0; //items alive
+	std::vector< uint32_t > free_slots; //erased slots (below 'slots'), re-used most recently erased first
+	uint32_t newest = -1U; //slot of the most recently added item
+	uint64_t changes = 0; //(see revision())
+
+	bool alive(uint32_t index) const { return index < slots && (generations[index] & 1); }
+	T *slot(uint32_t index) const { return reinterpret_cast< T * >(blocks[index / BlockSize]->bytes) + index % BlockSize; }
+	uint32_t first_alive() const { uint32_t i = 0; while (i < slots && !alive(i)) ++i; return i; }
+	void add_block();
+	//make room for slot 'slots', returning its address:
+	T *grow();
+	//clear() and take on the slots (but not the items) of 'other':
+	void copy_slots(Pool const &other);
+};
+
+//---------------------------
+
+template< typename T >
+void Pool< T >::add_block() {
+	blocks.emplace_back(std::make_unique< Block >());
+	std::pair< T const *, uint32_t > entry(reinterpret_cast< T const * >(blocks.back()->bytes), uint32_t(blocks.size() - 1));
+	block_order.insert(std::upper_bound(block_order.begin(), block_order.end(), entry, [](auto const &a, auto const &b) {
+		return std::less< T const * >()(a.first, b.first);
+	}), entry);
+}
+
+template< typename T >
+T *Pool< T >::grow() {
+	if (slots == blocks.size() * BlockSize) add_block();
+	if (slots == generations.size()) generations.emplace_back(0);
+	assert(!(generations[slots] & 1));
+	return slot(slots);
+}
+
+template< typename T >
+template< typename... Args >
+T &Pool< T >::emplace_back(Args &&... args) {
+	//(the slot is only taken once the item is constructed, in case construction throws)
+	bool reuse = !free_slots.empty();
+	uint32_t index = (reuse ? free_slots.back() : slots);
+	T *item = new (reuse ? slot(index) : grow()) T(std::forward< Args >(args)...);
+	if (reuse) free_slots.pop_back();
+	else slots += 1;
+	generations[index] += 1;
+	count += 1;
+	newest = index;
+	changes += 1;
+	return *item;
+}
+
+template< typename T >
+void Pool< T >::emplace_back_n(uint32_t n, std::vector< uint32_t > *indices) {
+	assert(indices);
+	reserve_back(n);
+	indices->reserve(indices->size() + n);
+	for (uint32_t i = 0; i < n; ++i) {
+		emplace_back();
+		indices->emplace_back(newest);
+	}
+}
+
+template< typename T >
+void Pool< T >::reserve_back(uint32_t n) {
+	//(erased slots are re-used first, so only the rest need new slots)
+	size_t fresh = n - std::min(size_t(n), free_slots.size());
+	while (blocks.size() * BlockSize < slots + fresh) add_block();
+	generations.reserve(slots + fresh);
+}
+
+template< typename T >
+void Pool< T >::erase(T const *item) {
+	uint32_t index = index_of(item);
+	assert(alive(index));
+	slot(index)->~T();
+	generations[index] += 1;
+	count -= 1;
+	free_slots.emplace_back(index);
+	changes += 1;
+}
+
+template< typename T >
+void Pool< T >::clear() {
+	for (uint32_t i = 0; i < slots; ++i) {
+		if (!alive(i)) continue;
+		slot(i)->~T();
+		generations[i] += 1;
+	}
+	slots = 0;
+	count = 0;
+	free_slots.clear();
+	newest = -1U;
+	changes += 1;
+}
+
+template< typename T >
+uint32_t Pool< T >::index_of(T const *item) const {
+	//(blocks are separate allocations, so find the last one starting at or before the item)
+	auto after = std::upper_bound(block_order.begin(), block_order.end(), item, [](T const *a, std::pair< T const *, uint32_t > const &b) {
+		return std::less< T const * >()(a, b.first);
+	});
+	assert(after != block_order.begin() && "item is not in this pool");
+	auto const &block = *(after - 1);
+	assert(item < block.first + BlockSize && "item is not in this pool");
+	return block.second * BlockSize + uint32_t(item - block.first);
+}
+
+template< typename T >
+void Pool< T >::copy_slots(Pool const &other) {
+	clear();
+	while (blocks.size() * BlockSize < other.slots) add_block();
+	//(keep generations ahead of any handles into this pool, but with other's alive/erased pattern)
+	if (generations.size() < other.slots) generations.resize(other.slots, 0);
+	for (uint32_t i = 0; i < other.slots; ++i) {
+		generations[i] = (generations[i] & ~1u) + (other.generations[i] & 1);
+	}
+	slots = other.slots;
+	count = other.count;
+	free_slots = other.free_slots;
+	newest = other.newest;
+}
+
+template< typename T >
+Pool< T > &Pool< T >::operator=(Pool const &other) {
+	if (&other == this) return *this;
+	copy_slots(other);
+	if constexpr (std::is_trivially_copyable_v< T >) {
+		//(erased slots are copied too, but never read)
+		for (uint32_t b = 0; b * BlockSize < slots; ++b) {
+			std::memcpy(blocks[b]->bytes, other.blocks[b]->bytes, sizeof(T) * std::min(BlockSize, slots - b * BlockSize));
+		}
+	} else {
+		for (uint32_t i = 0; i < slots; ++i) {
+			if (alive(i)) new (slot(i)) T(*other.slot(i));
+		}
+	}
+	return *this;
+}
+
+template< typename T >
+template< typename F >
+void Pool< T >::assign(Pool const &other, F const &copy_item) {
+	if (&other == this) return;
+	copy_slots(other);
+	for (uint32_t i = 0; i < slots; ++i) {
+		if (alive(i)) copy_item(*new (slot(i)) T(), *other.slot(i));
+	}
+}
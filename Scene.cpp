@@ -1,11 +1,23 @@
 #include "Scene.hpp"
+#include "Animation.hpp"
+#include "GPUCulling.hpp"
+#include "SceneInstance.hpp"
 
+#include "GeometryPool.hpp"
 #include "gl_errors.hpp"
 #include "read_write_chunk.hpp"
 #include "asset_stream.hpp"
+#include "parallel_for.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <tuple>
+
 
 //-------------------------
 
@@ -87,10 +99,127 @@ void Scene::draw(Camera const &camera) const {
 	draw(world_to_clip, world_to_light);
 }
 
+Scene::Frustum::Frustum(glm::mat4 const &to_clip) {
+	glm::vec4 row[4];
+	for (uint32_t r = 0; r < 4; ++r) {
+		row[r] = glm::vec4(to_clip[0][r], to_clip[1][r], to_clip[2][r], to_clip[3][r]);
+	}
+	planes[0] = row[3] + row[0]; //left
+	planes[1] = row[3] - row[0]; //right
+	planes[2] = row[3] + row[1]; //bottom
+	planes[3] = row[3] - row[1]; //top
+	planes[4] = row[3] + row[2]; //near
+	planes[5] = row[3] - row[2]; //far (always passes for infinite projections)
+	for (uint32_t i = 0; i < 6; ++i) {
+		scales[i] = glm::length(glm::vec3(planes[i]));
+	}
+}
+
+bool Scene::Frustum::sphere_outside(glm::vec3 const &center, float radius) const {
+	for (uint32_t i = 0; i < 6; ++i) {
+		if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius * scales[i]) return true;
+	}
+	return false;
+}
+
+//helper: find the eye position of a perspective 'to_clip' matrix (the point that maps to clip x = y = w = 0):
+// returns false for orthographic projections (which don't have one)
+static bool find_eye(glm::mat4 const &to_clip, glm::vec3 *eye_) {
+	assert(eye_);
+	glm::mat3 rows = glm::transpose(glm::mat3(
+		glm::vec3(to_clip[0][0], to_clip[1][0], to_clip[2][0]),
+		glm::vec3(to_clip[0][1], to_clip[1][1], to_clip[2][1]),
+		glm::vec3(to_clip[0][3], to_clip[1][3], to_clip[2][3])
+	));
+	if (glm::determinant(rows) == 0.0f) return false;
+	glm::vec3 eye = glm::inverse(rows) * -glm::vec3(to_clip[3][0], to_clip[3][1], to_clip[3][3]);
+	if (!(std::isfinite(eye.x) && std::isfinite(eye.y) && std::isfinite(eye.z))) return false;
+	*eye_ = eye;
+	return true;
+}
+
+//helper: does 'xf' preserve angles and winding order (i.e., is it rotation + uniform positive scale + translation)?
+// (normal cones can only be tested in object space for such transforms)
+static bool is_similarity(glm::mat4x3 const &xf) {
+	glm::mat3 m = glm::mat3(xf);
+	glm::mat3 mtm = glm::transpose(m) * m;
+	float s = mtm[0][0];
+	for (uint32_t c = 0; c < 3; ++c) {
+		for (uint32_t r = 0; r < 3; ++r) {
+			if (std::abs(mtm[c][r] - (c == r ? s : 0.0f)) > 1e-4f * s) return false;
+		}
+	}
+	return glm::determinant(m) > 0.0f;
+}
+
 void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light) const {
 
-	//Iterate through all drawables, sending each one to OpenGL:
-	for (auto const &drawable : drawables) {
+	//back-facing clusters can only be skipped if OpenGL would cull their triangles anyway:
+	bool cull_back_faces = false;
+	if (glIsEnabled(GL_CULL_FACE)) {
+		GLint cull_face = 0;
+		GLint front_face = 0;
+		glGetIntegerv(GL_CULL_FACE_MODE, &cull_face);
+		glGetIntegerv(GL_FRONT_FACE, &front_face);
+		cull_back_faces = (cull_face == GL_BACK && front_face == GL_CCW);
+	}
+
+	//vertex ranges of visible clusters (static to avoid re-allocating every frame):
+	static MultiDraw visible_clusters;
+
+	//program and vertex array currently bound (meshes from the same GeometryPool share vertex arrays, so these often don't change):
+	Bound bound;
+
+	//with GPU culling, drawables with slots are all sent to OpenGL and the GPU skips those out of view or hidden:
+	bool gpu = (gpu_culling && gpu_culling->supported());
+	size_t gpu_slots = 0; //(the first gpu_slots candidates are GPU culling slots)
+
+	//drawables to consider -- only those whose bounds overlap the view, if bounds are current:
+	// (static to avoid re-allocating every frame)
+	static std::vector< Drawable const * > candidates;
+	candidates.clear();
+	if (gpu) {
+		gpu_culling->cull(*this, world_to_clip);
+		candidates.assign(gpu_culling->slots.begin(), gpu_culling->slots.end());
+		gpu_slots = candidates.size();
+		candidates.insert(candidates.end(), gpu_culling->unslotted.begin(), gpu_culling->unslotted.end());
+	} else if (bounds_current()) {
+		overlap_view(world_to_clip, &candidates);
+		candidates.insert(candidates.end(), unbounded_drawables.begin(), unbounded_drawables.end());
+	} else {
+		for (auto const &drawable : drawables) {
+			candidates.emplace_back(&drawable);
+		}
+	}
+
+	//skip static drawables that can't be seen from the eye's view cell:
+	if (!gpu && use_pvs && !pvs.empty()) {
+		glm::vec3 eye;
+		uint32_t const *visible = (find_eye(world_to_clip, &eye) ? pvs.lookup(eye) : nullptr);
+		if (visible) {
+			candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [visible](Drawable const *drawable) {
+				return !drawable->dynamic && drawable->pvs_bit != -1U && !((visible[drawable->pvs_bit / 32] >> (drawable->pvs_bit % 32)) & 1);
+			}), candidates.end());
+		}
+	}
+
+	//draw occluders in view, so drawables behind them can be skipped:
+	if (!gpu && occlusion) {
+		occlusion->clear();
+		for (Drawable const *candidate : candidates) {
+			if (!candidate->occluder || !candidate->pipeline.mesh || candidate->pipeline.mesh->occluder_count == 0) continue;
+			Mesh const &mesh = *candidate->pipeline.mesh;
+			glm::mat4 object_to_clip = world_to_clip * glm::mat4(candidate->object_to_world());
+			occlusion->draw_occluder(object_to_clip, mesh.occluder, mesh.occluder_count);
+		}
+		occlusion->build_pyramid();
+	}
+
+	//Iterate through candidate drawables, sending each one to OpenGL:
+	for (size_t index = 0; index < candidates.size(); ++index) {
+		Drawable const &drawable = *candidates[index];
+		bool gpu_slot = (index < gpu_slots);
+
 		//Reference to drawable's pipeline for convenience:
 		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
 
@@ -101,79 +230,588 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 		//skip any drawables that don't contain any vertices:
 		if (pipeline.count == 0) continue;
 
+		//the object-to-world matrix is used for culling and in all three uniforms below:
+		assert(drawable.transform); //drawables *must* have a transform
+		glm::mat4x3 object_to_world = drawable.object_to_world();
+
+		//if the mesh is known, skip drawing whatever parts of it are out of view:
+		bool draw_clusters = false;
+		if (pipeline.mesh && !gpu_slot) {
+			Mesh const &mesh = *pipeline.mesh;
+			glm::mat4 object_to_clip = world_to_clip * glm::mat4(object_to_world);
+			Frustum frustum(object_to_clip);
+
+			//whole mesh (via bounding sphere):
+			if (mesh.radius >= 0.0f) {
+				if (frustum.sphere_outside(mesh.center, mesh.radius)) continue;
+			}
+
+			//whole mesh (via bounding box) behind occluders:
+			if (!gpu && occlusion && mesh.min.x <= mesh.max.x) {
+				if (!occlusion->visible(object_to_clip, mesh.min, mesh.max)) continue;
+			}
+
+			//individual clusters (of the full-detail level):
+			if (mesh.cluster_count != 0 && drawable.lod == 0) {
+				glm::vec3 eye;
+				bool cull_cones = cull_back_faces && is_similarity(object_to_world) && find_eye(object_to_clip, &eye);
+
+				visible_clusters.clear();
+				for (uint32_t c = 0; c < mesh.cluster_count; ++c) {
+					Mesh::Cluster const &cluster = mesh.clusters[c];
+					if (frustum.sphere_outside(cluster.center, cluster.radius)) continue;
+					if (cull_cones) {
+						glm::vec3 to_center = cluster.center - eye;
+						if (glm::dot(to_center, cluster.cone_axis) >= cluster.cone_cutoff * glm::length(to_center) + cluster.radius) continue;
+					}
+					visible_clusters.add(cluster.start, cluster.count);
+				}
+				if (visible_clusters.empty()) continue;
+				draw_clusters = true;
+			}
+		}
+
+		//bind program, vertex array, uniforms, and textures:
+		bind_pipeline(pipeline, object_to_world, world_to_clip, world_to_light, &bound);
+
+		//draw the object:
+		if (gpu_slot) {
+			gpu_culling->draw(uint32_t(index), pipeline.type);
+		} else if (pipeline.mesh && drawable.lod != 0 && drawable.lod < pipeline.mesh->lod_count) {
+			Mesh::LOD const &lod = pipeline.mesh->lods[drawable.lod];
+			glDrawArrays(pipeline.type, lod.start, lod.count);
+		} else if (draw_clusters) {
+			visible_clusters.draw(pipeline.type);
+		} else {
+			glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+		}
+
+		unbind_textures(pipeline);
+
+	}
+
+	//instances of prefabs (see load()):
+	for (auto const &instance : instances) {
+		instance.instance->draw(world_to_clip, world_to_light);
+	}
+
+	glUseProgram(0);
+	glBindVertexArray(0);
+
+	//depth drawn this frame is used to cull the next:
+	if (gpu) gpu_culling->capture_depth();
+
+	GL_ERRORS();
+}
+
+void Scene::bind_pipeline(Drawable::Pipeline const &pipeline, glm::mat4x3 const &object_to_world, glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light, Bound *bound) {
+	assert(bound);
 
-		//Set shader program:
+	//Set shader program:
+	if (pipeline.program != bound->program) {
 		glUseProgram(pipeline.program);
+		bound->program = pipeline.program;
+	}
 
-		//Set attribute sources:
+	//Set attribute sources:
+	if (pipeline.vao != bound->vao) {
 		glBindVertexArray(pipeline.vao);
+		bound->vao = pipeline.vao;
+	}
 
-		//Configure program uniforms:
+	//Configure program uniforms:
 
-		//the object-to-world matrix is used in all three of these uniforms:
-		assert(drawable.transform); //drawables *must* have a transform
-		glm::mat4x3 object_to_world = drawable.transform->make_local_to_world();
+	//positions are stored relative to object space (e.g., quantized into a bounding box):
+	glm::mat4x3 position_to_world = object_to_world * glm::mat4(pipeline.position_to_object);
 
-		//OBJECT_TO_CLIP takes vertices from object space to clip space:
-		if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * glm::mat4(object_to_world);
-			glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
+	//OBJECT_TO_CLIP takes vertices from object space to clip space:
+	if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
+		glm::mat4 object_to_clip = world_to_clip * glm::mat4(position_to_world);
+		glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
+	}
+
+	//the object-to-light matrix is used in the next two uniforms:
+	glm::mat4x3 object_to_light = world_to_light * glm::mat4(object_to_world);
+
+	//OBJECT_TO_CLIP takes vertices from object space to light space:
+	if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
+		glm::mat4x3 position_to_light = world_to_light * glm::mat4(position_to_world);
+		glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(position_to_light));
+	}
+
+	//NORMAL_TO_CLIP takes normals from object space to light space:
+	if (pipeline.NORMAL_TO_LIGHT_mat3 != -1U) {
+		glm::mat3 normal_to_light = glm::inverse(glm::transpose(glm::mat3(object_to_light)));
+		glUniformMatrix3fv(pipeline.NORMAL_TO_LIGHT_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_light));
+	}
+
+	//set any requested custom uniforms:
+	if (pipeline.set_uniforms) pipeline.set_uniforms();
+
+	//set up textures:
+	for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
+		if (pipeline.textures[i].texture != 0) {
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(pipeline.textures[i].target, pipeline.textures[i].texture);
+		}
+	}
+}
+
+void Scene::unbind_textures(Drawable::Pipeline const &pipeline) {
+	for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
+		if (pipeline.textures[i].texture != 0) {
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(pipeline.textures[i].target, 0);
+		}
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+float Scene::lod_scale(float tan_up, float tan_down, float height) {
+	return height / std::max(tan_up - tan_down, 1e-6f);
+}
+
+void Scene::update_lods(std::vector< LODView > const &views, float max_pixel_error, float hysteresis) {
+	for (auto &drawable : drawables) {
+		Mesh const *mesh = drawable.pipeline.mesh;
+		if (!mesh || mesh->lod_count == 0) {
+			drawable.lod = 0;
+			continue;
+		}
+
+		//world-space bounding sphere of the mesh:
+		assert(drawable.transform);
+		glm::mat4x3 object_to_world = drawable.object_to_world();
+		glm::vec3 center = object_to_world * glm::vec4(mesh->center, 1.0f);
+		float scale = std::max(glm::length(object_to_world[0]), std::max(glm::length(object_to_world[1]), glm::length(object_to_world[2])));
+		float radius = std::max(0.0f, mesh->radius) * scale;
+
+		//pixels per unit of (object-space) error, in whichever view sees the mesh largest:
+		float pixels_per_error = 0.0f;
+		for (auto const &view : views) {
+			float distance = glm::length(center - view.eye) - radius;
+			if (!(distance > 0.0f)) {
+				pixels_per_error = std::numeric_limits< float >::infinity();
+				break;
+			}
+			pixels_per_error = std::max(pixels_per_error, view.scale * scale / distance);
+		}
+
+		uint32_t level = std::min(drawable.lod, mesh->lod_count - 1);
+		//refine while the current level is too coarse:
+		while (level > 0 && mesh->lods[level].error * pixels_per_error > max_pixel_error) {
+			level -= 1;
+		}
+		//coarsen while the next level is comfortably fine enough:
+		while (level + 1 < mesh->lod_count && mesh->lods[level + 1].error * pixels_per_error <= (1.0f - hysteresis) * max_pixel_error) {
+			level += 1;
+		}
+		drawable.lod = level;
+	}
+}
+
+bool Scene::raycast(glm::vec3 const &origin, glm::vec3 const &direction, float t_max, RayHit *hit) const {
+	assert(hit);
+	bool found = false;
+	auto test = [&](Drawable const &drawable) {
+		Mesh const *mesh = drawable.pipeline.mesh;
+		if (!mesh || !mesh->bvh) return;
+
+		//ray in object space (with the same parameterization, since direction is transformed without normalizing):
+		//(object_to_world() is the baked placement for baked drawables, so invert it rather than the transform)
+		assert(drawable.transform);
+		glm::mat4x3 world_to_object = glm::mat4x3(glm::inverse(glm::mat4(drawable.object_to_world())));
+		glm::vec3 object_origin = world_to_object * glm::vec4(origin, 1.0f);
+		glm::vec3 object_direction = world_to_object * glm::vec4(direction, 0.0f);
+
+		MeshBVH::Hit object_hit;
+		object_hit.t = hit->t;
+		if (mesh->bvh->ray(object_origin, object_direction, t_max, &object_hit)) {
+			found = true;
+			hit->drawable = &drawable;
+			hit->t = object_hit.t;
+			hit->triangle = object_hit.triangle;
+			hit->point = origin + object_hit.t * direction;
+			//(normals transform by the inverse transpose of object_to_world)
+			hit->normal = glm::normalize(glm::transpose(glm::mat3(world_to_object)) * object_hit.normal);
+		}
+	};
+
+	if (bounds_current()) {
+		//(only drawables whose bounds the ray reaches before the closest hit so far)
+		auto visit = [&](void *user) {
+			test(*static_cast< Drawable const * >(user));
+			return std::min(t_max, hit->t);
+		};
+		static_bounds.query_ray(origin, direction, std::min(t_max, hit->t), visit);
+		dynamic_bounds.query_ray(origin, direction, std::min(t_max, hit->t), visit);
+	} else {
+		for (auto const &drawable : drawables) {
+			test(drawable);
+		}
+	}
+	return found;
+}
+
+bool Scene::sphere_contact(glm::vec3 const &center, float radius, SphereContact *contact) const {
+	assert(contact);
+	bool found = false;
+	auto test = [&](Drawable const &drawable) {
+		Mesh const *mesh = drawable.pipeline.mesh;
+		if (!mesh || !mesh->bvh) return;
+		float best = std::min(radius, contact->distance);
+
+		assert(drawable.transform);
+		glm::mat4x3 object_to_world = drawable.object_to_world();
+		float min_scale = std::min(glm::length(object_to_world[0]), std::min(glm::length(object_to_world[1]), glm::length(object_to_world[2])));
+		float max_scale = std::max(glm::length(object_to_world[0]), std::max(glm::length(object_to_world[1]), glm::length(object_to_world[2])));
+		if (!(min_scale > 0.0f)) return;
+
+		//skip meshes whose bounding sphere is out of range:
+		if (glm::length(object_to_world * glm::vec4(mesh->center, 1.0f) - center) - mesh->radius * max_scale > best) return;
+
+		//query in object space with a sphere big enough to contain the world-space sphere:
+		// (exact for uniformly scaled transforms; otherwise the world-space distance is re-checked)
+		glm::mat4x3 world_to_object = glm::mat4x3(glm::inverse(glm::mat4(object_to_world)));
+		MeshBVH::Contact object_contact;
+		if (mesh->bvh->sphere(world_to_object * glm::vec4(center, 1.0f), best / min_scale, &object_contact)) {
+			glm::vec3 point = object_to_world * glm::vec4(object_contact.point, 1.0f);
+			float distance = glm::length(point - center);
+			if (distance <= best) {
+				found = true;
+				contact->drawable = &drawable;
+				contact->distance = distance;
+				contact->triangle = object_contact.triangle;
+				contact->point = point;
+			}
+		}
+	};
+
+	if (bounds_current()) {
+		auto visit = [&](void *user) {
+			test(*static_cast< Drawable const * >(user));
+		};
+		static_bounds.query_sphere(center, std::min(radius, contact->distance), visit);
+		dynamic_bounds.query_sphere(center, std::min(radius, contact->distance), visit);
+	} else {
+		for (auto const &drawable : drawables) {
+			test(drawable);
+		}
+	}
+	return found;
+}
+
+bool Scene::Drawable::world_bounds(glm::vec3 *min_, glm::vec3 *max_) const {
+	assert(min_ && max_);
+	Mesh const *mesh = pipeline.mesh;
+	if (!mesh || !(mesh->min.x <= mesh->max.x)) return false;
+
+	if (baked && !dynamic) {
+		*min_ = baked_min;
+		*max_ = baked_max;
+		return true;
+	}
+
+	//box around the transformed mesh box:
+	glm::mat4x3 object_to_world = transform->make_local_to_world();
+	glm::vec3 center = object_to_world * glm::vec4(0.5f * (mesh->min + mesh->max), 1.0f);
+	glm::vec3 half = 0.5f * (mesh->max - mesh->min);
+	glm::vec3 extent = glm::abs(object_to_world[0]) * half.x + glm::abs(object_to_world[1]) * half.y + glm::abs(object_to_world[2]) * half.z;
+	*min_ = center - extent;
+	*max_ = center + extent;
+	return true;
+}
+
+//helper: world-space bounding box of a drawable as an AABBTree::Box:
+static bool world_bounds(Scene::Drawable const &drawable, AABBTree::Box *box) {
+	assert(box);
+	return drawable.world_bounds(&box->min, &box->max);
+}
+
+void Scene::build_bounds() {
+	static_bounds.clear();
+	dynamic_bounds.clear();
+	dynamic_drawables.clear();
+	unbounded_drawables.clear();
+
+	std::vector< std::pair< AABBTree::Box, void * > > static_items, dynamic_items;
+	for (auto &drawable : drawables) {
+		drawable.bounds_proxy = -1U;
+		AABBTree::Box box;
+		if (!world_bounds(drawable, &box)) {
+			unbounded_drawables.emplace_back(&drawable);
+		} else if (drawable.dynamic) {
+			dynamic_items.emplace_back(box, &drawable);
+			dynamic_drawables.emplace_back(&drawable);
+		} else {
+			static_items.emplace_back(box, &drawable);
 		}
+	}
+
+	std::vector< uint32_t > proxies;
+	static_bounds.build(static_items, &proxies);
+	for (uint32_t i = 0; i < static_items.size(); ++i) {
+		static_cast< Drawable * >(static_items[i].second)->bounds_proxy = proxies[i];
+	}
+	dynamic_bounds.build(dynamic_items, &proxies);
+	for (uint32_t i = 0; i < dynamic_items.size(); ++i) {
+		static_cast< Drawable * >(dynamic_items[i].second)->bounds_proxy = proxies[i];
+	}
 
-		//the object-to-light matrix is used in the next two uniforms:
-		glm::mat4x3 object_to_light = world_to_light * glm::mat4(object_to_world);
+	bounded_revision = drawables.revision();
+	bounds_built = true;
+}
 
-		//OBJECT_TO_CLIP takes vertices from object space to light space:
-		if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
+void Scene::update_bounds() {
+	if (!bounds_current()) {
+		build_bounds();
+		return;
+	}
+	for (Drawable *drawable : dynamic_drawables) {
+		AABBTree::Box box;
+		if (world_bounds(*drawable, &box)) {
+			dynamic_bounds.move(drawable->bounds_proxy, box);
 		}
+	}
+}
 
-		//NORMAL_TO_CLIP takes normals from object space to light space:
-		if (pipeline.NORMAL_TO_LIGHT_mat3 != -1U) {
-			glm::mat3 normal_to_light = glm::inverse(glm::transpose(glm::mat3(object_to_light)));
-			glUniformMatrix3fv(pipeline.NORMAL_TO_LIGHT_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_light));
+//helper for the overlap queries -- use trees if they are current, otherwise test every drawable:
+template< typename TreeQuery, typename BoxTest >
+static void find_overlaps(Scene const &scene, TreeQuery const &tree_query, BoxTest const &box_test, std::vector< Scene::Drawable const * > *out) {
+	assert(out);
+	if (scene.bounds_current()) {
+		auto add = [out](void *user) {
+			out->emplace_back(static_cast< Scene::Drawable const * >(user));
+		};
+		tree_query(scene.static_bounds, add);
+		tree_query(scene.dynamic_bounds, add);
+	} else {
+		for (auto const &drawable : scene.drawables) {
+			AABBTree::Box box;
+			if (world_bounds(drawable, &box) && box_test(box)) out->emplace_back(&drawable);
 		}
+	}
+}
+
+void Scene::overlap_box(glm::vec3 const &min, glm::vec3 const &max, std::vector< Drawable const * > *out) const {
+	AABBTree::Box query;
+	query.min = min;
+	query.max = max;
+	find_overlaps(*this,
+		[&](AABBTree const &tree, auto const &add) { tree.query_box(query, add); },
+		[&](AABBTree::Box const &box) { return AABBTree::overlaps_box(box, query); },
+		out);
+}
+
+void Scene::overlap_sphere(glm::vec3 const &center, float radius, std::vector< Drawable const * > *out) const {
+	find_overlaps(*this,
+		[&](AABBTree const &tree, auto const &add) { tree.query_sphere(center, radius, add); },
+		[&](AABBTree::Box const &box) { return AABBTree::overlaps_sphere(box, center, radius); },
+		out);
+}
+
+void Scene::overlap_ray(glm::vec3 const &origin, glm::vec3 const &direction, float t_max, std::vector< Drawable const * > *out) const {
+	find_overlaps(*this,
+		[&](AABBTree const &tree, auto const &add) { tree.query_ray(origin, direction, t_max, [&](void *user) { add(user); return t_max; }); },
+		[&](AABBTree::Box const &box) { return AABBTree::overlaps_ray(box, origin, 1.0f / direction, t_max); },
+		out);
+}
 
-		//set any requested custom uniforms:
-		if (pipeline.set_uniforms) pipeline.set_uniforms();
+void Scene::overlap_view(glm::mat4 const &world_to_clip, std::vector< Drawable const * > *out) const {
+	Frustum frustum(world_to_clip);
+	find_overlaps(*this,
+		[&](AABBTree const &tree, auto const &add) { tree.query_planes(frustum.planes, 6, add); },
+		[&](AABBTree::Box const &box) { uint32_t active = 0x3f; return AABBTree::overlaps_planes(box, frustum.planes, 6, &active); },
+		out);
+}
+
+
+uint32_t Scene::batch_static(float cell_size) {
+	assert(cell_size > 0.0f);
 
-		//set up textures:
+	//group drawables that can be merged by everything they bind, and by grid cell:
+	typedef std::tuple< GLuint, GLuint, bool, std::array< GLuint, 2 * Drawable::Pipeline::TextureCount >, glm::ivec3 > GroupKey;
+	struct GroupKeyLess {
+		bool operator()(GroupKey const &a, GroupKey const &b) const {
+			auto const &ca = std::get< 4 >(a);
+			auto const &cb = std::get< 4 >(b);
+			return std::tie(std::get< 0 >(a), std::get< 1 >(a), std::get< 2 >(a), std::get< 3 >(a), ca.x, ca.y, ca.z)
+			     < std::tie(std::get< 0 >(b), std::get< 1 >(b), std::get< 2 >(b), std::get< 3 >(b), cb.x, cb.y, cb.z);
+		}
+	};
+	std::map< GroupKey, std::vector< Drawable * >, GroupKeyLess > groups;
+
+	for (auto &drawable : drawables) {
+		Drawable *d = &drawable;
+		Drawable::Pipeline const &pipeline = d->pipeline;
+		if (d->dynamic || d->occluder || pipeline.set_uniforms) continue;
+		if (pipeline.program == 0 || pipeline.vao == 0 || pipeline.type != GL_TRIANGLES) continue;
+		Mesh const *mesh = pipeline.mesh;
+		if (!mesh || !mesh->vertices || mesh->lod_count > 1 || mesh->count == 0) continue;
+		if (pipeline.start != mesh->start || pipeline.count != mesh->count) continue;
+
+		glm::vec3 min, max;
+		if (!d->world_bounds(&min, &max)) continue;
+		glm::vec3 center = 0.5f * (min + max);
+
+		std::array< GLuint, 2 * Drawable::Pipeline::TextureCount > textures;
 		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, pipeline.textures[i].texture);
+			textures[2 * i + 0] = pipeline.textures[i].texture;
+			textures[2 * i + 1] = pipeline.textures[i].target;
+		}
+		GroupKey key(pipeline.program, pipeline.vao, mesh->quantized, textures, glm::ivec3(glm::floor(center / cell_size)));
+		groups[key].emplace_back(d);
+	}
+
+	uint32_t made = 0;
+	for (auto const &[key, members] : groups) {
+		//(nothing to gain from a batch of one)
+		if (members.size() < 2) continue;
+		bool quantized = std::get< 2 >(key);
+
+		//stored vertices of every member (in batch order), and their world-space positions and normals:
+		std::vector< uint8_t const * > sources;
+		std::vector< glm::vec3 > positions;
+		std::vector< glm::vec3 > normals;
+		std::vector< glm::vec3 > bvh_positions; //(triangles of members with BVHs, for the batch's BVH)
+		size_t stride = (quantized ? sizeof(MeshBuffer::QuantizedVertex) : sizeof(MeshBuffer::Vertex));
+		for (auto const &d : members) {
+			Mesh const &member = *d->pipeline.mesh;
+			glm::mat4x3 object_to_world = d->object_to_world();
+			glm::mat4x3 position_to_world = object_to_world * glm::mat4(member.position_to_object);
+			glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(object_to_world)));
+			//mirroring transforms turn triangles inside out, so reverse their winding:
+			bool flip = (glm::determinant(glm::mat3(object_to_world)) < 0.0f);
+
+			for (uint32_t v = 0; v < member.count; ++v) {
+				uint32_t from = v;
+				if (flip && v % 3 != 0 && v / 3 * 3 + 2 < member.count) from = v / 3 * 3 + 3 - v % 3;
+				uint8_t const *source = member.vertices + from * stride;
+				glm::vec3 position, normal;
+				if (quantized) {
+					MeshBuffer::QuantizedVertex const &vertex = *reinterpret_cast< MeshBuffer::QuantizedVertex const * >(source);
+					position = glm::vec3(vertex.Position) / 65535.0f;
+					normal = MeshBuffer::decode_normal(vertex.Normal);
+				} else {
+					MeshBuffer::Vertex const &vertex = *reinterpret_cast< MeshBuffer::Vertex const * >(source);
+					position = vertex.Position;
+					normal = vertex.Normal;
+				}
+				sources.emplace_back(source);
+				positions.emplace_back(position_to_world * glm::vec4(position, 1.0f));
+				normals.emplace_back(glm::normalize(normal_to_world * normal));
+			}
+			if (member.bvh) {
+				bvh_positions.insert(bvh_positions.end(), positions.end() - member.count, positions.end() - member.count % 3);
 			}
 		}
 
-		//draw the object:
-		glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+		static_batches.emplace_back();
+		StaticBatch &batch = static_batches.back();
+		Mesh &mesh = batch.mesh;
+		mesh.type = GL_TRIANGLES;
+		mesh.count = GLuint(positions.size());
+		mesh.quantized = quantized;
+		for (glm::vec3 const &p : positions) {
+			mesh.min = glm::min(mesh.min, p);
+			mesh.max = glm::max(mesh.max, p);
+		}
+		mesh.center = 0.5f * (mesh.min + mesh.max);
+		mesh.radius = 0.5f * glm::length(mesh.max - mesh.min);
+		//(the batch's transform is the identity, so world-space positions are also its object-space positions)
+		if (!bvh_positions.empty()) {
+			batch.bvh = std::make_shared< MeshBVH >(bvh_positions);
+			mesh.bvh = batch.bvh.get();
+		}
 
-		//un-bind textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, 0);
+		//re-pack vertices (colors and texcoords are copied as-is) and append them to the pool the members came from:
+		// (the members share a vertex array, so the batch can use it too)
+		if (quantized) {
+			glm::vec3 size = mesh.max - mesh.min;
+			mesh.position_to_object = glm::mat4x3(
+				glm::vec3(size.x, 0.0f, 0.0f),
+				glm::vec3(0.0f, size.y, 0.0f),
+				glm::vec3(0.0f, 0.0f, size.z),
+				mesh.min
+			);
+			glm::vec3 inv_size = glm::vec3(
+				size.x > 0.0f ? 1.0f / size.x : 0.0f,
+				size.y > 0.0f ? 1.0f / size.y : 0.0f,
+				size.z > 0.0f ? 1.0f / size.z : 0.0f
+			);
+			std::vector< MeshBuffer::QuantizedVertex > data;
+			data.reserve(sources.size());
+			for (size_t v = 0; v < sources.size(); ++v) {
+				data.emplace_back(*reinterpret_cast< MeshBuffer::QuantizedVertex const * >(sources[v]));
+				glm::vec3 unorm = glm::clamp((positions[v] - mesh.min) * inv_size, glm::vec3(0.0f), glm::vec3(1.0f));
+				data.back().Position = glm::u16vec3(glm::round(unorm * 65535.0f));
+				data.back().Normal = MeshBuffer::encode_normal(normals[v]);
+			}
+			mesh.start = GeometryPool::shared("pnq0", sizeof(MeshBuffer::QuantizedVertex)).append(data.data(), GLuint(data.size()));
+		} else {
+			std::vector< MeshBuffer::Vertex > data;
+			data.reserve(sources.size());
+			for (size_t v = 0; v < sources.size(); ++v) {
+				data.emplace_back(*reinterpret_cast< MeshBuffer::Vertex const * >(sources[v]));
+				data.back().Position = positions[v];
+				data.back().Normal = normals[v];
 			}
+			mesh.start = GeometryPool::shared("pnct", sizeof(MeshBuffer::Vertex)).append(data.data(), GLuint(data.size()));
 		}
-		glActiveTexture(GL_TEXTURE0);
 
-	}
+		batch.transform = &transforms.emplace_back();
+		batch.transform->name = intern("batch:" + std::to_string(static_batches.size() - 1));
 
-	glUseProgram(0);
-	glBindVertexArray(0);
+		Drawable &drawable = drawables.emplace_back(batch.transform);
+		drawable.pipeline = members[0]->pipeline;
+		drawable.pipeline.start = mesh.start;
+		drawable.pipeline.count = mesh.count;
+		drawable.pipeline.position_to_object = mesh.position_to_object;
+		drawable.pipeline.mesh = &mesh;
+		drawable.dynamic = false;
 
-	GL_ERRORS();
+		for (auto const &d : members) {
+			batch.members.emplace_back(d->transform);
+			drawables.erase(d);
+		}
+		made += 1;
+	}
+
+	//drawables changed, so bounds trees and GPU culling slots are stale (and batches added transforms):
+	if (made) {
+		bounds_built = false;
+		index_names();
+		if (gpu_culling) gpu_culling->invalidate();
+	}
+	return made;
 }
 
+void Scene::load(std::string const &filename,
+	std::function< void(Scene &, Transform *, std::string_view) > const &on_drawable) {
+	if (!on_drawable) {
+		load(filename, std::function< void(Scene &, std::vector< DrawableRequest > const &, std::vector< Drawable * > *) >());
+		return;
+	}
+	load(filename, [&on_drawable](Scene &scene, std::vector< DrawableRequest > const &requests, std::vector< Drawable * > *made) {
+		for (uint32_t i = 0; i < requests.size(); ++i) {
+			size_t before = scene.drawables.size();
+			on_drawable(scene, requests[i].transform, requests[i].mesh_name);
+			if (scene.drawables.size() > before) (*made)[i] = &scene.drawables.back();
+		}
+	});
+}
 
 void Scene::load(std::string const &filename,
-	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
+	std::function< void(Scene &, std::vector< DrawableRequest > const &, std::vector< Drawable * > *made) > const &on_drawables) {
 
 	std::unique_ptr< std::istream > file_ptr = asset_stream(filename);
 	auto &file = *file_ptr;
 
-	std::vector< char > names;
-	read_chunk(file, "str0", &names);
+	//(transform names point into the string table, so it is kept by this scene -- and by any prefab scenes made below)
+	std::shared_ptr< std::vector< char > > name_table = std::make_shared< std::vector< char > >();
+	read_chunk(file, "str0", name_table.get());
+	std::vector< char > const &names = *name_table;
+	name_tables.emplace_back(name_table);
 
 	struct HierarchyEntry {
 		uint32_t parent;
@@ -218,71 +856,227 @@ void Scene::load(std::string const &filename,
 	std::vector< LightEntry > loaded_lights;
 	read_chunk(file, "lmp0", &loaded_lights);
 
+	//prefabs (instanced collections) are ranges of hierarchy entries stored once, and instances place them under other transforms:
+	struct PrefabEntry {
+		uint32_t name_begin;
+		uint32_t name_end;
+		uint32_t xfh_begin, xfh_end; //hierarchy entries of the prefab (entries without parents are its roots)
+	};
+	static_assert(sizeof(PrefabEntry) == 4 + 4 + 4 + 4, "PrefabEntry is packed.");
+	std::vector< PrefabEntry > loaded_prefabs;
+
+	struct InstanceEntry {
+		uint32_t transform; //the instance's roots are children of this transform
+		uint32_t prefab;
+	};
+	static_assert(sizeof(InstanceEntry) == 4 + 4, "InstanceEntry is packed.");
+	std::vector< InstanceEntry > loaded_instances;
 
-	//--------------------------------
-	//Now that file is loaded, create transforms for hierarchy entries:
+	if (peek_chunk_magic(file) == "pfb0") {
+		read_chunk(file, "pfb0", &loaded_prefabs);
+		read_chunk(file, "ins0", &loaded_instances);
+	}
 
-	std::vector< Transform * > hierarchy_transforms;
-	hierarchy_transforms.reserve(hierarchy.size());
+	//(optional) world placement, baked by the exporter -- one entry per hierarchy entry, and one box per mesh entry:
+	// (for entries in prefabs, these are relative to the prefab's roots, so are only used for flags)
+	struct WorldEntry {
+		glm::mat4x3 local_to_world;
+		uint32_t flags;
+	};
+	static_assert(sizeof(WorldEntry) == 4*12 + 4, "WorldEntry is packed.");
+	enum : uint32_t {
+		WorldStatic = 1, //transform never moves (nor do its children)
+		WorldOccluder = 2, //transform's meshes are occluders
+	};
+	std::vector< WorldEntry > worlds;
 
-	for (auto const &h : hierarchy) {
-		transforms.emplace_back();
-		Transform *t = &transforms.back();
-		if (h.parent != -1U) {
-			if (h.parent >= hierarchy_transforms.size()) {
-				throw std::runtime_error("scene file '" + filename + "' did not contain transforms in topological-sort order.");
-			}
-			t->parent = hierarchy_transforms[h.parent];
-		}
+	struct MeshBoundsEntry {
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+	static_assert(sizeof(MeshBoundsEntry) == 4*3 + 4*3, "MeshBoundsEntry is packed.");
+	std::vector< MeshBoundsEntry > mesh_bounds;
 
-		if (h.name_begin <= h.name_end && h.name_end <= names.size()) {
-			t->name = std::string(names.begin() + h.name_begin, names.begin() + h.name_end);
-		} else {
-				throw std::runtime_error("scene file '" + filename + "' contains hierarchy entry with invalid name indices");
-		}
+	if (peek_chunk_magic(file) == "xfw0") {
+		read_chunk(file, "xfw0", &worlds);
+		read_chunk(file, "mbw0", &mesh_bounds);
+	}
 
-		t->position = h.position;
-		t->rotation = h.rotation;
-		t->scale = h.scale;
 
-		hierarchy_transforms.emplace_back(t);
+	//--------------------------------
+	//Check references between entries:
+
+	for (uint32_t i = 0; i < hierarchy.size(); ++i) {
+		HierarchyEntry const &h = hierarchy[i];
+		if (h.parent != -1U && h.parent >= i) {
+			throw std::runtime_error("scene file '" + filename + "' did not contain transforms in topological-sort order.");
+		}
+		if (!(h.name_begin <= h.name_end && h.name_end <= names.size())) {
+			throw std::runtime_error("scene file '" + filename + "' contains hierarchy entry with invalid name indices");
+		}
 	}
-	assert(hierarchy_transforms.size() == hierarchy.size());
 
 	for (auto const &m : meshes) {
-		if (m.transform >= hierarchy_transforms.size()) {
+		if (m.transform >= hierarchy.size()) {
 			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid transform index (" + std::to_string(m.transform) + ")");
 		}
 		if (!(m.name_begin <= m.name_end && m.name_end <= names.size())) {
 			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid name indices");
 		}
-		std::string name = std::string(names.begin() + m.name_begin, names.begin() + m.name_end);
+	}
+	for (auto const &c : loaded_cameras) {
+		if (c.transform >= hierarchy.size()) {
+			throw std::runtime_error("scene file '" + filename + "' contains camera entry with invalid transform index (" + std::to_string(c.transform) + ")");
+		}
+	}
+	for (auto const &l : loaded_lights) {
+		if (l.transform >= hierarchy.size()) {
+			throw std::runtime_error("scene file '" + filename + "' contains lamp entry with invalid transform index (" + std::to_string(l.transform) + ")");
+		}
+	}
 
-		if (on_drawable) {
-			on_drawable(*this, hierarchy_transforms[m.transform], name);
+	if (!worlds.empty() || !mesh_bounds.empty()) {
+		if (worlds.size() != hierarchy.size()) {
+			throw std::runtime_error("scene file '" + filename + "' has world transforms for " + std::to_string(worlds.size()) + " of " + std::to_string(hierarchy.size()) + " hierarchy entries");
 		}
+		if (mesh_bounds.size() != meshes.size()) {
+			throw std::runtime_error("scene file '" + filename + "' has world bounds for " + std::to_string(mesh_bounds.size()) + " of " + std::to_string(meshes.size()) + " mesh entries");
+		}
+	}
 
+	//which prefab (if any) each hierarchy entry belongs to:
+	std::vector< uint32_t > owner(hierarchy.size(), -1U);
+	for (uint32_t p = 0; p < loaded_prefabs.size(); ++p) {
+		PrefabEntry const &prefab = loaded_prefabs[p];
+		if (!(prefab.name_begin <= prefab.name_end && prefab.name_end <= names.size())) {
+			throw std::runtime_error("scene file '" + filename + "' contains prefab entry with invalid name indices");
+		}
+		if (!(prefab.xfh_begin <= prefab.xfh_end && prefab.xfh_end <= hierarchy.size())) {
+			throw std::runtime_error("scene file '" + filename + "' contains prefab entry with invalid hierarchy range");
+		}
+		for (uint32_t i = prefab.xfh_begin; i < prefab.xfh_end; ++i) {
+			if (owner[i] != -1U) throw std::runtime_error("scene file '" + filename + "' contains overlapping prefabs");
+			owner[i] = p;
+		}
+	}
+	for (uint32_t i = 0; i < hierarchy.size(); ++i) {
+		if (hierarchy[i].parent != -1U && owner[hierarchy[i].parent] != owner[i]) {
+			throw std::runtime_error("scene file '" + filename + "' contains transform with parent in a different prefab");
+		}
 	}
 
-	for (auto const &c : loaded_cameras) {
-		if (c.transform >= hierarchy_transforms.size()) {
-			throw std::runtime_error("scene file '" + filename + "' contains camera entry with invalid transform index (" + std::to_string(c.transform) + ")");
+	//what each prefab contains, beyond its hierarchy entries (by index of entry):
+	struct Contents {
+		std::vector< uint32_t > meshes, cameras, lights, instances;
+	};
+	std::vector< Contents > prefab_contents(loaded_prefabs.size());
+	for (uint32_t i = 0; i < loaded_instances.size(); ++i) {
+		InstanceEntry const &instance = loaded_instances[i];
+		if (instance.transform >= hierarchy.size()) {
+			throw std::runtime_error("scene file '" + filename + "' contains instance entry with invalid transform index (" + std::to_string(instance.transform) + ")");
+		}
+		if (instance.prefab >= loaded_prefabs.size()) {
+			throw std::runtime_error("scene file '" + filename + "' contains instance entry with invalid prefab index (" + std::to_string(instance.prefab) + ")");
+		}
+		if (owner[instance.transform] != -1U) prefab_contents[owner[instance.transform]].instances.emplace_back(i);
+	}
+	for (uint32_t i = 0; i < meshes.size(); ++i) {
+		if (owner[meshes[i].transform] != -1U) prefab_contents[owner[meshes[i].transform]].meshes.emplace_back(i);
+	}
+	for (uint32_t i = 0; i < loaded_cameras.size(); ++i) {
+		if (owner[loaded_cameras[i].transform] != -1U) prefab_contents[owner[loaded_cameras[i].transform]].cameras.emplace_back(i);
+	}
+	for (uint32_t i = 0; i < loaded_lights.size(); ++i) {
+		if (owner[loaded_lights[i].transform] != -1U) prefab_contents[owner[loaded_lights[i].transform]].lights.emplace_back(i);
+	}
+
+
+	//--------------------------------
+	//Now that file is loaded, create transforms (and objects) for entries:
+
+	//(drawables before this point didn't come from this file)
+	// (they can't be told apart by position, since new drawables may re-use erased slots, so remember them)
+	std::vector< Drawable * > old_drawables;
+	old_drawables.reserve(drawables.size());
+	for (auto &d : drawables) {
+		old_drawables.emplace_back(&d);
+	}
+
+	//transform for hierarchy entry 'h' (without its parent):
+	auto add_transform = [&](Scene &target, HierarchyEntry const &h) {
+		target.transforms.emplace_back();
+		Transform *t = &target.transforms.back();
+		t->name = std::string_view(names.data() + h.name_begin, h.name_end - h.name_begin);
+		t->position = h.position;
+		t->rotation = h.rotation;
+		t->scale = h.scale;
+		return t;
+	};
+	//transforms named or flagged as static (or under one that is) never move:
+	auto file_static = [&](uint32_t i) {
+		if (!worlds.empty() && (worlds[i].flags & WorldStatic)) return true;
+		HierarchyEntry const &h = hierarchy[i];
+		std::string_view name(names.data() + h.name_begin, h.name_end - h.name_begin);
+		return name.substr(0, StaticPrefix.size()) == StaticPrefix;
+	};
+	//transforms named or flagged as occluders have meshes that hide what is behind them:
+	auto file_occluder = [&](uint32_t i) {
+		if (!worlds.empty() && (worlds[i].flags & WorldOccluder)) return true;
+		HierarchyEntry const &h = hierarchy[i];
+		std::string_view name(names.data() + h.name_begin, h.name_end - h.name_begin);
+		return name.substr(0, OccluderPrefix.size()) == OccluderPrefix;
+	};
+
+	//drawables for mesh entries, made with one call of on_drawables:
+	// ('own' entries are the scene's own meshes, whose baked world placement applies and whose index is their bit in
+	//  potentially visible sets; prefabs' meshes get neither)
+	struct PendingMesh {
+		uint32_t mesh;
+		Transform *transform;
+		bool is_static;
+		bool own;
+	};
+	auto add_meshes = [&](Scene &target, std::vector< PendingMesh > const &pending) {
+		if (!on_drawables || pending.empty()) return;
+		std::vector< DrawableRequest > requests;
+		requests.reserve(pending.size());
+		for (auto const &p : pending) {
+			MeshEntry const &m = meshes[p.mesh];
+			requests.emplace_back(DrawableRequest{p.transform, std::string_view(names.data() + m.name_begin, m.name_end - m.name_begin), file_occluder(m.transform)});
+		}
+
+		std::vector< Drawable * > made(requests.size(), nullptr);
+		on_drawables(target, requests, &made);
+
+		for (uint32_t r = 0; r < pending.size(); ++r) {
+			Drawable *d = made[r];
+			if (!d) continue;
+			PendingMesh const &p = pending[r];
+			d->pvs_bit = (p.own ? p.mesh : -1U);
+			if (p.is_static) d->dynamic = false;
+			if (requests[r].occluder) d->occluder = true;
+			if (p.own && !worlds.empty()) {
+				d->baked = true;
+				d->baked_to_world = worlds[meshes[p.mesh].transform].local_to_world;
+				d->baked_min = mesh_bounds[p.mesh].min;
+				d->baked_max = mesh_bounds[p.mesh].max;
+			}
 		}
+	};
+
+	auto add_camera = [&](Scene &target, CameraEntry const &c, Transform *transform) {
 		if (std::string(c.type, 4) != "pers") {
 			std::cout << "Ignoring non-perspective camera (" + std::string(c.type, 4) + ") stored in file." << std::endl;
-			continue;
+			return;
 		}
-		cameras.emplace_back(hierarchy_transforms[c.transform]);
-		Camera *camera = &cameras.back();
+		target.cameras.emplace_back(transform);
+		Camera *camera = &target.cameras.back();
 		camera->fovy = c.data / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
 		camera->near = c.clip_near;
 		//N.b. far plane is ignored because cameras use infinite perspective matrices.
-	}
+	};
 
-	for (auto const &l : loaded_lights) {
-		if (l.transform >= hierarchy_transforms.size()) {
-			throw std::runtime_error("scene file '" + filename + "' contains lamp entry with invalid transform index (" + std::to_string(l.transform) + ")");
-		}
+	auto add_light = [&](Scene &target, LightEntry const &l, Transform *transform) {
 		if (l.type == 'p') {
 			//good
 		} else if (l.type == 'h') {
@@ -293,18 +1087,156 @@ void Scene::load(std::string const &filename,
 			//sure
 		} else {
 			std::cout << "Ignoring unrecognized lamp type (" + std::string(&l.type, 1) + ") stored in file." << std::endl;
-			continue;
+			return;
 		}
-		lights.emplace_back(hierarchy_transforms[l.transform]);
-		Light *light = &lights.back();
+		target.lights.emplace_back(transform);
+		Light *light = &target.lights.back();
 		light->type = static_cast<Light::Type>(l.type);
 		light->energy = glm::vec3(l.color) / 255.0f * l.energy;
 		light->spot_fov = l.fov / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
+	};
+
+	//add a copy of prefab 'p' (and any prefabs it instances) to 'target', with its roots under 'parent':
+	// (prefab drawables don't have potentially visible set bits, since the sets are for a file's own mesh entries)
+	std::vector< bool > placing(loaded_prefabs.size(), false);
+	std::function< void(Scene &, uint32_t, Transform *, bool) > place = [&](Scene &target, uint32_t p, Transform *parent, bool parent_static) {
+		if (placing[p]) throw std::runtime_error("scene file '" + filename + "' contains a prefab that instances itself");
+		placing[p] = true;
+
+		PrefabEntry const &prefab = loaded_prefabs[p];
+		std::vector< Transform * > local(prefab.xfh_end - prefab.xfh_begin);
+		std::vector< bool > local_static(local.size());
+		for (uint32_t i = prefab.xfh_begin; i < prefab.xfh_end; ++i) {
+			HierarchyEntry const &h = hierarchy[i];
+			Transform *t = add_transform(target, h);
+			t->parent = (h.parent == -1U ? parent : local[h.parent - prefab.xfh_begin]);
+			local[i - prefab.xfh_begin] = t;
+			local_static[i - prefab.xfh_begin] = file_static(i) || (h.parent == -1U ? parent_static : local_static[h.parent - prefab.xfh_begin]);
+		}
+
+		Contents const &contents = prefab_contents[p];
+		std::vector< PendingMesh > pending;
+		pending.reserve(contents.meshes.size());
+		for (uint32_t m : contents.meshes) {
+			uint32_t i = meshes[m].transform - prefab.xfh_begin;
+			pending.emplace_back(PendingMesh{m, local[i], local_static[i], false});
+		}
+		add_meshes(target, pending);
+		for (uint32_t c : contents.cameras) {
+			add_camera(target, loaded_cameras[c], local[loaded_cameras[c].transform - prefab.xfh_begin]);
+		}
+		for (uint32_t l : contents.lights) {
+			add_light(target, loaded_lights[l], local[loaded_lights[l].transform - prefab.xfh_begin]);
+		}
+		for (uint32_t n : contents.instances) {
+			uint32_t i = loaded_instances[n].transform - prefab.xfh_begin;
+			place(target, loaded_instances[n].prefab, local[i], local_static[i]);
+		}
+
+		placing[p] = false;
+	};
+
+	//the scene's own entries (those not in prefabs):
+	// transforms are made up front (in entry order), then filled in on several threads -- each entry's slot is known,
+	// so parents can be pointed at before they are filled:
+	std::vector< uint32_t > own_entries;
+	own_entries.reserve(hierarchy.size());
+	for (uint32_t i = 0; i < hierarchy.size(); ++i) {
+		if (owner[i] == -1U) own_entries.emplace_back(i);
+	}
+	std::vector< uint32_t > own_slots;
+	transforms.emplace_back_n(uint32_t(own_entries.size()), &own_slots);
+	std::vector< uint32_t > entry_slot(hierarchy.size(), -1U);
+	for (uint32_t e = 0; e < own_entries.size(); ++e) {
+		entry_slot[own_entries[e]] = own_slots[e];
+	}
+
+	std::vector< Transform * > hierarchy_transforms(hierarchy.size(), nullptr);
+	parallel_for(uint32_t(own_entries.size()), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t e = begin; e < end; ++e) {
+			uint32_t i = own_entries[e];
+			HierarchyEntry const &h = hierarchy[i];
+			Transform *t = transforms.at(entry_slot[i]);
+			t->name = std::string_view(names.data() + h.name_begin, h.name_end - h.name_begin);
+			t->position = h.position;
+			t->rotation = h.rotation;
+			t->scale = h.scale;
+			t->parent = (h.parent == -1U ? nullptr : transforms.at(entry_slot[h.parent]));
+			hierarchy_transforms[i] = t;
+		}
+	});
+
+	std::vector< bool > hierarchy_static(hierarchy.size(), false);
+	for (uint32_t i : own_entries) {
+		HierarchyEntry const &h = hierarchy[i];
+		hierarchy_static[i] = file_static(i) || (h.parent != -1U && hierarchy_static[h.parent]);
+	}
+
+	{ //the scene's own meshes, in one batch:
+		std::vector< PendingMesh > pending;
+		pending.reserve(meshes.size());
+		for (uint32_t m = 0; m < meshes.size(); ++m) {
+			uint32_t i = meshes[m].transform;
+			if (owner[i] != -1U) continue;
+			pending.emplace_back(PendingMesh{m, hierarchy_transforms[i], hierarchy_static[i], true});
+		}
+		drawables.reserve_back(uint32_t(pending.size()));
+		add_meshes(*this, pending);
 	}
+	for (auto const &c : loaded_cameras) {
+		if (owner[c.transform] != -1U) continue;
+		add_camera(*this, c, hierarchy_transforms[c.transform]);
+	}
+	for (auto const &l : loaded_lights) {
+		if (owner[l.transform] != -1U) continue;
+		add_light(*this, l, hierarchy_transforms[l.transform]);
+	}
+
+	//instances -- either copies of prefabs, or references to prefabs loaded once:
+	std::vector< uint32_t > prefab_index(loaded_prefabs.size(), -1U); //(in 'prefabs')
+	for (auto const &instance : loaded_instances) {
+		if (owner[instance.transform] != -1U) continue;
+		Transform *transform = hierarchy_transforms[instance.transform];
+		if (expand_prefabs) {
+			place(*this, instance.prefab, transform, hierarchy_static[instance.transform]);
+			continue;
+		}
+		uint32_t &index = prefab_index[instance.prefab];
+		if (index == -1U) {
+			PrefabEntry const &entry = loaded_prefabs[instance.prefab];
+			std::shared_ptr< Scene > scene = std::make_shared< Scene >();
+			scene->name_tables.emplace_back(name_table);
+			place(*scene, instance.prefab, nullptr, false);
+			scene->index_names();
+			index = uint32_t(prefabs.size());
+			prefabs.emplace_back();
+			prefabs.back().name = std::string(names.begin() + entry.name_begin, names.begin() + entry.name_end);
+			prefabs.back().scene = scene;
+			prefabs.back().prefab = std::make_shared< ScenePrefab >(*scene);
+		}
+		instances.emplace_back();
+		instances.back().transform = transform;
+		instances.back().instance = std::make_shared< SceneInstance >(prefabs[index].prefab);
+	}
+	update_instances();
 
-	//load any extra that a subclass wants:
+	//load any extra that a subclass wants (and potentially visible sets, via Scene::load_extra):
+	pvs = PVS();
 	load_extra(file, names, hierarchy_transforms);
 
+	if (!pvs.empty()) {
+		//(sets baked for a different list of mesh entries would skip the wrong drawables)
+		if (pvs.mesh_count != meshes.size()) {
+			throw std::runtime_error("scene file '" + filename + "' has potentially visible sets for " + std::to_string(pvs.mesh_count) + " mesh entries, but contains " + std::to_string(meshes.size()));
+		}
+		//earlier drawables aren't described by these sets:
+		for (Drawable *d : old_drawables) {
+			d->pvs_bit = -1U;
+		}
+	}
+
+	index_names();
+
 	if (file.peek() != EOF) {
 		std::cerr << "WARNING: trailing data in scene file '" << filename << "'" << std::endl;
 	}
@@ -315,10 +1247,109 @@ void Scene::load(std::string const &filename,
 
 //-------------------------
 
-Scene::Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
+std::string_view Scene::intern(std::string_view name) {
+	//(each interned name gets its own table, since tables can't grow -- that would move names already handed out)
+	auto table = std::make_shared< std::vector< char > >(name.begin(), name.end());
+	name_tables.emplace_back(table);
+	return std::string_view(table->data(), table->size());
+}
+
+void Scene::index_names() {
+	sorted_names.clear();
+	sorted_names.reserve(transforms.size());
+	for (auto const &t : transforms) {
+		sorted_names.emplace_back(NamedTransform{t.name, transforms.handle(&t)});
+	}
+	//(transforms are visited in index order, so a stable sort keeps lower indices first among equal names)
+	std::stable_sort(sorted_names.begin(), sorted_names.end(), [](NamedTransform const &a, NamedTransform const &b) {
+		return a.name < b.name;
+	});
+
+	name_to_sorted.clear();
+	name_to_sorted.reserve(sorted_names.size());
+	for (uint32_t i = 0; i < sorted_names.size(); ++i) {
+		name_to_sorted.emplace(sorted_names[i].name, i); //(keeps the first entry of each name)
+	}
+
+	names_indexed = true;
+	indexed_revision = transforms.revision();
+}
+
+std::pair< uint32_t, uint32_t > Scene::name_range(std::string_view prefix, bool exact) const {
+	uint32_t begin;
+	if (exact) {
+		auto f = name_to_sorted.find(prefix);
+		if (f == name_to_sorted.end()) return std::make_pair(0, 0);
+		begin = f->second;
+	} else {
+		begin = uint32_t(std::lower_bound(sorted_names.begin(), sorted_names.end(), prefix, [](NamedTransform const &a, std::string_view b) {
+			return a.name < b;
+		}) - sorted_names.begin());
+	}
+	uint32_t end = begin;
+	while (end < sorted_names.size() && (exact ? sorted_names[end].name == prefix : sorted_names[end].name.substr(0, prefix.size()) == prefix)) ++end;
+	return std::make_pair(begin, end);
+}
+
+Scene::Transform const *Scene::find(std::string_view name) const {
+	if (!names_current()) {
+		for (auto const &t : transforms) {
+			if (t.name == name) return &t;
+		}
+		return nullptr;
+	}
+	auto range = name_range(name, true);
+	if (range.first == range.second) return nullptr;
+	return transforms.get(sorted_names[range.first].handle);
+}
+
+Scene::Transform *Scene::find(std::string_view name) {
+	return const_cast< Transform * >(static_cast< Scene const & >(*this).find(name));
+}
+
+void Scene::find_all(std::string_view name, std::vector< Transform * > *out) {
+	assert(out);
+	if (!names_current()) {
+		for (auto &t : transforms) {
+			if (t.name == name) out->emplace_back(&t);
+		}
+		return;
+	}
+	auto range = name_range(name, true);
+	for (uint32_t i = range.first; i < range.second; ++i) {
+		out->emplace_back(transforms.get(sorted_names[i].handle));
+	}
+}
+
+void Scene::find_prefix(std::string_view prefix, std::vector< Transform * > *out) {
+	assert(out);
+	if (!names_current()) {
+		for (auto &t : transforms) {
+			if (t.name.substr(0, prefix.size()) == prefix) out->emplace_back(&t);
+		}
+		return;
+	}
+	auto range = name_range(prefix, false);
+	for (uint32_t i = range.first; i < range.second; ++i) {
+		out->emplace_back(transforms.get(sorted_names[i].handle));
+	}
+}
+
+void Scene::update_instances() {
+	for (auto &instance : instances) {
+		instance.instance->instance_to_world = instance.transform->make_local_to_world();
+		instance.instance->update_world();
+	}
+}
+
+Scene::Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string_view) > const &on_drawable) {
 	load(filename, on_drawable);
 }
 
+Scene::Scene(std::string const &filename, std::function< void(Scene &, std::vector< DrawableRequest > const &, std::vector< Drawable * > *) > const &on_drawables) {
+	load(filename, on_drawables);
+}
+
 Scene::Scene(Scene const &other) {
 	set(other);
 }
@@ -328,51 +1359,157 @@ Scene &Scene::operator=(Scene const &other) {
 	return *this;
 }
 
-void Scene::set(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map_) {
+void Scene::load_extra(std::istream &from, std::vector< char > const &str0, std::vector< Transform * > const &xfh0) {
+	if (peek_chunk_magic(from) == "pvg0") load_pvs(from);
 
-	std::unordered_map< Transform const *, Transform * > t2t_temp;
-	std::unordered_map< Transform const *, Transform * > &transform_to_transform = *(transform_map_ ? transform_map_ : &t2t_temp);
+	if (peek_chunk_magic(from) == "anc0") {
+		std::vector< uint32_t > entry_slots;
+		entry_slots.reserve(xfh0.size());
+		for (Transform *t : xfh0) {
+			entry_slots.emplace_back(t ? transforms.index_of(t) : -1U);
+		}
+		AnimationClip::read(from, str0, entry_slots, &clips);
+	}
+}
 
-	transform_to_transform.clear();
+void Scene::load_pvs(std::istream &from) {
+	struct GridEntry {
+		glm::vec3 min;
+		float cell_size;
+		glm::uvec3 size;
+		uint32_t mesh_count; //mesh entries the sets have bits for
+	};
+	static_assert(sizeof(GridEntry) == 4*3 + 4 + 4*3 + 4, "GridEntry is packed.");
+	std::vector< GridEntry > grid;
+	read_chunk(from, "pvg0", &grid);
+	if (grid.size() != 1) throw std::runtime_error("expected one potentially visible set grid, found " + std::to_string(grid.size()));
+
+	PVS loaded;
+	loaded.min = grid[0].min;
+	loaded.cell_size = grid[0].cell_size;
+	loaded.size = grid[0].size;
+	loaded.mesh_count = grid[0].mesh_count;
+	loaded.words = (loaded.mesh_count + 31) / 32;
+	read_chunk(from, "pvc0", &loaded.cells);
+	read_chunk(from, "pvs0", &loaded.sets);
+
+	if (!(loaded.cell_size > 0.0f)) throw std::runtime_error("potentially visible set grid has non-positive cell size");
+	if (uint64_t(loaded.size.x) * loaded.size.y * loaded.size.z != loaded.cells.size()) {
+		throw std::runtime_error("potentially visible set grid has " + std::to_string(loaded.cells.size()) + " cells, not " + std::to_string(uint64_t(loaded.size.x) * loaded.size.y * loaded.size.z));
+	}
+	if (loaded.words == 0 ? !loaded.sets.empty() : loaded.sets.size() % loaded.words != 0) {
+		throw std::runtime_error("potentially visible sets are not a whole number of sets");
+	}
+	uint32_t set_count = (loaded.words == 0 ? 0 : uint32_t(loaded.sets.size() / loaded.words));
+	for (uint32_t cell : loaded.cells) {
+		if (cell != -1U && cell >= set_count) throw std::runtime_error("potentially visible set cell refers to out-of-range set");
+	}
+	//(with no meshes there's nothing to skip, so no need to keep the sets)
+	if (loaded.words != 0) pvs = std::move(loaded);
+}
 
-	//null transform maps to itself:
-	transform_to_transform.insert(std::make_pair(nullptr, nullptr));
+uint32_t const *Scene::PVS::lookup(glm::vec3 const &position) const {
+	glm::vec3 at = (position - min) / cell_size;
+	if (!(at.x >= 0.0f && at.y >= 0.0f && at.z >= 0.0f)) return nullptr;
+	if (!(at.x < float(size.x) && at.y < float(size.y) && at.z < float(size.z))) return nullptr;
+	glm::uvec3 cell = glm::min(glm::uvec3(at), size - glm::uvec3(1));
+	uint32_t set = cells[(cell.z * size.y + cell.y) * size.x + cell.x];
+	if (set == -1U) return nullptr;
+	return sets.data() + size_t(set) * words;
+}
 
-	//Copy transforms and store mapping:
-	transforms.clear();
-	for (auto const &t : other.transforms) {
-		transforms.emplace_back();
-		transforms.back().name = t.name;
-		transforms.back().position = t.position;
-		transforms.back().rotation = t.rotation;
-		transforms.back().scale = t.scale;
-		transforms.back().parent = t.parent; //will update later
+void Scene::set(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map_) {
 
-		//store mapping between transforms old and new:
-		auto ret = transform_to_transform.insert(std::make_pair(&t, &transforms.back()));
-		assert(ret.second);
-	}
+	//names point into other's string tables, which are never changed, so share them:
+	name_tables = other.name_tables;
+
+	//Copy transforms slot-for-slot, so each copy has the same index (in transforms) as its original (in other.transforms):
+	transforms.assign(other.transforms, [](Transform &t, Transform const &o) {
+		t.name = o.name;
+		t.position = o.position;
+		t.rotation = o.rotation;
+		t.scale = o.scale;
+		t.parent = o.parent; //will update later
+	});
+
+	//..which makes mapping transforms of other to transforms of this a lookup by index:
+	auto transform_to_transform = [&](Transform const *t) -> Transform * {
+		if (t == nullptr) return nullptr;
+		return transforms.at(other.transforms.index_of(t));
+	};
 
 	//update transform parents:
 	for (auto &t : transforms) {
-		t.parent = transform_to_transform.at(t.parent);
+		t.parent = transform_to_transform(t.parent);
+	}
+
+	//(handles include generations, which differ between pools, so the name index is rebuilt rather than copied)
+	index_names();
+
+	if (transform_map_) {
+		transform_map_->clear();
+		transform_map_->insert(std::make_pair(nullptr, nullptr));
+		for (auto const &t : other.transforms) {
+			transform_map_->insert(std::make_pair(&t, transform_to_transform(&t)));
+		}
+	}
+
+	//copy other's static batches, updating transform pointers:
+	static_batches = other.static_batches;
+	std::unordered_map< Mesh const *, Mesh const * > batch_mesh_to_mesh;
+	auto ob = other.static_batches.begin();
+	for (auto &b : static_batches) {
+		b.transform = transform_to_transform(b.transform);
+		for (auto &m : b.members) {
+			m = transform_to_transform(m);
+		}
+		batch_mesh_to_mesh.emplace(&ob->mesh, &b.mesh);
+		++ob;
 	}
 
-	//copy other's drawables, updating transform pointers:
+	//copy other's drawables, updating transform pointers (and pointers to batch meshes):
 	drawables = other.drawables;
 	for (auto &d : drawables) {
-		d.transform = transform_to_transform.at(d.transform);
+		d.transform = transform_to_transform(d.transform);
+		d.bounds_proxy = -1U;
+		auto f = batch_mesh_to_mesh.find(d.pipeline.mesh);
+		if (f != batch_mesh_to_mesh.end()) d.pipeline.mesh = f->second;
+	}
+
+	//bounds trees refer to other's drawables, so will need to be rebuilt:
+	static_bounds.clear();
+	dynamic_bounds.clear();
+	dynamic_drawables.clear();
+	unbounded_drawables.clear();
+	bounds_built = false;
+
+	//prefabs are never changed after loading, so can be shared; instances are copied:
+	expand_prefabs = other.expand_prefabs;
+	prefabs = other.prefabs;
+	instances.clear();
+	for (auto const &i : other.instances) {
+		instances.emplace_back();
+		instances.back().transform = transform_to_transform(i.transform);
+		instances.back().instance = std::make_shared< SceneInstance >(*i.instance);
 	}
 
+	//potentially visible sets refer to drawables by Drawable::pvs_bit, so copy as-is:
+	pvs = other.pvs;
+	use_pvs = other.use_pvs;
+
+	//clips refer to transforms by slot, and slots are kept, so can be shared:
+	clips = other.clips;
+
 	//copy other's cameras, updating transform pointers:
+	// (cameras and lights are trivially copyable, so these copies are a memcpy per Pool block)
 	cameras = other.cameras;
 	for (auto &c : cameras) {
-		c.transform = transform_to_transform.at(c.transform);
+		c.transform = transform_to_transform(c.transform);
 	}
 
 	//copy other's lights, updating transform pointers:
 	lights = other.lights;
 	for (auto &l : lights) {
-		l.transform = transform_to_transform.at(l.transform);
+		l.transform = transform_to_transform(l.transform);
 	}
 }
@@ -11,21 +11,33 @@
  */
 
 #include "GL.hpp"
+#include "Mesh.hpp"
+#include "AABBTree.hpp"
+#include "OcclusionBuffer.hpp"
+#include "Pool.hpp"
+
+struct AnimationClip;
+struct GPUCulling;
+struct ScenePrefab;
+struct SceneInstance;
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <limits>
 #include <list>
 #include <memory>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
 struct Scene {
 	struct Transform {
-		//Transform names are useful for debugging and looking up locations in a loaded scene:
-		std::string name;
+		//Transform names are useful for debugging and looking up locations in a loaded scene (see find()):
+		// (names point into strings kept by the scene -- load()'s string table, or intern()'d -- so must not outlive it)
+		std::string_view name;
 
 		//The core function of a transform is to store a transformation in the world:
 		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -65,6 +77,13 @@ struct Scene {
 			GLuint start = 0; //first vertex to draw; passed to glDrawArrays
 			GLuint count = 0; //number of vertices to draw; passed to glDrawArrays
 
+			//maps stored vertex positions to object space (non-identity for quantized meshes; see Mesh::position_to_object):
+			glm::mat4x3 position_to_object = glm::mat4x3(1.0f);
+
+			//(optional) mesh being drawn; if set, draw() skips the drawable when the mesh's bounds are out of view,
+			// and -- for clustered meshes -- draws only the visible clusters (instead of start/count):
+			Mesh const *mesh = nullptr;
+
 			//uniforms:
 			GLuint OBJECT_TO_CLIP_mat4 = -1U; //uniform location for object to clip space matrix
 			GLuint OBJECT_TO_LIGHT_mat4x3 = -1U; //uniform location for object to light space (== world space) matrix
@@ -79,6 +98,34 @@ struct Scene {
 				GLenum target = GL_TEXTURE_2D;
 			} textures[TextureCount];
 		} pipeline;
+
+		//level of detail to draw (index into pipeline.mesh->lods; 0 is full detail), usually set by update_lods():
+		uint32_t lod = 0;
+
+		//might this drawable's transform (or its parents) move?
+		// non-dynamic drawables are kept in a bounds tree that update_bounds() never refits, so must stay put once it sees them
+		bool dynamic = true;
+		uint32_t bounds_proxy = -1U; //(used by update_bounds())
+
+		//should pipeline.mesh->occluder be drawn into Scene::occlusion, to hide drawables behind this one?
+		bool occluder = false;
+
+		//which bit of Scene::pvs's sets refers to this drawable (the index of its mesh entry in the scene file; set by load()):
+		uint32_t pvs_bit = -1U;
+
+		//world placement baked into the scene file (chunks 'xfw0' and 'mbw0'; set by load() for the file's own mesh entries),
+		// used instead of walking the transform hierarchy while the drawable is non-dynamic:
+		// (the bounds are of the mesh named in the file, so are only right if pipeline.mesh is that mesh)
+		bool baked = false;
+		glm::mat4x3 baked_to_world = glm::mat4x3(1.0f);
+		glm::vec3 baked_min = glm::vec3(0.0f);
+		glm::vec3 baked_max = glm::vec3(0.0f);
+
+		//transform->make_local_to_world(), or the baked matrix if there is one and the drawable is non-dynamic:
+		glm::mat4x3 object_to_world() const { return (baked && !dynamic ? baked_to_world : transform->make_local_to_world()); }
+
+		//world-space bounding box of pipeline.mesh (returns false if there is no mesh or it is empty):
+		bool world_bounds(glm::vec3 *min, glm::vec3 *max) const;
 	};
 
 	struct Camera {
@@ -117,35 +164,254 @@ struct Scene {
 	};
 
 	//Scenes, of course, may have many of the above objects:
-	std::list< Transform > transforms;
-	std::list< Drawable > drawables;
-	std::list< Camera > cameras;
-	std::list< Light > lights;
+	// (kept in Pools -- see Pool.hpp -- so pointers to them stay valid as objects are added, and each has an index and a Handle)
+	Pool< Transform > transforms;
+	Pool< Drawable > drawables;
+	Pool< Camera > cameras;
+	Pool< Light > lights;
 
 	//The "draw" function provides a convenient way to pass all the things in a scene to OpenGL:
 	void draw(Camera const &camera) const;
 
 	//..sometimes, you want to draw with a custom projection matrix and/or light space:
+	// (clusters facing away from the eye are only culled if GL_CULL_FACE is enabled for GL_BACK faces with GL_CCW front faces)
 	void draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light = glm::mat4x3(1.0f)) const;
 
+	//frustum planes in the space that 'to_clip' takes to clip space (used by draw() and overlap_view()):
+	// (a point p is inside when dot(plane, vec4(p, 1)) >= 0 for all planes)
+	struct Frustum {
+		Frustum(glm::mat4 const &to_clip);
+		glm::vec4 planes[6];
+		float scales[6]; //length of each plane's normal, to compare against sphere radii
+
+		bool sphere_outside(glm::vec3 const &center, float radius) const;
+	};
+
+	//the parts of draw() that send one drawable to OpenGL (also used by SceneInstance::draw):
+	// bind_pipeline() binds the program, vertex array, and textures (program and vertex array only if not already 'bound'),
+	// and sets the uniforms for an object at 'object_to_world'; call unbind_textures() after drawing.
+	struct Bound {
+		GLuint program = 0;
+		GLuint vao = 0;
+	};
+	static void bind_pipeline(Drawable::Pipeline const &pipeline, glm::mat4x3 const &object_to_world, glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light, Bound *bound);
+	static void unbind_textures(Drawable::Pipeline const &pipeline);
+
+	//Level-of-detail selection for drawables whose pipeline.mesh has levels of detail:
+	struct LODView {
+		glm::vec3 eye = glm::vec3(0.0f); //world-space viewpoint
+		float scale = 1.0f; //size in pixels of a one-unit object at unit distance (see lod_scale())
+	};
+	//for a perspective view spanning [tan_down, tan_up] vertically (tan_down < 0) over 'height' pixels:
+	// (e.g., tan_up = -tan_down = tan(fovy / 2) for a Camera; tan(angleUp), tan(angleDown) for an XrFovf)
+	static float lod_scale(float tan_up, float tan_down, float height);
+	//set every drawable's 'lod' to the coarsest level whose error projects to at most 'max_pixel_error' pixels in all views:
+	// call once per frame with every view being drawn (e.g., both eyes) so that views agree on levels;
+	// levels only get coarser once their error falls below (1 - hysteresis) * max_pixel_error, to avoid popping back and forth.
+	void update_lods(std::vector< LODView > const &views, float max_pixel_error = 1.0f, float hysteresis = 0.25f);
+
+	//Queries against the triangles of drawables whose pipeline.mesh has a BVH (see MeshBuffer::BuildBVH):
+	// (full-detail triangles are used regardless of 'lod')
+	struct RayHit {
+		Drawable const *drawable = nullptr; //drawable that was hit
+		float t = std::numeric_limits< float >::infinity(); //ray parameter of hit
+		uint32_t triangle = -1U; //index of triangle hit (see MeshBVH::Hit)
+		glm::vec3 point = glm::vec3(0.0f); //world-space hit point
+		glm::vec3 normal = glm::vec3(0.0f); //world-space unit normal of triangle hit
+	};
+	//closest hit of world-space ray 'origin + t * direction' with t in [0, min(t_max, hit->t)]:
+	// (returns true and updates 'hit' only if a closer hit was found)
+	bool raycast(glm::vec3 const &origin, glm::vec3 const &direction, float t_max, RayHit *hit) const;
+
+	struct SphereContact {
+		Drawable const *drawable = nullptr; //drawable containing 'point'
+		float distance = std::numeric_limits< float >::infinity(); //world-space distance from center to 'point'
+		uint32_t triangle = -1U; //index of triangle containing 'point'
+		glm::vec3 point = glm::vec3(0.0f); //world-space closest point
+	};
+	//closest point on any drawable within world-space distance min(radius, contact->distance) of 'center':
+	// (returns true and updates 'contact' only if a closer point was found)
+	bool sphere_contact(glm::vec3 const &center, float radius, SphereContact *contact) const;
+
+	//(optional) if set, draw() rasterizes occluders (see Drawable::occluder) into this buffer
+	// and skips drawables whose bounds it hides; its 'tested' and 'rejected' counts are for the latest draw():
+	OcclusionBuffer *occlusion = nullptr;
+
+	//(optional) if set (and supported), draw() leaves culling of drawables with meshes to the GPU (see GPUCulling.hpp),
+	// skipping the bounds trees, potentially visible sets, 'occlusion', and cluster culling for them:
+	GPUCulling *gpu_culling = nullptr;
+
+	//Potentially visible sets, baked for static scenes by 'bake-pvs' and read from the scene file by load_extra():
+	// a grid of view cells, each with the set of drawables (by Drawable::pvs_bit) that can be seen from somewhere in the cell.
+	// if use_pvs is set, draw() skips non-dynamic drawables that aren't in the set of the cell containing the eye.
+	// (a scene only keeps the sets from the most recent load())
+	struct PVS {
+		glm::vec3 min = glm::vec3(0.0f); //corner of the grid
+		float cell_size = 1.0f;
+		glm::uvec3 size = glm::uvec3(0); //cells along each axis
+		uint32_t mesh_count = 0; //mesh entries (in the scene file) the sets have bits for
+		uint32_t words = 0; //uint32_t's per set
+		std::vector< uint32_t > cells; //set of each cell (x fastest, then y, then z), or -1U if anything might be visible from the cell
+		std::vector< uint32_t > sets; //bits of all sets, 'words' per set
+
+		bool empty() const { return cells.empty(); }
+		//bits of the set of the cell containing 'position' (or nullptr if anything might be visible from there):
+		uint32_t const *lookup(glm::vec3 const &position) const;
+	} pvs;
+	bool use_pvs = true;
+
+	//Animation clips exported with the scene (chunks 'anc0', 'ant0', 'ank0'), read by load_extra() -- see Animation.hpp:
+	// (clips refer to transforms by slot, so are shared with copies of the scene; each load() adds its file's clips)
+	std::vector< std::shared_ptr< AnimationClip const > > clips;
+
+	//World-space bounds of drawables (those with a pipeline.mesh) are kept in two trees -- static and dynamic --
+	// which draw(), raycast(), sphere_contact(), and the overlap queries below use once update_bounds() has been called.
+	// (until then, or if drawables have been added or removed since, they test every drawable instead)
+
+	//call after moving transforms (e.g., at the end of every update); only refits 'dynamic' drawables:
+	// (rebuilds both trees if drawables were added or removed, or if called for the first time)
+	void update_bounds();
+	//rebuild both trees from scratch (e.g., after changing drawables' meshes or 'dynamic' flags):
+	void build_bounds();
+	bool bounds_current() const { return bounds_built && bounded_revision == drawables.revision(); }
+
+	//append drawables whose world-space bounds overlap a box, sphere, ray, or view (given by its world-to-clip matrix) to 'out':
+	// (dynamic drawables' bounds are slightly enlarged in the tree, so near misses may be reported)
+	void overlap_box(glm::vec3 const &min, glm::vec3 const &max, std::vector< Drawable const * > *out) const;
+	void overlap_sphere(glm::vec3 const &center, float radius, std::vector< Drawable const * > *out) const;
+	void overlap_ray(glm::vec3 const &origin, glm::vec3 const &direction, float t_max, std::vector< Drawable const * > *out) const;
+	void overlap_view(glm::mat4 const &world_to_clip, std::vector< Drawable const * > *out) const;
+
+	//(internals used by the above:)
+	static constexpr float DynamicBoundsMargin = 0.1f; //world units dynamic bounds are enlarged by, so small moves don't change the tree
+	AABBTree static_bounds;
+	AABBTree dynamic_bounds = AABBTree(DynamicBoundsMargin);
+	std::vector< Drawable * > dynamic_drawables; //drawables in dynamic_bounds
+	std::vector< Drawable const * > unbounded_drawables; //drawables without bounds (always drawn)
+	uint64_t bounded_revision = 0; //drawables.revision() when trees were built
+	bool bounds_built = false;
+
+	//Static batching merges non-dynamic drawables that share a pipeline (program, vertex array, textures) and are near each other
+	// into one drawable per group, with their vertices pre-transformed to world space (appended to the same GeometryPool):
+	// - drawables qualify if their pipeline.mesh has Mesh::vertices (see MeshBuffer::KeepVertices), is drawn whole as GL_TRIANGLES,
+	//   and has no levels of detail; drawables that set_uniforms or are occluders are left alone
+	// - groups are split by a grid of 'cell_size' world units (by bounds center), so batches can still be culled
+	// - merged drawables are removed; their transforms are kept (see StaticBatch::members), but moving them no longer does anything
+	// - batches' bounding boxes are wider than their members', so re-quantized positions are coarser (about cell_size / 65535)
+	// - batches are never skipped by potentially visible sets (their pvs_bit is -1U)
+	// - batches get a BVH (see Mesh::bvh) of the triangles of the members whose meshes had one, so raycast() and sphere_contact() still find them
+	//needs a current OpenGL context; returns the number of batches made:
+	uint32_t batch_static(float cell_size = 16.0f);
+
+	struct StaticBatch {
+		Transform *transform = nullptr; //(identity; named "batch:<n>")
+		Mesh mesh; //world-space vertex range of the batch
+		std::shared_ptr< MeshBVH const > bvh; //mesh.bvh, if any (shared by copies of the scene)
+		std::vector< Transform * > members; //transforms of the drawables merged into this batch
+	};
+	std::list< StaticBatch > static_batches;
+
+	//load() marks drawables whose transform (or any of its parents) is named with this prefix -- or is flagged static
+	// in the scene file's 'xfw0' chunk -- as non-dynamic:
+	// (e.g., name props "static:Rock" in Blender to have batch_static() merge them)
+	static constexpr std::string_view StaticPrefix = "static:";
+
+	//load() marks drawables whose transform is named with this prefix -- or is flagged as an occluder in the scene
+	// file's 'xfw0' chunk -- as occluders (see Drawable::occluder); occluders are only what the scene says they are:
+	// (e.g., name big, solid walls "occluder:Wall" in Blender; their whole mesh is drawn into Scene::occlusion)
+	static constexpr std::string_view OccluderPrefix = "occluder:";
+
+	//Prefabs are collections stored once in a scene file (chunks 'pfb0' and 'ins0', written by export-scene.py for instanced collections),
+	// and placed at any number of instance transforms:
+	// - if expand_prefabs is set (the default), load() adds a copy of a prefab's transforms (calling on_drawable for its meshes) under every instance
+	// - otherwise, load() makes each prefab once, as its own scene in 'prefabs' (calling on_drawable with that scene), and adds an
+	//   Instance (a SceneInstance; see SceneInstance.hpp) for every instance, which draw() draws after the scene's drawables
+	//   (instances aren't in the bounds trees or potentially visible sets, and aren't hit by raycast() or sphere_contact())
+	bool expand_prefabs = true;
+	struct Prefab {
+		std::string name;
+		std::shared_ptr< Scene const > scene;
+		std::shared_ptr< ScenePrefab const > prefab;
+	};
+	std::vector< Prefab > prefabs;
+	struct Instance {
+		Transform *transform = nullptr; //the prefab's roots are placed relative to this transform
+		std::shared_ptr< SceneInstance > instance;
+	};
+	std::vector< Instance > instances;
+	//call after moving instances' transforms (load() calls it once):
+	void update_instances();
+
+	//Transform names are views into string tables shared by this scene (and its copies), so a transform costs no
+	// string allocation: load() keeps the file's 'str0' chunk, and intern() keeps names made at runtime:
+	std::string_view intern(std::string_view name);
+
+	//Transforms can be found by name (or name prefix) through an index, which load() builds:
+	// call index_names() after adding, removing, or renaming transforms; until then, lookups scan every transform.
+	// (where names are shared, the transform with the lowest index comes first -- often, but not always, the first added)
+	void index_names();
+	bool names_current() const { return names_indexed && indexed_revision == transforms.revision(); }
+	//first transform named 'name' (or nullptr if there isn't one):
+	Transform *find(std::string_view name);
+	Transform const *find(std::string_view name) const;
+	//append all transforms named 'name', or all transforms with names starting with 'prefix', to 'out':
+	void find_all(std::string_view name, std::vector< Transform * > *out);
+	void find_prefix(std::string_view prefix, std::vector< Transform * > *out);
+
+	//(internals used by the above:)
+	std::vector< std::shared_ptr< std::vector< char > const > > name_tables;
+	struct NamedTransform {
+		std::string_view name;
+		Pool< Transform >::Handle handle;
+	};
+	std::vector< NamedTransform > sorted_names; //transforms sorted by name (then index), so prefixes are ranges
+	std::unordered_map< std::string_view, uint32_t > name_to_sorted; //first entry in sorted_names with each name
+	bool names_indexed = false;
+	uint64_t indexed_revision = 0; //transforms.revision() when indexed
+	//entries of sorted_names with names starting with 'prefix' (or, if 'exact', with names equal to 'prefix'):
+	std::pair< uint32_t, uint32_t > name_range(std::string_view prefix, bool exact) const;
+
 	//add transforms/objects/cameras from a scene file to this scene:
 	// the 'on_drawable' callback gives your code a chance to look up mesh data and make Drawables:
+	//  (the mesh name it is passed is only valid during the callback)
+	//  (the entry's static flag, potentially visible set bit, and baked placement go to the drawable that is
+	//   drawables.back() after the call, so if a call makes several drawables, the others get none of them)
 	// throws on file format errors
 	void load(std::string const &filename,
-		std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable = nullptr
+		std::function< void(Scene &, Transform *, std::string_view) > const &on_drawable = nullptr
+	);
+
+	//..or with a batched callback, which is passed every mesh entry at once (well, once for the scene's own meshes,
+	// and once per placed prefab), so it can resolve many mesh names together -- e.g., in parallel (see parallel_for.hpp):
+	// set (*made)[i] to the drawable made for requests[i] (all start as nullptr; leave it so for requests that make none),
+	// so load() can apply each entry's flags and placement to its drawable.
+	// (load() itself builds the transforms of large files on several threads; the result is the same as a one-thread load)
+	struct DrawableRequest {
+		Transform *transform;
+		std::string_view mesh_name; //(only valid during the callback)
+		bool occluder; //will the drawable be marked as an occluder? (see OccluderPrefix)
+	};
+	void load(std::string const &filename,
+		std::function< void(Scene &, std::vector< DrawableRequest > const &, std::vector< Drawable * > *made) > const &on_drawables
 	);
 
 	//this function is called to read extra chunks from the scene file after the main chunks are read:
 	// this is useful if you, e.g., subclassing scene to represent a game level/area
-	virtual void load_extra(std::istream &from, std::vector< char > const &str0, std::vector< Transform * > const &xfh0) { }
+	// the base version reads potentially visible sets (chunks 'pvg0', 'pvc0', 'pvs0') and animation clips (chunks 'anc0', 'ant0', 'ank0'),
+	//  if present, so overrides should call it first
+	// (xfh0[i] is the transform made for hierarchy entry i, or nullptr for entries that belong to prefabs)
+	virtual void load_extra(std::istream &from, std::vector< char > const &str0, std::vector< Transform * > const &xfh0);
+	void load_pvs(std::istream &from); //(reads 'pvg0', 'pvc0', 'pvs0' into pvs; used by load_extra())
 
 	//empty scene:
 	Scene() = default;
 
 	//load a scene:
-	Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable);
+	Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string_view) > const &on_drawable);
+	Scene(std::string const &filename, std::function< void(Scene &, std::vector< DrawableRequest > const &, std::vector< Drawable * > *) > const &on_drawables);
 
 	//copy a scene (with proper pointer fixup):
+	// (copies everything; to spawn many copies of a scene that share its drawables, see SceneInstance.hpp)
 	Scene(Scene const &); //...as a constructor
 	Scene &operator=(Scene const &); //...as scene = scene
 	//... as a set() function that optionally returns the transform->transform mapping:
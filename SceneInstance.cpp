@@ -0,0 +1,134 @@
+#include "SceneInstance.hpp"
+
+#include "gl_errors.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+ScenePrefab::ScenePrefab(Scene const &scene_) : scene(scene_) {
+	slots = scene.transforms.slot_count();
+	parents.assign(slots, -1U);
+	positions.assign(slots, glm::vec3(0.0f));
+	rotations.assign(slots, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	scales.assign(slots, glm::vec3(1.0f));
+
+	for (auto const &t : scene.transforms) {
+		uint32_t i = index(&t);
+		if (t.parent) parents[i] = index(t.parent);
+		positions[i] = t.position;
+		rotations[i] = t.rotation;
+		scales[i] = t.scale;
+	}
+
+	{ //order transforms parents-first (depth-first from each root):
+		std::vector< std::vector< uint32_t > > children(slots);
+		std::vector< uint32_t > todo;
+		for (auto const &t : scene.transforms) {
+			uint32_t i = index(&t);
+			if (parents[i] == -1U) todo.emplace_back(i);
+			else children[parents[i]].emplace_back(i);
+		}
+		order.reserve(scene.transforms.size());
+		while (!todo.empty()) {
+			uint32_t i = todo.back();
+			todo.pop_back();
+			order.emplace_back(i);
+			todo.insert(todo.end(), children[i].rbegin(), children[i].rend());
+		}
+		//(transforms in a parent cycle are never reached)
+		if (order.size() != scene.transforms.size()) {
+			throw std::runtime_error("scene transforms have a cycle of parents");
+		}
+	}
+
+	drawables.reserve(scene.drawables.size());
+	drawable_transforms.reserve(scene.drawables.size());
+	for (auto const &d : scene.drawables) {
+		drawables.emplace_back(&d);
+		drawable_transforms.emplace_back(index(d.transform));
+	}
+}
+
+uint32_t ScenePrefab::find(std::string_view name) const {
+	Scene::Transform const *transform = scene.find(name);
+	if (!transform) return -1U;
+	return index(transform);
+}
+
+//-------------------------
+
+SceneInstance::SceneInstance(std::shared_ptr< ScenePrefab const > const &prefab_) : prefab(prefab_),
+	positions(prefab->positions), rotations(prefab->rotations), scales(prefab->scales) {
+	local_to_world.resize(prefab->slots);
+	update_world();
+}
+
+SceneInstance::SceneInstance(SceneInstance const &other) : prefab(other.prefab), instance_to_world(other.instance_to_world),
+	positions(other.positions), rotations(other.rotations), scales(other.scales), local_to_world(other.local_to_world) {
+	written.resize(other.written.size());
+	for (uint32_t i = 0; i < written.size(); ++i) {
+		if (other.written[i]) written[i] = std::make_unique< Scene::Drawable >(*other.written[i]);
+	}
+}
+
+void SceneInstance::update_world() {
+	for (uint32_t i : prefab->order) {
+		//(same as Scene::Transform::make_local_to_parent)
+		glm::mat3 rot = glm::mat3_cast(rotations[i]);
+		glm::mat4x3 local_to_parent = glm::mat4x3(
+			rot[0] * scales[i].x,
+			rot[1] * scales[i].y,
+			rot[2] * scales[i].z,
+			positions[i]
+		);
+		uint32_t parent = prefab->parents[i];
+		glm::mat4x3 const &parent_to_world = (parent == -1U ? instance_to_world : local_to_world[parent]);
+		local_to_world[i] = parent_to_world * glm::mat4(local_to_parent);
+	}
+}
+
+Scene::Drawable const &SceneInstance::drawable(uint32_t index) const {
+	if (!written.empty() && written[index]) return *written[index];
+	return *prefab->drawables.at(index);
+}
+
+Scene::Drawable &SceneInstance::write_drawable(uint32_t index) {
+	if (written.empty()) written.resize(prefab->drawables.size());
+	if (!written.at(index)) written[index] = std::make_unique< Scene::Drawable >(*prefab->drawables[index]);
+	return *written[index];
+}
+
+void SceneInstance::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light) const {
+	Scene::Bound bound;
+
+	for (uint32_t index = 0; index < prefab->drawables.size(); ++index) {
+		Scene::Drawable const &d = drawable(index);
+		Scene::Drawable::Pipeline const &pipeline = d.pipeline;
+
+		if (pipeline.program == 0 || pipeline.vao == 0 || pipeline.count == 0) continue;
+
+		glm::mat4x3 const &object_to_world = local_to_world[prefab->drawable_transforms[index]];
+
+		//skip meshes out of view:
+		if (pipeline.mesh && pipeline.mesh->radius >= 0.0f) {
+			Scene::Frustum frustum(world_to_clip * glm::mat4(object_to_world));
+			if (frustum.sphere_outside(pipeline.mesh->center, pipeline.mesh->radius)) continue;
+		}
+
+		Scene::bind_pipeline(pipeline, object_to_world, world_to_clip, world_to_light, &bound);
+
+		if (pipeline.mesh && d.lod != 0 && d.lod < pipeline.mesh->lod_count) {
+			Mesh::LOD const &lod = pipeline.mesh->lods[d.lod];
+			glDrawArrays(pipeline.type, lod.start, lod.count);
+		} else {
+			glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+		}
+
+		Scene::unbind_textures(pipeline);
+	}
+
+	glUseProgram(0);
+	glBindVertexArray(0);
+
+	GL_ERRORS();
+}
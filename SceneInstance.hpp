@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+ * Scene instancing for spawning many copies of a "prefab" scene without deep-copying it (as Scene::set does):
+ *
+ * A ScenePrefab is built once from a (loaded, no longer changing) Scene, and holds what instances share:
+ *  - the hierarchy as arrays indexed by transform slot (see Pool::index_of): parent slots, initial local
+ *    positions / rotations / scales, and an order with parents before children
+ *  - the scene's drawables (pipelines, meshes), cameras, and lights, which stay in the Scene
+ *
+ * A SceneInstance is one copy of a prefab. It only allocates the mutable per-transform state
+ *  (local position / rotation / scale and world matrices -- a few array copies), and copies a
+ *  drawable only when code asks to change it (write_drawable()).
+ *
+ * Instances are drawn with SceneInstance::draw(), which culls drawables with meshes by their
+ *  bounding spheres; the bounds trees, potentially visible sets, occlusion, and GPU culling of
+ *  Scene::draw are not used.
+ *
+ */
+
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ScenePrefab {
+	//(scene must outlive the prefab and its instances, and must not be changed while they exist)
+	ScenePrefab(Scene const &scene);
+
+	Scene const &scene;
+
+	//slot of a transform (use as an index into the per-transform arrays here and in SceneInstance):
+	uint32_t index(Scene::Transform const *transform) const { return scene.transforms.index_of(transform); }
+	//slot of the transform with a given name (or -1U if there is none; if several share a name, the first -- see Scene::find):
+	uint32_t find(std::string_view name) const;
+
+	//per-transform arrays (indexed by slot; erased slots hold identity transforms):
+	uint32_t slots = 0;
+	std::vector< uint32_t > parents; //slot of parent (or -1U)
+	std::vector< glm::vec3 > positions;
+	std::vector< glm::quat > rotations;
+	std::vector< glm::vec3 > scales;
+
+	//slots of all transforms, parents before children:
+	std::vector< uint32_t > order;
+
+	//drawables of the scene and the slots of their transforms:
+	std::vector< Scene::Drawable const * > drawables;
+	std::vector< uint32_t > drawable_transforms;
+};
+
+struct SceneInstance {
+	SceneInstance(std::shared_ptr< ScenePrefab const > const &prefab);
+	SceneInstance(SceneInstance const &); //(copies written drawables, too)
+
+	std::shared_ptr< ScenePrefab const > prefab;
+
+	//where the instance is in the world (applies to transforms without parents):
+	glm::mat4x3 instance_to_world = glm::mat4x3(1.0f);
+
+	//local state of each transform (indexed by slot; see ScenePrefab::index and ScenePrefab::find), starting as the prefab's:
+	std::vector< glm::vec3 > positions;
+	std::vector< glm::quat > rotations;
+	std::vector< glm::vec3 > scales;
+
+	//world matrix of each transform, as of the latest update_world():
+	std::vector< glm::mat4x3 > local_to_world;
+	//call after changing instance_to_world or local state (and before draw()):
+	void update_world();
+
+	//drawables (indexed as ScenePrefab::drawables):
+	// drawable() is the instance's copy, if it has written one, otherwise the prefab's
+	// write_drawable() makes the instance's own copy (on first call) and returns it
+	// (only the copy's pipeline and lod are used by the instance; its transform is ignored)
+	Scene::Drawable const &drawable(uint32_t index) const;
+	Scene::Drawable &write_drawable(uint32_t index);
+
+	void draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light = glm::mat4x3(1.0f)) const;
+
+	//-- internals ---
+	std::vector< std::unique_ptr< Scene::Drawable > > written; //(empty until the first write_drawable())
+};
@@ -0,0 +1,229 @@
+#include "SceneSnapshot.hpp"
+
+#include "GPUCulling.hpp"
+#include "GeometryPool.hpp"
+#include "read_write_chunk.hpp"
+
+#include <stdexcept>
+#include <string>
+
+void SceneSnapshot::save(Scene const &scene, MeshBuffer const *meshes) {
+	//(resize() keeps capacity, so repeated saves of a scene that isn't growing don't allocate)
+	transforms.resize(scene.transforms.slot_count());
+	for (uint32_t i = 0; i < transforms.size(); ++i) {
+		TransformEntry &entry = transforms[i];
+		Scene::Transform const *t = scene.transforms.at(i);
+		if (!t) {
+			entry = TransformEntry{0, -1U, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f)};
+			continue;
+		}
+		entry.flags = Alive;
+		entry.parent = (t->parent ? scene.transforms.index_of(t->parent) : -1U);
+		entry.position = t->position;
+		entry.rotation = t->rotation;
+		entry.scale = t->scale;
+	}
+
+	drawables.resize(scene.drawables.slot_count());
+	for (uint32_t i = 0; i < drawables.size(); ++i) {
+		DrawableEntry &entry = drawables[i];
+		Scene::Drawable const *d = scene.drawables.at(i);
+		if (!d) {
+			entry = DrawableEntry{0, -1U, -1U, 0, 0, 0, 0};
+			continue;
+		}
+		entry.flags = Alive | (d->dynamic ? Dynamic : 0) | (d->occluder ? Occluder : 0) | (d->pipeline.mesh ? HasMesh : 0);
+		entry.transform = scene.transforms.index_of(d->transform);
+		entry.mesh = (d->pipeline.mesh && meshes ? meshes->id_of(d->pipeline.mesh) : MeshBuffer::InvalidMeshID);
+		entry.type = d->pipeline.type;
+		entry.start = d->pipeline.start;
+		entry.count = d->pipeline.count;
+		entry.lod = d->lod;
+	}
+
+	cameras.resize(scene.cameras.slot_count());
+	for (uint32_t i = 0; i < cameras.size(); ++i) {
+		Scene::Camera const *c = scene.cameras.at(i);
+		if (!c) {
+			cameras[i] = CameraEntry{0, -1U, 0.0f, 0.0f, 0.0f};
+			continue;
+		}
+		cameras[i] = CameraEntry{Alive, scene.transforms.index_of(c->transform), c->fovy, c->aspect, c->near};
+	}
+
+	lights.resize(scene.lights.slot_count());
+	for (uint32_t i = 0; i < lights.size(); ++i) {
+		Scene::Light const *l = scene.lights.at(i);
+		if (!l) {
+			lights[i] = LightEntry{0, -1U, 0, glm::vec3(0.0f), 0.0f};
+			continue;
+		}
+		lights[i] = LightEntry{Alive, scene.transforms.index_of(l->transform), uint32_t(l->type), l->energy, l->spot_fov};
+	}
+}
+
+void SceneSnapshot::restore(Scene &scene, MeshBuffer const *meshes) const {
+	//check everything first, so a snapshot that doesn't fit leaves the scene as it was:
+	auto check_slots = [](char const *what, uint32_t slot_count, uint32_t entries, auto const &alive, auto const &entry_alive) {
+		if (slot_count != entries) {
+			throw std::runtime_error(std::string("snapshot has ") + std::to_string(entries) + " " + what + " slots, but scene has " + std::to_string(slot_count));
+		}
+		for (uint32_t i = 0; i < entries; ++i) {
+			if (alive(i) != entry_alive(i)) {
+				throw std::runtime_error(std::string("snapshot and scene differ in which ") + what + " slots are in use (e.g., slot " + std::to_string(i) + ")");
+			}
+		}
+	};
+	check_slots("transform", scene.transforms.slot_count(), uint32_t(transforms.size()),
+		[&](uint32_t i) { return scene.transforms.at(i) != nullptr; }, [&](uint32_t i) { return (transforms[i].flags & Alive) != 0; });
+	check_slots("drawable", scene.drawables.slot_count(), uint32_t(drawables.size()),
+		[&](uint32_t i) { return scene.drawables.at(i) != nullptr; }, [&](uint32_t i) { return (drawables[i].flags & Alive) != 0; });
+	check_slots("camera", scene.cameras.slot_count(), uint32_t(cameras.size()),
+		[&](uint32_t i) { return scene.cameras.at(i) != nullptr; }, [&](uint32_t i) { return (cameras[i].flags & Alive) != 0; });
+	check_slots("light", scene.lights.slot_count(), uint32_t(lights.size()),
+		[&](uint32_t i) { return scene.lights.at(i) != nullptr; }, [&](uint32_t i) { return (lights[i].flags & Alive) != 0; });
+
+	auto check_transform = [&](uint32_t slot) {
+		if (!scene.transforms.at(slot)) throw std::runtime_error("snapshot refers to transform slot " + std::to_string(slot) + ", which is not in use");
+	};
+	for (uint32_t i = 0; i < transforms.size(); ++i) {
+		if (!(transforms[i].flags & Alive) || transforms[i].parent == -1U) continue;
+		check_transform(transforms[i].parent);
+	}
+	{ //parent chains must end (make_local_to_world() would never return on a cycle):
+		std::vector< uint8_t > state(transforms.size(), 0); //0: not walked yet, 1: on the chain being walked, 2: chain ends
+		std::vector< uint32_t > chain;
+		for (uint32_t i = 0; i < transforms.size(); ++i) {
+			if (!(transforms[i].flags & Alive)) continue;
+			chain.clear();
+			uint32_t at = i;
+			while (at != -1U && state[at] == 0) {
+				state[at] = 1;
+				chain.emplace_back(at);
+				at = transforms[at].parent;
+			}
+			if (at != -1U && state[at] == 1) {
+				throw std::runtime_error("snapshot has a cycle of transform parents (through slot " + std::to_string(at) + ")");
+			}
+			for (uint32_t c : chain) state[c] = 2;
+		}
+	}
+	GLuint pool_size = GeometryPool::largest_shared_size();
+	for (auto const &entry : drawables) {
+		if (!(entry.flags & Alive)) continue;
+		check_transform(entry.transform);
+		if (entry.mesh != MeshBuffer::InvalidMeshID) {
+			if (!(meshes && entry.mesh < meshes->mesh_count())) {
+				throw std::runtime_error("snapshot refers to mesh " + std::to_string(entry.mesh) + ", which is not in the given mesh buffer");
+			}
+			Mesh const &mesh = meshes->mesh(entry.mesh);
+			if (entry.lod != 0 && entry.lod >= mesh.lod_count) {
+				throw std::runtime_error("snapshot has level of detail " + std::to_string(entry.lod) + " of mesh " + std::to_string(entry.mesh) + ", which has " + std::to_string(mesh.lod_count));
+			}
+		} else if (entry.flags & HasMesh) {
+			//(meshes not from the buffer -- streamed, skinned, batched -- are all drawn from shared geometry pools)
+			if (entry.start > pool_size || entry.count > pool_size - entry.start) {
+				throw std::runtime_error("snapshot has vertex range [" + std::to_string(entry.start) + ", +" + std::to_string(entry.count) + ") past the end of the geometry pools");
+			}
+		}
+	}
+	for (auto const &entry : cameras) {
+		if (entry.flags & Alive) check_transform(entry.transform);
+	}
+	for (auto const &entry : lights) {
+		if (!(entry.flags & Alive)) continue;
+		check_transform(entry.transform);
+		if (entry.type != Scene::Light::Point && entry.type != Scene::Light::Hemisphere
+		 && entry.type != Scene::Light::Spot && entry.type != Scene::Light::Directional) {
+			throw std::runtime_error("snapshot has light of unknown type (" + std::to_string(entry.type) + ")");
+		}
+	}
+
+	//...then assign:
+	for (uint32_t i = 0; i < transforms.size(); ++i) {
+		TransformEntry const &entry = transforms[i];
+		if (!(entry.flags & Alive)) continue;
+		Scene::Transform &t = *scene.transforms.at(i);
+		t.parent = (entry.parent == -1U ? nullptr : scene.transforms.at(entry.parent));
+		t.position = entry.position;
+		t.rotation = entry.rotation;
+		t.scale = entry.scale;
+	}
+
+	bool drawables_changed = false;
+	for (uint32_t i = 0; i < drawables.size(); ++i) {
+		DrawableEntry const &entry = drawables[i];
+		if (!(entry.flags & Alive)) continue;
+		Scene::Drawable &d = *scene.drawables.at(i);
+		d.transform = scene.transforms.at(entry.transform);
+
+		//(mesh == -1U with HasMesh set means the mesh wasn't from the buffer, so is left as it is)
+		Mesh const *mesh = d.pipeline.mesh;
+		if (!(entry.flags & HasMesh)) mesh = nullptr;
+		else if (entry.mesh != MeshBuffer::InvalidMeshID) mesh = &meshes->mesh(entry.mesh);
+		if (mesh != d.pipeline.mesh) {
+			d.pipeline.mesh = mesh;
+			if (mesh) d.pipeline.position_to_object = mesh->position_to_object;
+			drawables_changed = true;
+		}
+		//(ranges of meshes from the buffer come from the mesh itself, so a snapshot can't point them elsewhere)
+		if (entry.mesh != MeshBuffer::InvalidMeshID) {
+			d.pipeline.type = mesh->type;
+			d.pipeline.start = mesh->start;
+			d.pipeline.count = mesh->count;
+		} else {
+			d.pipeline.type = GLenum(entry.type);
+			d.pipeline.start = entry.start;
+			d.pipeline.count = entry.count;
+		}
+		d.lod = entry.lod;
+
+		bool dynamic = (entry.flags & Dynamic) != 0;
+		if (dynamic != d.dynamic) {
+			d.dynamic = dynamic;
+			drawables_changed = true;
+		}
+		d.occluder = (entry.flags & Occluder) != 0;
+	}
+
+	for (uint32_t i = 0; i < cameras.size(); ++i) {
+		CameraEntry const &entry = cameras[i];
+		if (!(entry.flags & Alive)) continue;
+		Scene::Camera &c = *scene.cameras.at(i);
+		c.transform = scene.transforms.at(entry.transform);
+		c.fovy = entry.fovy;
+		c.aspect = entry.aspect;
+		c.near = entry.near;
+	}
+
+	for (uint32_t i = 0; i < lights.size(); ++i) {
+		LightEntry const &entry = lights[i];
+		if (!(entry.flags & Alive)) continue;
+		Scene::Light &l = *scene.lights.at(i);
+		l.transform = scene.transforms.at(entry.transform);
+		l.type = Scene::Light::Type(entry.type);
+		l.energy = entry.energy;
+		l.spot_fov = entry.spot_fov;
+	}
+
+	//bounds trees and GPU culling slots depend on meshes and dynamic flags:
+	if (drawables_changed) {
+		scene.bounds_built = false;
+		if (scene.gpu_culling) scene.gpu_culling->invalidate();
+	}
+}
+
+void SceneSnapshot::write(std::ostream &to) const {
+	write_chunk("sxf0", transforms, &to);
+	write_chunk("sdr0", drawables, &to);
+	write_chunk("scm0", cameras, &to);
+	write_chunk("slt0", lights, &to);
+	if (!to) throw std::runtime_error("failed to write scene snapshot");
+}
+
+void SceneSnapshot::read(std::istream &from) {
+	read_chunk(from, "sxf0", &transforms);
+	read_chunk(from, "sdr0", &drawables);
+	read_chunk(from, "scm0", &cameras);
+	read_chunk(from, "slt0", &lights);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+ * A SceneSnapshot records the changing state of a Scene, so it can be put back later
+ *  (e.g., to rewind and replay while debugging, or to pick up where the app left off after a pause):
+ *  - transforms: local position, rotation, and scale, and parent
+ *  - drawables: transform, mesh (by MeshBuffer::MeshID), vertex range, level of detail, and dynamic/occluder flags
+ *  - cameras: transform and projection parameters
+ *  - lights: transform, type, energy, and spot fov
+ *
+ * Everything is kept by Pool slot (see Pool.hpp), in flat arrays of packed entries:
+ *  - save() re-uses the snapshot's arrays, so -- once they've grown to fit -- taking a snapshot doesn't allocate
+ *  - restore() assigns to items already in the scene, and never adds, removes, or re-allocates anything;
+ *    so the scene must have the same slots in use as when the snapshot was saved (e.g., the same scene with
+ *    nothing added or removed since, or a copy made by Scene::set, which keeps slots), or restore() throws
+ *  - write() and read() store snapshots as chunks (see read_write_chunk.hpp), to keep them across runs
+ *
+ * What isn't state -- names, drawables' programs, vertex arrays, textures, and set_uniforms, baked placements,
+ *  bounds trees, potentially visible sets, and prefab instances -- is neither saved nor restored.
+ *
+ */
+
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <iostream>
+#include <vector>
+
+struct SceneSnapshot {
+	//record the state of 'scene':
+	// (drawables with meshes from 'meshes' store their MeshID; others keep whatever mesh they have when restored)
+	void save(Scene const &scene, MeshBuffer const *meshes = nullptr);
+
+	//put the recorded state back into 'scene' (throws -- changing nothing -- if its slots don't match the snapshot, or if the snapshot
+	// is malformed: e.g., refers to unused slots, has a cycle of parents, levels of detail a mesh doesn't have, vertex ranges past the
+	// end of the geometry pools, or lights of unknown type):
+	// (drawables with a MeshID get their vertex range from that mesh; only others use the recorded range)
+	// (rebuilds bounds and GPU culling slots only if drawables' meshes or dynamic flags changed)
+	void restore(Scene &scene, MeshBuffer const *meshes = nullptr) const;
+
+	//read/write snapshots as chunks 'sxf0', 'sdr0', 'scm0', 'slt0' (throws on errors):
+	void write(std::ostream &to) const;
+	void read(std::istream &from);
+
+	//-- internals ---
+	enum : uint32_t {
+		Alive = 1, //slot held an item
+		Dynamic = 2, //(drawables) dynamic flag
+		Occluder = 4, //(drawables) occluder flag
+		HasMesh = 8, //(drawables) pipeline.mesh was set
+	};
+	struct TransformEntry {
+		uint32_t flags;
+		uint32_t parent; //slot of parent, or -1U
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+	};
+	static_assert(sizeof(TransformEntry) == 4 + 4 + 4*3 + 4*4 + 4*3, "TransformEntry is packed.");
+	struct DrawableEntry {
+		uint32_t flags;
+		uint32_t transform; //slot of transform
+		uint32_t mesh; //MeshID, or -1U if pipeline.mesh wasn't from the MeshBuffer passed to save()
+		uint32_t type;
+		uint32_t start, count;
+		uint32_t lod;
+	};
+	static_assert(sizeof(DrawableEntry) == 4*7, "DrawableEntry is packed.");
+	struct CameraEntry {
+		uint32_t flags;
+		uint32_t transform;
+		float fovy, aspect, near;
+	};
+	static_assert(sizeof(CameraEntry) == 4*5, "CameraEntry is packed.");
+	struct LightEntry {
+		uint32_t flags;
+		uint32_t transform;
+		uint32_t type; //(a Scene::Light::Type)
+		glm::vec3 energy;
+		float spot_fov;
+	};
+	static_assert(sizeof(LightEntry) == 4*3 + 4*3 + 4, "LightEntry is packed.");
+
+	std::vector< TransformEntry > transforms;
+	std::vector< DrawableEntry > drawables;
+	std::vector< CameraEntry > cameras;
+	std::vector< LightEntry > lights;
+};
@@ -6,7 +6,7 @@
 #include <iostream>
 
 ShowMeshesMode::ShowMeshesMode(MeshBuffer const &buffer_) : buffer(buffer_) {
-	vao = buffer.make_vao_for_program(show_meshes_program->program);
+	vao = buffer.make_vao_for_program((buffer.quantized ? quantized_show_meshes_program : show_meshes_program)->program);
 
 	//Set up scene:
 	{ //create a single camera:
@@ -22,7 +22,7 @@ ShowMeshesMode::ShowMeshesMode(MeshBuffer const &buffer_) : buffer(buffer_) {
 		scene.drawables.emplace_back(&scene.transforms.back());
 		scene_drawable = &scene.drawables.back();
 
-		scene_drawable->pipeline = show_meshes_program_pipeline;
+		scene_drawable->pipeline = (buffer.quantized ? quantized_show_meshes_program_pipeline : show_meshes_program_pipeline);
 		scene_drawable->pipeline.vao = vao;
 		//these will be updated by the mesh selection code:
 		scene_drawable->pipeline.type = GL_TRIANGLES;
@@ -151,19 +151,19 @@ void ShowMeshesMode::draw(glm::uvec2 const &drawable_size) {
 	}
 }
 
-void ShowMeshesMode::select_prev_mesh() {
-	auto f = buffer.meshes.find(current_mesh_name);
-	if (f != buffer.meshes.end()) --f;
-	if (f == buffer.meshes.end()) f = buffer.meshes.begin();
-
-	if (f != buffer.meshes.end()) {
-		current_mesh_name = f->first;
-		scene_drawable->pipeline.type = f->second.type;
-		scene_drawable->pipeline.start = f->second.start;
-		scene_drawable->pipeline.count = f->second.count;
-		current_mesh_min = f->second.min;
-		current_mesh_max = f->second.max;
+void ShowMeshesMode::select_mesh(MeshBuffer::MeshID id) {
+	if (id < buffer.mesh_count()) {
+		Mesh const &mesh = buffer.mesh(id);
+		current_mesh = id;
+		current_mesh_name = std::string(buffer.name(id));
+		scene_drawable->pipeline.type = mesh.type;
+		scene_drawable->pipeline.start = mesh.start;
+		scene_drawable->pipeline.count = mesh.count;
+		scene_drawable->pipeline.position_to_object = mesh.position_to_object;
+		current_mesh_min = mesh.min;
+		current_mesh_max = mesh.max;
 	} else {
+		current_mesh = MeshBuffer::InvalidMeshID;
 		current_mesh_name = "";
 		scene_drawable->pipeline.type = GL_TRIANGLES;
 		scene_drawable->pipeline.start = 0;
@@ -173,31 +173,14 @@ void ShowMeshesMode::select_prev_mesh() {
 	}
 }
 
-void ShowMeshesMode::select_next_mesh() {
-	auto f = buffer.meshes.find(current_mesh_name);
-	if (f != buffer.meshes.end()) ++f;
-	if (f == buffer.meshes.end()) {
-		auto temp = buffer.meshes.rbegin();
-		if (temp != buffer.meshes.rend()) {
-			++temp;
-			f = temp.base();
-			assert(f != buffer.meshes.end());
-		}
-	}
+void ShowMeshesMode::select_prev_mesh() {
+	//(meshes are in file order; selection stops at the first mesh)
+	if (current_mesh == MeshBuffer::InvalidMeshID || current_mesh == 0) select_mesh(0);
+	else select_mesh(current_mesh - 1);
+}
 
-	if (f != buffer.meshes.end()) {
-		current_mesh_name = f->first;
-		scene_drawable->pipeline.type = f->second.type;
-		scene_drawable->pipeline.start = f->second.start;
-		scene_drawable->pipeline.count = f->second.count;
-		current_mesh_min = f->second.min;
-		current_mesh_max = f->second.max;
-	} else {
-		current_mesh_name = "";
-		scene_drawable->pipeline.type = GL_TRIANGLES;
-		scene_drawable->pipeline.start = 0;
-		scene_drawable->pipeline.count = 0;
-		current_mesh_min = glm::vec3(0.0f);
-		current_mesh_max = glm::vec3(0.0f);
-	}
+void ShowMeshesMode::select_next_mesh() {
+	//(selection stops at the last mesh)
+	if (current_mesh == MeshBuffer::InvalidMeshID) select_mesh(0);
+	else if (current_mesh + 1 < buffer.mesh_count()) select_mesh(current_mesh + 1);
 }
@@ -31,9 +31,11 @@ struct ShowMeshesMode : Mode {
 	MeshBuffer const &buffer;
 
 	//currently selected mesh:
+	MeshBuffer::MeshID current_mesh = MeshBuffer::InvalidMeshID;
 	std::string current_mesh_name = "";
 	glm::vec3 current_mesh_min = glm::vec3(0.0f);
 	glm::vec3 current_mesh_max = glm::vec3(0.0f);
+	void select_mesh(MeshBuffer::MeshID id);
 	void select_prev_mesh();
 	void select_next_mesh();
 	
@@ -4,31 +4,59 @@
 #include "gl_errors.hpp"
 
 Scene::Drawable::Pipeline show_meshes_program_pipeline;
+Scene::Drawable::Pipeline quantized_show_meshes_program_pipeline;
+
+//helper used by both program variants to build their pipeline templates:
+static void make_pipeline(ShowMeshesProgram const &program, Scene::Drawable::Pipeline *pipeline_) {
+	assert(pipeline_);
+	auto &pipeline = *pipeline_;
+
+	pipeline.program = program.program;
+
+	pipeline.OBJECT_TO_CLIP_mat4 = program.OBJECT_TO_CLIP_mat4;
+	pipeline.OBJECT_TO_LIGHT_mat4x3 = program.OBJECT_TO_LIGHT_mat4x3;
+	pipeline.NORMAL_TO_LIGHT_mat3 = program.NORMAL_TO_LIGHT_mat3;
+}
 
 Load< ShowMeshesProgram > show_meshes_program(LoadTagEarly, []() -> ShowMeshesProgram * {
 	auto *ret = new ShowMeshesProgram();
 
-	show_meshes_program_pipeline.program = ret->program;
+	make_pipeline(*ret, &show_meshes_program_pipeline);
 
-	show_meshes_program_pipeline.OBJECT_TO_CLIP_mat4 = ret->OBJECT_TO_CLIP_mat4;
-	show_meshes_program_pipeline.OBJECT_TO_LIGHT_mat4x3 = ret->OBJECT_TO_LIGHT_mat4x3;
-	show_meshes_program_pipeline.NORMAL_TO_LIGHT_mat3 = ret->NORMAL_TO_LIGHT_mat3;
+	return ret;
+});
+
+Load< ShowMeshesProgram > quantized_show_meshes_program(LoadTagEarly, []() -> ShowMeshesProgram * {
+	auto *ret = new ShowMeshesProgram(true);
+
+	make_pipeline(*ret, &quantized_show_meshes_program_pipeline);
 
 	return ret;
 });
 
-ShowMeshesProgram::ShowMeshesProgram() {
+ShowMeshesProgram::ShowMeshesProgram(bool quantized) {
 	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
 	program = gl_compile_program(
 		//vertex shader:
 		"#version 330\n"
+		+ std::string(quantized ? "#define QUANTIZED\n" : "") +
 		"uniform mat4 OBJECT_TO_CLIP;\n"
 		"uniform mat4x3 OBJECT_TO_LIGHT;\n"
 		"uniform mat3 NORMAL_TO_LIGHT;\n"
-		"in vec4 Position;\n"
-		"in vec3 Normal;\n"
-		"in vec4 Color;\n"
-		"in vec2 TexCoord;\n"
+		"layout(location=0) in vec4 Position;\n" //(attribute locations as in MeshBuffer)
+		"#ifdef QUANTIZED\n"
+		"layout(location=1) in vec2 Normal;\n" //octahedral-encoded
+		"vec3 decode_normal(vec2 e) {\n"
+		"	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+		"	if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);\n"
+		"	return normalize(n);\n"
+		"}\n"
+		"#else\n"
+		"layout(location=1) in vec3 Normal;\n"
+		"vec3 decode_normal(vec3 n) { return n; }\n"
+		"#endif\n"
+		"layout(location=2) in vec4 Color;\n"
+		"layout(location=3) in vec2 TexCoord;\n"
 		"out vec3 position;\n"
 		"out vec3 normal;\n"
 		"out vec4 color;\n"
@@ -36,7 +64,7 @@ ShowMeshesProgram::ShowMeshesProgram() {
 		"void main() {\n"
 		"	gl_Position = OBJECT_TO_CLIP * Position;\n"
 		"	position = OBJECT_TO_LIGHT * Position;\n"
-		"	normal = NORMAL_TO_LIGHT * Normal;\n"
+		"	normal = NORMAL_TO_LIGHT * decode_normal(Normal);\n"
 		"	color = Color;\n"
 		"	texCoord = TexCoord;\n"
 		"}\n"
@@ -72,14 +100,14 @@ ShowMeshesProgram::ShowMeshesProgram() {
 		"	}\n"
 		"}\n"
 		,
-		"ShowMeshesProgram"
+		quantized ? "ShowMeshesProgram(quantized)" : "ShowMeshesProgram"
 	);
 
-	//look up the locations of vertex attributes:
-	Position_vec4 = glGetAttribLocation(program, "Position");
-	Normal_vec3 = glGetAttribLocation(program, "Normal");
-	Color_vec4 = glGetAttribLocation(program, "Color");
-	TexCoord_vec2 = glGetAttribLocation(program, "TexCoord");
+	//vertex attributes are at fixed locations (see MeshBuffer), so don't need to be looked up:
+	Position_vec4 = MeshBuffer::PositionLocation;
+	Normal_vec3 = MeshBuffer::NormalLocation;
+	Color_vec4 = MeshBuffer::ColorLocation;
+	TexCoord_vec2 = MeshBuffer::TexCoordLocation;
 
 	//look up the locations of uniforms:
 	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
@@ -1,6 +1,10 @@
 #include "ShowSceneMode.hpp"
 #include "DrawLines.hpp"
+#include "GPUCulling.hpp"
+#include "WorldStream.hpp"
 
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 
 ShowSceneMode::ShowSceneMode(Scene const &scene_) : scene(scene_) {
@@ -83,6 +87,7 @@ void ShowSceneMode::draw(glm::uvec2 const &drawable_size) {
 	scene_camera->transform->scale = glm::vec3(1.0f);
 	scene_camera->aspect = float(drawable_size.x) / float(drawable_size.y);
 
+	if (stream) stream->update(scene_camera->transform->make_local_to_world()[3]);
 
 	//--- actual drawing ---
 	glClearColor(0.5f, 0.5f, 0.5f, 0.0f);
@@ -121,7 +126,7 @@ void ShowSceneMode::draw(glm::uvec2 const &drawable_size) {
 			draw_lines.draw(xf(glm::vec3(0.0f)), xf(glm::vec3(0.0f, 0.0f, -len)), glm::u8vec4(0x00, 0x00, 0x88, 0xff));
 
 			//transform name:
-			draw_lines.draw_text("'" + transform.name + "'",
+			draw_lines.draw_text("'" + std::string(transform.name) + "'",
 				xf(glm::vec3(0.05f, 0.0f, 0.05f)),
 				0.15f * xfd(glm::vec3(1.0f, 0.0f, 0.0f)),
 				0.15f * xfd(glm::vec3(0.0f, 0.0f, 1.0f)),
@@ -136,4 +141,30 @@ void ShowSceneMode::draw(glm::uvec2 const &drawable_size) {
 		*/
 	}
 
+	if (scene.occlusion || scene.gpu_culling) { //report how much occlusion or GPU culling skipped:
+		glDisable(GL_DEPTH_TEST);
+		float aspect = float(drawable_size.x) / float(drawable_size.y);
+		DrawLines lines(glm::mat4(
+			1.0f / aspect, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		));
+		constexpr float H = 0.09f;
+		char text[128];
+		if (scene.gpu_culling && scene.gpu_culling->supported()) {
+			uint32_t slots = scene.gpu_culling->slot_count();
+			uint32_t visible = scene.gpu_culling->read_visible_count();
+			std::snprintf(text, sizeof(text), "GPU culled %u of %u draws", slots - std::min(visible, slots), slots);
+		} else if (scene.occlusion) {
+			std::snprintf(text, sizeof(text), "occlusion culled %u of %u draws (%.1f%%)", scene.occlusion->rejected, scene.occlusion->tested, scene.occlusion->rejected_percent());
+		} else {
+			std::snprintf(text, sizeof(text), "GPU culling not supported");
+		}
+		lines.draw_text(text,
+			glm::vec3(-aspect + 0.1f * H, -1.0 + 0.1f * H, 0.0),
+			glm::vec3(H, 0.0f, 0.0f), glm::vec3(0.0f, H, 0.0f),
+			glm::u8vec4(0xff, 0xff, 0xff, 0x00));
+	}
+
 }
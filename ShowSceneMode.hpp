@@ -11,6 +11,8 @@
 #include "Scene.hpp"
 #include "Mesh.hpp"
 
+struct WorldStream;
+
 struct ShowSceneMode : Mode {
 	ShowSceneMode(Scene const &scene);
 	virtual ~ShowSceneMode();
@@ -30,6 +32,9 @@ struct ShowSceneMode : Mode {
 	//Scene being viewed:
 	Scene const &scene;
 
+	//(optional) cells streamed into the scene around the camera (updated every draw()):
+	WorldStream *stream = nullptr;
+
 	//mode uses a secondary Scene to hold a camera:
 	Scene camera_scene;
 	Scene::Camera *scene_camera = nullptr;
@@ -8,14 +8,15 @@
 //Shader program that provides various modes for visualizing positions,
 // colors, normals, and texture coordinates; mostly useful for debugging.
 struct ShowSceneProgram {
-	ShowSceneProgram();
+	//if 'quantized' is set, the program reads octahedral-encoded normals (for use with quantized MeshBuffers):
+	ShowSceneProgram(bool quantized = false);
 	~ShowSceneProgram();
 
 	GLuint program = 0;
 
 	//Attribute (per-vertex variable) locations:
 	GLuint Position_vec4 = -1U;
-	GLuint Normal_vec3 = -1U;
+	GLuint Normal_vec3 = -1U; //(Normal_vec2 in the quantized variant)
 	GLuint Color_vec4 = -1U;
 	GLuint TexCoord_vec2 = -1U;
 
@@ -32,3 +33,7 @@ struct ShowSceneProgram {
 
 extern Load< ShowSceneProgram > show_scene_program;
 extern Scene::Drawable::Pipeline show_scene_program_pipeline; //Drawable::Pipeline already initialized with proper uniform locations for this program.
+
+//Variant of the above for drawing meshes from quantized MeshBuffers:
+extern Load< ShowSceneProgram > quantized_show_scene_program;
+extern Scene::Drawable::Pipeline quantized_show_scene_program_pipeline;
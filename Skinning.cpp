@@ -0,0 +1,229 @@
+#include "Skinning.hpp"
+
+#include "GeometryPool.hpp"
+#include "GPUCulling.hpp"
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+//IEEE half -> float (for quantized texcoords; the inverse of float_to_half in 'cook-meshes'):
+static float half_to_float(uint16_t h) {
+	uint32_t e = (h >> 10) & 0x1f;
+	uint32_t m = h & 0x3ff;
+	float f;
+	if (e == 0) f = std::ldexp(float(m), -24); //subnormal (or zero)
+	else if (e == 31) f = (m ? std::numeric_limits< float >::quiet_NaN() : std::numeric_limits< float >::infinity());
+	else f = std::ldexp(float(m | 0x400), int(e) - 25);
+	return (h & 0x8000) ? -f : f;
+}
+
+static GeometryPool &skinned_pool() {
+	return GeometryPool::shared("pns0", sizeof(MeshBuffer::SkinnedVertex));
+}
+
+SkinPalettes::SkinPalettes() {
+	glGenBuffers(1, &buffer);
+
+	//palettes are bound by offset, which must be a multiple of the uniform buffer offset alignment:
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment = std::max(alignment, GLint(sizeof(glm::vec4)));
+	GLsizeiptr palette_size = GLsizeiptr(MaxBones) * 3 * sizeof(glm::vec4);
+	slot_size = (palette_size + alignment - 1) / alignment * alignment;
+
+	GL_ERRORS();
+}
+
+SkinPalettes::~SkinPalettes() {
+	assert(models.empty() && "SkinnedModels should be destroyed before their SkinPalettes");
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void SkinPalettes::update() {
+	size_t slot_rows = size_t(slot_size) / sizeof(glm::vec4);
+	//(resize() keeps capacity, so this only allocates when models are added)
+	rows.resize(models.size() * slot_rows);
+
+	for (uint32_t i = 0; i < models.size(); ++i) {
+		SkinnedModel &model = *models[i];
+		glm::mat4x3 world_to_model = model.root->make_world_to_local();
+		glm::vec4 *palette = rows.data() + i * slot_rows;
+
+		Mesh &mesh = model.mesh;
+		mesh.min = glm::vec3( std::numeric_limits< float >::infinity());
+		mesh.max = glm::vec3(-std::numeric_limits< float >::infinity());
+
+		for (uint32_t b = 0; b < model.bones.size(); ++b) {
+			glm::mat4x3 bone_to_model = world_to_model * glm::mat4(model.bones[b]->make_local_to_world());
+
+			//palette entry as three rows, so it fits in three vec4's:
+			glm::mat4x3 bind_to_model = bone_to_model * glm::mat4(model.bind_to_bone[b]);
+			for (uint32_t r = 0; r < 3; ++r) {
+				palette[3 * b + r] = glm::vec4(bind_to_model[0][r], bind_to_model[1][r], bind_to_model[2][r], bind_to_model[3][r]);
+			}
+
+			//model bounds include the box around each bone's (transformed) box:
+			glm::vec3 center = bone_to_model * glm::vec4(0.5f * (model.bone_min[b] + model.bone_max[b]), 1.0f);
+			glm::vec3 half = 0.5f * (model.bone_max[b] - model.bone_min[b]);
+			glm::vec3 extent = glm::abs(bone_to_model[0]) * half.x + glm::abs(bone_to_model[1]) * half.y + glm::abs(bone_to_model[2]) * half.z;
+			mesh.min = glm::min(mesh.min, center - extent);
+			mesh.max = glm::max(mesh.max, center + extent);
+		}
+		mesh.center = 0.5f * (mesh.min + mesh.max);
+		mesh.radius = 0.5f * glm::length(mesh.max - mesh.min);
+	}
+
+	//every palette in one upload (re-specifying the buffer, so the driver needn't wait for draws using last frame's palettes):
+	if (rows.empty()) return;
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, rows.size() * sizeof(glm::vec4), rows.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	GL_ERRORS();
+}
+
+void SkinPalettes::bind(uint32_t slot) const {
+	assert((slot + 1) * size_t(slot_size) <= rows.size() * sizeof(glm::vec4) && "call SkinPalettes::update() before drawing skinned models");
+	glBindBufferRange(GL_UNIFORM_BUFFER, Binding, buffer, GLintptr(slot) * slot_size, GLsizeiptr(MaxBones) * 3 * sizeof(glm::vec4));
+}
+
+//------------------------------
+
+SkinnedModel::SkinnedModel(Scene &scene, Scene::Transform *root_, Scene::Drawable::Pipeline const &pipeline, SkinPalettes *palettes_)
+	: root(root_), palettes(palettes_) {
+	assert(root);
+	assert(palettes);
+
+	//drawables that can be merged, and the bone (index in 'bones') each is bound to:
+	std::vector< std::pair< Scene::Drawable *, uint32_t > > parts;
+	for (auto &drawable : scene.drawables) {
+		Scene::Drawable *d = &drawable;
+		Scene::Drawable::Pipeline const &part = d->pipeline;
+		if (d->occluder || part.set_uniforms || part.type != GL_TRIANGLES) continue;
+		Mesh const *mesh = part.mesh;
+		if (!mesh || !mesh->vertices || mesh->lod_count > 1 || mesh->count == 0) continue;
+		if (part.start != mesh->start || part.count != mesh->count) continue;
+
+		bool same_textures = true;
+		for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+			if (part.textures[i].texture != pipeline.textures[i].texture || part.textures[i].target != pipeline.textures[i].target) same_textures = false;
+		}
+		if (!same_textures) continue;
+
+		Scene::Transform *above = d->transform;
+		while (above && above != root) above = above->parent;
+		if (!above) continue;
+
+		auto f = std::find(bones.begin(), bones.end(), d->transform);
+		if (f == bones.end()) {
+			if (bones.size() == SkinPalettes::MaxBones) continue;
+			bones.emplace_back(d->transform);
+			f = bones.end() - 1;
+		}
+		parts.emplace_back(d, uint32_t(f - bones.begin()));
+	}
+	if (parts.empty()) {
+		throw std::runtime_error("No drawables under transform '" + std::string(root->name) + "' can be merged into a skinned model.");
+	}
+
+	//the current pose is the bind pose, so bind-pose model space is just the root's space:
+	glm::mat4x3 world_to_model = root->make_world_to_local();
+	glm::mat4 model_to_world = glm::mat4(root->make_local_to_world());
+	std::vector< glm::mat4x3 > bone_to_bind;
+	for (Scene::Transform *bone : bones) {
+		bone_to_bind.emplace_back(world_to_model * glm::mat4(bone->make_local_to_world()));
+		bind_to_bone.emplace_back(bone->make_world_to_local() * model_to_world);
+	}
+	bone_min.assign(bones.size(), glm::vec3( std::numeric_limits< float >::infinity()));
+	bone_max.assign(bones.size(), glm::vec3(-std::numeric_limits< float >::infinity()));
+
+	//re-pack every part's vertices (in bind-pose model space), with full weight on the part's bone:
+	std::vector< MeshBuffer::SkinnedVertex > data;
+	for (auto const &[d, b] : parts) {
+		Mesh const &part = *d->pipeline.mesh;
+		glm::mat4x3 const &position_to_object = d->pipeline.position_to_object;
+		glm::mat3 normal_to_bind = glm::inverse(glm::transpose(glm::mat3(bone_to_bind[b])));
+		size_t stride = (part.quantized ? sizeof(MeshBuffer::QuantizedVertex) : sizeof(MeshBuffer::Vertex));
+
+		for (uint32_t v = 0; v < part.count; ++v) {
+			uint8_t const *source = part.vertices + v * stride;
+			MeshBuffer::SkinnedVertex vertex;
+			glm::vec3 position, normal;
+			if (part.quantized) {
+				MeshBuffer::QuantizedVertex const &stored = *reinterpret_cast< MeshBuffer::QuantizedVertex const * >(source);
+				position = position_to_object * glm::vec4(glm::vec3(stored.Position) / 65535.0f, 1.0f);
+				normal = MeshBuffer::decode_normal(stored.Normal);
+				vertex.Color = stored.Color;
+				vertex.TexCoord = glm::vec2(half_to_float(stored.TexCoord.x), half_to_float(stored.TexCoord.y));
+			} else {
+				MeshBuffer::Vertex const &stored = *reinterpret_cast< MeshBuffer::Vertex const * >(source);
+				position = position_to_object * glm::vec4(stored.Position, 1.0f);
+				normal = stored.Normal;
+				vertex.Color = stored.Color;
+				vertex.TexCoord = stored.TexCoord;
+			}
+			bone_min[b] = glm::min(bone_min[b], position);
+			bone_max[b] = glm::max(bone_max[b], position);
+
+			vertex.Position = bone_to_bind[b] * glm::vec4(position, 1.0f);
+			vertex.Normal = glm::normalize(normal_to_bind * normal);
+			vertex.BoneIndices = glm::u8vec4(b, 0, 0, 0);
+			vertex.BoneWeights = glm::u8vec4(255, 0, 0, 0);
+			data.emplace_back(vertex);
+
+			mesh.min = glm::min(mesh.min, vertex.Position);
+			mesh.max = glm::max(mesh.max, vertex.Position);
+		}
+	}
+
+	//(allocated, rather than appended, so the range can be re-used once the model is gone)
+	GeometryPool &pool = skinned_pool();
+	mesh.type = GL_TRIANGLES;
+	mesh.count = GLuint(data.size());
+	mesh.start = pool.allocate(mesh.count);
+	pool.upload(mesh.start, data.data(), mesh.count);
+	mesh.center = 0.5f * (mesh.min + mesh.max);
+	mesh.radius = 0.5f * glm::length(mesh.max - mesh.min);
+
+	slot = uint32_t(palettes->models.size());
+	palettes->models.emplace_back(this);
+
+	drawable = &scene.drawables.emplace_back(root);
+	drawable->pipeline = pipeline;
+	drawable->pipeline.vao = palettes->layout.make_vao_for_program(pipeline.program);
+	drawable->pipeline.type = mesh.type;
+	drawable->pipeline.start = mesh.start;
+	drawable->pipeline.count = mesh.count;
+	drawable->pipeline.position_to_object = mesh.position_to_object;
+	drawable->pipeline.mesh = &mesh;
+	drawable->pipeline.set_uniforms = [this, also = pipeline.set_uniforms]() {
+		palettes->bind(slot);
+		if (also) also();
+	};
+	drawable->dynamic = true;
+
+	for (auto const &[d, b] : parts) {
+		scene.drawables.erase(d);
+	}
+
+	//drawables changed, so bounds trees and GPU culling slots are stale:
+	scene.bounds_built = false;
+	if (scene.gpu_culling) scene.gpu_culling->invalidate();
+}
+
+SkinnedModel::~SkinnedModel() {
+	std::vector< SkinnedModel * > &models = palettes->models;
+	assert(slot < models.size() && models[slot] == this);
+	models.erase(models.begin() + slot);
+	for (uint32_t i = slot; i < models.size(); ++i) {
+		models[i]->slot = i;
+	}
+
+	skinned_pool().release(mesh.start, mesh.count);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+/*
+ * Skinned models draw a whole articulated character -- many parts, each moved by its own transform ("bone") --
+ *  as one drawable, with the vertices of every part in one range of the skinned GeometryPool (see
+ *  MeshBuffer::SkinnedVertex) and a palette of bone matrices that the vertex program blends between
+ *  (see skinned_lit_color_texture_program).
+ *
+ * A SkinnedModel is made from the rigid drawables already in a scene under some root transform:
+ *    SkinnedModel hexapod(scene, body, skinned_lit_color_texture_program_pipeline, &palettes);
+ *  each merged drawable's transform becomes a bone, and its vertices are bound to that bone with full weight.
+ *  (so scene files need no armature data; vertices with several bones would work the same way)
+ *
+ * SkinPalettes keeps the palettes of many models in one uniform buffer, which update() refills -- with one
+ *  upload -- after transforms have moved each frame:
+ *    pose.apply(scene);
+ *    palettes.update();
+ *    scene.update_bounds();
+ *  update() also refits each model's bounds (from boxes around each bone's vertices), so culling follows the pose.
+ *
+ * Bone matrices are also used for normals, so bones should be scaled uniformly.
+ *
+ */
+
+#include "GL.hpp"
+#include "Mesh.hpp"
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct SkinnedModel;
+
+struct SkinPalettes {
+	//needs a current OpenGL context:
+	SkinPalettes();
+	~SkinPalettes();
+
+	//programs read palettes as 'layout(std140) uniform Bones { vec4 BONES[3 * MaxBones]; };' at binding point Binding,
+	// each bone as the three rows of its (model space from bind pose) mat4x3:
+	enum : GLuint {
+		MaxBones = 64,
+		Binding = 0,
+	};
+
+	//compute the palettes and bounds of every model from its bones' transforms, and upload all the palettes:
+	void update();
+
+	//the skinned vertex layout's buffer and attributes (for MeshBuffer::make_vao_for_program()):
+	MeshBuffer layout = MeshBuffer(MeshBuffer::Layout::Skinned);
+
+	//-- internals ---
+	GLuint buffer = 0; //uniform buffer with a palette per model
+	GLsizeiptr slot_size = 0; //bytes per palette (MaxBones bones, rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+	std::vector< SkinnedModel * > models; //(models[i]'s palette is slot i of 'buffer')
+	std::vector< glm::vec4 > rows; //palettes of all models, as uploaded
+
+	//bind the palette of models[slot] (called by models' set_uniforms):
+	void bind(uint32_t slot) const;
+
+	SkinPalettes(SkinPalettes const &) = delete;
+};
+
+struct SkinnedModel {
+	//merge drawables under 'root' (and on it) into one drawable on 'root', drawn with 'pipeline' and a palette from 'palettes':
+	// - drawables qualify if their pipeline.mesh has Mesh::vertices (see MeshBuffer::KeepVertices), is drawn whole as GL_TRIANGLES,
+	//   and has no levels of detail, and they bind the same textures as 'pipeline'; drawables that set_uniforms or are occluders are left alone
+	// - parts on more than MaxBones different transforms are also left alone
+	// - the pose at the time of merging is the bind pose
+	// - merged drawables are removed; the new drawable is dynamic, and is never skipped by potentially visible sets
+	//needs a current OpenGL context; throws if nothing qualifies:
+	SkinnedModel(Scene &scene, Scene::Transform *root, Scene::Drawable::Pipeline const &pipeline, SkinPalettes *palettes);
+	//releases the model's vertices and palette, so erase its drawable (or the scene) first:
+	~SkinnedModel();
+
+	Scene::Transform *root;
+	Scene::Drawable *drawable; //(the merged drawable, in the scene)
+	std::vector< Scene::Transform * > bones; //transform of each palette entry
+
+	//-- internals ---
+	SkinPalettes *palettes;
+	uint32_t slot = 0; //index in palettes->models
+	Mesh mesh; //drawable's mesh (model space; bounds refit by SkinPalettes::update())
+	std::vector< glm::mat4x3 > bind_to_bone; //takes bind-pose model space to each bone's space
+	std::vector< glm::vec3 > bone_min, bone_max; //box around each bone's vertices (bone space)
+
+	SkinnedModel(SkinnedModel const &) = delete;
+};
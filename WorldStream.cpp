@@ -0,0 +1,560 @@
+#include "WorldStream.hpp"
+
+#include "GeometryPool.hpp"
+#include "GPUCulling.hpp"
+#include "asset_stream.hpp"
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+//file layouts (as written by 'cook-cells'; scene and mesh chunks are as read by Scene::load and MeshBuffer):
+namespace {
+	struct CellEntry {
+		glm::vec3 min, max;
+		uint32_t scene_begin, scene_end;
+		uint32_t meshes_begin, meshes_end;
+		uint32_t vertex_bytes;
+	};
+	static_assert(sizeof(CellEntry) == 4*3 + 4*3 + 4*4 + 4, "CellEntry is packed.");
+
+	struct HierarchyEntry {
+		uint32_t parent;
+		uint32_t name_begin;
+		uint32_t name_end;
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+	};
+	static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
+
+	struct MeshEntry {
+		uint32_t transform;
+		uint32_t name_begin;
+		uint32_t name_end;
+	};
+	static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
+
+	struct WorldEntry {
+		glm::mat4x3 local_to_world;
+		uint32_t flags;
+	};
+	static_assert(sizeof(WorldEntry) == 4*12 + 4, "WorldEntry is packed.");
+	enum : uint32_t { WorldStatic = 1 };
+
+	struct BoxEntry {
+		glm::vec3 min, max;
+	};
+	static_assert(sizeof(BoxEntry) == 24, "Box entry should be packed");
+
+	struct IndexEntry {
+		uint32_t name_begin, name_end;
+		uint32_t vertex_begin, vertex_end;
+	};
+	static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+	struct MetaEntry {
+		glm::vec3 min, max;
+		glm::vec3 center; float radius;
+		uint32_t vertex_count, triangle_count;
+		uint64_t hash;
+	};
+	static_assert(sizeof(MetaEntry) == 56, "Meta entry should be packed");
+}
+
+struct WorldStream::CellData {
+	//transforms (names point into 'strings', which the scene keeps while the cell is resident):
+	std::shared_ptr< std::vector< char > const > strings;
+	std::vector< HierarchyEntry > hierarchy;
+	std::vector< bool > hierarchy_static;
+
+	//meshes (vertex ranges relative to the cell's vertices, until the cell is added to the scene):
+	bool quantized = false;
+	size_t stride = 0;
+	std::vector< char > vertices; //(freed once uploaded)
+	std::vector< Mesh > meshes;
+
+	//mesh entries of the scene file, with their meshes and (if the file had them) baked world placements:
+	struct Placement {
+		uint32_t transform;
+		uint32_t mesh;
+		bool baked = false;
+		glm::mat4x3 to_world = glm::mat4x3(1.0f);
+		BoxEntry bounds;
+	};
+	std::vector< Placement > placements;
+};
+
+//read a cell's files (on the background thread; throws on errors):
+static std::unique_ptr< WorldStream::CellData > read_cell(std::string const &scene_file, std::string const &meshes_file) {
+	auto data = std::make_unique< WorldStream::CellData >();
+
+	std::vector< MeshEntry > entries;
+	std::vector< WorldEntry > worlds;
+	std::vector< BoxEntry > mesh_bounds;
+	{ //scene:
+		std::unique_ptr< std::istream > file = asset_stream(scene_file);
+		auto strings = std::make_shared< std::vector< char > >();
+		read_chunk(*file, "str0", strings.get());
+		data->strings = strings;
+		read_chunk(*file, "xfh0", &data->hierarchy);
+		read_chunk(*file, "msh0", &entries);
+		std::vector< char > ignored; //(cells have no cameras or lights)
+		read_chunk(*file, "cam0", &ignored);
+		read_chunk(*file, "lmp0", &ignored);
+		if (peek_chunk_magic(*file) == "xfw0") {
+			read_chunk(*file, "xfw0", &worlds);
+			read_chunk(*file, "mbw0", &mesh_bounds);
+		}
+
+		for (uint32_t i = 0; i < data->hierarchy.size(); ++i) {
+			HierarchyEntry const &h = data->hierarchy[i];
+			if (h.parent != -1U && h.parent >= i) {
+				throw std::runtime_error("cell scene '" + scene_file + "' did not contain transforms in topological-sort order.");
+			}
+			if (!(h.name_begin <= h.name_end && h.name_end <= strings->size())) {
+				throw std::runtime_error("cell scene '" + scene_file + "' contains hierarchy entry with invalid name indices");
+			}
+		}
+		for (auto const &m : entries) {
+			if (m.transform >= data->hierarchy.size() || !(m.name_begin <= m.name_end && m.name_end <= strings->size())) {
+				throw std::runtime_error("cell scene '" + scene_file + "' contains invalid mesh entry");
+			}
+		}
+		if (!worlds.empty() && (worlds.size() != data->hierarchy.size() || mesh_bounds.size() != entries.size())) {
+			throw std::runtime_error("cell scene '" + scene_file + "' has world transforms or bounds that don't match its entries");
+		}
+
+		//transforms named or flagged as static (or under one that is) never move (as in Scene::load):
+		data->hierarchy_static.assign(data->hierarchy.size(), false);
+		for (uint32_t i = 0; i < data->hierarchy.size(); ++i) {
+			HierarchyEntry const &h = data->hierarchy[i];
+			std::string_view name(strings->data() + h.name_begin, h.name_end - h.name_begin);
+			data->hierarchy_static[i] = (!worlds.empty() && (worlds[i].flags & WorldStatic))
+				|| name.substr(0, Scene::StaticPrefix.size()) == Scene::StaticPrefix
+				|| (h.parent != -1U && data->hierarchy_static[h.parent]);
+		}
+	}
+
+	{ //meshes:
+		std::unique_ptr< std::istream > file = asset_stream(meshes_file);
+		data->quantized = (peek_chunk_magic(*file) == "pnq0");
+		data->stride = (data->quantized ? sizeof(MeshBuffer::QuantizedVertex) : sizeof(MeshBuffer::Vertex));
+		read_chunk(*file, (data->quantized ? "pnq0" : "pnct"), &data->vertices);
+		if (data->vertices.size() % data->stride != 0) {
+			throw std::runtime_error("cell meshes '" + meshes_file + "' have a partial vertex");
+		}
+		uint32_t total = uint32_t(data->vertices.size() / data->stride);
+
+		std::vector< char > strings;
+		std::vector< IndexEntry > index;
+		std::vector< BoxEntry > boxes;
+		std::vector< MetaEntry > metadata;
+		read_chunk(*file, "str0", &strings);
+		read_chunk(*file, "idx0", &index);
+		if (data->quantized) {
+			read_chunk(*file, "box0", &boxes);
+			if (boxes.size() != index.size()) throw std::runtime_error("cell meshes '" + meshes_file + "' have wrong number of boxes");
+		}
+		if (peek_chunk_magic(*file) == "met0") {
+			read_chunk(*file, "met0", &metadata);
+			if (metadata.size() != index.size()) throw std::runtime_error("cell meshes '" + meshes_file + "' have wrong number of metadata entries");
+		}
+
+		//(same as MeshBuffer's loader, but without clusters, levels of detail, or copies for queries)
+		std::unordered_map< std::string_view, uint32_t > by_name;
+		data->meshes.reserve(index.size());
+		for (uint32_t i = 0; i < index.size(); ++i) {
+			IndexEntry const &entry = index[i];
+			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+				throw std::runtime_error("cell meshes '" + meshes_file + "' have index entry with out-of-range name begin/end");
+			}
+			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
+				throw std::runtime_error("cell meshes '" + meshes_file + "' have index entry with out-of-range vertex start/count");
+			}
+			Mesh mesh;
+			mesh.type = GL_TRIANGLES;
+			mesh.start = entry.vertex_begin;
+			mesh.count = entry.vertex_end - entry.vertex_begin;
+			mesh.quantized = data->quantized;
+			if (data->quantized) {
+				glm::vec3 size = boxes[i].max - boxes[i].min;
+				mesh.position_to_object = glm::mat4x3(
+					glm::vec3(size.x, 0.0f, 0.0f),
+					glm::vec3(0.0f, size.y, 0.0f),
+					glm::vec3(0.0f, 0.0f, size.z),
+					boxes[i].min
+				);
+			}
+			if (!metadata.empty()) {
+				MetaEntry const &meta = metadata[i];
+				mesh.min = meta.min;
+				mesh.max = meta.max;
+				mesh.center = meta.center;
+				mesh.radius = meta.radius;
+				mesh.hash = meta.hash;
+			} else {
+				if (data->quantized) {
+					mesh.min = boxes[i].min;
+					mesh.max = boxes[i].max;
+				} else {
+					for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+						glm::vec3 const &p = reinterpret_cast< MeshBuffer::Vertex const * >(data->vertices.data())[v].Position;
+						mesh.min = glm::min(mesh.min, p);
+						mesh.max = glm::max(mesh.max, p);
+					}
+				}
+				if (mesh.count != 0) {
+					mesh.center = 0.5f * (mesh.min + mesh.max);
+					mesh.radius = 0.5f * glm::length(mesh.max - mesh.min);
+				}
+			}
+			data->meshes.emplace_back(mesh);
+			by_name.emplace(std::string_view(strings.data() + entry.name_begin, entry.name_end - entry.name_begin), i);
+		}
+
+		data->placements.reserve(entries.size());
+		for (uint32_t m = 0; m < entries.size(); ++m) {
+			MeshEntry const &entry = entries[m];
+			std::string_view name(data->strings->data() + entry.name_begin, entry.name_end - entry.name_begin);
+			auto f = by_name.find(name);
+			if (f == by_name.end()) {
+				throw std::runtime_error("cell scene '" + scene_file + "' uses mesh '" + std::string(name) + "', which is not in '" + meshes_file + "'");
+			}
+			WorldStream::CellData::Placement placement;
+			placement.transform = entry.transform;
+			placement.mesh = f->second;
+			if (!worlds.empty()) {
+				placement.baked = true;
+				placement.to_world = worlds[entry.transform].local_to_world;
+				placement.bounds = mesh_bounds[m];
+			}
+			data->placements.emplace_back(placement);
+		}
+	}
+
+	return data;
+}
+
+//what a cell keeps in memory (besides its vertices) while resident -- its transforms and drawables, and its parsed data:
+static size_t scene_bytes(WorldStream::CellData const &data) {
+	return data.hierarchy.size() * (sizeof(Scene::Transform) + sizeof(HierarchyEntry))
+	     + data.placements.size() * (sizeof(Scene::Drawable) + sizeof(WorldStream::CellData::Placement))
+	     + data.meshes.size() * sizeof(Mesh)
+	     + data.strings->size();
+}
+
+static GeometryPool &pool_for(bool quantized) {
+	if (quantized) return GeometryPool::shared("pnq0", sizeof(MeshBuffer::QuantizedVertex));
+	else return GeometryPool::shared("pnct", sizeof(MeshBuffer::Vertex));
+}
+
+//-------------------------
+
+WorldStream::WorldStream(std::string const &manifest, Scene &scene_,
+	std::function< Scene::Drawable *(Scene &, Scene::Transform *, Mesh const &, MeshBuffer const &) > const &on_drawable_,
+	uint32_t flags_) : scene(scene_), on_drawable(on_drawable_), flags(flags_) {
+
+	std::vector< char > strings;
+	std::vector< CellEntry > entries;
+	{
+		std::unique_ptr< std::istream > file = asset_stream(manifest);
+		read_chunk(*file, "str0", &strings);
+		read_chunk(*file, "cel0", &entries);
+	}
+
+	//cell files are named relative to the manifest:
+	std::string prefix = manifest.substr(0, manifest.find_last_of("/\\") + 1);
+
+	min = glm::vec3( std::numeric_limits< float >::infinity());
+	max = glm::vec3(-std::numeric_limits< float >::infinity());
+	cells.resize(entries.size());
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		CellEntry const &entry = entries[i];
+		if (!(entry.scene_begin <= entry.scene_end && entry.scene_end <= strings.size())
+		 || !(entry.meshes_begin <= entry.meshes_end && entry.meshes_end <= strings.size())) {
+			throw std::runtime_error("cell manifest '" + manifest + "' contains cell entry with invalid name indices");
+		}
+		Cell &cell = cells[i];
+		cell.min = entry.min;
+		cell.max = entry.max;
+		cell.scene_file = prefix + std::string(strings.begin() + entry.scene_begin, strings.begin() + entry.scene_end);
+		cell.meshes_file = prefix + std::string(strings.begin() + entry.meshes_begin, strings.begin() + entry.meshes_end);
+		cell.vertex_bytes = entry.vertex_bytes;
+		min = glm::min(min, cell.min);
+		max = glm::max(max, cell.max);
+	}
+	if (cells.empty()) min = max = glm::vec3(0.0f);
+
+	loader = std::thread(&WorldStream::load_cells, this);
+}
+
+WorldStream::~WorldStream() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	loader.join();
+
+	for (auto &cell : cells) {
+		if (cell.state != Cell::Unloaded && cell.state != Cell::Failed) unload(cell);
+	}
+}
+
+void WorldStream::update(glm::vec3 const &focus) {
+	stats.uploaded_bytes = 0;
+
+	for (auto &cell : cells) {
+		cell.distance = glm::length(focus - glm::clamp(focus, cell.min, cell.max));
+	}
+
+	//cells that should be loaded -- the nearest within load_radius, as many as fit in memory_budget:
+	std::vector< bool > want(cells.size(), false);
+	{
+		std::vector< uint32_t > near;
+		for (uint32_t i = 0; i < cells.size(); ++i) {
+			if (cells[i].state != Cell::Failed && cells[i].distance <= load_radius) near.emplace_back(i);
+		}
+		std::sort(near.begin(), near.end(), [this](uint32_t a, uint32_t b) { return cells[a].distance < cells[b].distance; });
+		size_t bytes = 0;
+		for (uint32_t i : near) {
+			if (bytes + cells[i].bytes() > memory_budget) break;
+			bytes += cells[i].bytes();
+			want[i] = true;
+		}
+	}
+
+	{ //collect cells read by the background thread, and give it the (nearest-last) list of cells to read next:
+		std::unique_lock< std::mutex > lock(mutex);
+		for (auto &[index, data] : done) {
+			Cell &cell = cells[index];
+			assert(cell.state == Cell::Queued);
+			if (data) {
+				cell.scene_bytes = scene_bytes(*data);
+				cell.data = std::move(data);
+				cell.state = Cell::Parsed;
+			} else {
+				cell.state = Cell::Failed;
+				stats.failures += 1;
+			}
+		}
+		done.clear();
+
+		queue.clear();
+		for (uint32_t i = 0; i < cells.size(); ++i) {
+			Cell &cell = cells[i];
+			if (want[i] && cell.state == Cell::Unloaded) cell.state = Cell::Queued;
+			if (cell.state == Cell::Queued && i != loading) {
+				if (want[i]) queue.emplace_back(i);
+				else cell.state = Cell::Unloaded;
+			}
+		}
+		std::sort(queue.begin(), queue.end(), [this](uint32_t a, uint32_t b) { return cells[a].distance > cells[b].distance; });
+		if (!queue.empty()) wake.notify_one();
+	}
+
+	//unload cells that are far away:
+	for (uint32_t i = 0; i < cells.size(); ++i) {
+		Cell &cell = cells[i];
+		bool loaded = (cell.state == Cell::Parsed || cell.state == Cell::Uploading || cell.state == Cell::Resident);
+		if (loaded && !want[i] && cell.distance > evict_radius) unload(cell);
+	}
+	//...and, farthest first, cells that aren't wanted if there isn't room for those that are:
+	// (wanted cells fit in memory_budget by themselves -- unless a cell just read turned out bigger than
+	//  its vertices alone, in which case the next update wants fewer cells)
+	{
+		size_t bytes = 0;
+		std::vector< uint32_t > unwanted;
+		for (uint32_t i = 0; i < cells.size(); ++i) {
+			Cell const &cell = cells[i];
+			if (want[i]) bytes += cell.bytes();
+			else if (cell.state == Cell::Parsed || cell.state == Cell::Uploading || cell.state == Cell::Resident || cell.state == Cell::Queued) {
+				bytes += cell.bytes();
+				if (cell.state != Cell::Queued) unwanted.emplace_back(i); //(queued cells finish loading, then go)
+			}
+		}
+		std::sort(unwanted.begin(), unwanted.end(), [this](uint32_t a, uint32_t b) { return cells[a].distance > cells[b].distance; });
+		for (uint32_t i : unwanted) {
+			if (bytes <= memory_budget) break;
+			bytes -= cells[i].bytes();
+			unload(cells[i]);
+		}
+	}
+
+	//upload (and add to the scene) cells that have been read, nearest first:
+	{
+		std::vector< uint32_t > ready;
+		for (uint32_t i = 0; i < cells.size(); ++i) {
+			if (cells[i].state == Cell::Parsed || cells[i].state == Cell::Uploading) ready.emplace_back(i);
+		}
+		std::sort(ready.begin(), ready.end(), [this](uint32_t a, uint32_t b) { return cells[a].distance < cells[b].distance; });
+		size_t budget = upload_budget;
+		for (uint32_t i : ready) {
+			if (budget == 0) break;
+			upload(cells[i], &budget);
+			if (cells[i].uploaded == cells[i].data->vertices.size()) add_to_scene(cells[i]);
+		}
+	}
+
+	stats.resident = 0;
+	stats.pending = 0;
+	stats.missing = 0;
+	stats.resident_bytes = 0;
+	for (auto const &cell : cells) {
+		if (cell.state == Cell::Resident) stats.resident += 1;
+		else if (cell.state == Cell::Queued || cell.state == Cell::Parsed || cell.state == Cell::Uploading) stats.pending += 1;
+		if (cell.state != Cell::Resident && cell.state != Cell::Failed && cell.distance <= load_radius) stats.missing += 1;
+		if (cell.state == Cell::Parsed || cell.state == Cell::Uploading || cell.state == Cell::Resident) stats.resident_bytes += cell.bytes();
+	}
+	stats.peak_bytes = std::max(stats.peak_bytes, stats.resident_bytes);
+}
+
+MeshBuffer const &WorldStream::layout(bool quantized) {
+	std::unique_ptr< MeshBuffer > &buffer = layouts[quantized ? 1 : 0];
+	if (!buffer) buffer = std::make_unique< MeshBuffer >(quantized ? MeshBuffer::Layout::Quantized : MeshBuffer::Layout::Float);
+	return *buffer;
+}
+
+void WorldStream::upload(Cell &cell, size_t *budget) {
+	CellData &data = *cell.data;
+	if (cell.state == Cell::Parsed) {
+		if (!(flags & Headless)) {
+			cell.count = GLuint(data.vertices.size() / data.stride);
+			cell.first = pool_for(data.quantized).allocate(cell.count);
+		}
+		cell.uploaded = 0;
+		cell.state = Cell::Uploading;
+	}
+
+	//whole vertices, at least one (so a budget smaller than a vertex still makes progress):
+	size_t bytes = std::min(data.vertices.size() - cell.uploaded, std::max(*budget / data.stride, size_t(1)) * data.stride);
+	if (!(flags & Headless) && bytes != 0) {
+		pool_for(data.quantized).upload(cell.first + GLuint(cell.uploaded / data.stride), data.vertices.data() + cell.uploaded, GLuint(bytes / data.stride));
+	}
+	cell.uploaded += bytes;
+	*budget -= std::min(*budget, bytes);
+	stats.uploaded_bytes += bytes;
+}
+
+void WorldStream::add_to_scene(Cell &cell) {
+	CellData &data = *cell.data;
+
+	//meshes are drawn from the cell's range of the pool:
+	for (auto &mesh : data.meshes) {
+		mesh.start += cell.first;
+	}
+
+	scene.name_tables.emplace_back(data.strings);
+	std::vector< char > const &names = *data.strings;
+
+	std::vector< uint32_t > slots;
+	scene.transforms.emplace_back_n(uint32_t(data.hierarchy.size()), &slots);
+	cell.transforms.reserve(data.hierarchy.size());
+	for (uint32_t i = 0; i < data.hierarchy.size(); ++i) {
+		HierarchyEntry const &h = data.hierarchy[i];
+		Scene::Transform *t = scene.transforms.at(slots[i]);
+		t->name = std::string_view(names.data() + h.name_begin, h.name_end - h.name_begin);
+		t->position = h.position;
+		t->rotation = h.rotation;
+		t->scale = h.scale;
+		t->parent = (h.parent == -1U ? nullptr : scene.transforms.at(slots[h.parent]));
+		cell.transforms.emplace_back(scene.transforms.handle(t));
+	}
+
+	scene.drawables.reserve_back(uint32_t(data.placements.size()));
+	for (auto const &placement : data.placements) {
+		Scene::Transform *transform = scene.transforms.at(slots[placement.transform]);
+		Mesh const &mesh = data.meshes[placement.mesh];
+
+		Scene::Drawable *drawable;
+		if (on_drawable && !(flags & Headless)) {
+			drawable = on_drawable(scene, transform, mesh, layout(data.quantized));
+			if (!drawable) continue;
+		} else {
+			drawable = &scene.drawables.emplace_back(transform);
+			drawable->pipeline.type = mesh.type;
+			drawable->pipeline.start = mesh.start;
+			drawable->pipeline.count = mesh.count;
+			drawable->pipeline.position_to_object = mesh.position_to_object;
+			drawable->pipeline.mesh = &mesh;
+		}
+
+		if (data.hierarchy_static[placement.transform]) drawable->dynamic = false;
+		if (placement.baked) {
+			drawable->baked = true;
+			drawable->baked_to_world = placement.to_world;
+			drawable->baked_min = placement.bounds.min;
+			drawable->baked_max = placement.bounds.max;
+		}
+		cell.drawables.emplace_back(scene.drawables.handle(drawable));
+	}
+
+	//vertices are on the GPU now (drawables point to data.meshes, so the rest is kept):
+	std::vector< char >().swap(data.vertices);
+	cell.uploaded = 0;
+
+	cell.state = Cell::Resident;
+	stats.loads += 1;
+
+	//drawables changed, so bounds trees and GPU culling slots are stale:
+	scene.bounds_built = false;
+	if (scene.gpu_culling) scene.gpu_culling->invalidate();
+}
+
+void WorldStream::unload(Cell &cell) {
+	if (cell.state == Cell::Resident) {
+		for (auto const &handle : cell.drawables) {
+			if (Scene::Drawable *drawable = scene.drawables.get(handle)) scene.drawables.erase(drawable);
+		}
+		for (auto const &handle : cell.transforms) {
+			if (Scene::Transform *transform = scene.transforms.get(handle)) scene.transforms.erase(transform);
+		}
+		cell.drawables.clear();
+		cell.transforms.clear();
+
+		auto f = std::find(scene.name_tables.begin(), scene.name_tables.end(), cell.data->strings);
+		if (f != scene.name_tables.end()) scene.name_tables.erase(f);
+
+		scene.bounds_built = false;
+		if (scene.gpu_culling) scene.gpu_culling->invalidate();
+	}
+	if ((cell.state == Cell::Uploading || cell.state == Cell::Resident) && !(flags & Headless)) {
+		pool_for(cell.data->quantized).release(cell.first, cell.count);
+	}
+
+	cell.data.reset();
+	cell.uploaded = 0;
+	cell.first = cell.count = 0;
+	cell.state = Cell::Unloaded;
+	stats.evictions += 1;
+}
+
+void WorldStream::load_cells() {
+	std::unique_lock< std::mutex > lock(mutex);
+	while (true) {
+		wake.wait(lock, [this]() { return quit || !queue.empty(); });
+		if (quit) return;
+
+		uint32_t index = queue.back();
+		queue.pop_back();
+		loading = index;
+		lock.unlock();
+
+		//(file names don't change after construction, so can be read without the lock)
+		std::unique_ptr< CellData > data;
+		try {
+			data = read_cell(cells[index].scene_file, cells[index].meshes_file);
+		} catch (std::exception &e) {
+			std::cerr << "WARNING: failed to read cell '" << cells[index].scene_file << "': " << e.what() << std::endl;
+		}
+
+		lock.lock();
+		loading = -1U;
+		done.emplace_back(index, std::move(data));
+	}
+}
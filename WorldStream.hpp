@@ -0,0 +1,138 @@
+#pragma once
+
+/*
+ * A WorldStream keeps the part of a large world that is near a point of interest (e.g., the
+ *  player's head) loaded in a Scene, so the whole world never needs to fit in memory at once.
+ *
+ * Worlds are split offline by 'cook-cells' into a base scene (load it with Scene::load as usual)
+ *  and "cells" -- small scene and mesh files, each holding the meshes whose bounds center in one box
+ *  of a grid -- listed, with their bounds, in a manifest ('.cells').
+ *
+ * Every update(focus):
+ *  - cells within load_radius of focus are read and parsed, nearest first, on a background thread
+ *  - parsed cells' vertices are copied into the shared GeometryPool (see GeometryPool::allocate),
+ *    at most upload_budget bytes per update, so no frame stalls on a big cell
+ *  - once all its vertices are uploaded, a cell's transforms and drawables are added to the scene
+ *  - cells farther than evict_radius (or, farthest first, any beyond what fits in memory_budget) are
+ *    removed, and their vertex ranges released for re-use
+ *
+ * Streamed drawables come and go from Scene::drawables, so the scene's bounds trees are rebuilt by the
+ *  next update_bounds() after a change. Streamed transforms aren't added to the name index (call
+ *  Scene::index_names() if you need to find them by name quickly).
+ *
+ * Cells are placed exactly as in the original scene (they don't move), and only carry meshes:
+ *  cameras, lights, and prefab instances all stay in the base scene.
+ *
+ */
+
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct WorldStream {
+	//flags for the constructor:
+	enum : uint32_t {
+		Headless = 1, //don't use OpenGL (vertices are parsed and counted, but not uploaded; for benchmarks and tools)
+	};
+
+	//'on_drawable' makes the drawable for a mesh placed at a transform in a cell, and returns it (or nullptr if it made none):
+	// (use layout.make_vao_for_program() for the vertex array; if on_drawable is not set -- or in Headless mode --
+	//  a drawable with only its vertex range and pipeline.mesh set is made instead)
+	// (the stream removes the returned drawable when the cell goes, so don't make others)
+	WorldStream(std::string const &manifest, Scene &scene,
+		std::function< Scene::Drawable *(Scene &, Scene::Transform *, Mesh const &, MeshBuffer const &layout) > const &on_drawable = nullptr,
+		uint32_t flags = 0);
+	~WorldStream(); //(stops the background thread and removes all cells from the scene, so destroy the stream before the scene)
+
+	//distance (from focus to a cell's bounds) within which cells are loaded:
+	float load_radius = 64.0f;
+	//distance beyond which cells are unloaded (larger than load_radius, so cells at the edge don't flicker in and out):
+	float evict_radius = 96.0f;
+	//vertex bytes copied to the GPU per update:
+	size_t upload_budget = size_t(4) << 20;
+	//bytes of cells loaded (or being loaded) at once -- their vertices, plus what they keep in the scene
+	// (transforms, drawables, names, and meshes; only known once a cell has been read, so counted from then on):
+	size_t memory_budget = size_t(256) << 20;
+
+	//load, upload, add, and remove cells around 'focus' (call once per frame, before drawing):
+	void update(glm::vec3 const &focus);
+
+	struct Stats {
+		uint32_t resident = 0; //cells in the scene
+		uint32_t pending = 0; //cells being read, parsed, or uploaded
+		uint32_t missing = 0; //cells within load_radius that weren't in the scene after the latest update
+		size_t resident_bytes = 0; //bytes (as counted for memory_budget) of cells in the scene or pending
+		size_t peak_bytes = 0; //most resident_bytes ever
+		size_t uploaded_bytes = 0; //vertex bytes uploaded in the latest update
+		uint32_t loads = 0; //cells added to the scene (in total)
+		uint32_t evictions = 0; //cells removed from the scene or dropped while pending (in total)
+		uint32_t failures = 0; //cells that couldn't be read (in total; a warning is printed for each)
+	} stats;
+
+	//bounds of all cells (from the manifest):
+	glm::vec3 min = glm::vec3(0.0f), max = glm::vec3(0.0f);
+	size_t cell_count() const { return cells.size(); }
+
+	//-- internals ---
+	Scene &scene;
+	std::function< Scene::Drawable *(Scene &, Scene::Transform *, Mesh const &, MeshBuffer const &) > on_drawable;
+	uint32_t flags;
+
+	//a cell's contents, as read by the background thread:
+	struct CellData;
+
+	struct Cell {
+		glm::vec3 min, max; //bounds of the cell's meshes
+		std::string scene_file, meshes_file;
+		size_t vertex_bytes = 0;
+		size_t scene_bytes = 0; //transforms, drawables, and parsed data kept while resident (0 until first read)
+		size_t bytes() const { return vertex_bytes + scene_bytes; }
+
+		enum State {
+			Unloaded,
+			Queued, //waiting for (or being read by) the background thread
+			Parsed, //read, with vertices waiting for upload
+			Uploading, //vertex range allocated, partly uploaded
+			Resident, //in the scene
+			Failed, //couldn't be read (never retried)
+		} state = Unloaded;
+		float distance = 0.0f; //from focus, as of the latest update
+
+		std::unique_ptr< CellData > data;
+		size_t uploaded = 0; //vertex bytes uploaded so far
+		GLuint first = 0, count = 0; //vertex range in the pool (while Uploading or Resident; not in Headless mode)
+
+		//what the cell added to the scene (while Resident):
+		std::vector< Pool< Scene::Transform >::Handle > transforms;
+		std::vector< Pool< Scene::Drawable >::Handle > drawables;
+	};
+	std::vector< Cell > cells;
+
+	//vertex layouts of the shared geometry pools (made when first needed; not in Headless mode):
+	std::unique_ptr< MeshBuffer > layouts[2]; //float, quantized
+	MeshBuffer const &layout(bool quantized);
+
+	void upload(Cell &cell, size_t *budget);
+	void add_to_scene(Cell &cell);
+	void unload(Cell &cell);
+
+	//background thread -- reads cells listed in 'queue' (nearest last) and posts them to 'done':
+	std::thread loader;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool quit = false;
+	std::vector< uint32_t > queue;
+	uint32_t loading = -1U; //cell being read right now
+	std::vector< std::pair< uint32_t, std::unique_ptr< CellData > > > done; //(nullptr data if reading failed)
+	void load_cells();
+
+	WorldStream(WorldStream const &) = delete;
+};
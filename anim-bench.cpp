@@ -0,0 +1,197 @@
+//anim-bench: times sampling and blending of animation clips (see Animation.hpp) on many transforms
+//
+// Usage:
+//   anim-bench [--transforms N] [--clips N] [--keys N] [--frames N] [--check]
+//
+//  --transforms N  animated transforms (default 4096), in chains of eight, like limbs
+//  --clips N       clips blended each frame (default 2), each with a track for every transform
+//  --keys N        keys per track (default 90; clips are 30 keys per second)
+//  --frames N      number of frames to time (default 1000)
+//  --check         compare every frame's result against plain per-transform glm::mix / glm::slerp
+//
+// Reports the average and worst time of a frame's AnimationPose::clear(), add() of every clip, and apply(),
+//  and the same for the per-transform glm version for comparison.
+//
+// Does not need an OpenGL context.
+
+#include "Animation.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+	bool usage = false;
+	uint32_t transform_count = 4096;
+	uint32_t clip_count = 2;
+	uint32_t key_count = 90;
+	uint32_t frames = 1000;
+	bool check = false;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--transforms" && argi + 1 < argc) {
+			argi += 1;
+			transform_count = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--clips" && argi + 1 < argc) {
+			argi += 1;
+			clip_count = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--keys" && argi + 1 < argc) {
+			argi += 1;
+			key_count = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--frames" && argi + 1 < argc) {
+			argi += 1;
+			frames = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--check") {
+			check = true;
+		} else {
+			std::cerr << "Unknown option '" << arg << "'." << std::endl;
+			usage = true;
+		}
+	}
+	if (usage) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--transforms N] [--clips N] [--keys N] [--frames N] [--check]" << std::endl;
+		return 1;
+	}
+
+	constexpr float FrameRate = 30.0f;
+	constexpr float Elapsed = 1.0f / 72.0f;
+	std::mt19937 mt(0x1234);
+	std::uniform_real_distribution< float > unit(0.0f, 1.0f);
+
+	//transforms in chains of eight:
+	Scene scene;
+	std::vector< uint32_t > targets;
+	scene.transforms.emplace_back_n(transform_count, &targets);
+	for (uint32_t i = 0; i < transform_count; ++i) {
+		Scene::Transform *t = scene.transforms.at(targets[i]);
+		t->parent = (i % 8 == 0 ? nullptr : scene.transforms.at(targets[i - 1]));
+	}
+
+	//clips of smooth random swinging (with some keys in the other hemisphere, as exporters sometimes write):
+	std::vector< std::shared_ptr< AnimationClip > > clips;
+	for (uint32_t c = 0; c < clip_count; ++c) {
+		clips.emplace_back(std::make_shared< AnimationClip >("clip" + std::to_string(c), FrameRate, key_count, targets));
+		AnimationClip &clip = *clips.back();
+		for (uint32_t t = 0; t < transform_count; ++t) {
+			glm::vec3 axis = glm::normalize(glm::vec3(unit(mt), unit(mt), unit(mt)) - 0.5f + glm::vec3(0.0f, 0.0f, 0.01f));
+			float amplitude = glm::radians(10.0f + 50.0f * unit(mt));
+			float phase = 2.0f * float(M_PI) * unit(mt);
+			glm::vec3 offset = glm::vec3(0.0f, 0.0f, 1.0f) + 0.1f * glm::vec3(unit(mt), unit(mt), unit(mt));
+			for (uint32_t f = 0; f < key_count; ++f) {
+				float angle = amplitude * std::sin(phase + 2.0f * float(M_PI) * f / float(std::max(1U, key_count - 1)));
+				glm::quat rotation = glm::angleAxis(angle, axis);
+				if (unit(mt) < 0.1f) rotation = -rotation;
+				clip.set_key(f, t, offset, rotation, glm::vec3(1.0f + 0.1f * std::sin(angle)));
+			}
+		}
+	}
+
+	std::cout << "Blending " << clip_count << " clips of " << key_count << " keys on " << transform_count << " transforms." << std::endl;
+
+	//the same blend, one transform at a time with glm:
+	auto reference = [&](float time, std::vector< float > const &weights, std::vector< glm::vec3 > *positions, std::vector< glm::quat > *rotations, std::vector< glm::vec3 > *scales) {
+		positions->assign(transform_count, glm::vec3(0.0f));
+		rotations->assign(transform_count, glm::quat(0.0f, 0.0f, 0.0f, 0.0f));
+		scales->assign(transform_count, glm::vec3(0.0f));
+		float total = 0.0f;
+		for (uint32_t c = 0; c < clip_count; ++c) {
+			AnimationClip const &clip = *clips[c];
+			float local = (clip.duration() > 0.0f ? std::fmod(time, clip.duration()) : 0.0f);
+			float at = local * clip.frame_rate;
+			uint32_t f0 = std::min(uint32_t(at), clip.frame_count - 1);
+			uint32_t f1 = std::min(f0 + 1, clip.frame_count - 1);
+			float amt = at - float(f0);
+			auto component = [&](uint32_t f, uint32_t comp, uint32_t t) {
+				return clip.keys[(size_t(f) * AnimationClip::Components + comp) * clip.stride + t];
+			};
+			for (uint32_t t = 0; t < transform_count; ++t) {
+				glm::vec3 p0(component(f0, 0, t), component(f0, 1, t), component(f0, 2, t));
+				glm::vec3 p1(component(f1, 0, t), component(f1, 1, t), component(f1, 2, t));
+				glm::quat q0(component(f0, 6, t), component(f0, 3, t), component(f0, 4, t), component(f0, 5, t));
+				glm::quat q1(component(f1, 6, t), component(f1, 3, t), component(f1, 4, t), component(f1, 5, t));
+				glm::vec3 s0(component(f0, 7, t), component(f0, 8, t), component(f0, 9, t));
+				glm::vec3 s1(component(f1, 7, t), component(f1, 8, t), component(f1, 9, t));
+				glm::quat q = glm::slerp(q0, q1, amt); //(takes the short way around)
+				if (glm::dot((*rotations)[t], q) < 0.0f) q = -q;
+				(*positions)[t] += weights[c] * glm::mix(p0, p1, amt);
+				(*rotations)[t] = (*rotations)[t] + weights[c] * q;
+				(*scales)[t] += weights[c] * glm::mix(s0, s1, amt);
+			}
+			total += weights[c];
+		}
+		for (uint32_t t = 0; t < transform_count; ++t) {
+			(*positions)[t] /= total;
+			(*rotations)[t] = glm::normalize((*rotations)[t]);
+			(*scales)[t] /= total;
+		}
+	};
+
+	AnimationPose pose(targets);
+	std::vector< float > weights(clip_count);
+	std::vector< glm::vec3 > positions, scales;
+	std::vector< glm::quat > rotations;
+
+	double total_ms = 0.0, worst_ms = 0.0;
+	double total_reference_ms = 0.0, worst_reference_ms = 0.0;
+	float worst_error = 0.0f;
+
+	for (uint32_t frame = 0; frame < frames; ++frame) {
+		float time = frame * Elapsed;
+		for (uint32_t c = 0; c < clip_count; ++c) {
+			weights[c] = 1.0f + 0.5f * std::sin(time + c);
+		}
+
+		auto before = std::chrono::high_resolution_clock::now();
+		pose.clear();
+		for (uint32_t c = 0; c < clip_count; ++c) {
+			pose.add(*clips[c], time, weights[c]);
+		}
+		pose.apply(scene);
+		auto after = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration< double, std::milli >(after - before).count();
+		total_ms += ms;
+		worst_ms = std::max(worst_ms, ms);
+
+		before = std::chrono::high_resolution_clock::now();
+		reference(time, weights, &positions, &rotations, &scales);
+		after = std::chrono::high_resolution_clock::now();
+		ms = std::chrono::duration< double, std::milli >(after - before).count();
+		total_reference_ms += ms;
+		worst_reference_ms = std::max(worst_reference_ms, ms);
+
+		if (check) {
+			for (uint32_t t = 0; t < transform_count; ++t) {
+				Scene::Transform const &transform = *scene.transforms.at(targets[t]);
+				worst_error = std::max(worst_error, glm::length(transform.position - positions[t]));
+				worst_error = std::max(worst_error, 1.0f - std::abs(glm::dot(transform.rotation, rotations[t])));
+				worst_error = std::max(worst_error, glm::length(transform.scale - scales[t]));
+			}
+		}
+	}
+
+	std::cout << "Over " << frames << " frames:\n"
+		<< "  AnimationPose: " << total_ms / frames << " ms average, " << worst_ms << " ms worst\n"
+		<< "  (per-transform glm: " << total_reference_ms / frames << " ms average, " << worst_reference_ms << " ms worst)" << std::endl;
+
+	if (check) {
+		//(nlerp and slerp differ slightly between keys, so allow a little)
+		constexpr float Tolerance = 1e-3f;
+		std::cout << "  largest difference from glm: " << worst_error << std::endl;
+		if (!(worst_error <= Tolerance)) {
+			std::cerr << "Results differ from glm by more than " << Tolerance << "." << std::endl;
+			return 1;
+		}
+		std::cout << "All frames match." << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,618 @@
+//bake-pvs: offline potentially-visible-set baking for static scenes
+//
+// Usage:
+//   bake-pvs [--cell S] [--samples N] [--resolution R] <in.scene> <in.pnct> <out.scene>
+//
+//  --cell S        size of (cubical) view cells (default: 16 cells along the scene's longest side)
+//  --samples N     eye positions sampled in each cell (default 8; spread over the cell's octants)
+//  --resolution R  size of each face of the cube map rendered at each sample (default 128)
+//
+// Divides the scene's bounds into a grid of view cells and, for each empty cell, finds
+//  which mesh entries (drawables) can be seen from it by rendering object ids around
+//  sample points. Writes a copy of the scene with 'pvg0' (grid), 'pvc0' (set index per cell)
+//  and 'pvs0' (one bit per mesh entry per set) chunks added before any other extra chunks;
+//  Scene::draw skips static drawables that aren't in the set of the eye's cell.
+//  (meshes in prefabs -- chunk 'pfb0' -- are left out: they neither hide nor get skipped)
+//
+// Cells that triangles pass through (where an eye would be inside a wall) get no set,
+//  so nothing is skipped there. Meshes with bounds overlapping a cell are always in its set.
+//
+// Visibility is sampled, so objects seen only through gaps smaller than a pixel (or
+//  only from between sample points) may be missed; raise --samples and --resolution for
+//  scenes with small openings.
+//
+// Does not need an OpenGL context.
+
+#include "read_write_chunk.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+//------------ file data (layouts match those read by Scene and MeshBuffer) ------------
+
+struct HierarchyEntry {
+	uint32_t parent;
+	uint32_t name_begin;
+	uint32_t name_end;
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
+
+struct MeshEntry {
+	uint32_t transform;
+	uint32_t name_begin;
+	uint32_t name_end;
+};
+static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
+
+struct PrefabEntry {
+	uint32_t name_begin;
+	uint32_t name_end;
+	uint32_t xfh_begin, xfh_end;
+};
+static_assert(sizeof(PrefabEntry) == 4 + 4 + 4 + 4, "PrefabEntry is packed.");
+
+struct GridEntry {
+	glm::vec3 min;
+	float cell_size;
+	glm::uvec3 size;
+	uint32_t mesh_count;
+};
+static_assert(sizeof(GridEntry) == 4*3 + 4 + 4*3 + 4, "GridEntry is packed.");
+
+struct Vertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::u8vec4 Color;
+	glm::vec2 TexCoord;
+};
+static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+
+struct QuantizedVertex {
+	glm::u16vec3 Position;
+	uint16_t _pad = 0;
+	glm::i16vec2 Normal;
+	glm::u8vec4 Color;
+	glm::u16vec2 TexCoord;
+};
+static_assert(sizeof(QuantizedVertex) == 3*2+2+2*2+4*1+2*2, "QuantizedVertex is packed.");
+
+struct IndexEntry {
+	uint32_t name_begin, name_end;
+	uint32_t vertex_begin, vertex_end;
+};
+static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+struct BoxEntry {
+	glm::vec3 min, max;
+};
+static_assert(sizeof(BoxEntry) == 24, "Box entry should be packed");
+
+//a chunk passed through unchanged:
+struct RawChunk {
+	std::string magic;
+	std::vector< char > data;
+};
+
+struct SceneFile {
+	std::vector< char > strings;
+	std::vector< HierarchyEntry > hierarchy;
+	std::vector< MeshEntry > meshes;
+	std::vector< char > cameras; //(passed through)
+	std::vector< char > lights; //(passed through)
+	std::vector< PrefabEntry > prefabs; //(passed through; meshes of prefabs are skipped)
+	std::vector< char > instances; //(passed through)
+	std::vector< char > worlds; //(passed through)
+	std::vector< char > mesh_bounds; //(passed through)
+	std::vector< RawChunk > extra; //chunks after 'lmp0', except earlier potentially visible sets
+};
+
+static SceneFile read_scene_file(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "' for reading.");
+
+	SceneFile ret;
+	read_chunk(file, "str0", &ret.strings);
+	read_chunk(file, "xfh0", &ret.hierarchy);
+	read_chunk(file, "msh0", &ret.meshes);
+	read_chunk(file, "cam0", &ret.cameras);
+	read_chunk(file, "lmp0", &ret.lights);
+	if (peek_chunk_magic(file) == "pfb0") {
+		read_chunk(file, "pfb0", &ret.prefabs);
+		read_chunk(file, "ins0", &ret.instances);
+	}
+	if (peek_chunk_magic(file) == "xfw0") {
+		read_chunk(file, "xfw0", &ret.worlds);
+		read_chunk(file, "mbw0", &ret.mesh_bounds);
+	}
+	while (true) {
+		std::string magic = peek_chunk_magic(file);
+		if (magic == "") break;
+		RawChunk chunk;
+		chunk.magic = magic;
+		read_chunk(file, magic, &chunk.data);
+		if (magic == "pvg0" || magic == "pvc0" || magic == "pvs0") continue;
+		ret.extra.emplace_back(std::move(chunk));
+	}
+
+	for (uint32_t i = 0; i < ret.hierarchy.size(); ++i) {
+		HierarchyEntry const &h = ret.hierarchy[i];
+		if (h.parent != -1U && h.parent >= i) {
+			throw std::runtime_error("scene file '" + filename + "' did not contain transforms in topological-sort order.");
+		}
+	}
+	for (auto const &p : ret.prefabs) {
+		if (!(p.xfh_begin <= p.xfh_end && p.xfh_end <= ret.hierarchy.size())) {
+			throw std::runtime_error("scene file '" + filename + "' contains prefab entry with invalid hierarchy range");
+		}
+	}
+	for (auto const &m : ret.meshes) {
+		if (m.transform >= ret.hierarchy.size()) {
+			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid transform index (" + std::to_string(m.transform) + ")");
+		}
+		if (!(m.name_begin <= m.name_end && m.name_end <= ret.strings.size())) {
+			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid name indices");
+		}
+	}
+	return ret;
+}
+
+//object-space triangle positions of each mesh in a .pnct file, by name:
+static std::map< std::string, std::vector< glm::vec3 > > read_mesh_positions(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "' for reading.");
+
+	bool quantized = (peek_chunk_magic(file) == "pnq0");
+	std::vector< Vertex > vertices;
+	std::vector< QuantizedVertex > quantized_vertices;
+	if (quantized) read_chunk(file, "pnq0", &quantized_vertices);
+	else read_chunk(file, "pnct", &vertices);
+	size_t vertex_count = (quantized ? quantized_vertices.size() : vertices.size());
+
+	std::vector< char > strings;
+	read_chunk(file, "str0", &strings);
+	std::vector< IndexEntry > index;
+	read_chunk(file, "idx0", &index);
+	std::vector< BoxEntry > boxes;
+	if (quantized) {
+		read_chunk(file, "box0", &boxes);
+		if (boxes.size() != index.size()) {
+			throw std::runtime_error("box chunk has " + std::to_string(boxes.size()) + " entries but index has " + std::to_string(index.size()));
+		}
+	}
+	//(metadata, clusters, and levels of detail aren't needed)
+
+	std::map< std::string, std::vector< glm::vec3 > > ret;
+	for (uint32_t i = 0; i < index.size(); ++i) {
+		IndexEntry const &entry = index[i];
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+			throw std::runtime_error("index entry has out-of-range name begin/end");
+		}
+		if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= vertex_count)) {
+			throw std::runtime_error("index entry has out-of-range vertex start/count");
+		}
+		std::vector< glm::vec3 > &positions = ret[std::string(strings.data() + entry.name_begin, strings.data() + entry.name_end)];
+		positions.clear();
+		for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+			if (quantized) {
+				positions.emplace_back(boxes[i].min + (boxes[i].max - boxes[i].min) * (glm::vec3(quantized_vertices[v].Position) / 65535.0f));
+			} else {
+				positions.emplace_back(vertices[v].Position);
+			}
+		}
+		positions.resize(positions.size() / 3 * 3);
+	}
+	return ret;
+}
+
+//------------ geometry ------------
+
+struct Triangle {
+	glm::vec3 a, b, c;
+	uint32_t mesh; //index of the mesh entry
+};
+
+//does the triangle overlap the box? (separating axis test, after Akenine-Möller)
+static bool triangle_overlaps_box(Triangle const &tri, glm::vec3 const &center, glm::vec3 const &half) {
+	glm::vec3 v[3] = {tri.a - center, tri.b - center, tri.c - center};
+
+	//box axes:
+	for (uint32_t c = 0; c < 3; ++c) {
+		float lo = std::min(v[0][c], std::min(v[1][c], v[2][c]));
+		float hi = std::max(v[0][c], std::max(v[1][c], v[2][c]));
+		if (lo > half[c] || hi < -half[c]) return false;
+	}
+
+	//triangle normal:
+	glm::vec3 e[3] = {v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+	glm::vec3 n = glm::cross(e[0], e[1]);
+	float r = glm::dot(half, glm::abs(n));
+	if (std::abs(glm::dot(n, v[0])) > r) return false;
+
+	//cross products of edges and box axes:
+	for (uint32_t i = 0; i < 3; ++i) {
+		for (uint32_t c = 0; c < 3; ++c) {
+			glm::vec3 axis = glm::vec3(0.0f);
+			axis[c] = 1.0f;
+			axis = glm::cross(axis, e[i]);
+			float p0 = glm::dot(axis, v[0]), p1 = glm::dot(axis, v[1]), p2 = glm::dot(axis, v[2]);
+			float radius = glm::dot(half, glm::abs(axis));
+			if (std::min(p0, std::min(p1, p2)) > radius || std::max(p0, std::max(p1, p2)) < -radius) return false;
+		}
+	}
+	return true;
+}
+
+//renders mesh ids into the faces of a cube map around a point:
+struct IdCube {
+	IdCube(uint32_t resolution_) : resolution(resolution_), depth(resolution * resolution), ids(resolution * resolution) { }
+
+	uint32_t resolution;
+	std::vector< float > depth; //1 / distance along the face's axis (0 is infinitely far)
+	std::vector< uint32_t > ids; //mesh entry (or -1U for nothing)
+
+	//mark meshes seen (in any face) from 'eye':
+	void render(glm::vec3 const &eye, float near, std::vector< Triangle > const &triangles, std::vector< uint32_t > *seen) {
+		//corners relative to the eye (shared by all faces):
+		relative.resize(triangles.size());
+		for (uint32_t t = 0; t < triangles.size(); ++t) {
+			relative[t] = {triangles[t].a - eye, triangles[t].b - eye, triangles[t].c - eye};
+		}
+
+		//each face's right, up, and forward axes (as +/- world axis 1, 2, or 3):
+		static int const faces[6][3] = {
+			{-3, 2, 1}, {3, 2,-1},
+			{1,-3, 2}, {1, 3,-2},
+			{1, 2, 3}, {-1, 2,-3},
+		};
+		for (auto const &face : faces) {
+			std::fill(depth.begin(), depth.end(), 0.0f);
+			std::fill(ids.begin(), ids.end(), -1U);
+			for (uint32_t t = 0; t < triangles.size(); ++t) {
+				//(right, up, forward) coordinates of the corners:
+				std::array< glm::vec3, 3 > local;
+				for (uint32_t k = 0; k < 3; ++k) {
+					for (uint32_t c = 0; c < 3; ++c) {
+						float v = relative[t][k][std::abs(face[c]) - 1];
+						local[k][c] = (face[c] < 0 ? -v : v);
+					}
+				}
+				if (local[0].z < near && local[1].z < near && local[2].z < near) continue;
+				//skip triangles entirely outside one side of the (90 degree) view:
+				bool outside = false;
+				for (uint32_t c = 0; c < 2 && !outside; ++c) {
+					outside = (local[0][c] > local[0].z && local[1][c] > local[1].z && local[2][c] > local[2].z)
+					       || (local[0][c] < -local[0].z && local[1][c] < -local[1].z && local[2][c] < -local[2].z);
+				}
+				if (outside) continue;
+				draw(local, near, triangles[t].mesh);
+			}
+			for (uint32_t id : ids) {
+				if (id != -1U) (*seen)[id / 32] |= (1u << (id % 32));
+			}
+		}
+	}
+
+	std::vector< std::array< glm::vec3, 3 > > relative; //(scratch space for render())
+
+	void draw(std::array< glm::vec3, 3 > const &local, float near, uint32_t id) {
+		//clip to the near plane (Sutherland-Hodgman), which leaves at most four corners:
+		std::array< glm::vec3, 4 > poly;
+		uint32_t count = 0;
+		for (uint32_t k = 0; k < 3; ++k) {
+			glm::vec3 const &a = local[k];
+			glm::vec3 const &b = local[(k + 1) % 3];
+			if (a.z >= near) poly[count++] = a;
+			if ((a.z >= near) != (b.z >= near)) {
+				float t = (near - a.z) / (b.z - a.z);
+				poly[count++] = glm::mix(a, b, t);
+			}
+		}
+		if (count < 3) return;
+
+		//project to pixels, keeping 1 / z for depth:
+		float const half = 0.5f * float(resolution);
+		std::array< glm::vec3, 4 > s;
+		for (uint32_t k = 0; k < count; ++k) {
+			float inv_z = 1.0f / poly[k].z;
+			s[k] = glm::vec3((poly[k].x * inv_z + 1.0f) * half, (poly[k].y * inv_z + 1.0f) * half, inv_z);
+		}
+		for (uint32_t k = 1; k + 1 < count; ++k) {
+			draw_triangle(s[0], s[k], s[k+1], id);
+		}
+	}
+
+	void draw_triangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, uint32_t id) {
+		float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+		if (!(std::abs(area) > 1e-8f)) return;
+		if (area < 0.0f) {
+			std::swap(b, c);
+			area = -area;
+		}
+		glm::vec2 min = glm::min(glm::vec2(a), glm::min(glm::vec2(b), glm::vec2(c)));
+		glm::vec2 max = glm::max(glm::vec2(a), glm::max(glm::vec2(b), glm::vec2(c)));
+		min = glm::max(glm::ceil(min - 0.5f), glm::vec2(0.0f));
+		max = glm::min(glm::floor(max - 0.5f), glm::vec2(float(resolution - 1)));
+		if (min.x > max.x || min.y > max.y) return;
+
+		glm::vec3 const *s[3] = {&a, &b, &c};
+		float A[3], B[3], C[3];
+		float Az = 0.0f, Bz = 0.0f, Cz = 0.0f;
+		for (uint32_t k = 0; k < 3; ++k) {
+			glm::vec3 const &p = *s[(k + 1) % 3];
+			glm::vec3 const &q = *s[(k + 2) % 3];
+			A[k] = p.y - q.y;
+			B[k] = q.x - p.x;
+			C[k] = p.x * q.y - p.y * q.x;
+			Az += A[k] * s[k]->z;
+			Bz += B[k] * s[k]->z;
+			Cz += C[k] * s[k]->z;
+		}
+		for (uint32_t y = uint32_t(min.y); y <= uint32_t(max.y); ++y) {
+			float py = float(y) + 0.5f;
+			for (uint32_t x = uint32_t(min.x); x <= uint32_t(max.x); ++x) {
+				float px = float(x) + 0.5f;
+				if (A[0] * px + B[0] * py + C[0] < 0.0f) continue;
+				if (A[1] * px + B[1] * py + C[1] < 0.0f) continue;
+				if (A[2] * px + B[2] * py + C[2] < 0.0f) continue;
+				float z = (Az * px + Bz * py + Cz) / area;
+				uint32_t i = y * resolution + x;
+				if (z > depth[i]) {
+					depth[i] = z;
+					ids[i] = id;
+				}
+			}
+		}
+	}
+};
+
+//------------ main ------------
+
+int main(int argc, char **argv) {
+	bool usage = false;
+	float cell_size = 0.0f;
+	uint32_t samples = 8;
+	uint32_t resolution = 128;
+	std::vector< std::string > files;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--cell" && argi + 1 < argc) {
+			argi += 1;
+			cell_size = float(std::atof(argv[argi]));
+			if (!(cell_size > 0.0f)) usage = true;
+		} else if (arg == "--samples" && argi + 1 < argc) {
+			argi += 1;
+			samples = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--resolution" && argi + 1 < argc) {
+			argi += 1;
+			resolution = uint32_t(std::max(8, std::atoi(argv[argi])));
+		} else if (arg.size() >= 2 && arg.substr(0,2) == "--") {
+			std::cerr << "Unknown option '" << arg << "'." << std::endl;
+			usage = true;
+		} else {
+			files.emplace_back(arg);
+		}
+	}
+	if (files.size() != 3) usage = true;
+
+	if (usage) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--cell S] [--samples N] [--resolution R] <in.scene> <in.pnct> <out.scene>" << std::endl;
+		return 1;
+	}
+
+	try {
+		SceneFile scene = read_scene_file(files[0]);
+		std::map< std::string, std::vector< glm::vec3 > > mesh_positions = read_mesh_positions(files[1]);
+
+		//world-space transforms (same math as Scene::Transform::make_local_to_world):
+		std::vector< glm::mat4 > local_to_world;
+		local_to_world.reserve(scene.hierarchy.size());
+		for (auto const &h : scene.hierarchy) {
+			glm::mat3 rot = glm::mat3_cast(h.rotation);
+			glm::mat4 local_to_parent = glm::mat4(
+				glm::vec4(rot[0] * h.scale.x, 0.0f),
+				glm::vec4(rot[1] * h.scale.y, 0.0f),
+				glm::vec4(rot[2] * h.scale.z, 0.0f),
+				glm::vec4(h.position, 1.0f)
+			);
+			local_to_world.emplace_back(h.parent == -1U ? local_to_parent : local_to_world[h.parent] * local_to_parent);
+		}
+
+		//world-space triangles and bounds of every mesh entry:
+		uint32_t const mesh_count = uint32_t(scene.meshes.size());
+		uint32_t const words = (mesh_count + 31) / 32;
+		std::vector< Triangle > triangles;
+		std::vector< BoxEntry > bounds(mesh_count, BoxEntry{glm::vec3(std::numeric_limits< float >::infinity()), glm::vec3(-std::numeric_limits< float >::infinity())});
+		std::vector< uint32_t > always(words, 0); //meshes with no geometry to test (always visible)
+		glm::vec3 scene_min = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 scene_max = glm::vec3(-std::numeric_limits< float >::infinity());
+		//(meshes in prefabs are placed at instances when loaded, and never skipped, so they are left out)
+		std::vector< bool > in_prefab(scene.hierarchy.size(), false);
+		for (auto const &p : scene.prefabs) {
+			std::fill(in_prefab.begin() + p.xfh_begin, in_prefab.begin() + p.xfh_end, true);
+		}
+		for (uint32_t m = 0; m < mesh_count; ++m) {
+			MeshEntry const &entry = scene.meshes[m];
+			if (in_prefab[entry.transform]) continue;
+			std::string name(scene.strings.data() + entry.name_begin, scene.strings.data() + entry.name_end);
+			auto f = mesh_positions.find(name);
+			if (f == mesh_positions.end() || f->second.empty()) {
+				std::cerr << "WARNING: no triangles for mesh '" << name << "'; it will always be visible." << std::endl;
+				always[m / 32] |= (1u << (m % 32));
+				continue;
+			}
+			glm::mat4 const &xf = local_to_world[entry.transform];
+			std::vector< glm::vec3 > const &positions = f->second;
+			for (uint32_t i = 0; i + 2 < positions.size(); i += 3) {
+				Triangle tri;
+				tri.a = glm::vec3(xf * glm::vec4(positions[i+0], 1.0f));
+				tri.b = glm::vec3(xf * glm::vec4(positions[i+1], 1.0f));
+				tri.c = glm::vec3(xf * glm::vec4(positions[i+2], 1.0f));
+				tri.mesh = m;
+				for (glm::vec3 const &p : {tri.a, tri.b, tri.c}) {
+					bounds[m].min = glm::min(bounds[m].min, p);
+					bounds[m].max = glm::max(bounds[m].max, p);
+				}
+				triangles.emplace_back(tri);
+			}
+			scene_min = glm::min(scene_min, bounds[m].min);
+			scene_max = glm::max(scene_max, bounds[m].max);
+		}
+		if (triangles.empty()) throw std::runtime_error("scene has no triangles to bake visibility for.");
+		std::cout << "Read " << mesh_count << " mesh entries (" << triangles.size() << " triangles)." << std::endl;
+
+		//grid covering the scene's bounds (with a little margin):
+		glm::vec3 extent = scene_max - scene_min;
+		float longest = std::max(extent.x, std::max(extent.y, extent.z));
+		if (cell_size == 0.0f) cell_size = std::max(longest / 16.0f, 1e-3f);
+		GridEntry grid;
+		grid.size = glm::uvec3(glm::max(glm::ceil((extent + 0.02f * cell_size) / cell_size), glm::vec3(1.0f)));
+		grid.min = 0.5f * (scene_min + scene_max) - 0.5f * cell_size * glm::vec3(grid.size);
+		grid.cell_size = cell_size;
+		grid.mesh_count = mesh_count;
+		uint64_t cell_count64 = uint64_t(grid.size.x) * grid.size.y * grid.size.z;
+		if (cell_count64 > (1u << 24)) throw std::runtime_error("grid of " + std::to_string(cell_count64) + " cells is too large; use a larger --cell size.");
+		uint32_t const cell_count = uint32_t(cell_count64);
+		std::cout << "Grid is " << grid.size.x << "x" << grid.size.y << "x" << grid.size.z << " cells of size " << cell_size << "." << std::endl;
+
+		auto cell_center = [&](uint32_t cell) {
+			glm::uvec3 at(cell % grid.size.x, (cell / grid.size.x) % grid.size.y, cell / (grid.size.x * grid.size.y));
+			return grid.min + cell_size * (glm::vec3(at) + 0.5f);
+		};
+
+		//cells that triangles pass through:
+		std::vector< bool > solid(cell_count, false);
+		glm::vec3 const half = glm::vec3(0.5f * cell_size);
+		for (auto const &tri : triangles) {
+			glm::vec3 lo = glm::min(tri.a, glm::min(tri.b, tri.c));
+			glm::vec3 hi = glm::max(tri.a, glm::max(tri.b, tri.c));
+			glm::uvec3 c0 = glm::uvec3(glm::clamp(glm::floor((lo - grid.min) / cell_size), glm::vec3(0.0f), glm::vec3(grid.size - glm::uvec3(1))));
+			glm::uvec3 c1 = glm::uvec3(glm::clamp(glm::floor((hi - grid.min) / cell_size), glm::vec3(0.0f), glm::vec3(grid.size - glm::uvec3(1))));
+			for (uint32_t z = c0.z; z <= c1.z; ++z) {
+				for (uint32_t y = c0.y; y <= c1.y; ++y) {
+					for (uint32_t x = c0.x; x <= c1.x; ++x) {
+						uint32_t cell = (z * grid.size.y + y) * grid.size.x + x;
+						if (solid[cell]) continue;
+						if (triangle_overlaps_box(tri, cell_center(cell), half)) solid[cell] = true;
+					}
+				}
+			}
+		}
+
+		//visible set of each empty cell, computed in parallel:
+		// (prefab meshes are never seen or skipped, so 'all' leaves them out -- otherwise no cell could stop early)
+		std::vector< uint32_t > all(words, 0);
+		for (uint32_t m = 0; m < mesh_count; ++m) {
+			if (!in_prefab[scene.meshes[m].transform]) all[m / 32] |= (1u << (m % 32));
+		}
+
+		std::vector< std::vector< uint32_t > > cell_sets(cell_count);
+		std::atomic< uint32_t > next_cell(0);
+		auto worker = [&]() {
+			IdCube cube(resolution);
+			float const near = 1e-3f * cell_size;
+			while (true) {
+				uint32_t cell = next_cell.fetch_add(1);
+				if (cell >= cell_count) break;
+				if (solid[cell]) continue;
+				glm::vec3 center = cell_center(cell);
+				std::vector< uint32_t > seen = always;
+
+				//meshes that reach into (or very near) the cell:
+				glm::vec3 lo = center - 1.05f * half;
+				glm::vec3 hi = center + 1.05f * half;
+				for (uint32_t m = 0; m < mesh_count; ++m) {
+					if (glm::any(glm::greaterThan(bounds[m].min, hi)) || glm::any(glm::lessThan(bounds[m].max, lo))) continue;
+					seen[m / 32] |= (1u << (m % 32));
+				}
+
+				//jittered samples, spread over the octants of the cell:
+				// (stopping early if everything has been seen)
+				std::mt19937 mt(cell);
+				std::uniform_real_distribution< float > unit(0.0f, 1.0f);
+				for (uint32_t s = 0; s < samples && seen != all; ++s) {
+					uint32_t octant = s % 8;
+					glm::vec3 at = glm::vec3(
+						0.5f * (float(octant & 1) + unit(mt)),
+						0.5f * (float((octant >> 1) & 1) + unit(mt)),
+						0.5f * (float((octant >> 2) & 1) + unit(mt))
+					);
+					cube.render(center - half + at * cell_size, near, triangles, &seen);
+				}
+				cell_sets[cell] = std::move(seen);
+			}
+		};
+		std::vector< std::thread > threads;
+		uint32_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+		for (uint32_t t = 0; t < thread_count; ++t) threads.emplace_back(worker);
+		for (auto &thread : threads) thread.join();
+
+		//share identical sets between cells:
+		std::vector< uint32_t > cells(cell_count, -1U);
+		std::vector< uint32_t > sets;
+		std::map< std::vector< uint32_t >, uint32_t > set_index;
+		uint32_t empty_cells = 0;
+		uint64_t total_visible = 0;
+		for (uint32_t cell = 0; cell < cell_count; ++cell) {
+			if (solid[cell]) continue;
+			std::vector< uint32_t > const &set = cell_sets[cell];
+			empty_cells += 1;
+			for (uint32_t word : set) {
+				for (uint32_t b = 0; b < 32; ++b) total_visible += (word >> b) & 1;
+			}
+			auto ret = set_index.emplace(set, uint32_t(set_index.size()));
+			if (ret.second) sets.insert(sets.end(), set.begin(), set.end());
+			cells[cell] = ret.first->second;
+		}
+		std::cout << "Baked " << empty_cells << " of " << cell_count << " cells (" << (cell_count - empty_cells) << " contain geometry) into "
+			<< set_index.size() << " distinct sets; on average "
+			<< (empty_cells ? double(total_visible) / empty_cells : 0.0) << " of " << mesh_count << " meshes are potentially visible." << std::endl;
+
+		std::ofstream out(files[2], std::ios::binary);
+		if (!out) throw std::runtime_error("Failed to open '" + files[2] + "' for writing.");
+		write_chunk("str0", scene.strings, &out);
+		write_chunk("xfh0", scene.hierarchy, &out);
+		write_chunk("msh0", scene.meshes, &out);
+		write_chunk("cam0", scene.cameras, &out);
+		write_chunk("lmp0", scene.lights, &out);
+		if (!scene.prefabs.empty() || !scene.instances.empty()) {
+			write_chunk("pfb0", scene.prefabs, &out);
+			write_chunk("ins0", scene.instances, &out);
+		}
+		if (!scene.worlds.empty() || !scene.mesh_bounds.empty()) {
+			write_chunk("xfw0", scene.worlds, &out);
+			write_chunk("mbw0", scene.mesh_bounds, &out);
+		}
+		write_chunk("pvg0", std::vector< GridEntry >{grid}, &out);
+		write_chunk("pvc0", cells, &out);
+		write_chunk("pvs0", sets, &out);
+		for (auto const &chunk : scene.extra) {
+			write_chunk(chunk.magic, chunk.data, &out);
+		}
+		std::cout << "Wrote " << out.tellp() << " bytes to '" << files[2] << "'." << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
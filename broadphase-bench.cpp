@@ -0,0 +1,173 @@
+//broadphase-bench: stress test for Broadphase (sweep-and-prune) with many moving boxes
+//
+// Usage:
+//   broadphase-bench [--boxes N] [--frames N] [--churn N] [--check]
+//
+//  --boxes N   number of boxes (default 10000), drifting and bouncing around a cube
+//               sized so each box overlaps a handful of others
+//  --frames N  number of updates to time (default 600)
+//  --churn N   boxes removed and re-added every frame (default 10)
+//  --check     compare every 50th frame's overlaps against testing all pairs
+//
+// Reports the average and worst time of Broadphase::update(), average pair and event counts,
+//  and the time of a single all-pairs test for comparison.
+//
+// Does not need an OpenGL context.
+
+#include "Broadphase.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Body {
+	glm::vec3 position;
+	glm::vec3 velocity;
+	glm::vec3 radius;
+	uint32_t proxy = -1U;
+};
+
+static Broadphase::Box body_box(Body const &body) {
+	Broadphase::Box box;
+	box.min = body.position - body.radius;
+	box.max = body.position + body.radius;
+	return box;
+}
+
+//overlapping pairs by testing all pairs (as sorted (a << 32 | b) keys):
+static std::vector< uint64_t > all_pairs(std::vector< Body > const &bodies) {
+	std::vector< uint64_t > ret;
+	for (uint32_t i = 0; i < bodies.size(); ++i) {
+		Broadphase::Box a = body_box(bodies[i]);
+		for (uint32_t j = i + 1; j < bodies.size(); ++j) {
+			Broadphase::Box b = body_box(bodies[j]);
+			if (glm::any(glm::lessThan(b.max, a.min)) || glm::any(glm::greaterThan(b.min, a.max))) continue;
+			uint64_t p = bodies[i].proxy;
+			uint64_t q = bodies[j].proxy;
+			ret.emplace_back(p < q ? (p << 32 | q) : (q << 32 | p));
+		}
+	}
+	std::sort(ret.begin(), ret.end());
+	return ret;
+}
+
+int main(int argc, char **argv) {
+	bool usage = false;
+	uint32_t box_count = 10000;
+	uint32_t frames = 600;
+	uint32_t churn = 10;
+	bool check = false;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--boxes" && argi + 1 < argc) {
+			argi += 1;
+			box_count = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--frames" && argi + 1 < argc) {
+			argi += 1;
+			frames = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--churn" && argi + 1 < argc) {
+			argi += 1;
+			churn = uint32_t(std::max(0, std::atoi(argv[argi])));
+		} else if (arg == "--check") {
+			check = true;
+		} else {
+			std::cerr << "Unknown option '" << arg << "'." << std::endl;
+			usage = true;
+		}
+	}
+	if (usage) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--boxes N] [--frames N] [--churn N] [--check]" << std::endl;
+		return 1;
+	}
+
+	//boxes of size 0.5-1.5 in a cube with about 8 units of volume per box:
+	constexpr float Elapsed = 1.0f / 60.0f;
+	float const half_size = 0.5f * std::cbrt(8.0f * float(box_count));
+	std::mt19937 mt(0x1234);
+	std::uniform_real_distribution< float > unit(0.0f, 1.0f);
+	auto random_vec3 = [&](float lo, float hi) {
+		return glm::vec3(lo + (hi - lo) * unit(mt), lo + (hi - lo) * unit(mt), lo + (hi - lo) * unit(mt));
+	};
+
+	Broadphase broadphase;
+	std::vector< Body > bodies(box_count);
+	for (auto &body : bodies) {
+		body.position = random_vec3(-half_size, half_size);
+		body.velocity = random_vec3(-2.0f, 2.0f);
+		body.radius = random_vec3(0.25f, 0.75f);
+		body.proxy = broadphase.add(body_box(body), &body);
+	}
+	broadphase.update();
+	std::cout << "Broadphase with " << box_count << " boxes in a " << 2.0f * half_size << "-unit cube; "
+		<< broadphase.began.size() << " pairs initially." << std::endl;
+
+	double total_ms = 0.0;
+	double worst_ms = 0.0;
+	uint64_t total_pairs = 0, total_began = 0, total_ended = 0;
+	uint32_t mismatches = 0;
+
+	for (uint32_t frame = 0; frame < frames; ++frame) {
+		//move everything, bouncing off the walls:
+		for (auto &body : bodies) {
+			body.position += Elapsed * body.velocity;
+			for (uint32_t c = 0; c < 3; ++c) {
+				if (std::abs(body.position[c]) > half_size) {
+					body.velocity[c] = -body.velocity[c];
+					body.position[c] = std::copysign(half_size, body.position[c]);
+				}
+			}
+			broadphase.move(body.proxy, body_box(body));
+		}
+		//re-spawn a few:
+		for (uint32_t i = 0; i < churn; ++i) {
+			Body &body = bodies[mt() % bodies.size()];
+			broadphase.remove(body.proxy);
+			body.position = random_vec3(-half_size, half_size);
+			body.proxy = broadphase.add(body_box(body), &body);
+		}
+
+		auto before = std::chrono::high_resolution_clock::now();
+		broadphase.update();
+		auto after = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration< double, std::milli >(after - before).count();
+		total_ms += ms;
+		worst_ms = std::max(worst_ms, ms);
+		total_pairs += broadphase.began.size() + broadphase.persisted.size();
+		total_began += broadphase.began.size();
+		total_ended += broadphase.ended.size();
+
+		if (check && frame % 50 == 0) {
+			if (all_pairs(bodies) != broadphase.pairs) {
+				std::cerr << "Frame " << frame << ": overlaps don't match all-pairs test!" << std::endl;
+				mismatches += 1;
+			}
+		}
+	}
+
+	auto before = std::chrono::high_resolution_clock::now();
+	std::vector< uint64_t > brute = all_pairs(bodies);
+	auto after = std::chrono::high_resolution_clock::now();
+	double brute_ms = std::chrono::duration< double, std::milli >(after - before).count();
+
+	std::cout << "Over " << frames << " frames:\n"
+		<< "  update: " << total_ms / frames << " ms average, " << worst_ms << " ms worst\n"
+		<< "  " << double(total_pairs) / frames << " pairs, " << double(total_began) / frames << " began, " << double(total_ended) / frames << " ended per frame (average)\n"
+		<< "  (all-pairs test: " << brute_ms << " ms for " << brute.size() << " pairs)" << std::endl;
+
+	if (check) {
+		if (mismatches) {
+			std::cerr << mismatches << " checked frames did not match." << std::endl;
+			return 1;
+		}
+		std::cout << "All checked frames match." << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,509 @@
+//cook-cells: offline splitting of a scene and its meshes into spatial cells for streaming (see WorldStream.hpp)
+//
+// Usage:
+//   cook-cells [--cell S] <in.scene> <in.pnct> <out>
+//
+//  --cell S  size of the (cubical) grid cells meshes are sorted into, in world units (default 32)
+//
+// Writes:
+//   <out>.cells      the manifest: a 'str0' chunk of file names and a 'cel0' chunk with, for each cell,
+//                    the world-space bounds of its meshes, its scene and mesh file names, and its vertex bytes
+//   <out>-base.scene everything that isn't streamed: the whole hierarchy, cameras, lights, prefabs, animation
+//                    clips, and meshes of prefabs and on animated transforms (load it as usual)
+//   <out>-<n>.scene  for each cell, the scene's own mesh entries whose world bounds center in it
+//                    (along with the hierarchy entries above them)
+//   <out>-<n>.pnct   for each cell, the vertices of the meshes its scene entries use
+//
+// Meshes used in several cells are copied into each. Clusters ('cls0') and levels of detail ('lod0')
+//  aren't copied to cell mesh files; metadata ('met0') is. Animation clips ('anc0', 'ant0', 'ank0') are
+//  copied to the base scene, whose hierarchy is unchanged; potentially visible sets and other extra
+//  chunks of the scene aren't copied anywhere, since mesh entries are renumbered.
+//
+// Does not need an OpenGL context.
+
+#include "read_write_chunk.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+//------------ file data (layouts match those read by Scene and MeshBuffer) ------------
+
+struct HierarchyEntry {
+	uint32_t parent;
+	uint32_t name_begin;
+	uint32_t name_end;
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
+
+struct MeshEntry {
+	uint32_t transform;
+	uint32_t name_begin;
+	uint32_t name_end;
+};
+static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
+
+struct PrefabEntry {
+	uint32_t name_begin;
+	uint32_t name_end;
+	uint32_t xfh_begin, xfh_end;
+};
+static_assert(sizeof(PrefabEntry) == 4 + 4 + 4 + 4, "PrefabEntry is packed.");
+
+struct WorldEntry {
+	glm::mat4x3 local_to_world;
+	uint32_t flags;
+};
+static_assert(sizeof(WorldEntry) == 4*12 + 4, "WorldEntry is packed.");
+
+struct BoxEntry {
+	glm::vec3 min, max;
+};
+static_assert(sizeof(BoxEntry) == 24, "Box entry should be packed");
+
+struct IndexEntry {
+	uint32_t name_begin, name_end;
+	uint32_t vertex_begin, vertex_end;
+};
+static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+struct MetaEntry {
+	glm::vec3 min, max;
+	glm::vec3 center; float radius;
+	uint32_t vertex_count, triangle_count;
+	uint64_t hash;
+};
+static_assert(sizeof(MetaEntry) == 56, "Meta entry should be packed");
+
+struct QuantizedVertex {
+	glm::u16vec3 Position;
+	uint16_t _pad = 0;
+	glm::i16vec2 Normal;
+	glm::u8vec4 Color;
+	glm::u16vec2 TexCoord;
+};
+static_assert(sizeof(QuantizedVertex) == 3*2+2+2*2+4*1+2*2, "QuantizedVertex is packed.");
+
+struct Vertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::u8vec4 Color;
+	glm::vec2 TexCoord;
+};
+static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+
+//manifest entry (read by WorldStream):
+struct CellEntry {
+	glm::vec3 min, max; //world-space bounds of the cell's meshes
+	uint32_t scene_begin, scene_end; //scene file name (in manifest's str0)
+	uint32_t meshes_begin, meshes_end; //mesh file name (in manifest's str0)
+	uint32_t vertex_bytes; //size of the cell's vertex data
+};
+static_assert(sizeof(CellEntry) == 4*3 + 4*3 + 4*4 + 4, "CellEntry is packed.");
+
+struct SceneFile {
+	std::vector< char > strings;
+	std::vector< HierarchyEntry > hierarchy;
+	std::vector< MeshEntry > meshes;
+	std::vector< char > cameras; //(copied to base)
+	std::vector< char > lights; //(copied to base)
+	std::vector< PrefabEntry > prefabs; //(copied to base)
+	std::vector< char > instances; //(copied to base)
+	std::vector< WorldEntry > worlds; //(optional)
+	std::vector< BoxEntry > mesh_bounds; //(optional)
+	std::vector< char > clips; //(optional; copied to base)
+	std::vector< uint32_t > tracks; //(optional; copied to base) hierarchy entry of each animation track
+	std::vector< char > keys; //(optional; copied to base)
+};
+
+static SceneFile read_scene_file(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "' for reading.");
+
+	SceneFile ret;
+	read_chunk(file, "str0", &ret.strings);
+	read_chunk(file, "xfh0", &ret.hierarchy);
+	read_chunk(file, "msh0", &ret.meshes);
+	read_chunk(file, "cam0", &ret.cameras);
+	read_chunk(file, "lmp0", &ret.lights);
+	if (peek_chunk_magic(file) == "pfb0") {
+		read_chunk(file, "pfb0", &ret.prefabs);
+		read_chunk(file, "ins0", &ret.instances);
+	}
+	if (peek_chunk_magic(file) == "xfw0") {
+		read_chunk(file, "xfw0", &ret.worlds);
+		read_chunk(file, "mbw0", &ret.mesh_bounds);
+	}
+	//animation clips may follow potentially visible sets, which (like anything else) are left behind:
+	while (true) {
+		std::string magic = peek_chunk_magic(file);
+		if (magic == "") break;
+		if (magic == "anc0") {
+			read_chunk(file, "anc0", &ret.clips);
+			read_chunk(file, "ant0", &ret.tracks);
+			read_chunk(file, "ank0", &ret.keys);
+			continue;
+		}
+		std::vector< char > ignored;
+		read_chunk(file, magic, &ignored);
+	}
+
+	for (uint32_t i = 0; i < ret.hierarchy.size(); ++i) {
+		HierarchyEntry const &h = ret.hierarchy[i];
+		if (h.parent != -1U && h.parent >= i) {
+			throw std::runtime_error("scene file '" + filename + "' did not contain transforms in topological-sort order.");
+		}
+		if (!(h.name_begin <= h.name_end && h.name_end <= ret.strings.size())) {
+			throw std::runtime_error("scene file '" + filename + "' contains hierarchy entry with invalid name indices");
+		}
+	}
+	for (auto const &p : ret.prefabs) {
+		if (!(p.xfh_begin <= p.xfh_end && p.xfh_end <= ret.hierarchy.size())) {
+			throw std::runtime_error("scene file '" + filename + "' contains prefab entry with invalid hierarchy range");
+		}
+	}
+	for (auto const &m : ret.meshes) {
+		if (m.transform >= ret.hierarchy.size()) {
+			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid transform index (" + std::to_string(m.transform) + ")");
+		}
+		if (!(m.name_begin <= m.name_end && m.name_end <= ret.strings.size())) {
+			throw std::runtime_error("scene file '" + filename + "' contains mesh entry with invalid name indices");
+		}
+	}
+	if (!ret.worlds.empty() && (ret.worlds.size() != ret.hierarchy.size() || ret.mesh_bounds.size() != ret.meshes.size())) {
+		throw std::runtime_error("scene file '" + filename + "' has world transforms or bounds that don't match its entries");
+	}
+	for (uint32_t t : ret.tracks) {
+		if (t >= ret.hierarchy.size()) {
+			throw std::runtime_error("scene file '" + filename + "' contains animation track with invalid transform index (" + std::to_string(t) + ")");
+		}
+	}
+	return ret;
+}
+
+struct MeshFile {
+	std::string layout; //"pnct" or "pnq0"
+	size_t stride = 0;
+	std::vector< char > vertices;
+	std::vector< char > strings;
+	std::vector< IndexEntry > index;
+	std::vector< BoxEntry > boxes; //(quantized only)
+	std::vector< MetaEntry > metadata; //(optional)
+
+	std::map< std::string, uint32_t > by_name; //index entry of each mesh name
+	std::vector< BoxEntry > bounds; //object-space bounds of each mesh
+};
+
+static MeshFile read_mesh_file(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "' for reading.");
+
+	MeshFile ret;
+	ret.layout = (peek_chunk_magic(file) == "pnq0" ? "pnq0" : "pnct");
+	ret.stride = (ret.layout == "pnq0" ? sizeof(QuantizedVertex) : sizeof(Vertex));
+	read_chunk(file, ret.layout, &ret.vertices);
+	if (ret.vertices.size() % ret.stride != 0) throw std::runtime_error("mesh file '" + filename + "' has a partial vertex");
+	size_t vertex_count = ret.vertices.size() / ret.stride;
+
+	read_chunk(file, "str0", &ret.strings);
+	read_chunk(file, "idx0", &ret.index);
+	if (ret.layout == "pnq0") {
+		read_chunk(file, "box0", &ret.boxes);
+		if (ret.boxes.size() != ret.index.size()) throw std::runtime_error("mesh file '" + filename + "' has wrong number of boxes");
+	}
+	if (peek_chunk_magic(file) == "met0") {
+		read_chunk(file, "met0", &ret.metadata);
+		if (ret.metadata.size() != ret.index.size()) throw std::runtime_error("mesh file '" + filename + "' has wrong number of metadata entries");
+	}
+	//(clusters and levels of detail are left behind)
+
+	for (uint32_t i = 0; i < ret.index.size(); ++i) {
+		IndexEntry const &entry = ret.index[i];
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= ret.strings.size())) {
+			throw std::runtime_error("index entry has out-of-range name begin/end");
+		}
+		if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= vertex_count)) {
+			throw std::runtime_error("index entry has out-of-range vertex start/count");
+		}
+		ret.by_name[std::string(ret.strings.data() + entry.name_begin, ret.strings.data() + entry.name_end)] = i;
+
+		BoxEntry box{glm::vec3(std::numeric_limits< float >::infinity()), glm::vec3(-std::numeric_limits< float >::infinity())};
+		if (!ret.metadata.empty()) {
+			box = BoxEntry{ret.metadata[i].min, ret.metadata[i].max};
+		} else if (!ret.boxes.empty()) {
+			box = ret.boxes[i];
+		} else {
+			for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+				glm::vec3 const &p = reinterpret_cast< Vertex const * >(ret.vertices.data())[v].Position;
+				box.min = glm::min(box.min, p);
+				box.max = glm::max(box.max, p);
+			}
+		}
+		ret.bounds.emplace_back(box);
+	}
+	return ret;
+}
+
+//strip directories from a path:
+static std::string base_name(std::string const &path) {
+	size_t slash = path.find_last_of("/\\");
+	return (slash == std::string::npos ? path : path.substr(slash + 1));
+}
+
+int main(int argc, char **argv) {
+	bool usage = false;
+	float cell_size = 32.0f;
+	std::vector< std::string > files;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--cell" && argi + 1 < argc) {
+			argi += 1;
+			cell_size = float(std::atof(argv[argi]));
+			if (!(cell_size > 0.0f)) usage = true;
+		} else if (arg.size() >= 2 && arg.substr(0,2) == "--") {
+			std::cerr << "Unknown option '" << arg << "'." << std::endl;
+			usage = true;
+		} else {
+			files.emplace_back(arg);
+		}
+	}
+	if (files.size() != 3) usage = true;
+
+	if (usage) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--cell S] <in.scene> <in.pnct> <out>" << std::endl;
+		return 1;
+	}
+
+	try {
+		SceneFile scene = read_scene_file(files[0]);
+		MeshFile mesh_file = read_mesh_file(files[1]);
+		std::string const &out = files[2];
+
+		//world-space transforms (same math as Scene::Transform::make_local_to_world):
+		std::vector< glm::mat4 > local_to_world;
+		local_to_world.reserve(scene.hierarchy.size());
+		for (auto const &h : scene.hierarchy) {
+			glm::mat3 rot = glm::mat3_cast(h.rotation);
+			glm::mat4 local_to_parent = glm::mat4(
+				glm::vec4(rot[0] * h.scale.x, 0.0f),
+				glm::vec4(rot[1] * h.scale.y, 0.0f),
+				glm::vec4(rot[2] * h.scale.z, 0.0f),
+				glm::vec4(h.position, 1.0f)
+			);
+			local_to_world.emplace_back(h.parent == -1U ? local_to_parent : local_to_world[h.parent] * local_to_parent);
+		}
+
+		//meshes of prefabs are placed at instances when loaded, so stay in the base scene:
+		std::vector< bool > in_prefab(scene.hierarchy.size(), false);
+		for (auto const &p : scene.prefabs) {
+			std::fill(in_prefab.begin() + p.xfh_begin, in_prefab.begin() + p.xfh_end, true);
+		}
+		//...as do meshes on animated transforms (or their children), since cells don't move:
+		std::vector< bool > animated(scene.hierarchy.size(), false);
+		for (uint32_t t : scene.tracks) {
+			animated[t] = true;
+		}
+		for (uint32_t i = 0; i < scene.hierarchy.size(); ++i) {
+			if (scene.hierarchy[i].parent != -1U && animated[scene.hierarchy[i].parent]) animated[i] = true;
+		}
+
+		//sort the scene's own mesh entries into cells by the center of their world bounds:
+		struct Cell {
+			std::vector< uint32_t > meshes; //mesh entries
+			glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+			glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+		};
+		std::map< std::tuple< int32_t, int32_t, int32_t >, Cell > cells; //(ordered, so output is deterministic)
+		std::vector< uint32_t > base_meshes;
+		for (uint32_t m = 0; m < scene.meshes.size(); ++m) {
+			MeshEntry const &entry = scene.meshes[m];
+			std::string name(scene.strings.data() + entry.name_begin, scene.strings.data() + entry.name_end);
+			auto f = mesh_file.by_name.find(name);
+			if (in_prefab[entry.transform] || animated[entry.transform] || f == mesh_file.by_name.end() || !(mesh_file.bounds[f->second].min.x <= mesh_file.bounds[f->second].max.x)) {
+				if (!in_prefab[entry.transform] && !animated[entry.transform]) std::cerr << "WARNING: no vertices for mesh '" << name << "'; leaving it in the base scene." << std::endl;
+				base_meshes.emplace_back(m);
+				continue;
+			}
+
+			//box around the transformed mesh box:
+			BoxEntry const &box = mesh_file.bounds[f->second];
+			glm::mat4 const &xf = local_to_world[entry.transform];
+			glm::vec3 center = glm::vec3(xf * glm::vec4(0.5f * (box.min + box.max), 1.0f));
+			glm::vec3 half = 0.5f * (box.max - box.min);
+			glm::vec3 extent = glm::abs(glm::vec3(xf[0])) * half.x + glm::abs(glm::vec3(xf[1])) * half.y + glm::abs(glm::vec3(xf[2])) * half.z;
+
+			glm::ivec3 at = glm::ivec3(glm::floor(center / cell_size));
+			Cell &cell = cells[std::make_tuple(at.x, at.y, at.z)];
+			cell.meshes.emplace_back(m);
+			cell.min = glm::min(cell.min, center - extent);
+			cell.max = glm::max(cell.max, center + extent);
+		}
+
+		//base scene -- everything but the streamed meshes:
+		{
+			std::ofstream base(out + "-base.scene", std::ios::binary);
+			if (!base) throw std::runtime_error("Failed to open '" + out + "-base.scene' for writing.");
+			std::vector< MeshEntry > meshes;
+			std::vector< BoxEntry > mesh_bounds;
+			for (uint32_t m : base_meshes) {
+				meshes.emplace_back(scene.meshes[m]);
+				if (!scene.mesh_bounds.empty()) mesh_bounds.emplace_back(scene.mesh_bounds[m]);
+			}
+			write_chunk("str0", scene.strings, &base);
+			write_chunk("xfh0", scene.hierarchy, &base);
+			write_chunk("msh0", meshes, &base);
+			write_chunk("cam0", scene.cameras, &base);
+			write_chunk("lmp0", scene.lights, &base);
+			if (!scene.prefabs.empty() || !scene.instances.empty()) {
+				write_chunk("pfb0", scene.prefabs, &base);
+				write_chunk("ins0", scene.instances, &base);
+			}
+			if (!scene.worlds.empty()) {
+				write_chunk("xfw0", scene.worlds, &base);
+				write_chunk("mbw0", mesh_bounds, &base);
+			}
+			if (!scene.clips.empty()) {
+				write_chunk("anc0", scene.clips, &base);
+				write_chunk("ant0", scene.tracks, &base);
+				write_chunk("ank0", scene.keys, &base);
+			}
+		}
+
+		//cell scenes and mesh files:
+		std::vector< char > manifest_strings;
+		std::vector< CellEntry > manifest_cells;
+		auto add_string = [&](std::string const &str, uint32_t *begin, uint32_t *end) {
+			*begin = uint32_t(manifest_strings.size());
+			manifest_strings.insert(manifest_strings.end(), str.begin(), str.end());
+			*end = uint32_t(manifest_strings.size());
+		};
+		size_t total_bytes = 0;
+		for (auto const &[key, cell] : cells) {
+			uint32_t n = uint32_t(manifest_cells.size());
+			std::string scene_name = out + "-" + std::to_string(n) + ".scene";
+			std::string meshes_name = out + "-" + std::to_string(n) + ".pnct";
+
+			//scene: the cell's mesh entries and every hierarchy entry above them (in the original order):
+			std::vector< uint32_t > entry_to_cell(scene.hierarchy.size(), -1U);
+			for (uint32_t m : cell.meshes) {
+				for (uint32_t i = scene.meshes[m].transform; i != -1U && entry_to_cell[i] == -1U; i = scene.hierarchy[i].parent) {
+					entry_to_cell[i] = 0; //(marked; numbered below)
+				}
+			}
+			std::vector< char > strings;
+			auto copy_string = [&](uint32_t begin, uint32_t end, uint32_t *new_begin, uint32_t *new_end) {
+				*new_begin = uint32_t(strings.size());
+				strings.insert(strings.end(), scene.strings.begin() + begin, scene.strings.begin() + end);
+				*new_end = uint32_t(strings.size());
+			};
+			std::vector< HierarchyEntry > hierarchy;
+			std::vector< WorldEntry > worlds;
+			for (uint32_t i = 0; i < scene.hierarchy.size(); ++i) {
+				if (entry_to_cell[i] == -1U) continue;
+				entry_to_cell[i] = uint32_t(hierarchy.size());
+				HierarchyEntry h = scene.hierarchy[i];
+				if (h.parent != -1U) h.parent = entry_to_cell[h.parent];
+				copy_string(h.name_begin, h.name_end, &h.name_begin, &h.name_end);
+				hierarchy.emplace_back(h);
+				if (!scene.worlds.empty()) worlds.emplace_back(scene.worlds[i]);
+			}
+
+			//meshes: each mesh used by the cell, once, with its vertices re-based:
+			std::vector< char > vertices;
+			std::vector< char > mesh_strings;
+			std::vector< IndexEntry > index;
+			std::vector< BoxEntry > boxes;
+			std::vector< MetaEntry > metadata;
+			std::map< uint32_t, uint32_t > copied; //mesh file index entry -> cell mesh file index entry
+
+			std::vector< MeshEntry > meshes;
+			std::vector< BoxEntry > mesh_bounds;
+			for (uint32_t m : cell.meshes) {
+				MeshEntry entry = scene.meshes[m];
+				std::string name(scene.strings.data() + entry.name_begin, scene.strings.data() + entry.name_end);
+				uint32_t i = mesh_file.by_name.at(name);
+				if (copied.emplace(i, uint32_t(index.size())).second) {
+					IndexEntry const &from = mesh_file.index[i];
+					IndexEntry to;
+					to.name_begin = uint32_t(mesh_strings.size());
+					mesh_strings.insert(mesh_strings.end(), name.begin(), name.end());
+					to.name_end = uint32_t(mesh_strings.size());
+					to.vertex_begin = uint32_t(vertices.size() / mesh_file.stride);
+					vertices.insert(vertices.end(), mesh_file.vertices.begin() + from.vertex_begin * mesh_file.stride, mesh_file.vertices.begin() + from.vertex_end * mesh_file.stride);
+					to.vertex_end = uint32_t(vertices.size() / mesh_file.stride);
+					index.emplace_back(to);
+					if (!mesh_file.boxes.empty()) boxes.emplace_back(mesh_file.boxes[i]);
+					if (!mesh_file.metadata.empty()) metadata.emplace_back(mesh_file.metadata[i]);
+				}
+				entry.transform = entry_to_cell[entry.transform];
+				copy_string(entry.name_begin, entry.name_end, &entry.name_begin, &entry.name_end);
+				meshes.emplace_back(entry);
+				if (!scene.mesh_bounds.empty()) mesh_bounds.emplace_back(scene.mesh_bounds[m]);
+			}
+
+			{
+				std::ofstream file(scene_name, std::ios::binary);
+				if (!file) throw std::runtime_error("Failed to open '" + scene_name + "' for writing.");
+				write_chunk("str0", strings, &file);
+				write_chunk("xfh0", hierarchy, &file);
+				write_chunk("msh0", meshes, &file);
+				write_chunk("cam0", std::vector< char >(), &file);
+				write_chunk("lmp0", std::vector< char >(), &file);
+				if (!worlds.empty()) {
+					write_chunk("xfw0", worlds, &file);
+					write_chunk("mbw0", mesh_bounds, &file);
+				}
+			}
+			{
+				std::ofstream file(meshes_name, std::ios::binary);
+				if (!file) throw std::runtime_error("Failed to open '" + meshes_name + "' for writing.");
+				write_chunk(mesh_file.layout, vertices, &file);
+				write_chunk("str0", mesh_strings, &file);
+				write_chunk("idx0", index, &file);
+				if (!mesh_file.boxes.empty()) write_chunk("box0", boxes, &file);
+				if (!mesh_file.metadata.empty()) write_chunk("met0", metadata, &file);
+			}
+
+			CellEntry entry;
+			entry.min = cell.min;
+			entry.max = cell.max;
+			//(file names are relative to the manifest)
+			add_string(base_name(scene_name), &entry.scene_begin, &entry.scene_end);
+			add_string(base_name(meshes_name), &entry.meshes_begin, &entry.meshes_end);
+			entry.vertex_bytes = uint32_t(vertices.size());
+			manifest_cells.emplace_back(entry);
+			total_bytes += vertices.size();
+		}
+
+		{
+			std::ofstream file(out + ".cells", std::ios::binary);
+			if (!file) throw std::runtime_error("Failed to open '" + out + ".cells' for writing.");
+			write_chunk("str0", manifest_strings, &file);
+			write_chunk("cel0", manifest_cells, &file);
+		}
+
+		std::cout << "Split " << (scene.meshes.size() - base_meshes.size()) << " of " << scene.meshes.size() << " mesh entries into "
+			<< manifest_cells.size() << " cells (" << total_bytes << " bytes of vertices; "
+			<< mesh_file.vertices.size() << " in '" << files[1] << "'); wrote '" << out << ".cells' and '" << out << "-base.scene'." << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
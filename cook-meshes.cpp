@@ -0,0 +1,1095 @@
+//cook-meshes: offline processing for .pnct mesh files (as written by scenes/export-meshes.py)
+//
+// Usage:
+//   cook-meshes [--clusters] [--lods N] [--quantize] <in.pnct> <out.pnct>
+//
+//  --clusters  reorder each mesh's triangles into spatially coherent clusters of (up to) 128 triangles
+//               and write a 'cls0' chunk with a bounding sphere and normal cone for each cluster;
+//               Scene::draw uses these to cull parts of large meshes.
+//  --lods N    add (up to) N coarser levels of detail per mesh, made by quadric-error edge collapse
+//               (each with about half the triangles of the previous); writes a 'lod0' chunk
+//               with the vertex range and geometric error of each level.
+//  --quantize  store vertices in the compact 20-byte 'pnq0' layout (see Mesh.hpp):
+//               unorm16 positions relative to each mesh's bounding box,
+//               octahedral snorm16 normals, u8 colors, half-float texcoords.
+//               reports the error introduced for every mesh.
+//
+// Always writes a 'met0' chunk with each mesh's bounds, counts, and content hash,
+//  so MeshBuffer doesn't need to scan vertex data when loading.
+//
+// Does not need an OpenGL context; output can be loaded directly by MeshBuffer.
+
+#include "read_write_chunk.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//------------ file data (layouts match those read by MeshBuffer) ------------
+
+struct Vertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::u8vec4 Color;
+	glm::vec2 TexCoord;
+};
+static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+
+struct QuantizedVertex {
+	glm::u16vec3 Position;
+	uint16_t _pad = 0;
+	glm::i16vec2 Normal;
+	glm::u8vec4 Color;
+	glm::u16vec2 TexCoord;
+};
+static_assert(sizeof(QuantizedVertex) == 3*2+2+2*2+4*1+2*2, "QuantizedVertex is packed.");
+
+struct IndexEntry {
+	uint32_t name_begin, name_end;
+	uint32_t vertex_begin, vertex_end;
+};
+static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+struct BoxEntry {
+	glm::vec3 min, max;
+};
+static_assert(sizeof(BoxEntry) == 24, "Box entry should be packed");
+
+struct ClusterEntry {
+	uint32_t mesh; //index entry the cluster belongs to
+	uint32_t vertex_begin, vertex_end;
+	glm::vec3 center; float radius; //bounding sphere
+	glm::vec3 cone_axis; float cone_cutoff; //normal cone
+};
+static_assert(sizeof(ClusterEntry) == 44, "Cluster entry should be packed");
+
+struct LODEntry {
+	uint32_t mesh; //index entry the level belongs to
+	uint32_t vertex_begin, vertex_end;
+	float error; //max distance from original surface (object space)
+};
+static_assert(sizeof(LODEntry) == 16, "LOD entry should be packed");
+
+struct MetaEntry {
+	glm::vec3 min, max; //bounding box (object space)
+	glm::vec3 center; float radius; //bounding sphere (object space)
+	uint32_t vertex_count, triangle_count;
+	uint64_t hash; //FNV-1a hash of the mesh's vertex data (as stored in the file)
+};
+static_assert(sizeof(MetaEntry) == 56, "Meta entry should be packed");
+
+struct MeshFile {
+	std::vector< Vertex > vertices;
+	std::vector< char > strings;
+	std::vector< IndexEntry > index;
+	std::vector< ClusterEntry > clusters; //(only if clustered)
+	std::vector< LODEntry > lods; //(only if simplified; vertices follow those of all index entries)
+
+	std::string name(IndexEntry const &entry) const {
+		return std::string(strings.data() + entry.name_begin, strings.data() + entry.name_end);
+	}
+};
+
+//------------ encoding helpers ------------
+
+//float -> IEEE half (round-to-nearest-even):
+static uint16_t float_to_half(float f) {
+	uint32_t x;
+	std::memcpy(&x, &f, 4);
+	uint32_t sign = (x >> 16) & 0x8000;
+	uint32_t exp = (x >> 23) & 0xff;
+	uint32_t mant = x & 0x7fffff;
+
+	if (exp == 0xff) return uint16_t(sign | 0x7c00 | (mant ? 0x200 : 0)); //inf / nan
+
+	int32_t e = int32_t(exp) - 127 + 15;
+	if (e >= 0x1f) return uint16_t(sign | 0x7c00); //overflow -> inf
+	if (e <= 0) { //half subnormal (or zero)
+		if (e < -10) return uint16_t(sign);
+		mant |= 0x800000;
+		uint32_t shift = uint32_t(14 - e);
+		uint32_t h = mant >> shift;
+		uint32_t rem = mant & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rem > halfway || (rem == halfway && (h & 1))) h += 1;
+		return uint16_t(sign | h);
+	}
+	uint32_t h = (uint32_t(e) << 10) | (mant >> 13);
+	uint32_t rem = mant & 0x1fff;
+	if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) h += 1; //(carry into exponent is correct rounding)
+	return uint16_t(sign | h);
+}
+
+//IEEE half -> float:
+static float half_to_float(uint16_t h) {
+	uint32_t sign = uint32_t(h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1f;
+	uint32_t mant = h & 0x3ff;
+	uint32_t x;
+	if (exp == 0) {
+		float f = std::ldexp(float(mant), -24); //zero or subnormal
+		return (sign ? -f : f);
+	} else if (exp == 0x1f) {
+		x = sign | 0x7f800000 | (mant << 13);
+	} else {
+		x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+	}
+	float f;
+	std::memcpy(&f, &x, 4);
+	return f;
+}
+
+//octahedral normal encoding, as in "A Survey of Efficient Representations for Independent Unit Vectors" [Cigolle et al. 2014]:
+static glm::vec2 oct_wrap(glm::vec2 const &v) {
+	return glm::vec2(
+		(1.0f - std::abs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f),
+		(1.0f - std::abs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f)
+	);
+}
+
+static glm::vec2 oct_encode(glm::vec3 const &n) {
+	float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if (l1 == 0.0f) return glm::vec2(0.0f);
+	glm::vec2 p = glm::vec2(n.x, n.y) / l1;
+	if (n.z < 0.0f) p = oct_wrap(p);
+	return p;
+}
+
+//(matches decode_normal() in the quantized shader variants)
+static glm::vec3 oct_decode(glm::vec2 const &e) {
+	glm::vec3 n = glm::vec3(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	if (n.z < 0.0f) {
+		glm::vec2 w = oct_wrap(glm::vec2(n.x, n.y));
+		n.x = w.x;
+		n.y = w.y;
+	}
+	return glm::normalize(n);
+}
+
+static float snorm16_to_float(int16_t v) {
+	return std::max(float(v) / 32767.0f, -1.0f);
+}
+
+//quantize normal, checking the four nearest snorm16 encodings for the one that decodes most accurately:
+static glm::i16vec2 quantize_normal(glm::vec3 const &normal) {
+	float len = glm::length(normal);
+	if (!(len > 0.0f)) return glm::i16vec2(0, 0); //degenerate normal; decodes to +z
+	glm::vec3 n = normal / len;
+
+	glm::vec2 e = glm::clamp(oct_encode(n), glm::vec2(-1.0f), glm::vec2(1.0f)) * 32767.0f;
+	glm::vec2 base = glm::floor(e);
+
+	glm::i16vec2 best = glm::i16vec2(0, 0);
+	float best_dot = -std::numeric_limits< float >::infinity();
+	for (uint32_t i = 0; i < 4; ++i) {
+		glm::vec2 c = glm::clamp(base + glm::vec2(float(i & 1), float(i >> 1)), glm::vec2(-32767.0f), glm::vec2(32767.0f));
+		glm::i16vec2 q = glm::i16vec2(int16_t(c.x), int16_t(c.y));
+		float d = glm::dot(oct_decode(glm::vec2(snorm16_to_float(q.x), snorm16_to_float(q.y))), n);
+		if (d > best_dot) {
+			best_dot = d;
+			best = q;
+		}
+	}
+	return best;
+}
+
+//------------ file i/o ------------
+
+static MeshFile read_mesh_file(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open '" + filename + "' for reading.");
+
+	if (peek_chunk_magic(file) == "pnq0") {
+		throw std::runtime_error("'" + filename + "' is already quantized; cook from the float export instead.");
+	}
+
+	MeshFile ret;
+	read_chunk(file, "pnct", &ret.vertices);
+	read_chunk(file, "str0", &ret.strings);
+	read_chunk(file, "idx0", &ret.index);
+
+	for (auto const &entry : ret.index) {
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= ret.strings.size())) {
+			throw std::runtime_error("index entry has out-of-range name begin/end");
+		}
+		if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= ret.vertices.size())) {
+			throw std::runtime_error("index entry has out-of-range vertex start/count");
+		}
+	}
+
+	if (file.peek() != EOF) {
+		std::cerr << "WARNING: ignoring trailing data in mesh file '" << filename << "'" << std::endl;
+	}
+
+	return ret;
+}
+
+//------------ quantization ------------
+
+static void quantize(MeshFile const &mesh_file, std::vector< QuantizedVertex > *quantized_, std::vector< BoxEntry > *boxes_) {
+	assert(quantized_);
+	assert(boxes_);
+	auto &quantized = *quantized_;
+	auto &boxes = *boxes_;
+
+	quantized.assign(mesh_file.vertices.size(), QuantizedVertex());
+	boxes.clear();
+	boxes.reserve(mesh_file.index.size());
+
+	std::cout << "Quantizing " << mesh_file.index.size() << " meshes:\n";
+	std::cout << "  (position error is relative to bounding box diagonal; normal error is in degrees)\n";
+
+	float worst_position = 0.0f;
+	float worst_normal = 0.0f;
+	float worst_texcoord = 0.0f;
+
+	auto lod = mesh_file.lods.begin();
+	for (uint32_t m = 0; m < mesh_file.index.size(); ++m) {
+		IndexEntry const &entry = mesh_file.index[m];
+
+		//vertex ranges of the mesh and its levels of detail (which only use positions from the mesh itself):
+		std::vector< std::pair< uint32_t, uint32_t > > ranges;
+		ranges.emplace_back(entry.vertex_begin, entry.vertex_end);
+		while (lod != mesh_file.lods.end() && lod->mesh == m) {
+			ranges.emplace_back(lod->vertex_begin, lod->vertex_end);
+			++lod;
+		}
+
+		BoxEntry box;
+		box.min = glm::vec3( std::numeric_limits< float >::infinity());
+		box.max = glm::vec3(-std::numeric_limits< float >::infinity());
+		for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+			box.min = glm::min(box.min, mesh_file.vertices[v].Position);
+			box.max = glm::max(box.max, mesh_file.vertices[v].Position);
+		}
+		if (entry.vertex_begin == entry.vertex_end) {
+			box.min = box.max = glm::vec3(0.0f);
+		}
+		boxes.emplace_back(box);
+
+		glm::vec3 size = box.max - box.min;
+		float diagonal = glm::length(size);
+
+		float max_position = 0.0f;
+		float max_normal_cos = 1.0f;
+		float max_texcoord = 0.0f;
+
+		for (auto const &range : ranges) {
+			for (uint32_t v = range.first; v < range.second; ++v) {
+				Vertex const &in = mesh_file.vertices[v];
+				QuantizedVertex &out = quantized[v];
+
+				//position, as unorm16 within bounding box:
+				glm::vec3 dequantized = box.min;
+				for (uint32_t c = 0; c < 3; ++c) {
+					float t = (size[c] > 0.0f ? (in.Position[c] - box.min[c]) / size[c] : 0.0f);
+					out.Position[c] = uint16_t(std::round(glm::clamp(t, 0.0f, 1.0f) * 65535.0f));
+					dequantized[c] = box.min[c] + (out.Position[c] / 65535.0f) * size[c];
+				}
+				max_position = std::max(max_position, glm::length(dequantized - in.Position));
+
+				//normal, octahedral-encoded:
+				out.Normal = quantize_normal(in.Normal);
+				if (glm::length(in.Normal) > 0.0f) {
+					glm::vec3 decoded = oct_decode(glm::vec2(snorm16_to_float(out.Normal.x), snorm16_to_float(out.Normal.y)));
+					max_normal_cos = std::min(max_normal_cos, glm::dot(decoded, glm::normalize(in.Normal)));
+				}
+
+				//color is passed through:
+				out.Color = in.Color;
+
+				//texcoord, as half-float:
+				for (uint32_t c = 0; c < 2; ++c) {
+					out.TexCoord[c] = float_to_half(in.TexCoord[c]);
+					max_texcoord = std::max(max_texcoord, std::abs(half_to_float(out.TexCoord[c]) - in.TexCoord[c]));
+				}
+			}
+		}
+
+		float max_normal = std::acos(glm::clamp(max_normal_cos, -1.0f, 1.0f)) / 3.1415926f * 180.0f;
+		float relative_position = (diagonal > 0.0f ? max_position / diagonal : 0.0f);
+
+		std::cout << "  '" << mesh_file.name(entry) << "': " << (entry.vertex_end - entry.vertex_begin) << " vertices;"
+			<< " position " << max_position << " (" << relative_position << ")"
+			<< ", normal " << max_normal
+			<< ", texcoord " << max_texcoord << "\n";
+
+		worst_position = std::max(worst_position, relative_position);
+		worst_normal = std::max(worst_normal, max_normal);
+		worst_texcoord = std::max(worst_texcoord, max_texcoord);
+	}
+
+	std::cout << "Worst-case errors: position " << worst_position << " of diagonal, normal " << worst_normal << " degrees, texcoord " << worst_texcoord << "\n";
+	std::cout << "Vertex data: " << mesh_file.vertices.size() * sizeof(Vertex) << " bytes -> " << quantized.size() * sizeof(QuantizedVertex) << " bytes." << std::endl;
+}
+
+//------------ clustering ------------
+
+//(triangles per cluster; a few hundred vertices per range keeps multi-draw overhead low)
+static constexpr uint32_t ClusterTriangles = 128;
+
+//spread the low 10 bits of x out to every third bit (for morton codes):
+static uint32_t spread_bits(uint32_t x) {
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+//bounding sphere and normal cone of a range of triangle-soup vertices:
+static void compute_cluster_bounds(std::vector< Vertex > const &vertices, ClusterEntry *cluster_) {
+	assert(cluster_);
+	auto &cluster = *cluster_;
+
+	glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+	glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+	for (uint32_t v = cluster.vertex_begin; v < cluster.vertex_end; ++v) {
+		min = glm::min(min, vertices[v].Position);
+		max = glm::max(max, vertices[v].Position);
+	}
+	cluster.center = 0.5f * (min + max);
+	cluster.radius = 0.0f;
+	for (uint32_t v = cluster.vertex_begin; v < cluster.vertex_end; ++v) {
+		cluster.radius = std::max(cluster.radius, glm::length(vertices[v].Position - cluster.center));
+	}
+
+	//cone around the (winding-order) face normals; degenerate triangles are never drawn, so don't constrain it:
+	std::vector< glm::vec3 > normals;
+	glm::vec3 sum = glm::vec3(0.0f);
+	for (uint32_t v = cluster.vertex_begin; v + 2 < cluster.vertex_end; v += 3) {
+		glm::vec3 n = glm::cross(vertices[v+1].Position - vertices[v].Position, vertices[v+2].Position - vertices[v].Position);
+		float len = glm::length(n);
+		if (!(len > 0.0f)) continue;
+		normals.emplace_back(n / len);
+		sum += normals.back();
+	}
+
+	//default: cone that never culls:
+	cluster.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+	cluster.cone_cutoff = 1.0f;
+
+	float sum_len = glm::length(sum);
+	if (normals.empty() || !(sum_len > 0.0f)) return;
+	glm::vec3 axis = sum / sum_len;
+	float min_dot = 1.0f;
+	for (auto const &n : normals) {
+		min_dot = std::min(min_dot, glm::dot(n, axis));
+	}
+	cluster.cone_axis = axis;
+	//cluster faces away from all eye positions within the cone of half-angle (90 deg - acos(min_dot)) about the axis;
+	// if that cone is very narrow, culling will almost never succeed, so don't bother:
+	if (min_dot > 0.1f) {
+		cluster.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+	}
+}
+
+//reorder the triangles of every mesh into clusters and record cluster bounds:
+static void cluster_meshes(MeshFile *mesh_file_) {
+	assert(mesh_file_);
+	auto &mesh_file = *mesh_file_;
+	auto &vertices = mesh_file.vertices;
+
+	mesh_file.clusters.clear();
+
+	std::cout << "Clustering " << mesh_file.index.size() << " meshes:\n";
+
+	uint32_t total_cones = 0;
+
+	for (uint32_t m = 0; m < mesh_file.index.size(); ++m) {
+		IndexEntry const &entry = mesh_file.index[m];
+		uint32_t count = entry.vertex_end - entry.vertex_begin;
+		if (count % 3 != 0) {
+			std::cerr << "WARNING: '" << mesh_file.name(entry) << "' is not a triangle list; not clustering it." << std::endl;
+			continue;
+		}
+		uint32_t triangles = count / 3;
+		if (triangles == 0) continue;
+
+		//per-triangle centroid and unit normal:
+		std::vector< glm::vec3 > centroids(triangles);
+		std::vector< glm::vec3 > normals(triangles);
+		glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+		for (uint32_t t = 0; t < triangles; ++t) {
+			Vertex const *tri = &vertices[entry.vertex_begin + 3 * t];
+			centroids[t] = (tri[0].Position + tri[1].Position + tri[2].Position) / 3.0f;
+			glm::vec3 n = glm::cross(tri[1].Position - tri[0].Position, tri[2].Position - tri[0].Position);
+			float len = glm::length(n);
+			normals[t] = (len > 0.0f ? n / len : glm::vec3(0.0f));
+			min = glm::min(min, centroids[t]);
+			max = glm::max(max, centroids[t]);
+		}
+
+		//triangles sharing a position are neighbors (exported meshes duplicate vertices at uv/normal seams):
+		std::map< std::array< float, 3 >, std::vector< uint32_t > > corners;
+		for (uint32_t t = 0; t < triangles; ++t) {
+			for (uint32_t i = 0; i < 3; ++i) {
+				glm::vec3 const &p = vertices[entry.vertex_begin + 3 * t + i].Position;
+				corners[{p.x, p.y, p.z}].emplace_back(t);
+			}
+		}
+		std::vector< std::vector< uint32_t > const * > triangle_corners(3 * triangles);
+		for (uint32_t t = 0; t < triangles; ++t) {
+			for (uint32_t i = 0; i < 3; ++i) {
+				glm::vec3 const &p = vertices[entry.vertex_begin + 3 * t + i].Position;
+				triangle_corners[3 * t + i] = &corners[{p.x, p.y, p.z}];
+			}
+		}
+
+		//seed order: morton order of centroids, so consecutive clusters are (mostly) nearby:
+		std::vector< uint32_t > order(triangles);
+		{
+			glm::vec3 scale = max - min;
+			std::vector< uint32_t > codes(triangles);
+			for (uint32_t t = 0; t < triangles; ++t) {
+				glm::uvec3 q = glm::uvec3(0);
+				for (uint32_t c = 0; c < 3; ++c) {
+					float f = (scale[c] > 0.0f ? (centroids[t][c] - min[c]) / scale[c] : 0.0f);
+					q[c] = uint32_t(glm::clamp(f, 0.0f, 1.0f) * 1023.0f);
+				}
+				codes[t] = spread_bits(q.x) | (spread_bits(q.y) << 1) | (spread_bits(q.z) << 2);
+				order[t] = t;
+			}
+			std::stable_sort(order.begin(), order.end(), [&codes](uint32_t a, uint32_t b) {
+				return codes[a] < codes[b];
+			});
+		}
+
+		//greedily grow clusters across neighboring triangles, preferring ones close to the cluster and facing the same way:
+		std::vector< bool > used(triangles, false);
+		std::vector< uint32_t > reordered; //triangles, in cluster order
+		reordered.reserve(triangles);
+		std::vector< uint32_t > cluster_sizes;
+
+		std::vector< uint32_t > frontier;
+		auto next_seed = order.begin();
+		while (reordered.size() < triangles) {
+			uint32_t size = 0;
+			glm::vec3 centroid_sum = glm::vec3(0.0f);
+			glm::vec3 normal_sum = glm::vec3(0.0f);
+			float radius = 0.0f;
+			frontier.clear();
+
+			auto add = [&](uint32_t t) {
+				used[t] = true;
+				reordered.emplace_back(t);
+				size += 1;
+				centroid_sum += centroids[t];
+				normal_sum += normals[t];
+				glm::vec3 center = centroid_sum / float(size);
+				radius = std::max(radius, glm::length(centroids[t] - center));
+				for (uint32_t i = 0; i < 3; ++i) {
+					for (uint32_t n : *triangle_corners[3 * t + i]) {
+						if (!used[n]) frontier.emplace_back(n);
+					}
+				}
+			};
+
+			while (used[*next_seed]) ++next_seed;
+			add(*next_seed);
+
+			while (size < ClusterTriangles) {
+				glm::vec3 center = centroid_sum / float(size);
+				float normal_len = glm::length(normal_sum);
+				glm::vec3 axis = (normal_len > 0.0f ? normal_sum / normal_len : glm::vec3(0.0f));
+
+				//pick the best unused triangle from the frontier (compacting away used ones as we go):
+				uint32_t best = -1U;
+				float best_score = std::numeric_limits< float >::infinity();
+				uint32_t kept = 0;
+				for (uint32_t i = 0; i < frontier.size(); ++i) {
+					uint32_t t = frontier[i];
+					if (used[t]) continue;
+					frontier[kept++] = t;
+					float score = glm::length(centroids[t] - center) / (radius + 1e-6f)
+					            + 2.0f * (1.0f - glm::dot(normals[t], axis));
+					if (score < best_score) {
+						best_score = score;
+						best = t;
+					}
+				}
+				frontier.resize(kept);
+
+				if (best == -1U) {
+					//no connected triangles left; continue with the next triangle in morton order:
+					while (next_seed != order.end() && used[*next_seed]) ++next_seed;
+					if (next_seed == order.end()) break;
+					best = *next_seed;
+				}
+				add(best);
+			}
+			cluster_sizes.emplace_back(size);
+		}
+		assert(reordered.size() == triangles);
+
+		//write back reordered vertices:
+		{
+			std::vector< Vertex > old(vertices.begin() + entry.vertex_begin, vertices.begin() + entry.vertex_end);
+			for (uint32_t i = 0; i < triangles; ++i) {
+				for (uint32_t c = 0; c < 3; ++c) {
+					vertices[entry.vertex_begin + 3 * i + c] = old[3 * reordered[i] + c];
+				}
+			}
+		}
+
+		//record clusters:
+		uint32_t begin = entry.vertex_begin;
+		uint32_t cones = 0;
+		for (uint32_t size : cluster_sizes) {
+			ClusterEntry cluster;
+			cluster.mesh = m;
+			cluster.vertex_begin = begin;
+			cluster.vertex_end = begin + 3 * size;
+			compute_cluster_bounds(vertices, &cluster);
+			if (cluster.cone_cutoff < 1.0f) cones += 1;
+			mesh_file.clusters.emplace_back(cluster);
+			begin = cluster.vertex_end;
+		}
+		assert(begin == entry.vertex_end);
+		total_cones += cones;
+
+		std::cout << "  '" << mesh_file.name(entry) << "': " << triangles << " triangles -> " << cluster_sizes.size() << " clusters"
+			<< " (" << float(triangles) / float(cluster_sizes.size()) << " triangles each, " << cones << " with usable normal cones)\n";
+	}
+
+	std::cout << "Total: " << mesh_file.clusters.size() << " clusters, " << total_cones << " with usable normal cones." << std::endl;
+}
+
+//------------ simplification ------------
+
+//quadric error metric, as in "Surface Simplification Using Quadric Error Metrics" [Garland and Heckbert 1997]:
+// error(p) = sum of weighted squared distances from p to a set of planes
+struct Quadric {
+	double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+	double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+	double c = 0.0;
+	double weight = 0.0; //sum of plane weights
+
+	//plane dot(normal, p) + d = 0, with 'normal' unit length:
+	static Quadric plane(glm::vec3 const &normal, float d, double weight) {
+		Quadric q;
+		q.a00 = weight * normal.x * normal.x;
+		q.a01 = weight * normal.x * normal.y;
+		q.a02 = weight * normal.x * normal.z;
+		q.a11 = weight * normal.y * normal.y;
+		q.a12 = weight * normal.y * normal.z;
+		q.a22 = weight * normal.z * normal.z;
+		q.b0 = weight * normal.x * d;
+		q.b1 = weight * normal.y * d;
+		q.b2 = weight * normal.z * d;
+		q.c = weight * d * d;
+		q.weight = weight;
+		return q;
+	}
+
+	Quadric &operator+=(Quadric const &o) {
+		a00 += o.a00; a01 += o.a01; a02 += o.a02; a11 += o.a11; a12 += o.a12; a22 += o.a22;
+		b0 += o.b0; b1 += o.b1; b2 += o.b2;
+		c += o.c;
+		weight += o.weight;
+		return *this;
+	}
+
+	double error(glm::vec3 const &p) const {
+		double x = p.x, y = p.y, z = p.z;
+		double e = a00 * x * x + a11 * y * y + a22 * z * z
+		         + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+		         + 2.0 * (b0 * x + b1 * y + b2 * z)
+		         + c;
+		return std::max(e, 0.0);
+	}
+
+	//(weighted) root-mean-square distance from p to the planes:
+	float distance(glm::vec3 const &p) const {
+		return (weight > 0.0 ? float(std::sqrt(error(p) / weight)) : 0.0f);
+	}
+};
+
+//distance from point p to triangle abc (closest point as in "Real-Time Collision Detection" [Ericson 2005], 5.1.5):
+static float point_triangle_distance(glm::vec3 const &p, glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c) {
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return glm::length(p - a);
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return glm::length(p - b);
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return glm::length(p - (a + (d1 / (d1 - d3)) * ab));
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return glm::length(p - c);
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return glm::length(p - (a + (d2 / (d2 - d6)) * ac));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return glm::length(p - (b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b)));
+
+	float denom = va + vb + vc;
+	if (!(denom > 0.0f)) return glm::length(p - a); //degenerate triangle
+	return glm::length(p - (a + ab * (vb / denom) + ac * (vc / denom)));
+}
+
+//simplify every mesh into (up to) 'levels' coarser levels, each with about half the triangles of the previous one:
+// level k only does collapses that move the surface less than 2^k / 64 of the mesh's diagonal, so may stop early.
+// simplification is by half-edge collapses (so every level uses a subset of the original vertices),
+// and vertices on uv/normal/color seams only collapse along those seams.
+static void make_lods(MeshFile *mesh_file_, uint32_t levels) {
+	assert(mesh_file_);
+	auto &mesh_file = *mesh_file_;
+
+	mesh_file.lods.clear();
+	std::vector< Vertex > lod_vertices; //appended to mesh_file.vertices at the end
+
+	std::cout << "Simplifying " << mesh_file.index.size() << " meshes into (up to) " << levels << " levels:\n";
+	std::cout << "  (error is max distance from original vertices to simplified surface; relative error is vs. bounding box diagonal)\n";
+
+	for (uint32_t m = 0; m < mesh_file.index.size(); ++m) {
+		IndexEntry const &entry = mesh_file.index[m];
+		uint32_t count = entry.vertex_end - entry.vertex_begin;
+		if (count % 3 != 0) {
+			std::cerr << "WARNING: '" << mesh_file.name(entry) << "' is not a triangle list; not simplifying it." << std::endl;
+			continue;
+		}
+		uint32_t triangles = count / 3;
+		if (triangles == 0) continue;
+
+		//weld identical vertices:
+		std::vector< Vertex > unique;
+		std::vector< uint32_t > current(count); //live triangles, as indices into 'unique'
+		{
+			std::map< std::array< uint32_t, sizeof(Vertex) / 4 >, uint32_t > welded;
+			for (uint32_t i = 0; i < count; ++i) {
+				Vertex const &vertex = mesh_file.vertices[entry.vertex_begin + i];
+				std::array< uint32_t, sizeof(Vertex) / 4 > key;
+				std::memcpy(key.data(), &vertex, sizeof(Vertex));
+				auto ret = welded.emplace(key, uint32_t(unique.size()));
+				if (ret.second) unique.emplace_back(vertex);
+				current[i] = ret.first->second;
+			}
+		}
+
+		//group vertices by position (vertices at seams share a position but not other attributes):
+		std::vector< uint32_t > group_of(unique.size());
+		std::vector< glm::vec3 > positions;
+		{
+			std::map< std::array< float, 3 >, uint32_t > grouped;
+			for (uint32_t v = 0; v < unique.size(); ++v) {
+				glm::vec3 const &p = unique[v].Position;
+				auto ret = grouped.emplace(std::array< float, 3 >{p.x, p.y, p.z}, uint32_t(positions.size()));
+				if (ret.second) positions.emplace_back(p);
+				group_of[v] = ret.first->second;
+			}
+		}
+		uint32_t groups = uint32_t(positions.size());
+
+		glm::vec3 min = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 max = glm::vec3(-std::numeric_limits< float >::infinity());
+		for (auto const &p : positions) {
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+		float diagonal = glm::length(max - min);
+
+		//quadrics from triangle planes (area-weighted):
+		std::vector< Quadric > quadrics(groups);
+		for (uint32_t t = 0; t < triangles; ++t) {
+			glm::vec3 const &a = positions[group_of[current[3*t+0]]];
+			glm::vec3 const &b = positions[group_of[current[3*t+1]]];
+			glm::vec3 const &c = positions[group_of[current[3*t+2]]];
+			glm::vec3 n = glm::cross(b - a, c - a);
+			float len = glm::length(n);
+			if (!(len > 0.0f)) continue;
+			n /= len;
+			Quadric q = Quadric::plane(n, -glm::dot(n, a), 0.5 * len);
+			for (uint32_t i = 0; i < 3; ++i) {
+				quadrics[group_of[current[3*t+i]]] += q;
+			}
+		}
+
+		//..plus perpendicular planes along border and seam edges, to keep them in place:
+		{
+			struct EdgeInfo {
+				uint32_t uses = 0;
+				uint32_t lo = 0, hi = 0; //vertices at lower and higher group (from first use)
+				bool seam = false;
+				glm::vec3 normal = glm::vec3(0.0f); //(of first use)
+			};
+			std::map< std::pair< uint32_t, uint32_t >, EdgeInfo > edges;
+			for (uint32_t t = 0; t < triangles; ++t) {
+				glm::vec3 const &a = positions[group_of[current[3*t+0]]];
+				glm::vec3 n = glm::cross(positions[group_of[current[3*t+1]]] - a, positions[group_of[current[3*t+2]]] - a);
+				for (uint32_t i = 0; i < 3; ++i) {
+					uint32_t va = current[3*t+i];
+					uint32_t vb = current[3*t+(i+1)%3];
+					if (group_of[va] > group_of[vb]) std::swap(va, vb);
+					if (group_of[va] == group_of[vb]) continue;
+					EdgeInfo &info = edges[std::make_pair(group_of[va], group_of[vb])];
+					if (info.uses == 0) {
+						info.lo = va;
+						info.hi = vb;
+						info.normal = n;
+					} else if (info.lo != va || info.hi != vb) {
+						info.seam = true;
+					}
+					info.uses += 1;
+				}
+			}
+			for (auto const &[key, info] : edges) {
+				if (info.uses != 1 && !info.seam) continue;
+				glm::vec3 const &a = positions[key.first];
+				glm::vec3 const &b = positions[key.second];
+				glm::vec3 n = glm::cross(b - a, info.normal);
+				float len = glm::length(n);
+				if (!(len > 0.0f)) continue;
+				n /= len;
+				Quadric q = Quadric::plane(n, -glm::dot(n, a), 10.0 * glm::dot(b - a, b - a));
+				quadrics[key.first] += q;
+				quadrics[key.second] += q;
+			}
+		}
+
+		//(for measuring error) group each original group was collapsed into:
+		std::vector< uint32_t > collapsed_into(groups);
+		for (uint32_t g = 0; g < groups; ++g) collapsed_into[g] = g;
+		auto find_group = [&](uint32_t g) {
+			while (collapsed_into[g] != g) {
+				collapsed_into[g] = collapsed_into[collapsed_into[g]];
+				g = collapsed_into[g];
+			}
+			return g;
+		};
+
+		//triangles around each group (rebuilt from 'current' as needed):
+		std::vector< uint32_t > around_begin;
+		std::vector< uint32_t > around;
+		auto build_around = [&]() {
+			around_begin.assign(groups + 1, 0);
+			for (uint32_t v : current) around_begin[group_of[v] + 1] += 1;
+			for (uint32_t g = 0; g < groups; ++g) around_begin[g + 1] += around_begin[g];
+			around.assign(current.size(), 0);
+			std::vector< uint32_t > fill(around_begin.begin(), around_begin.end() - 1);
+			for (uint32_t i = 0; i < current.size(); ++i) {
+				around[fill[group_of[current[i]]]++] = i / 3;
+			}
+		};
+
+		//check if group 'from' can collapse into group 'to'; fills 'mapping' with (from vertex, to vertex) pairs:
+		std::vector< std::pair< uint32_t, uint32_t > > mapping;
+		auto can_collapse = [&](uint32_t from, uint32_t to) -> bool {
+			mapping.clear();
+			//every vertex at 'from' must share a triangle with exactly one vertex at 'to' (this keeps seams intact):
+			for (uint32_t i = around_begin[from]; i < around_begin[from + 1]; ++i) {
+				uint32_t t = around[i];
+				uint32_t a = -1U, b = -1U;
+				for (uint32_t k = 0; k < 3; ++k) {
+					if (group_of[current[3*t+k]] == from) a = current[3*t+k];
+					if (group_of[current[3*t+k]] == to) b = current[3*t+k];
+				}
+				if (b == -1U) continue;
+				auto f = std::find_if(mapping.begin(), mapping.end(), [a](auto const &p) { return p.first == a; });
+				if (f == mapping.end()) mapping.emplace_back(a, b);
+				else if (f->second != b) return false;
+			}
+			for (uint32_t i = around_begin[from]; i < around_begin[from + 1]; ++i) {
+				uint32_t t = around[i];
+				bool has_to = false;
+				uint32_t a = -1U;
+				for (uint32_t k = 0; k < 3; ++k) {
+					if (group_of[current[3*t+k]] == from) a = current[3*t+k];
+					if (group_of[current[3*t+k]] == to) has_to = true;
+				}
+				if (std::find_if(mapping.begin(), mapping.end(), [a](auto const &p) { return p.first == a; }) == mapping.end()) return false;
+				if (has_to) continue;
+				//remaining triangles must not flip (or get much steeper):
+				glm::vec3 p[3], q[3];
+				for (uint32_t k = 0; k < 3; ++k) {
+					uint32_t g = group_of[current[3*t+k]];
+					p[k] = positions[g];
+					q[k] = (g == from ? positions[to] : positions[g]);
+				}
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+				if (glm::dot(before, after) < 0.25f * glm::length(before) * glm::length(after)) return false;
+			}
+			return true;
+		};
+
+		//one pass of (non-overlapping) collapses, cheapest first; returns number of triangles removed:
+		auto simplify_pass = [&](uint32_t target, float max_distance) -> uint32_t {
+			build_around();
+			uint32_t live = uint32_t(current.size() / 3);
+
+			struct Collapse {
+				uint32_t from, to;
+				double cost;
+			};
+			std::vector< Collapse > collapses;
+			std::vector< uint32_t > neighbors;
+			std::vector< Collapse > options;
+			for (uint32_t g = 0; g < groups; ++g) {
+				if (around_begin[g] == around_begin[g + 1]) continue;
+				neighbors.clear();
+				for (uint32_t i = around_begin[g]; i < around_begin[g + 1]; ++i) {
+					for (uint32_t k = 0; k < 3; ++k) {
+						uint32_t n = group_of[current[3*around[i]+k]];
+						if (n != g) neighbors.emplace_back(n);
+					}
+				}
+				std::sort(neighbors.begin(), neighbors.end());
+				neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+
+				options.clear();
+				for (uint32_t n : neighbors) {
+					Quadric q = quadrics[g];
+					q += quadrics[n];
+					if (q.distance(positions[n]) > max_distance) continue;
+					options.emplace_back(Collapse{g, n, q.error(positions[n])});
+				}
+				std::sort(options.begin(), options.end(), [](Collapse const &a, Collapse const &b) { return a.cost < b.cost; });
+				for (auto const &option : options) {
+					if (can_collapse(option.from, option.to)) {
+						collapses.emplace_back(option);
+						break;
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](Collapse const &a, Collapse const &b) { return a.cost < b.cost; });
+
+			//do (up to) the cheaper half of the collapses, skipping any that touch already-changed triangles:
+			std::vector< bool > locked(groups, false);
+			uint32_t removed = 0;
+			size_t limit = std::max< size_t >(1, (collapses.size() + 1) / 2);
+			for (size_t c = 0; c < collapses.size() && c < limit && live - removed > target; ++c) {
+				Collapse const &collapse = collapses[c];
+				if (locked[collapse.from] || locked[collapse.to]) continue;
+				if (!can_collapse(collapse.from, collapse.to)) continue;
+
+				for (uint32_t i = around_begin[collapse.from]; i < around_begin[collapse.from + 1]; ++i) {
+					uint32_t t = around[i];
+					bool degenerate = false;
+					for (uint32_t k = 0; k < 3; ++k) {
+						uint32_t &v = current[3*t+k];
+						locked[group_of[v]] = true;
+						if (group_of[v] == collapse.from) {
+							v = std::find_if(mapping.begin(), mapping.end(), [v](auto const &p) { return p.first == v; })->second;
+						} else if (group_of[v] == collapse.to) {
+							degenerate = true;
+						}
+					}
+					if (degenerate) removed += 1;
+				}
+				locked[collapse.from] = true;
+				locked[collapse.to] = true;
+				quadrics[collapse.to] += quadrics[collapse.from];
+				collapsed_into[collapse.from] = collapse.to;
+			}
+
+			//remove triangles that collapsed:
+			uint32_t kept = 0;
+			for (uint32_t t = 0; t < live; ++t) {
+				uint32_t g0 = group_of[current[3*t+0]], g1 = group_of[current[3*t+1]], g2 = group_of[current[3*t+2]];
+				if (g0 == g1 || g1 == g2 || g2 == g0) continue;
+				for (uint32_t k = 0; k < 3; ++k) current[3*kept+k] = current[3*t+k];
+				kept += 1;
+			}
+			current.resize(3 * kept);
+			return live - kept;
+		};
+
+		//max distance from original vertices to the current surface:
+		// (a one-sided estimate; cheap because each original vertex only checks triangles around where it collapsed to)
+		auto measure_error = [&]() -> float {
+			build_around();
+			float error = 0.0f;
+			for (uint32_t g = 0; g < groups; ++g) {
+				uint32_t r = find_group(g);
+				float dist = glm::length(positions[g] - positions[r]);
+				for (uint32_t i = around_begin[r]; i < around_begin[r + 1]; ++i) {
+					uint32_t t = around[i];
+					dist = std::min(dist, point_triangle_distance(positions[g],
+						positions[group_of[current[3*t+0]]],
+						positions[group_of[current[3*t+1]]],
+						positions[group_of[current[3*t+2]]]
+					));
+				}
+				error = std::max(error, dist);
+			}
+			return error;
+		};
+
+		std::cout << "  '" << mesh_file.name(entry) << "': " << triangles << " triangles";
+		uint32_t previous = triangles;
+		for (uint32_t level = 1; level <= levels; ++level) {
+			uint32_t target = triangles >> level;
+			float max_distance = diagonal * float(1u << level) / 64.0f;
+			while (current.size() / 3 > target) {
+				if (simplify_pass(target, max_distance) == 0) break;
+			}
+			uint32_t live = uint32_t(current.size() / 3);
+			//stop once simplification stalls:
+			if (live == 0 || live > previous - previous / 10) break;
+
+			LODEntry lod;
+			lod.mesh = m;
+			lod.vertex_begin = uint32_t(mesh_file.vertices.size() + lod_vertices.size());
+			for (uint32_t v : current) {
+				lod_vertices.emplace_back(unique[v]);
+			}
+			lod.vertex_end = uint32_t(mesh_file.vertices.size() + lod_vertices.size());
+			lod.error = measure_error();
+			mesh_file.lods.emplace_back(lod);
+
+			std::cout << "; [" << level << "] " << live << " (" << 100.0f * float(live) / float(triangles) << "%)"
+				<< " error " << lod.error << " (" << (diagonal > 0.0f ? lod.error / diagonal : 0.0f) << ")";
+			previous = live;
+		}
+		std::cout << "\n";
+	}
+
+	mesh_file.vertices.insert(mesh_file.vertices.end(), lod_vertices.begin(), lod_vertices.end());
+
+	std::cout << "Total: " << mesh_file.lods.size() << " levels, " << lod_vertices.size() << " extra vertices." << std::endl;
+}
+
+//------------ metadata ------------
+
+//FNV-1a (must match MeshBuffer's hash_vertex_data):
+static uint64_t hash_bytes(void const *data, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ reinterpret_cast< uint8_t const * >(data)[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+//bounds and hash of every mesh, as read by MeshBuffer:
+// 'stored' and 'stride' are the vertex data as written to the file (float or quantized)
+static std::vector< MetaEntry > make_metadata(MeshFile const &mesh_file, void const *stored, size_t stride) {
+	std::vector< MetaEntry > metadata;
+	metadata.reserve(mesh_file.index.size());
+	for (IndexEntry const &entry : mesh_file.index) {
+		MetaEntry meta;
+		meta.min = glm::vec3( std::numeric_limits< float >::infinity());
+		meta.max = glm::vec3(-std::numeric_limits< float >::infinity());
+		for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+			meta.min = glm::min(meta.min, mesh_file.vertices[v].Position);
+			meta.max = glm::max(meta.max, mesh_file.vertices[v].Position);
+		}
+		//sphere around box center (usually much tighter than the box's corners):
+		meta.center = 0.5f * (meta.min + meta.max);
+		meta.radius = 0.0f;
+		for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+			meta.radius = std::max(meta.radius, glm::length(mesh_file.vertices[v].Position - meta.center));
+		}
+		if (entry.vertex_begin == entry.vertex_end) {
+			meta.center = glm::vec3(0.0f);
+			meta.radius = -1.0f;
+		}
+		meta.vertex_count = entry.vertex_end - entry.vertex_begin;
+		meta.triangle_count = meta.vertex_count / 3;
+		meta.hash = hash_bytes(reinterpret_cast< uint8_t const * >(stored) + entry.vertex_begin * stride, meta.vertex_count * stride);
+		metadata.emplace_back(meta);
+	}
+	return metadata;
+}
+
+//------------ main ------------
+
+int main(int argc, char **argv) {
+	bool usage = false;
+	bool do_quantize = false;
+	bool do_clusters = false;
+	uint32_t lod_levels = 0;
+	std::string in_file;
+	std::string out_file;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--quantize") {
+			do_quantize = true;
+		} else if (arg == "--clusters") {
+			do_clusters = true;
+		} else if (arg == "--lods" && argi + 1 < argc) {
+			argi += 1;
+			lod_levels = uint32_t(std::max(0, std::atoi(argv[argi])));
+		} else if (arg.size() >= 2 && arg.substr(0,2) == "--") {
+			std::cerr << "Unknown option '" << arg << "'." << std::endl;
+			usage = true;
+		} else if (in_file == "") {
+			in_file = arg;
+		} else if (out_file == "") {
+			out_file = arg;
+		} else {
+			usage = true;
+		}
+	}
+	if (in_file == "" || out_file == "") usage = true;
+
+	if (usage) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--clusters] [--lods N] [--quantize] <in.pnct> <out.pnct>" << std::endl;
+		return 1;
+	}
+
+	try {
+		MeshFile mesh_file = read_mesh_file(in_file);
+		std::cout << "Read " << mesh_file.index.size() << " meshes (" << mesh_file.vertices.size() << " vertices) from '" << in_file << "'." << std::endl;
+
+		if (do_clusters) {
+			cluster_meshes(&mesh_file);
+		}
+		if (lod_levels > 0) {
+			make_lods(&mesh_file, lod_levels);
+		}
+
+		std::ofstream out(out_file, std::ios::binary);
+		if (!out) throw std::runtime_error("Failed to open '" + out_file + "' for writing.");
+
+		if (do_quantize) {
+			std::vector< QuantizedVertex > quantized;
+			std::vector< BoxEntry > boxes;
+			quantize(mesh_file, &quantized, &boxes);
+
+			write_chunk("pnq0", quantized, &out);
+			write_chunk("str0", mesh_file.strings, &out);
+			write_chunk("idx0", mesh_file.index, &out);
+			write_chunk("box0", boxes, &out);
+			write_chunk("met0", make_metadata(mesh_file, quantized.data(), sizeof(QuantizedVertex)), &out);
+		} else {
+			write_chunk("pnct", mesh_file.vertices, &out);
+			write_chunk("str0", mesh_file.strings, &out);
+			write_chunk("idx0", mesh_file.index, &out);
+			write_chunk("met0", make_metadata(mesh_file, mesh_file.vertices.data(), sizeof(Vertex)), &out);
+		}
+		if (!mesh_file.clusters.empty()) {
+			write_chunk("cls0", mesh_file.clusters, &out);
+		}
+		if (!mesh_file.lods.empty()) {
+			write_chunk("lod0", mesh_file.lods, &out);
+		}
+
+		std::cout << "Wrote " << out.tellp() << " bytes to '" << out_file << "'." << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -5,6 +5,11 @@
 #include <stdexcept>
 #include <iostream>
 
+//(compute shaders are newer than the OpenGL 3.3 core in GL.hpp)
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+
 static GLuint gl_compile_shader(GLenum type, std::string const &source, std::string const &DEBUG_name) {
 	GLuint shader = glCreateShader(type);
 	GLchar const *str = source.c_str();
@@ -27,6 +32,23 @@ static GLuint gl_compile_shader(GLenum type, std::string const &source, std::str
 	return shader;
 }
 
+//link the shader program and throw errors if linking fails:
+static void link_program(GLuint program) {
+	glLinkProgram(program);
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE) {
+		std::cerr << "Failed to link shader program." << std::endl;
+		GLint info_log_length = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
+		std::vector< GLchar > info_log(info_log_length, 0);
+		GLsizei length = 0;
+		glGetProgramInfoLog(program, GLint(info_log.size()), &length, &info_log[0]);
+		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
+		throw std::runtime_error("failed to link program");
+	}
+}
+
 GLuint gl_compile_program(
 	std::string const &vertex_shader_source,
 	std::string const &fragment_shader_source,
@@ -44,20 +66,23 @@ GLuint gl_compile_program(
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
 
-	//link the shader program and throw errors if linking fails:
-	glLinkProgram(program);
-	GLint link_status = GL_FALSE;
-	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
-	if (link_status != GL_TRUE) {
-		std::cerr << "Failed to link shader program." << std::endl;
-		GLint info_log_length = 0;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
-		std::vector< GLchar > info_log(info_log_length, 0);
-		GLsizei length = 0;
-		glGetProgramInfoLog(program, GLint(info_log.size()), &length, &info_log[0]);
-		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-		throw std::runtime_error("failed to link program");
-	}
+	link_program(program);
+
+	return program;
+}
+
+GLuint gl_compile_compute_program(
+	std::string const &compute_shader_source,
+	std::string const &DEBUG_program_name
+	) {
+
+	GLuint compute_shader = gl_compile_shader(GL_COMPUTE_SHADER, compute_shader_source, DEBUG_program_name + ".compute");
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, compute_shader);
+	glDeleteShader(compute_shader);
+
+	link_program(program);
 
 	return program;
 }
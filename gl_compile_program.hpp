@@ -11,3 +11,10 @@ GLuint gl_compile_program(
 	std::string const &fragment_shader_source,
 	std::string const &DEBUG_program_name //program name, used for debug messages
 );
+
+//compiles+links an OpenGL compute shader program from source.
+// (needs OpenGL 4.3 or OpenGL ES 3.1; throws on compilation error)
+GLuint gl_compile_compute_program(
+	std::string const &compute_shader_source,
+	std::string const &DEBUG_program_name //program name, used for debug messages
+);
@@ -0,0 +1,196 @@
+//load-bench: times Scene::load() of a large generated scene file, with per-entry and batched drawable callbacks
+//
+// Usage:
+//   load-bench [--entries N] [--meshes N] [--runs N] [--file path]
+//
+//  --entries N  transforms in the scene, each with a mesh entry (default 100000), in chains of eight
+//  --meshes N   distinct mesh names referenced by the entries (default 1000)
+//  --runs N     loads to time for each callback (default 5)
+//  --file path  where to write the generated scene (default 'load-bench.scene'; removed afterward)
+//
+// Reports the best and average time of loading the scene:
+//  - with no callback (transforms only)
+//  - with a per-entry callback, which looks up each mesh name and makes a drawable
+//  - with a batched callback, which looks up all mesh names with parallel_for and then makes drawables
+//  Mesh names are looked up in a hash table of stand-in meshes, so no OpenGL context is needed.
+
+#include "Scene.hpp"
+#include "Mesh.hpp"
+#include "parallel_for.hpp"
+#include "read_write_chunk.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+int main(int argc, char **argv) {
+	bool usage = false;
+	uint32_t entry_count = 100000;
+	uint32_t mesh_count = 1000;
+	uint32_t runs = 5;
+	std::string file = "load-bench.scene";
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--entries" && argi + 1 < argc) {
+			argi += 1;
+			entry_count = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--meshes" && argi + 1 < argc) {
+			argi += 1;
+			mesh_count = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--runs" && argi + 1 < argc) {
+			argi += 1;
+			runs = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--file" && argi + 1 < argc) {
+			argi += 1;
+			file = argv[argi];
+		} else {
+			std::cerr << "Unknown option '" << arg << "'." << std::endl;
+			usage = true;
+		}
+	}
+	if (usage) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--entries N] [--meshes N] [--runs N] [--file path]" << std::endl;
+		return 1;
+	}
+
+	//stand-in meshes, looked up by name:
+	std::vector< std::string > mesh_names;
+	std::unordered_map< std::string_view, Mesh > lookup;
+	mesh_names.reserve(mesh_count);
+	for (uint32_t m = 0; m < mesh_count; ++m) {
+		mesh_names.emplace_back("Mesh." + std::to_string(m));
+	}
+	for (uint32_t m = 0; m < mesh_count; ++m) {
+		Mesh &mesh = lookup[mesh_names[m]];
+		mesh.start = m * 36;
+		mesh.count = 36;
+	}
+
+	{ //write the scene file (in the same format as export-scene.py, without baked world placement):
+		std::vector< char > names;
+		struct HierarchyEntry {
+			uint32_t parent;
+			uint32_t name_begin;
+			uint32_t name_end;
+			glm::vec3 position;
+			glm::quat rotation;
+			glm::vec3 scale;
+		};
+		static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
+		struct MeshEntry {
+			uint32_t transform;
+			uint32_t name_begin;
+			uint32_t name_end;
+		};
+		static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
+
+		std::vector< std::pair< uint32_t, uint32_t > > mesh_name_ranges;
+		for (std::string const &name : mesh_names) {
+			mesh_name_ranges.emplace_back(uint32_t(names.size()), uint32_t(names.size() + name.size()));
+			names.insert(names.end(), name.begin(), name.end());
+		}
+
+		std::vector< HierarchyEntry > hierarchy;
+		std::vector< MeshEntry > meshes;
+		hierarchy.reserve(entry_count);
+		meshes.reserve(entry_count);
+		for (uint32_t i = 0; i < entry_count; ++i) {
+			std::string name = "Object." + std::to_string(i);
+			HierarchyEntry h;
+			h.parent = (i % 8 == 0 ? -1U : i - 1);
+			h.name_begin = uint32_t(names.size());
+			names.insert(names.end(), name.begin(), name.end());
+			h.name_end = uint32_t(names.size());
+			h.position = glm::vec3(float(i % 8), float((i / 8) % 256), float(i / 2048));
+			h.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+			h.scale = glm::vec3(1.0f);
+			hierarchy.emplace_back(h);
+
+			auto const &range = mesh_name_ranges[(i * 7919u) % mesh_count];
+			meshes.emplace_back(MeshEntry{i, range.first, range.second});
+		}
+
+		std::ofstream out(file, std::ios::binary);
+		write_chunk("str0", names, &out);
+		write_chunk("xfh0", hierarchy, &out);
+		write_chunk("msh0", meshes, &out);
+		write_chunk("cam0", std::vector< char >(), &out);
+		write_chunk("lmp0", std::vector< char >(), &out);
+		if (!out) {
+			std::cerr << "Failed to write '" << file << "'." << std::endl;
+			return 1;
+		}
+	}
+
+	auto make_drawable = [](Scene &scene, Scene::Transform *transform, Mesh const &mesh) -> Scene::Drawable & {
+		Scene::Drawable &drawable = scene.drawables.emplace_back(transform);
+		drawable.pipeline.type = mesh.type;
+		drawable.pipeline.start = mesh.start;
+		drawable.pipeline.count = mesh.count;
+		drawable.pipeline.position_to_object = mesh.position_to_object;
+		drawable.pipeline.mesh = &mesh;
+		return drawable;
+	};
+
+	auto time_loads = [&](std::string const &label, std::function< void(Scene &) > const &load) {
+		double total_ms = 0.0, best_ms = 0.0;
+		size_t drawable_count = 0;
+		for (uint32_t run = 0; run < runs; ++run) {
+			Scene scene;
+			auto before = std::chrono::high_resolution_clock::now();
+			load(scene);
+			auto after = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration< double, std::milli >(after - before).count();
+			total_ms += ms;
+			best_ms = (run == 0 ? ms : std::min(best_ms, ms));
+			drawable_count = scene.drawables.size();
+		}
+		std::cout << "  " << label << ": " << best_ms << " ms best, " << total_ms / runs << " ms average (" << drawable_count << " drawables)" << std::endl;
+	};
+
+	std::cout << "Loading " << entry_count << " entries referencing " << mesh_count << " meshes, " << runs << " times each ("
+		<< std::max(1u, std::thread::hardware_concurrency()) << " hardware threads):" << std::endl;
+
+	try {
+		time_loads("no callback", [&](Scene &scene) {
+			scene.load(file);
+		});
+		time_loads("per-entry callback", [&](Scene &scene) {
+			scene.load(file, [&](Scene &scene, Scene::Transform *transform, std::string_view mesh_name) {
+				make_drawable(scene, transform, lookup.at(mesh_name));
+			});
+		});
+		time_loads("batched callback", [&](Scene &scene) {
+			scene.load(file, [&](Scene &scene, std::vector< Scene::DrawableRequest > const &requests, std::vector< Scene::Drawable * > *made) {
+				std::vector< Mesh const * > found(requests.size(), nullptr);
+				parallel_for(uint32_t(requests.size()), [&](uint32_t begin, uint32_t end) {
+					for (uint32_t i = begin; i < end; ++i) {
+						found[i] = &lookup.at(requests[i].mesh_name);
+					}
+				});
+				for (uint32_t i = 0; i < requests.size(); ++i) {
+					(*made)[i] = &make_drawable(scene, requests[i].transform, *found[i]);
+				}
+			});
+		});
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		std::remove(file.c_str());
+		return 1;
+	}
+
+	std::remove(file.c_str());
+	return 0;
+}
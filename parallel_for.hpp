@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ * parallel_for(count, body) splits [0, count) into contiguous ranges and calls body(begin, end)
+ *  for each range -- one on the calling thread, and one on each of (up to) a thread per other hardware
+ *  thread, started for the call -- returning once all are done.
+ *
+ * Threads are started and joined by every call (there is no persistent pool), which costs tens of
+ *  microseconds, so only use it for work that takes well over that.
+ *
+ * Each index is in exactly one range, so a body that only writes the outputs of its own indices
+ *  (e.g., slots of a pre-sized vector) gives the same result regardless of thread count or timing.
+ *
+ * Small counts (under 'grain' per thread) are run on fewer threads -- or just the calling thread.
+ * If any call of body throws, the first exception is re-thrown on the calling thread.
+ *
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+template< typename F >
+void parallel_for(uint32_t count, F const &body, uint32_t grain = 1024) {
+	uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, std::max(1u, count / std::max(1u, grain)));
+	if (threads <= 1) {
+		if (count) body(0u, count);
+		return;
+	}
+
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	auto run = [&](uint32_t t) {
+		uint32_t begin = uint32_t(uint64_t(count) * t / threads);
+		uint32_t end = uint32_t(uint64_t(count) * (t + 1) / threads);
+		try {
+			body(begin, end);
+		} catch (...) {
+			std::unique_lock< std::mutex > lock(error_mutex);
+			if (!error) error = std::current_exception();
+		}
+	};
+
+	std::vector< std::thread > workers;
+	workers.reserve(threads - 1);
+	for (uint32_t t = 1; t < threads; ++t) workers.emplace_back(run, t);
+	run(0); //(calling thread takes the first range)
+	for (auto &worker : workers) worker.join();
+
+	if (error) std::rethrow_exception(error);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 #include <vector>
 #include <stdexcept>
 #include <cassert>
@@ -40,6 +41,20 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 	}
 }
 
+//helper function that returns the magic number of the next chunk without consuming it:
+// (returns an empty string if there is no next chunk)
+inline std::string peek_chunk_magic(std::istream &from) {
+	std::streampos at = from.tellg();
+	char magic[4] = {'\0', '\0', '\0', '\0'};
+	if (!from.read(magic, 4)) {
+		from.clear();
+		from.seekg(at);
+		return "";
+	}
+	from.seekg(at);
+	return std::string(magic, 4);
+}
+
 
 //helper function to write a chunk of data in the same format as read_chunk:
 template< typename T >
@@ -57,12 +57,41 @@ else:
 # msh0 len < uint uint uint > [hierarchy point + mesh name]
 # cam0 len < uint params > [heirarchy point + camera params]
 # lig0 len < uint params > [hierarchy point + light params]
+# xfw0 len < mat4x3 uint > [world matrix + flags (1: static, 2: occluder) of each hierarchy entry]
+# mbw0 len < vec3 vec3 > [world bounding box of each mesh entry]
+# (only if there are instanced collections:)
+# pfb0 len < uint uint uint uint > [prefab name + range of hierarchy entries]
+# ins0 len < uint uint > [hierarchy point + prefab index]
+# (only if objects are animated:)
+# anc0 len < uint uint float uint uint uint uint > [clip name + frame rate + frame count + range of tracks + first key]
+# ant0 len < uint > [hierarchy point of each track]
+# ank0 len < vec3 quat vec3 > [keys of each clip: for each frame, the local position, rotation, and scale of each track]
+#
+#Animation is sampled at every frame of the scene's frame range and split into clips at timeline markers
+# (each clip runs from its marker to the next, and is named after it); without markers, the whole range is one
+# clip named after the scene. Every clip has a track for each animated object (those with animation data or
+# drivers) that isn't in an instanced collection.
+#
+#Instanced collections ("prefabs") are written once each, after the rest of the scene, as a
+# contiguous range of hierarchy entries (whose roots have no parent); each instance is an
+# 'ins0' entry naming the transform the prefab's roots go under. (For entries in prefabs, the
+# world matrices and boxes in 'xfw0' and 'mbw0' are relative to the prefab's roots.)
+#
+#Objects are flagged static if named with a 'static:' prefix or given a custom property 'static'
+# (and so are their children).
+#
+#Objects are flagged as occluders (their meshes hide what is behind them when occlusion culling) if named
+# with an 'occluder:' prefix or given a custom property 'occluder' (their children are not).
 
 strings_data = b""
 xfh_data = b""
 mesh_data = b""
 camera_data = b""
 lamp_data = b""
+prefab_data = b""
+world_data = b""
+mesh_bounds_data = b""
+instance_data = b""
 
 #write_string will add a string to the strings section and return a packed (begin,end) reference:
 def write_string(string):
@@ -73,33 +102,43 @@ def write_string(string):
 	return struct.pack('II', begin, end)
 
 
-#keep map from tuples of objects to hierarchy ids:
-# (obj,) <-- object just in scene
-# (par,par,obj,) <-- object being visited through instanced collections; 'par,' entries are empties instancing it
+#keep map from (prefab, object) pairs to hierarchy ids:
+# (None,obj) <-- object just in scene
+# ('name',obj) <-- object in the instanced collection 'name'
 obj_to_xfh = dict()
 
-#maintain information about current instance stack:
-instance_parents = []
+#instanced collections, in the order they will be written (index is the prefab id):
+prefab_collections = []
+prefab_ids = dict()
+
+def prefab_id(coll):
+	if not coll.name in prefab_ids:
+		prefab_ids[coll.name] = len(prefab_collections)
+		prefab_collections.append(coll)
+	return prefab_ids[coll.name]
+
+#name of the collection currently being written as a prefab (None while writing the scene itself):
+current_prefab = None
 
 def parent_names():
-	names = "'->'".join(map(lambda x: x.name, instance_parents))
-	if names != '': names = "'" + names + "': "
-	return names
+	if current_prefab == None: return ""
+	return "'" + current_prefab + "': "
+
+#static-ness of objects (by (prefab, object), as in obj_to_xfh):
+obj_static = dict()
 
 #write_xfh will add an object [and its parents] to the hierarchy section and return a packed (idx) reference:
+# (and its world matrix and flags to the world section)
 def write_xfh(obj):
 	global xfh_data
-	par_obj = tuple(instance_parents + [obj])
+	global world_data
+	par_obj = (current_prefab, obj)
 	if par_obj in obj_to_xfh: return obj_to_xfh[par_obj]
 
 	if obj.parent == None:
-		if len(instance_parents) == 0:
-			parent_ref = struct.pack('i', -1)
-			world_to_parent = mathutils.Matrix()
-		else:
-			assert(tuple(instance_parents) in obj_to_xfh) #<-- NOTE: instance parent always written before being passed
-			parent_ref = obj_to_xfh[tuple(instance_parents)]
-			world_to_parent = mathutils.Matrix()
+		#(roots of prefabs are placed relative to their instances when loaded)
+		parent_ref = struct.pack('i', -1)
+		world_to_parent = mathutils.Matrix()
 	else:
 		parent_ref = write_xfh(obj.parent)
 		world_to_parent = obj.parent.matrix_world.copy()
@@ -117,6 +156,16 @@ def write_xfh(obj):
 	xfh_data += struct.pack('4f', transform[1].x, transform[1].y, transform[1].z, transform[1].w)
 	xfh_data += struct.pack('3f', transform[2].x, transform[2].y, transform[2].z)
 
+	is_static = obj.name.startswith('static:') or bool(obj.get('static', False))
+	if obj.parent != None and obj_static[(current_prefab, obj.parent)]: is_static = True
+	obj_static[par_obj] = is_static
+	is_occluder = obj.name.startswith('occluder:') or bool(obj.get('occluder', False))
+
+	m = obj.matrix_world
+	for c in range(0,4):
+		world_data += struct.pack('3f', m[0][c], m[1][c], m[2][c])
+	world_data += struct.pack('I', (1 if is_static else 0) | (2 if is_occluder else 0))
+
 	return ref
 
 #write_mesh will add an object to the mesh section:
@@ -125,6 +174,11 @@ def write_mesh(obj):
 	assert(obj.type == 'MESH')
 	mesh_data += write_xfh(obj) #hierarchy reference
 	mesh_data += write_string(obj.data.name) #mesh name
+
+	global mesh_bounds_data
+	corners = [obj.matrix_world @ mathutils.Vector(c) for c in obj.bound_box]
+	mesh_bounds_data += struct.pack('3f', *(min(c[i] for c in corners) for i in range(0,3)))
+	mesh_bounds_data += struct.pack('3f', *(max(c[i] for c in corners) for i in range(0,3)))
 	print("mesh: " + parent_names() + obj.name + " / " + obj.data.name)
 
 #write_camera will add an object to the camera section:
@@ -190,11 +244,11 @@ def write_light(obj):
 
 written = set()
 def write_objects(from_collection):
-	global instance_parents
+	global instance_data
 	global written
 	for obj in from_collection.objects:
-		if tuple(instance_parents + [obj]) in written: continue
-		written.add(tuple(instance_parents + [obj]))
+		if (current_prefab, obj) in written: continue
+		written.add((current_prefab, obj))
 		if obj.type == 'MESH':
 			write_mesh(obj)
 		elif obj.type == 'CAMERA':
@@ -202,10 +256,9 @@ def write_objects(from_collection):
 		elif obj.type == 'LIGHT':
 			write_light(obj)
 		elif obj.type == 'EMPTY' and obj.instance_collection:
-			write_xfh(obj)
-			instance_parents.append(obj)
-			write_objects(obj.instance_collection)
-			instance_parents.pop()
+			instance_data += write_xfh(obj) #hierarchy reference
+			instance_data += struct.pack('I', prefab_id(obj.instance_collection))
+			print("instance: " + parent_names() + obj.name + " / " + obj.instance_collection.name)
 		else:
 			print('Skipping ' + obj.type)
 	for child in from_collection.children:
@@ -213,6 +266,67 @@ def write_objects(from_collection):
 
 write_objects(collection)
 
+#write each instanced collection (including those instanced by other instanced collections) once:
+p = 0
+while p < len(prefab_collections):
+	current_prefab = prefab_collections[p].name
+	xfh_begin = len(obj_to_xfh)
+	write_objects(prefab_collections[p])
+	xfh_end = len(obj_to_xfh)
+	prefab_data += write_string(current_prefab)
+	prefab_data += struct.pack('II', xfh_begin, xfh_end)
+	print("prefab: '" + current_prefab + "' (" + str(xfh_end - xfh_begin) + " transforms)")
+	p += 1
+current_prefab = None
+
+#sample animated objects (only the scene's own; prefabs aren't animated) into clips:
+clip_data = b""
+track_data = b""
+key_data = b""
+
+animated = []
+for (prefab, obj), ref in obj_to_xfh.items():
+	if prefab != None: continue
+	if obj.animation_data == None: continue
+	ad = obj.animation_data
+	if ad.action == None and len(ad.nla_tracks) == 0 and len(ad.drivers) == 0: continue
+	animated.append((obj, ref))
+animated.sort(key=lambda a: struct.unpack('i', a[1])[0])
+
+if len(animated) > 0:
+	scene = bpy.context.scene
+	fps = scene.render.fps / scene.render.fps_base
+	markers = sorted(scene.timeline_markers, key=lambda m: m.frame)
+	ranges = []
+	for i in range(0, len(markers)):
+		end = markers[i+1].frame if i + 1 < len(markers) else scene.frame_end
+		if end > markers[i].frame: ranges.append((markers[i].name, markers[i].frame, end))
+	if len(ranges) == 0:
+		ranges.append((scene.name, scene.frame_start, scene.frame_end))
+
+	for (obj, ref) in animated:
+		track_data += ref
+
+	original_frame = scene.frame_current
+	for (name, begin, end) in ranges:
+		key_begin = len(key_data) // (4*10)
+		for frame in range(begin, end + 1):
+			scene.frame_set(frame)
+			for (obj, ref) in animated:
+				if obj.parent == None:
+					world_to_parent = mathutils.Matrix()
+				else:
+					world_to_parent = obj.parent.matrix_world.copy()
+					world_to_parent.invert()
+				transform = (world_to_parent @ obj.matrix_world).decompose()
+				key_data += struct.pack('3f', transform[0].x, transform[0].y, transform[0].z)
+				key_data += struct.pack('4f', transform[1].x, transform[1].y, transform[1].z, transform[1].w)
+				key_data += struct.pack('3f', transform[2].x, transform[2].y, transform[2].z)
+		clip_data += write_string(name)
+		clip_data += struct.pack('fIIII', fps, end + 1 - begin, 0, len(animated), key_begin)
+		print("clip: " + name + " (frames " + str(begin) + "-" + str(end) + " at " + str(fps) + " fps, " + str(len(animated)) + " tracks)")
+	scene.frame_set(original_frame)
+
 #write the strings chunk and scene chunk to an output blob:
 blob = open(outfile, 'wb')
 def write_chunk(magic, data):
@@ -225,6 +339,15 @@ write_chunk(b'xfh0', xfh_data)
 write_chunk(b'msh0', mesh_data)
 write_chunk(b'cam0', camera_data)
 write_chunk(b'lmp0', lamp_data)
+if len(prefab_collections) > 0:
+	write_chunk(b'pfb0', prefab_data)
+	write_chunk(b'ins0', instance_data)
+write_chunk(b'xfw0', world_data)
+write_chunk(b'mbw0', mesh_bounds_data)
+if len(animated) > 0:
+	write_chunk(b'anc0', clip_data)
+	write_chunk(b'ant0', track_data)
+	write_chunk(b'ank0', key_data)
 
 print("Wrote " + str(blob.tell()) + " bytes to '" + outfile + "'")
 blob.close()
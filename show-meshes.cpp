@@ -81,9 +81,15 @@ int main(int argc, char **argv) {
 	//------------ create game mode + make current --------------
 	bool usage = false;
 	MeshBuffer *buffer = nullptr;
-	if (argc == 2) {
+	int argi = 1;
+	if (argi < argc && std::string(argv[argi]) == "--verify") {
+		//check stored mesh metadata against vertex data while loading:
+		MeshBuffer::verify_metadata = true;
+		argi += 1;
+	}
+	if (argi + 1 == argc) {
 		try {
-			buffer = new MeshBuffer(argv[1]);
+			buffer = new MeshBuffer(argv[argi]);
 		} catch (std::exception &e) {
 			std::cerr << "ERROR: " << e.what() << std::endl;
 			usage = true;
@@ -97,7 +103,7 @@ int main(int argc, char **argv) {
 		usage = true;
 	}
 	if (usage) {
-		std::cerr << "Usage:\n\t" << argv[0] << " [path/to/meshes.pnct]" << std::endl;
+		std::cerr << "Usage:\n\t" << argv[0] << " [--verify] [path/to/meshes.pnct]" << std::endl;
 		return 1;
 	}
 
@@ -4,6 +4,9 @@
 #include "GL.hpp"
 #include "load_save_png.hpp"
 #include "ShowSceneProgram.hpp"
+#include "GPUCulling.hpp"
+#include "WorldStream.hpp"
+#include "parallel_for.hpp"
 
 #include <SDL.h>
 
@@ -12,6 +15,7 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <unordered_set>
 
 int main(int argc, char **argv) {
 #ifdef _WIN32
@@ -81,13 +85,41 @@ int main(int argc, char **argv) {
 
 	//------------ create game mode + make current --------------
 	bool usage = false;
+	bool occlusion = false;
+	bool gpu_culling = false;
+	bool batch_static = false;
+	bool instance_prefabs = false;
+	std::string stream_file;
 	std::string scene_file;
 	std::string meshes_file;
-	if (argc == 2) {
-		scene_file = argv[1];
-	} else if (argc == 3) {
-		scene_file = argv[1];
-		meshes_file = argv[2];
+	int argi = 1;
+	while (argi < argc) {
+		if (std::string(argv[argi]) == "--occlusion") {
+			//cull with an OcclusionBuffer, using the drawables the scene marks as occluders (see Scene::OccluderPrefix):
+			occlusion = true;
+		} else if (std::string(argv[argi]) == "--gpu-culling") {
+			//cull on the GPU with compute shaders, against the previous frame's depth (see GPUCulling.hpp):
+			gpu_culling = true;
+		} else if (std::string(argv[argi]) == "--batch-static") {
+			//merge drawables into world-space static batches after loading (see Scene::batch_static):
+			batch_static = true;
+		} else if (std::string(argv[argi]) == "--instance-prefabs") {
+			//load each instanced collection once and draw its instances as SceneInstances (see Scene::expand_prefabs):
+			instance_prefabs = true;
+		} else if (std::string(argv[argi]) == "--stream" && argi + 1 < argc) {
+			//stream cells made by 'cook-cells' in and out around the camera (see WorldStream.hpp):
+			argi += 1;
+			stream_file = argv[argi];
+		} else {
+			break;
+		}
+		argi += 1;
+	}
+	if (argi + 1 == argc) {
+		scene_file = argv[argi];
+	} else if (argi + 2 == argc) {
+		scene_file = argv[argi];
+		meshes_file = argv[argi + 1];
 	} else {
 		usage = true;
 	}
@@ -95,8 +127,23 @@ int main(int argc, char **argv) {
 	GLuint buffer_vao = 0;
 	if (meshes_file != "") {
 		try {
-			buffer = new MeshBuffer(meshes_file);
-			buffer_vao = buffer->make_vao_for_program(show_scene_program->program);
+			//only meshes drawn by occluders need occluder copies, so find them with a first pass over the scene (which makes no drawables):
+			std::unordered_set< std::string > occluder_names;
+			if (occlusion && scene_file != "") {
+				try {
+					Scene names_only;
+					names_only.expand_prefabs = !instance_prefabs;
+					names_only.load(scene_file, [&occluder_names](Scene &, std::vector< Scene::DrawableRequest > const &requests, std::vector< Scene::Drawable * > *) {
+						for (auto const &request : requests) {
+							if (request.occluder) occluder_names.emplace(request.mesh_name);
+						}
+					});
+				} catch (std::exception &) {
+					//(errors in the scene file are reported when it is loaded for real, below)
+				}
+			}
+			buffer = new MeshBuffer(meshes_file, (occlusion ? MeshBuffer::KeepOccluders : 0) | (batch_static ? MeshBuffer::KeepVertices : 0), &occluder_names);
+			buffer_vao = buffer->make_vao_for_program((buffer->quantized ? quantized_show_scene_program : show_scene_program)->program);
 		} catch (std::exception &e) {
 			std::cerr << "ERROR loading mesh buffer '" << meshes_file << "': " << e.what() << std::endl;
 			usage = true;
@@ -107,21 +154,42 @@ int main(int argc, char **argv) {
 	if (scene_file != "") {
 		try {
 			scene = new Scene();
-			scene->load(scene_file, [&buffer,&buffer_vao](Scene &scene, Scene::Transform *transform, std::string const &mesh_name){
+			scene->expand_prefabs = !instance_prefabs;
+			scene->load(scene_file, [&buffer,&buffer_vao](Scene &scene, std::vector< Scene::DrawableRequest > const &requests, std::vector< Scene::Drawable * > *made){
 				if (!buffer_vao) return;
-				Mesh const &mesh = buffer->lookup(mesh_name);
+				//look up meshes on several threads (scenes may have very many mesh references):
+				std::vector< Mesh const * > found(requests.size(), nullptr);
+				parallel_for(uint32_t(requests.size()), [&](uint32_t begin, uint32_t end) {
+					for (uint32_t i = begin; i < end; ++i) {
+						found[i] = &buffer->lookup(requests[i].mesh_name);
+					}
+				});
 
-				scene.drawables.emplace_back(transform);
-				Scene::Drawable &drawable = scene.drawables.back();
+				for (uint32_t i = 0; i < requests.size(); ++i) {
+					Mesh const &mesh = *found[i];
 
-				drawable.pipeline = show_scene_program_pipeline;
+					Scene::Drawable &drawable = scene.drawables.emplace_back(requests[i].transform);
+					(*made)[i] = &drawable;
 
-				drawable.pipeline.vao = buffer_vao;
-				drawable.pipeline.type = mesh.type;
-				drawable.pipeline.start = mesh.start;
-				drawable.pipeline.count = mesh.count;
+					drawable.pipeline = (buffer->quantized ? quantized_show_scene_program_pipeline : show_scene_program_pipeline);
 
+					drawable.pipeline.vao = buffer_vao;
+					drawable.pipeline.type = mesh.type;
+					drawable.pipeline.start = mesh.start;
+					drawable.pipeline.count = mesh.count;
+					drawable.pipeline.position_to_object = mesh.position_to_object;
+					drawable.pipeline.mesh = &mesh;
+					//(nothing moves in the viewer, so potentially visible sets apply to everything)
+					drawable.dynamic = false;
+				}
 			});
+			if (batch_static) {
+				size_t before = scene->drawables.size();
+				uint32_t batches = scene->batch_static();
+				std::cout << "Merged " << (before - (scene->drawables.size() - batches)) << " of " << before << " drawables into " << batches << " static batches." << std::endl;
+			}
+			if (occlusion) scene->occlusion = new OcclusionBuffer();
+			if (gpu_culling) scene->gpu_culling = new GPUCulling();
 		} catch (std::exception &e) {
 			std::cerr << "ERROR loading scene '" << scene_file << "': " << e.what() << std::endl;
 			usage = true;
@@ -131,8 +199,30 @@ int main(int argc, char **argv) {
 	if (!scene) {
 		usage = true;
 	}
+	WorldStream *stream = nullptr;
+	if (scene && stream_file != "") {
+		try {
+			stream = new WorldStream(stream_file, *scene, [](Scene &scene, Scene::Transform *transform, Mesh const &mesh, MeshBuffer const &layout) -> Scene::Drawable * {
+				Scene::Drawable &drawable = scene.drawables.emplace_back(transform);
+
+				drawable.pipeline = (layout.quantized ? quantized_show_scene_program_pipeline : show_scene_program_pipeline);
+
+				drawable.pipeline.vao = layout.make_vao_for_program((layout.quantized ? quantized_show_scene_program : show_scene_program)->program);
+				drawable.pipeline.type = mesh.type;
+				drawable.pipeline.start = mesh.start;
+				drawable.pipeline.count = mesh.count;
+				drawable.pipeline.position_to_object = mesh.position_to_object;
+				drawable.pipeline.mesh = &mesh;
+				return &drawable;
+			});
+			std::cout << "Streaming " << stream->cell_count() << " cells from '" << stream_file << "'." << std::endl;
+		} catch (std::exception &e) {
+			std::cerr << "ERROR loading cells '" << stream_file << "': " << e.what() << std::endl;
+			usage = true;
+		}
+	}
 	if (usage) {
-		std::cerr << "Usage:\n\t" << argv[0] << " <path/to/scene.scene> [path/to/meshes.pnct]" << std::endl;
+		std::cerr << "Usage:\n\t" << argv[0] << " [--occlusion] [--gpu-culling] [--batch-static] [--instance-prefabs] [--stream path/to/world.cells] <path/to/scene.scene> [path/to/meshes.pnct]" << std::endl;
 		return 1;
 	}
 	std::cout << "Showing scene from '" << scene_file << "' with";
@@ -141,7 +231,11 @@ int main(int argc, char **argv) {
 	} else {
 		std::cout << " no meshes -- consider passing a '.pnct' file as the second argument." << std::endl;
 	}
-	Mode::set_current(std::make_shared< ShowSceneMode >(*scene));
+	{
+		auto mode = std::make_shared< ShowSceneMode >(*scene);
+		mode->stream = stream;
+		Mode::set_current(mode);
+	}
 
 	//------------ main loop ------------
 
@@ -222,6 +316,10 @@ int main(int argc, char **argv) {
 
 
 	//------------  teardown ------------
+	//(stops the stream's loading thread and frees its vertices while there's still a context)
+	delete stream;
+	stream = nullptr;
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
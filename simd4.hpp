@@ -0,0 +1,97 @@
+#pragma once
+
+/*
+ * Four-wide float helpers for code that processes four things at once
+ *  (e.g., MeshBVH's box and triangle tests, OcclusionBuffer's rasterizer, AnimationPose's blending).
+ *
+ * F4 is four floats, M4 is four lane masks (from comparisons).
+ * Uses SSE2 on x86, NEON on ARM, and plain loops elsewhere.
+ *
+ * (functions are static inline, so this is meant to be included by .cpp files)
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+struct F4 { __m128 v; };
+struct M4 { __m128 v; };
+static inline F4 load4(float const *p) { return F4{_mm_loadu_ps(p)}; }
+static inline F4 splat(float f) { return F4{_mm_set1_ps(f)}; }
+static inline F4 operator+(F4 a, F4 b) { return F4{_mm_add_ps(a.v, b.v)}; }
+static inline F4 operator-(F4 a, F4 b) { return F4{_mm_sub_ps(a.v, b.v)}; }
+static inline F4 operator*(F4 a, F4 b) { return F4{_mm_mul_ps(a.v, b.v)}; }
+static inline F4 operator/(F4 a, F4 b) { return F4{_mm_div_ps(a.v, b.v)}; }
+static inline F4 sqrt4(F4 a) { return F4{_mm_sqrt_ps(a.v)}; }
+static inline F4 min4(F4 a, F4 b) { return F4{_mm_min_ps(a.v, b.v)}; }
+static inline F4 max4(F4 a, F4 b) { return F4{_mm_max_ps(a.v, b.v)}; }
+static inline M4 operator<(F4 a, F4 b) { return M4{_mm_cmplt_ps(a.v, b.v)}; }
+static inline M4 operator<=(F4 a, F4 b) { return M4{_mm_cmple_ps(a.v, b.v)}; }
+static inline M4 operator>(F4 a, F4 b) { return M4{_mm_cmpgt_ps(a.v, b.v)}; }
+static inline M4 operator>=(F4 a, F4 b) { return M4{_mm_cmpge_ps(a.v, b.v)}; }
+static inline M4 operator&(M4 a, M4 b) { return M4{_mm_and_ps(a.v, b.v)}; }
+static inline M4 operator|(M4 a, M4 b) { return M4{_mm_or_ps(a.v, b.v)}; }
+static inline uint32_t bits(M4 m) { return uint32_t(_mm_movemask_ps(m.v)); }
+static inline void store4(F4 a, float *p) { _mm_storeu_ps(p, a.v); }
+static inline F4 select4(M4 m, F4 a, F4 b) { return F4{_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))}; }
+
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+
+struct F4 { float32x4_t v; };
+struct M4 { uint32x4_t v; };
+static inline F4 load4(float const *p) { return F4{vld1q_f32(p)}; }
+static inline F4 splat(float f) { return F4{vdupq_n_f32(f)}; }
+static inline F4 operator+(F4 a, F4 b) { return F4{vaddq_f32(a.v, b.v)}; }
+static inline F4 operator-(F4 a, F4 b) { return F4{vsubq_f32(a.v, b.v)}; }
+static inline F4 operator*(F4 a, F4 b) { return F4{vmulq_f32(a.v, b.v)}; }
+static inline F4 operator/(F4 a, F4 b) { return F4{vdivq_f32(a.v, b.v)}; }
+static inline F4 sqrt4(F4 a) { return F4{vsqrtq_f32(a.v)}; }
+static inline F4 min4(F4 a, F4 b) { return F4{vminq_f32(a.v, b.v)}; }
+static inline F4 max4(F4 a, F4 b) { return F4{vmaxq_f32(a.v, b.v)}; }
+static inline M4 operator<(F4 a, F4 b) { return M4{vcltq_f32(a.v, b.v)}; }
+static inline M4 operator<=(F4 a, F4 b) { return M4{vcleq_f32(a.v, b.v)}; }
+static inline M4 operator>(F4 a, F4 b) { return M4{vcgtq_f32(a.v, b.v)}; }
+static inline M4 operator>=(F4 a, F4 b) { return M4{vcgeq_f32(a.v, b.v)}; }
+static inline M4 operator&(M4 a, M4 b) { return M4{vandq_u32(a.v, b.v)}; }
+static inline M4 operator|(M4 a, M4 b) { return M4{vorrq_u32(a.v, b.v)}; }
+static inline uint32_t bits(M4 m) {
+	static const uint32_t lane_bits[4] = {1, 2, 4, 8};
+	return vaddvq_u32(vandq_u32(m.v, vld1q_u32(lane_bits)));
+}
+static inline void store4(F4 a, float *p) { vst1q_f32(p, a.v); }
+static inline F4 select4(M4 m, F4 a, F4 b) { return F4{vbslq_f32(m.v, a.v, b.v)}; }
+
+#else
+//(plain loops; compilers will often vectorize these anyway)
+
+struct F4 { float v[4]; };
+struct M4 { uint32_t v; };
+#define LANES(EXPR) F4 r; for (uint32_t i = 0; i < 4; ++i) r.v[i] = (EXPR); return r;
+#define LANE_BITS(EXPR) M4 r{0}; for (uint32_t i = 0; i < 4; ++i) r.v |= uint32_t(EXPR) << i; return r;
+static inline F4 load4(float const *p) { LANES(p[i]) }
+static inline F4 splat(float f) { LANES(f) }
+static inline F4 operator+(F4 a, F4 b) { LANES(a.v[i] + b.v[i]) }
+static inline F4 operator-(F4 a, F4 b) { LANES(a.v[i] - b.v[i]) }
+static inline F4 operator*(F4 a, F4 b) { LANES(a.v[i] * b.v[i]) }
+static inline F4 operator/(F4 a, F4 b) { LANES(a.v[i] / b.v[i]) }
+static inline F4 sqrt4(F4 a) { LANES(std::sqrt(a.v[i])) }
+static inline F4 min4(F4 a, F4 b) { LANES(std::min(a.v[i], b.v[i])) }
+static inline F4 max4(F4 a, F4 b) { LANES(std::max(a.v[i], b.v[i])) }
+static inline M4 operator<(F4 a, F4 b) { LANE_BITS(a.v[i] < b.v[i]) }
+static inline M4 operator<=(F4 a, F4 b) { LANE_BITS(a.v[i] <= b.v[i]) }
+static inline M4 operator>(F4 a, F4 b) { LANE_BITS(a.v[i] > b.v[i]) }
+static inline M4 operator>=(F4 a, F4 b) { LANE_BITS(a.v[i] >= b.v[i]) }
+#undef LANES
+#undef LANE_BITS
+static inline M4 operator&(M4 a, M4 b) { return M4{a.v & b.v}; }
+static inline M4 operator|(M4 a, M4 b) { return M4{a.v | b.v}; }
+static inline uint32_t bits(M4 m) { return m.v; }
+static inline void store4(F4 a, float *p) { for (uint32_t i = 0; i < 4; ++i) p[i] = a.v[i]; }
+static inline F4 select4(M4 m, F4 a, F4 b) { F4 r; for (uint32_t i = 0; i < 4; ++i) r.v[i] = ((m.v >> i) & 1 ? a.v[i] : b.v[i]); return r; }
+
+#endif
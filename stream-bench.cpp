@@ -0,0 +1,164 @@
+//stream-bench: flies a path through a world cooked by 'cook-cells', streaming cells with WorldStream
+//
+// Usage:
+//   stream-bench [--path file] [--speed S] [--hz N] [--load R] [--evict R] [--upload B] [--memory B] <world.cells>
+//
+//  --path file  text file of "x y z" waypoints to fly through (default: a straight line corner-to-corner
+//                across the bounds of all cells, a little above their middle height)
+//  --speed S    flight speed, world units per second (default 8)
+//  --hz N       frames per second (default 72, as on Quest); each frame sleeps until the next is due,
+//                so the background thread has the time it would have in an app
+//  --load R, --evict R, --upload B, --memory B
+//               WorldStream::load_radius, evict_radius, upload_budget (bytes/frame), and memory_budget (bytes)
+//
+// Reports the average and worst time of WorldStream::update(), how many frames had cells within the load
+//  radius missing (i.e., that an app would show with holes), peak memory, load/eviction counts, and the
+//  slots and storage of the scene's transform and drawable pools at the end (which shouldn't grow with time).
+//
+// Does not need an OpenGL context (runs WorldStream in Headless mode).
+
+#include "WorldStream.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char **argv) {
+	bool usage = false;
+	std::string path_file;
+	std::string manifest;
+	float speed = 8.0f;
+	uint32_t hz = 72;
+	float load_radius = -1.0f, evict_radius = -1.0f;
+	double upload_budget = -1.0, memory_budget = -1.0;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--path" && argi + 1 < argc) {
+			argi += 1;
+			path_file = argv[argi];
+		} else if (arg == "--speed" && argi + 1 < argc) {
+			argi += 1;
+			speed = float(std::atof(argv[argi]));
+			if (!(speed > 0.0f)) usage = true;
+		} else if (arg == "--hz" && argi + 1 < argc) {
+			argi += 1;
+			hz = uint32_t(std::max(1, std::atoi(argv[argi])));
+		} else if (arg == "--load" && argi + 1 < argc) {
+			argi += 1;
+			load_radius = float(std::atof(argv[argi]));
+		} else if (arg == "--evict" && argi + 1 < argc) {
+			argi += 1;
+			evict_radius = float(std::atof(argv[argi]));
+		} else if (arg == "--upload" && argi + 1 < argc) {
+			argi += 1;
+			upload_budget = std::atof(argv[argi]);
+		} else if (arg == "--memory" && argi + 1 < argc) {
+			argi += 1;
+			memory_budget = std::atof(argv[argi]);
+		} else if (arg.size() >= 2 && arg.substr(0,2) == "--") {
+			std::cerr << "Unknown option '" << arg << "'." << std::endl;
+			usage = true;
+		} else if (manifest == "") {
+			manifest = arg;
+		} else {
+			usage = true;
+		}
+	}
+	if (manifest == "") usage = true;
+	if (usage) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [--path file] [--speed S] [--hz N] [--load R] [--evict R] [--upload B] [--memory B] <world.cells>" << std::endl;
+		return 1;
+	}
+
+	try {
+		Scene scene;
+		WorldStream stream(manifest, scene, nullptr, WorldStream::Headless);
+		if (load_radius >= 0.0f) stream.load_radius = load_radius;
+		if (evict_radius >= 0.0f) stream.evict_radius = evict_radius;
+		if (upload_budget >= 0.0) stream.upload_budget = size_t(upload_budget);
+		if (memory_budget >= 0.0) stream.memory_budget = size_t(memory_budget);
+		stream.evict_radius = std::max(stream.evict_radius, stream.load_radius);
+
+		std::vector< glm::vec3 > path;
+		if (path_file != "") {
+			std::ifstream file(path_file);
+			if (!file) throw std::runtime_error("Failed to open path '" + path_file + "'.");
+			glm::vec3 at;
+			while (file >> at.x >> at.y >> at.z) path.emplace_back(at);
+		} else {
+			float height = 0.5f * (stream.min.z + stream.max.z);
+			path.emplace_back(stream.min.x, stream.min.y, height);
+			path.emplace_back(stream.max.x, stream.max.y, height);
+		}
+		if (path.empty()) throw std::runtime_error("Path has no waypoints.");
+
+		std::cout << "Streaming " << stream.cell_count() << " cells from '" << manifest << "' along a " << path.size() << "-point path at "
+			<< speed << " units/s (" << hz << " Hz; load radius " << stream.load_radius << ", evict radius " << stream.evict_radius
+			<< ", " << stream.upload_budget << " bytes/frame upload, " << stream.memory_budget << " bytes memory)." << std::endl;
+
+		auto const frame_time = std::chrono::duration< double >(1.0 / hz);
+		auto next_frame = std::chrono::steady_clock::now();
+
+		double total_ms = 0.0, worst_ms = 0.0;
+		uint32_t frames = 0, missing_frames = 0;
+		size_t worst_upload = 0;
+
+		//fly each leg of the path:
+		glm::vec3 at = path[0];
+		size_t leg = 1;
+		while (true) {
+			//advance along the path by one frame's distance:
+			float step = speed / float(hz);
+			while (leg < path.size() && step > 0.0f) {
+				float left = glm::length(path[leg] - at);
+				if (left <= step) {
+					at = path[leg];
+					step -= left;
+					leg += 1;
+				} else {
+					at += (step / left) * (path[leg] - at);
+					step = 0.0f;
+				}
+			}
+
+			auto before = std::chrono::high_resolution_clock::now();
+			stream.update(at);
+			auto after = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration< double, std::milli >(after - before).count();
+			total_ms += ms;
+			worst_ms = std::max(worst_ms, ms);
+			worst_upload = std::max(worst_upload, stream.stats.uploaded_bytes);
+			frames += 1;
+			if (stream.stats.missing) missing_frames += 1;
+
+			//stop once the end is reached and everything around it has arrived:
+			if (leg >= path.size() && stream.stats.pending == 0) break;
+
+			next_frame += std::chrono::duration_cast< std::chrono::steady_clock::duration >(frame_time);
+			std::this_thread::sleep_until(next_frame);
+		}
+
+		WorldStream::Stats const &stats = stream.stats;
+		std::cout << "Over " << frames << " frames (" << double(frames) / hz << " s):\n"
+			<< "  update: " << total_ms / frames << " ms average, " << worst_ms << " ms worst\n"
+			<< "  " << missing_frames << " frames with cells in range missing\n"
+			<< "  " << stats.loads << " cells loaded, " << stats.evictions << " evicted, " << stats.failures << " failed; " << stats.resident << " resident at end\n"
+			<< "  " << stats.peak_bytes << " bytes (vertices and scene data) at peak; " << worst_upload << " bytes uploaded in the busiest frame\n"
+			<< "  " << scene.transforms.size() << " transforms and " << scene.drawables.size() << " drawables in the scene at end, in "
+			<< scene.transforms.slot_count() << " and " << scene.drawables.slot_count() << " slots ("
+			<< scene.transforms.storage_bytes() + scene.drawables.storage_bytes() << " bytes of pool storage)" << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}